@@ -6,6 +6,7 @@
 #include <command.h>
 #include <common.h>
 #include <cpu_func.h>
+#include <serial.h>
 
 __weak void reset_cpu(ulong addr)
 {
@@ -16,6 +17,8 @@ __weak void reset_cpu(ulong addr)
 int do_reset(cmd_tbl_t *cmdtp, int flag, int argc, char *const argv[])
 {
 	printf("Resetting the board...\n");
+	if (CONFIG_IS_ENABLED(SERIAL_TX_BUFFER))
+		serial_flush();
 
 	reset_cpu(0);
 
@@ -19,6 +19,7 @@
 #include <dm/root.h>
 #include <env.h>
 #include <image.h>
+#include <serial.h>
 #include <u-boot/zlib.h>
 #include <asm/byteorder.h>
 #include <linux/libfdt.h>
@@ -107,6 +108,8 @@ static void announce_and_cleanup(int fake)
 
 	printf("\nStarting kernel ...%s\n\n", fake ?
 		"(fake run for tracing)" : "");
+	if (CONFIG_IS_ENABLED(SERIAL_TX_BUFFER))
+		serial_flush();
 	/*
 	 * Call remove function of all devices with a removal flag set.
 	 * This may be useful for last-stage operations, like cancelling
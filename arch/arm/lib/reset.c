@@ -23,6 +23,7 @@
 #include <common.h>
 #include <cpu_func.h>
 #include <irq_func.h>
+#include <serial.h>
 
 __weak void reset_misc(void)
 {
@@ -31,6 +32,8 @@ __weak void reset_misc(void)
 int do_reset(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 {
 	puts ("resetting ...\n");
+	if (CONFIG_IS_ENABLED(SERIAL_TX_BUFFER))
+		serial_flush();
 
 	udelay (50000);				/* wait 50 ms */
 
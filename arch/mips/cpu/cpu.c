@@ -6,6 +6,7 @@
 
 #include <common.h>
 #include <command.h>
+#include <serial.h>
 #include <linux/compiler.h>
 #include <asm/cache.h>
 #include <asm/mipsregs.h>
@@ -22,6 +23,8 @@ void __weak _machine_restart(void)
 
 int do_reset(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 {
+	if (CONFIG_IS_ENABLED(SERIAL_TX_BUFFER))
+		serial_flush();
 	_machine_restart();
 
 	return 0;
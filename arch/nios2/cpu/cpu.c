@@ -10,6 +10,7 @@
 #include <dm.h>
 #include <errno.h>
 #include <irq_func.h>
+#include <serial.h>
 #include <asm/cache.h>
 
 DECLARE_GLOBAL_DATA_PTR;
@@ -32,6 +33,8 @@ int checkboard(void)
 
 int do_reset(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 {
+	if (CONFIG_IS_ENABLED(SERIAL_TX_BUFFER))
+		serial_flush();
 	disable_interrupts();
 	/* indirect call to go beyond 256MB limitation of toolchain */
 	nios2_callr(gd->arch.reset_addr);
@@ -244,4 +244,21 @@ uint sandbox_pci_read_bar(u32 barval, int type, uint size);
  */
 void sandbox_set_enable_memio(bool enable);
 
+/**
+ * sandbox_serial_set_tx_busy() - Make the sandbox serial device refuse output
+ *
+ * While busy, the device accepts no characters, like a UART with a full TX
+ * FIFO.
+ *
+ * @busy: true to refuse output, false to accept it again
+ */
+void sandbox_serial_set_tx_busy(bool busy);
+
+/**
+ * sandbox_serial_get_tx_count() - Get the number of characters written
+ *
+ * @return number of characters written by the sandbox serial device
+ */
+size_t sandbox_serial_get_tx_count(void);
+
 #endif
@@ -94,6 +94,20 @@ static int do_log_rec(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 	return 0;
 }
 
+#ifdef CONFIG_LOG_BUFFER
+static int do_log_dump(cmd_tbl_t *cmdtp, int flag, int argc,
+		       char * const argv[])
+{
+	int max_recs = -1;
+
+	if (argc > 1)
+		max_recs = simple_strtoul(argv[1], NULL, 10);
+	log_buffer_dump(max_recs);
+
+	return 0;
+}
+#endif
+
 static cmd_tbl_t log_sub[] = {
 	U_BOOT_CMD_MKENT(level, CONFIG_SYS_MAXARGS, 1, do_log_level, "", ""),
 #ifdef CONFIG_LOG_TEST
@@ -101,6 +115,9 @@ static cmd_tbl_t log_sub[] = {
 #endif
 	U_BOOT_CMD_MKENT(format, CONFIG_SYS_MAXARGS, 1, do_log_format, "", ""),
 	U_BOOT_CMD_MKENT(rec, CONFIG_SYS_MAXARGS, 1, do_log_rec, "", ""),
+#ifdef CONFIG_LOG_BUFFER
+	U_BOOT_CMD_MKENT(dump, 2, 1, do_log_dump, "", ""),
+#endif
 };
 
 static int do_log(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
@@ -133,6 +150,10 @@ static char log_help_text[] =
 	"\tor 'default', equivalent to 'fm', or 'all' for all\n"
 	"log rec <category> <level> <file> <line> <func> <message> - "
 		"output a log record"
+#ifdef CONFIG_LOG_BUFFER
+	"\nlog dump [<count>] - show the last <count> records in the log "
+		"buffer, or all"
+#endif
 	;
 #endif
 
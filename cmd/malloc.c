@@ -0,0 +1,87 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Commands for inspecting the malloc() heap
+ */
+
+#include <common.h>
+#include <command.h>
+#include <malloc.h>
+#include <malloc_trace.h>
+#include <slab.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+/* Number of call sites shown by 'malloc dump' */
+#define MALLOC_DUMP_SITES	20
+
+static void show_slab_stats(void)
+{
+	struct slab_stats stats;
+	int i;
+
+	printf("\n%5s %5s %7s %7s %9s %9s\n", "Size", "Pages", "Objects",
+	       "Peak", "Allocs", "Frees");
+	for (i = 0; !slab_get_stats(i, &stats); i++) {
+		printf("%5u %5u %7u %7u %9lu %9lu\n", stats.size, stats.pages,
+		       stats.objs, stats.peak, stats.allocs, stats.frees);
+	}
+}
+
+static int do_malloc_stats(cmd_tbl_t *cmdtp, int flag, int argc,
+			   char *const argv[])
+{
+	printf("Heap:        %08lx, size %lx\n", mem_malloc_start,
+	       mem_malloc_end - mem_malloc_start);
+#if CONFIG_VAL(SYS_MALLOC_F_LEN)
+	printf("Early heap:  %08lx, used %lx of %lx\n", gd->malloc_base,
+	       gd->malloc_ptr, gd->malloc_limit);
+#endif
+	if (CONFIG_IS_ENABLED(SYS_MALLOC_SLAB))
+		show_slab_stats();
+
+	return 0;
+}
+
+static int do_malloc_dump(cmd_tbl_t *cmdtp, int flag, int argc,
+			  char *const argv[])
+{
+	struct malloc_trace_site sites[MALLOC_DUMP_SITES];
+	struct malloc_trace_stats stats;
+	int count, i;
+
+	if (!IS_ENABLED(CONFIG_MALLOC_TRACE)) {
+		printf("Tracing is not enabled (CONFIG_MALLOC_TRACE)\n");
+		return CMD_RET_FAILURE;
+	}
+	malloc_trace_get_stats(&stats);
+	printf("Allocs %lu, frees %lu, failed %lu, records %lu\n",
+	       stats.allocs, stats.frees, stats.failed, stats.count);
+	malloc_trace_report();
+
+	count = malloc_trace_get_sites(sites, ARRAY_SIZE(sites));
+	if (count < 0) {
+		printf("Cannot read trace (err=%d)\n", count);
+		return CMD_RET_FAILURE;
+	}
+	printf("\n%-10s %7s %10s %7s %10s\n", "Caller", "Allocs", "Bytes",
+	       "Live", "Live bytes");
+	for (i = 0; i < min(count, MALLOC_DUMP_SITES); i++) {
+		struct malloc_trace_site *site = &sites[i];
+
+		printf("%08lx   %7u %10lu %7u %10lu\n",
+		       (ulong)site->caller - gd->reloc_off, site->allocs,
+		       site->bytes, site->live, site->live_bytes);
+	}
+	if (count > MALLOC_DUMP_SITES)
+		printf("(%d more call sites)\n", count - MALLOC_DUMP_SITES);
+
+	return 0;
+}
+
+static char malloc_help_text[] =
+	"stats - show heap and slab allocator statistics\n"
+	"malloc dump - show traced allocations by call site";
+
+U_BOOT_CMD_WITH_SUBCMDS(malloc, "malloc() heap information", malloc_help_text,
+	U_BOOT_SUBCMD_MKENT(stats, 1, 1, do_malloc_stats),
+	U_BOOT_SUBCMD_MKENT(dump, 1, 1, do_malloc_dump));
@@ -16,12 +16,16 @@
 #include <cli.h>
 #include <command.h>
 #include <console.h>
+#include <display_options.h>
 #include <flash.h>
 #include <hash.h>
 #include <mapmem.h>
+#include <memtest.h>
 #include <watchdog.h>
 #include <asm/io.h>
 #include <linux/compiler.h>
+#include <linux/math64.h>
+#include <linux/sizes.h>
 
 DECLARE_GLOBAL_DATA_PTR;
 
@@ -29,6 +33,9 @@ DECLARE_GLOBAL_DATA_PTR;
 #define CONFIG_SYS_MEMTEST_SCRATCH 0
 #endif
 
+/* Amount of memory handled between watchdog resets and checks for Ctrl-C */
+#define MEM_CHUNK_SIZE	SZ_1M
+
 static int mod_mem(cmd_tbl_t *, int, int, int, char * const []);
 
 /* Display values from last command.
@@ -221,41 +228,37 @@ static int do_mem_mwc(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 }
 #endif /* CONFIG_CMD_MX_CYCLIC */
 
-static int do_mem_cmp(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
+/*
+ * Print how long an operation on a range of memory took, and how fast it
+ * was. Small ranges are too quick to time, so nothing is printed for them.
+ */
+static void mem_show_speed(ulong bytes, ulong time)
+{
+	if (bytes <= MEM_CHUNK_SIZE)
+		return;
+	printf(" in %lu ms", time);
+	if (time > 0) {
+		puts(" (");
+		print_size(div_u64((u64)bytes * 1000, time), "/s");
+		puts(")");
+	}
+}
+
+/*
+ * Find the first value which differs between two buffers, and print it.
+ * Returns the number of values which are the same before it.
+ */
+static ulong mem_cmp_show_diff(ulong addr1, const void *buf1, ulong addr2,
+			       const void *buf2, ulong count, int size,
+			       const char *type)
 {
-	ulong	addr1, addr2, count, ngood, bytes;
-	int	size;
-	int     rcode = 0;
-	const char *type;
-	const void *buf1, *buf2, *base;
 #ifdef MEM_SUPPORT_64BIT_DATA
 	u64 word1, word2;
 #else
 	ulong word1, word2;
 #endif
+	ulong ngood;
 
-	if (argc != 4)
-		return CMD_RET_USAGE;
-
-	/* Check for size specification.
-	*/
-	if ((size = cmd_get_data_size(argv[0], 4)) < 0)
-		return 1;
-	type = size == 8 ? "double word" :
-	       size == 4 ? "word" :
-	       size == 2 ? "halfword" : "byte";
-
-	addr1 = simple_strtoul(argv[1], NULL, 16);
-	addr1 += base_address;
-
-	addr2 = simple_strtoul(argv[2], NULL, 16);
-	addr2 += base_address;
-
-	count = simple_strtoul(argv[3], NULL, 16);
-
-	bytes = size * count;
-	base = buf1 = map_sysmem(addr1, bytes);
-	buf2 = map_sysmem(addr2, bytes);
 	for (ngood = 0; ngood < count; ++ngood) {
 		if (size == 4) {
 			word1 = *(u32 *)buf1;
@@ -273,7 +276,7 @@ static int do_mem_cmp(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 			word2 = *(u8 *)buf2;
 		}
 		if (word1 != word2) {
-			ulong offset = buf1 - base;
+			ulong offset = ngood * size;
 #ifdef MEM_SUPPORT_64BIT_DATA
 			printf("%s at 0x%p (%#0*llx) != %s at 0x%p (%#0*llx)\n",
 			       type, (void *)(addr1 + offset), size, word1,
@@ -283,27 +286,87 @@ static int do_mem_cmp(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 				type, (ulong)(addr1 + offset), size, word1,
 				type, (ulong)(addr2 + offset), size, word2);
 #endif
-			rcode = 1;
 			break;
 		}
 
 		buf1 += size;
 		buf2 += size;
+	}
+
+	return ngood;
+}
+
+static int do_mem_cmp(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
+{
+	ulong	addr1, addr2, count, ngood, bytes, done, chunk, start;
+	int	size;
+	int     rcode = 0;
+	const char *type;
+	const void *buf1, *buf2;
+
+	if (argc != 4)
+		return CMD_RET_USAGE;
+
+	/* Check for size specification.
+	*/
+	if ((size = cmd_get_data_size(argv[0], 4)) < 0)
+		return 1;
+	type = size == 8 ? "double word" :
+	       size == 4 ? "word" :
+	       size == 2 ? "halfword" : "byte";
+
+	addr1 = simple_strtoul(argv[1], NULL, 16);
+	addr1 += base_address;
+
+	addr2 = simple_strtoul(argv[2], NULL, 16);
+	addr2 += base_address;
+
+	count = simple_strtoul(argv[3], NULL, 16);
 
-		/* reset watchdog from time to time */
-		if ((ngood % (64 << 10)) == 0)
-			WATCHDOG_RESET();
+	bytes = size * count;
+	buf1 = map_sysmem(addr1, bytes);
+	buf2 = map_sysmem(addr2, bytes);
+
+	/*
+	 * Compare a chunk at a time with memcmp(), which is much faster than
+	 * reading each value in turn. Only look at the values themselves
+	 * once a chunk is found to be different.
+	 */
+	start = get_timer(0);
+	for (done = 0; done < bytes; done += chunk) {
+		chunk = min(bytes - done, (ulong)MEM_CHUNK_SIZE);
+		if (memcmp(buf1 + done, buf2 + done, chunk)) {
+			done += size * mem_cmp_show_diff(addr1 + done,
+							 buf1 + done,
+							 addr2 + done,
+							 buf2 + done,
+							 chunk / size, size,
+							 type);
+			rcode = 1;
+			break;
+		}
+		WATCHDOG_RESET();
+		if (done + chunk < bytes && ctrlc()) {
+			done += chunk;
+			puts("Abort\n");
+			rcode = 1;
+			break;
+		}
 	}
+	ngood = done / size;
 	unmap_sysmem(buf1);
 	unmap_sysmem(buf2);
 
-	printf("Total of %ld %s(s) were the same\n", ngood, type);
+	printf("Total of %ld %s(s) were the same", ngood, type);
+	mem_show_speed(ngood * size, get_timer(start));
+	puts("\n");
+
 	return rcode;
 }
 
 static int do_mem_cp(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 {
-	ulong	addr, dest, count;
+	ulong	addr, dest, count, bytes, done, chunk, start;
 	void	*src, *dst;
 	int	size;
 
@@ -328,8 +391,9 @@ static int do_mem_cp(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 		return 1;
 	}
 
-	src = map_sysmem(addr, count * size);
-	dst = map_sysmem(dest, count * size);
+	bytes = count * size;
+	src = map_sysmem(addr, bytes);
+	dst = map_sysmem(dest, bytes);
 
 #ifdef CONFIG_MTD_NOR_FLASH
 	/* check if we are copying to Flash */
@@ -338,7 +402,7 @@ static int do_mem_cp(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 
 		puts ("Copy to Flash... ");
 
-		rc = flash_write((char *)src, (ulong)dst, count * size);
+		rc = flash_write((char *)src, (ulong)dst, bytes);
 		if (rc != 0) {
 			flash_perror(rc);
 			unmap_sysmem(src);
@@ -352,11 +416,29 @@ static int do_mem_cp(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 	}
 #endif
 
-	memcpy(dst, src, count * size);
+	/* Copy a chunk at a time so that large copies can be interrupted */
+	start = get_timer(0);
+	for (done = 0; done < bytes; done += chunk) {
+		chunk = min(bytes - done, (ulong)MEM_CHUNK_SIZE);
+		memcpy(dst + done, src + done, chunk);
+		WATCHDOG_RESET();
+		if (done + chunk < bytes && ctrlc()) {
+			done += chunk;
+			puts("Abort\n");
+			break;
+		}
+	}
 
 	unmap_sysmem(src);
 	unmap_sysmem(dst);
-	return 0;
+
+	if (bytes > MEM_CHUNK_SIZE) {
+		printf("%lu bytes copied", done);
+		mem_show_speed(done, get_timer(start));
+		puts("\n");
+	}
+
+	return done == bytes ? 0 : 1;
 }
 
 static int do_mem_base(cmd_tbl_t *cmdtp, int flag, int argc,
@@ -577,13 +659,12 @@ static int do_mem_loopw(cmd_tbl_t *cmdtp, int flag, int argc,
 #endif /* CONFIG_LOOPW */
 
 #ifdef CONFIG_CMD_MEMTEST
-static ulong mem_test_alt(vu_long *buf, ulong start_addr, ulong end_addr,
-			  vu_long *dummy)
+static int mem_test_alt(struct memtest *mt, vu_long *dummy)
 {
 	vu_long *addr;
-	ulong errs = 0;
+	ulong start_addr = mt->addr;
 	ulong val, readback;
-	int j;
+	int j, ret;
 	vu_long offset;
 	vu_long test_offset;
 	vu_long pattern;
@@ -601,7 +682,8 @@ static ulong mem_test_alt(vu_long *buf, ulong start_addr, ulong end_addr,
 		0xaaaaaaaa,	/* alternating 1/0 */
 	};
 
-	num_words = (end_addr - start_addr) / sizeof(vu_long);
+	/* The last word is only used by the increment/decrement test */
+	num_words = mt->words - 1;
 
 	/*
 	 * Data line test: write a pattern to the first
@@ -620,7 +702,7 @@ static ulong mem_test_alt(vu_long *buf, ulong start_addr, ulong end_addr,
 	 * '0's and '0' bits through a field of '1's (i.e.
 	 * pattern and ~pattern).
 	 */
-	addr = buf;
+	addr = mt->buf;
 	for (j = 0; j < sizeof(bitpattern) / sizeof(bitpattern[0]); j++) {
 		val = bitpattern[j];
 		for (; val != 0; val <<= 1) {
@@ -631,9 +713,9 @@ static ulong mem_test_alt(vu_long *buf, ulong start_addr, ulong end_addr,
 				printf("FAILURE (data line): "
 					"expected %08lx, actual %08lx\n",
 						val, readback);
-				errs++;
+				mt->errs++;
 				if (ctrlc())
-					return -1;
+					return -EINTR;
 			}
 			*addr  = ~val;
 			*dummy  = val;
@@ -642,9 +724,9 @@ static ulong mem_test_alt(vu_long *buf, ulong start_addr, ulong end_addr,
 				printf("FAILURE (data line): "
 					"Is %08lx, should be %08lx\n",
 						readback, ~val);
-				errs++;
+				mt->errs++;
 				if (ctrlc())
-					return -1;
+					return -EINTR;
 			}
 		}
 	}
@@ -707,9 +789,9 @@ static ulong mem_test_alt(vu_long *buf, ulong start_addr, ulong end_addr,
 				" expected 0x%.8lx, actual 0x%.8lx\n",
 				start_addr + offset*sizeof(vu_long),
 				pattern, temp);
-			errs++;
+			mt->errs++;
 			if (ctrlc())
-				return -1;
+				return -EINTR;
 		}
 	}
 	addr[test_offset] = pattern;
@@ -729,9 +811,9 @@ static ulong mem_test_alt(vu_long *buf, ulong start_addr, ulong end_addr,
 					" actual 0x%.8lx\n",
 					start_addr + offset*sizeof(vu_long),
 					pattern, temp);
-				errs++;
+				mt->errs++;
 				if (ctrlc())
-					return -1;
+					return -EINTR;
 			}
 		}
 		addr[test_offset] = pattern;
@@ -749,66 +831,27 @@ static ulong mem_test_alt(vu_long *buf, ulong start_addr, ulong end_addr,
 	 *
 	 * Returns:     0 if the test succeeds, 1 if the test fails.
 	 */
-	num_words++;
-
-	/*
-	 * Fill memory with a known pattern.
-	 */
-	for (pattern = 1, offset = 0; offset < num_words; pattern++, offset++) {
-		WATCHDOG_RESET();
-		addr[offset] = pattern;
-	}
+	ret = memtest_fill(mt, 1, 1);
 
 	/*
 	 * Check each location and invert it for the second pass.
 	 */
-	for (pattern = 1, offset = 0; offset < num_words; pattern++, offset++) {
-		WATCHDOG_RESET();
-		temp = addr[offset];
-		if (temp != pattern) {
-			printf("\nFAILURE (read/write) @ 0x%.8lx:"
-				" expected 0x%.8lx, actual 0x%.8lx)\n",
-				start_addr + offset*sizeof(vu_long),
-				pattern, temp);
-			errs++;
-			if (ctrlc())
-				return -1;
-		}
-
-		anti_pattern = ~pattern;
-		addr[offset] = anti_pattern;
-	}
+	if (!ret)
+		ret = memtest_check(mt, 1, 1, MEMTEST_INVERT);
 
 	/*
 	 * Check each location for the inverted pattern and zero it.
 	 */
-	for (pattern = 1, offset = 0; offset < num_words; pattern++, offset++) {
-		WATCHDOG_RESET();
-		anti_pattern = ~pattern;
-		temp = addr[offset];
-		if (temp != anti_pattern) {
-			printf("\nFAILURE (read/write): @ 0x%.8lx:"
-				" expected 0x%.8lx, actual 0x%.8lx)\n",
-				start_addr + offset*sizeof(vu_long),
-				anti_pattern, temp);
-			errs++;
-			if (ctrlc())
-				return -1;
-		}
-		addr[offset] = 0;
-	}
+	if (!ret)
+		ret = memtest_check(mt, ~1UL, -1UL, MEMTEST_ZERO);
 
-	return errs;
+	return ret;
 }
 
-static ulong mem_test_quick(vu_long *buf, ulong start_addr, ulong end_addr,
-			    vu_long pattern, int iteration)
+static int mem_test_quick(struct memtest *mt, ulong pattern, int iteration)
 {
-	vu_long *end;
-	vu_long *addr;
-	ulong errs = 0;
-	ulong incr, length;
-	ulong val, readback;
+	ulong incr;
+	int ret;
 
 	/* Alternate the pattern */
 	incr = 1;
@@ -825,39 +868,37 @@ static ulong mem_test_quick(vu_long *buf, ulong start_addr, ulong end_addr,
 		else
 			pattern = ~pattern;
 	}
-	length = (end_addr - start_addr) / sizeof(ulong);
-	end = buf + length;
 	printf("\rPattern %08lX  Writing..."
 		"%12s"
 		"\b\b\b\b\b\b\b\b\b\b",
 		pattern, "");
 
-	for (addr = buf, val = pattern; addr < end; addr++) {
-		WATCHDOG_RESET();
-		*addr = val;
-		val += incr;
-	}
+	ret = memtest_fill(mt, pattern, incr);
+	if (ret)
+		return ret;
 
 	puts("Reading...");
 
-	for (addr = buf, val = pattern; addr < end; addr++) {
-		WATCHDOG_RESET();
-		readback = *addr;
-		if (readback != val) {
-			ulong offset = addr - buf;
-
-			printf("\nMem error @ 0x%08X: "
-				"found %08lX, expected %08lX\n",
-				(uint)(uintptr_t)(start_addr + offset*sizeof(vu_long)),
-				readback, val);
-			errs++;
-			if (ctrlc())
-				return -1;
-		}
-		val += incr;
-	}
+	return memtest_check(mt, pattern, incr, MEMTEST_KEEP);
+}
 
-	return errs;
+/* Show the errors found by a memory test, with the bits which were wrong */
+static void mem_test_show_errs(struct memtest *mt)
+{
+	const int width = sizeof(ulong) * 2;
+	struct memtest_err *err;
+	int i;
+
+	if (!mt->nerr)
+		return;
+	printf("%-*s  %-*s  %-*s  %s\n", width, "Address", width, "Expected",
+	       width, "Actual", "Bad bits");
+	for (i = 0, err = mt->err; i < mt->nerr; i++, err++)
+		printf("%0*lx  %0*lx  %0*lx  %0*lx\n", width, err->addr, width,
+		       err->expected, width, err->actual, width,
+		       err->expected ^ err->actual);
+	if (mt->errs > mt->nerr)
+		printf("(%lu more)\n", mt->errs - mt->nerr);
 }
 
 /*
@@ -869,10 +910,10 @@ static int do_mem_mtest(cmd_tbl_t *cmdtp, int flag, int argc,
 			char * const argv[])
 {
 	ulong start, end;
-	vu_long *buf, *dummy;
+	struct memtest mt;
+	vu_long *dummy;
 	ulong iteration_limit = 0;
-	int ret;
-	ulong errs = 0;	/* number of errors, or -1 if interrupted */
+	int ret = 0;
 	ulong pattern = 0;
 	int iteration;
 #if defined(CONFIG_SYS_ALT_MEMTEST)
@@ -909,27 +950,28 @@ static int do_mem_mtest(cmd_tbl_t *cmdtp, int flag, int argc,
 	debug("%s:%d: start %#08lx end %#08lx\n", __func__, __LINE__,
 	      start, end);
 
-	buf = map_sysmem(start, end - start);
+	/* The alternative test also covers the word at @end */
+	memtest_init(&mt, start, end - start + (alt_test ? sizeof(ulong) : 0),
+		     true);
 	dummy = map_sysmem(CONFIG_SYS_MEMTEST_SCRATCH, sizeof(vu_long));
 	for (iteration = 0;
 			!iteration_limit || iteration < iteration_limit;
 			iteration++) {
 		if (ctrlc()) {
-			errs = -1UL;
+			ret = -EINTR;
 			break;
 		}
 
 		printf("Iteration: %6d\r", iteration + 1);
 		debug("\n");
-		if (alt_test) {
-			errs = mem_test_alt(buf, start, end, dummy);
-		} else {
-			errs = mem_test_quick(buf, start, end, pattern,
-					      iteration);
-		}
-		if (errs == -1UL)
+		if (alt_test)
+			ret = mem_test_alt(&mt, dummy);
+		else
+			ret = mem_test_quick(&mt, pattern, iteration);
+		if (ret)
 			break;
 	}
+	memtest_uninit(&mt);
 
 	/*
 	 * Work-around for eldk-4.2 which gives this warning if we try to
@@ -937,24 +979,21 @@ static int do_mem_mtest(cmd_tbl_t *cmdtp, int flag, int argc,
 	 * warning: initialization discards qualifiers from pointer target type
 	 */
 	{
-		void *vbuf = (void *)buf;
 		void *vdummy = (void *)dummy;
 
-		unmap_sysmem(vbuf);
 		unmap_sysmem(vdummy);
 	}
 
-	if (errs == -1UL) {
+	if (ret) {
 		/* Memory test was aborted - write a newline to finish off */
 		putc('\n');
-		ret = 1;
 	} else {
-		printf("Tested %d iteration(s) with %lu errors.\n",
-			iteration, errs);
-		ret = errs != 0;
+		printf("Tested %d iteration(s) with %lu errors (%lu MiB/s).\n",
+		       iteration, mt.errs, memtest_mib_per_sec(&mt));
 	}
+	mem_test_show_errs(&mt);
 
-	return ret;
+	return ret || mt.errs;
 }
 #endif	/* CONFIG_CMD_MEMTEST */
 
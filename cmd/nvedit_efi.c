@@ -17,11 +17,9 @@
 #include <linux/kernel.h>
 
 /*
- * From efi_variable.c,
- *
- * Mapping between UEFI variables and u-boot variables:
- *
- *   efi_$guid_$varname = {attributes}(type)value
+ * UEFI variables are kept by efi_variable.c, which persists the non-volatile
+ * ones in the U-Boot variable efi_vars. They are accessed here through the
+ * UEFI runtime services.
  */
 
 static const struct {
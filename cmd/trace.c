@@ -76,6 +76,31 @@ static int create_call_list(int argc, char * const argv[])
 	return 0;
 }
 
+static int set_mode(int argc, char * const argv[])
+{
+	int mode;
+
+	if (argc < 3) {
+		mode = trace_get_mode();
+		if (mode < 0)
+			return CMD_RET_FAILURE;
+		printf("Trace mode: %s\n", trace_get_mode_name(mode));
+		return 0;
+	}
+	for (mode = 0; mode < TRACE_MODE_COUNT; mode++) {
+		if (!strcmp(argv[2], trace_get_mode_name(mode)))
+			break;
+	}
+	if (mode == TRACE_MODE_COUNT)
+		return CMD_RET_USAGE;
+	if (trace_set_mode(mode)) {
+		printf("Cannot set trace mode\n");
+		return CMD_RET_FAILURE;
+	}
+
+	return 0;
+}
+
 int do_trace(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 {
 	const char *cmd = argc < 2 ? NULL : argv[1];
@@ -100,6 +125,8 @@ int do_trace(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 	case 's':
 		trace_print_stats();
 		break;
+	case 'm':
+		return set_mode(argc, argv);
 	default:
 		return CMD_RET_USAGE;
 	}
@@ -115,5 +142,7 @@ U_BOOT_CMD(
 	"trace resume                       - resume tracing\n"
 	"trace funclist [<addr> <size>]     - dump function list into buffer\n"
 	"trace calls  [<addr> <size>]       "
-		"- dump function call trace into buffer"
+		"- dump function call trace into buffer\n"
+	"trace mode [calls|compact|aggregate] "
+		"- show / set how calls are recorded"
 );
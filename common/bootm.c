@@ -13,8 +13,11 @@
 #include <fdt_support.h>
 #include <irq_func.h>
 #include <lmb.h>
+#include <log.h>
 #include <malloc.h>
+#include <malloc_trace.h>
 #include <mapmem.h>
+#include <serial.h>
 #include <asm/io.h>
 #if defined(CONFIG_CMD_USB)
 #include <usb.h>
@@ -620,6 +623,13 @@ int do_bootm_states(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[],
 	}
 
 	/* Now run the OS! We hope this doesn't return */
+	if (IS_ENABLED(CONFIG_MALLOC_TRACE) && (states & BOOTM_STATE_OS_GO))
+		malloc_trace_report();
+	if (IS_ENABLED(CONFIG_LOG_BUFFER) && IS_ENABLED(CONFIG_BLOBLIST) &&
+	    (states & BOOTM_STATE_OS_GO))
+		log_buffer_export();
+	if (CONFIG_IS_ENABLED(SERIAL_TX_BUFFER) && (states & BOOTM_STATE_OS_GO))
+		serial_flush();
 	if (!ret && (states & BOOTM_STATE_OS_GO))
 		ret = boot_selected_os(argc, argv, BOOTM_STATE_OS_GO,
 				images, boot_fn);
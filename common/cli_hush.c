@@ -479,7 +479,8 @@ static int parse_string(o_string *dest, struct p_context *ctx, const char *src);
 #endif
 static int parse_stream(o_string *dest, struct p_context *ctx, struct in_str *input0, int end_trigger);
 /*   setup: */
-static int parse_stream_outer(struct in_str *inp, int flag);
+static int parse_stream_outer(struct in_str *inp, int flag,
+			      struct pipe **save);
 #ifndef __U_BOOT__
 static int parse_string_outer(const char *s, int flag);
 static int parse_file_outer(FILE *f);
@@ -3182,7 +3183,119 @@ static void update_ifs_map(void)
 
 /* most recursion does not come through here, the exeception is
  * from builtin_source() */
-static int parse_stream_outer(struct in_str *inp, int flag)
+#ifdef CONFIG_HUSH_PARSE_CACHE
+/*
+ * Cache of parsed command lines. Scripts stored in environment variables are
+ * parsed again every time they are run, e.g. by 'run' in the body of a loop.
+ * The parse tree only depends on the text and the parse flags (and IFS, which
+ * disables the cache when set), so a copy of the tree is kept for each line
+ * and cloned when the same line is run again.
+ */
+struct parse_cache_ent {
+	char *str;
+	int flag;
+	struct pipe *list;
+};
+
+static struct parse_cache_ent parse_cache[CONFIG_HUSH_PARSE_CACHE_ENTRIES];
+static int parse_cache_next;
+
+static struct pipe *clone_pipe_list(struct pipe *head);
+
+static void clone_child(struct child_prog *dst, struct child_prog *src)
+{
+	int a;
+
+	*dst = *src;
+	if (src->argv) {
+		dst->argv = xmalloc((src->argc + 1) * sizeof(*dst->argv));
+		dst->argv_nonnull = xmalloc((src->argc + 1) *
+					    sizeof(*dst->argv_nonnull));
+		for (a = 0; a < src->argc; a++)
+			dst->argv[a] = xstrdup(src->argv[a]);
+		dst->argv[a] = NULL;
+		memcpy(dst->argv_nonnull, src->argv_nonnull,
+		       (src->argc + 1) * sizeof(*dst->argv_nonnull));
+	} else if (src->group) {
+		dst->group = clone_pipe_list(src->group);
+	}
+}
+
+/* Make a copy of a parse tree, which can be run and freed */
+static struct pipe *clone_pipe_list(struct pipe *head)
+{
+	struct pipe *list = NULL, **tail = &list;
+	struct pipe *pi, *new;
+	int i;
+
+	for (pi = head; pi; pi = pi->next) {
+		new = xmalloc(sizeof(*new));
+		*new = *pi;
+		new->next = NULL;
+		if (pi->progs) {
+			new->progs = xmalloc(pi->num_progs *
+					     sizeof(*new->progs));
+			for (i = 0; i < pi->num_progs; i++)
+				clone_child(&new->progs[i], &pi->progs[i]);
+		}
+		*tail = new;
+		tail = &new->next;
+	}
+
+	return list;
+}
+
+static struct parse_cache_ent *parse_cache_find(const char *s, int flag)
+{
+	int i;
+
+	for (i = 0; i < CONFIG_HUSH_PARSE_CACHE_ENTRIES; i++) {
+		struct parse_cache_ent *ent = &parse_cache[i];
+
+		if (ent->str && ent->flag == flag && !strcmp(ent->str, s))
+			return ent;
+	}
+
+	return NULL;
+}
+
+static void parse_cache_add(const char *s, int flag, struct pipe *list)
+{
+	struct parse_cache_ent *ent = &parse_cache[parse_cache_next];
+
+	if (ent->str) {
+		free(ent->str);
+		free_pipe_list(ent->list, 0);
+	}
+	ent->str = xstrdup(s);
+	ent->flag = flag;
+	ent->list = list;
+	parse_cache_next = (parse_cache_next + 1) %
+			   CONFIG_HUSH_PARSE_CACHE_ENTRIES;
+}
+
+/* Run a cached parse tree, as parse_stream_outer() runs a parsed line */
+static int parse_cache_run(struct parse_cache_ent *ent)
+{
+	int code;
+
+	update_ifs_map();
+	code = run_list(clone_pipe_list(ent->list));
+	if (code == -2)		/* exit */
+		code = 0;
+	else if (code == -1)
+		flag_repeat = 0;
+
+	return (code != 0) ? 1 : 0;
+}
+#endif /* CONFIG_HUSH_PARSE_CACHE */
+
+/*
+ * If @save is not NULL and the whole input is parsed as a single line without
+ * errors, a copy of the parse tree is returned in *@save before it is run.
+ */
+static int parse_stream_outer(struct in_str *inp, int flag,
+			      struct pipe **save)
 {
 
 	struct p_context ctx;
@@ -3214,6 +3327,11 @@ static int parse_stream_outer(struct in_str *inp, int flag)
 #ifndef __U_BOOT__
 			run_list(ctx.list_head);
 #else
+#ifdef CONFIG_HUSH_PARSE_CACHE
+			if (save && inp->peek == static_peek && !b_peek(inp))
+				*save = clone_pipe_list(ctx.list_head);
+#endif
+			save = NULL;
 			code = run_list(ctx.list_head);
 			if (code == -2) {	/* exit */
 				b_free(&temp);
@@ -3261,26 +3379,42 @@ int parse_string_outer(const char *s, int flag)
 {
 	struct in_str input;
 #ifdef __U_BOOT__
+	struct pipe *list = NULL, **save = NULL;
 	char *p = NULL;
 	int rcode;
 	if (!s)
 		return 1;
 	if (!*s)
 		return 0;
+#ifdef CONFIG_HUSH_PARSE_CACHE
+	/* Strings built by expanding variables differ each time */
+	if (!(flag & FLAG_REPARSING) && !env_get("IFS")) {
+		struct parse_cache_ent *ent = parse_cache_find(s, flag);
+
+		if (ent)
+			return parse_cache_run(ent);
+		save = &list;
+	}
+#endif
 	if (!(p = strchr(s, '\n')) || *++p) {
 		p = xmalloc(strlen(s) + 2);
 		strcpy(p, s);
 		strcat(p, "\n");
 		setup_string_in_str(&input, p);
-		rcode = parse_stream_outer(&input, flag);
+		rcode = parse_stream_outer(&input, flag, save);
 		free(p);
-		return rcode;
 	} else {
+		setup_string_in_str(&input, s);
+		rcode = parse_stream_outer(&input, flag, save);
+	}
+#ifdef CONFIG_HUSH_PARSE_CACHE
+	if (list)
+		parse_cache_add(s, flag, list);
 #endif
+	return rcode;
+#else
 	setup_string_in_str(&input, s);
-	return parse_stream_outer(&input, flag);
-#ifdef __U_BOOT__
-	}
+	return parse_stream_outer(&input, flag, NULL);
 #endif
 }
 
@@ -3297,7 +3431,7 @@ int parse_file_outer(void)
 #else
 	setup_file_in_str(&input);
 #endif
-	rcode = parse_stream_outer(&input, FLAG_PARSE_SEMICOLON);
+	rcode = parse_stream_outer(&input, FLAG_PARSE_SEMICOLON, NULL);
 	return rcode;
 }
 
@@ -12,8 +12,11 @@
 #include <command.h>
 #include <console.h>
 #include <env.h>
+#include <malloc.h>
 #include <linux/ctype.h>
 
+DECLARE_GLOBAL_DATA_PTR;
+
 /*
  * Use puts() instead of printf() to avoid printf buffer overflow
  * for long help messages
@@ -117,10 +120,95 @@ cmd_tbl_t *find_cmd_tbl(const char *cmd, cmd_tbl_t *table, int table_len)
 	return NULL;	/* not found or ambiguous command */
 }
 
+#ifdef CONFIG_CMDLINE
+/*
+ * Hash index of the main command table, mapping full command names to their
+ * position in the table. It is built on the first lookup after relocation,
+ * once the command table is final. Slots hold CMD_HASH_EMPTY or an index into
+ * the table and collisions are resolved by linear probing.
+ */
+#define CMD_HASH_EMPTY	0xffff
+
+static u16 *cmd_hash;
+static uint cmd_hash_mask;
+
+static uint cmd_hash_name(const char *name, int len)
+{
+	uint hash = 2166136261U;
+
+	while (len--) {
+		hash ^= (u8)*name++;
+		hash *= 16777619;
+	}
+
+	return hash;
+}
+
+static int cmd_hash_init(cmd_tbl_t *table, int table_len)
+{
+	uint size, slot;
+	int i;
+
+	for (size = 16; size < table_len * 2; size <<= 1)
+		;
+	cmd_hash = malloc(size * sizeof(*cmd_hash));
+	if (!cmd_hash)
+		return -ENOMEM;
+	memset(cmd_hash, 0xff, size * sizeof(*cmd_hash));
+	cmd_hash_mask = size - 1;
+
+	for (i = 0; i < table_len; i++) {
+		slot = cmd_hash_name(table[i].name, strlen(table[i].name));
+		for (slot &= cmd_hash_mask; cmd_hash[slot] != CMD_HASH_EMPTY;
+		     slot = (slot + 1) & cmd_hash_mask)
+			;
+		cmd_hash[slot] = i;
+	}
+
+	return 0;
+}
+
+/* Look up a command by its full name, ignoring any length modifier */
+static cmd_tbl_t *find_cmd_hashed(const char *cmd, cmd_tbl_t *table,
+				  int table_len)
+{
+	const char *p;
+	uint slot;
+	int len;
+
+	if (!(gd->flags & GD_FLG_RELOC) || table_len >= CMD_HASH_EMPTY)
+		return NULL;
+	if (!cmd_hash && cmd_hash_init(table, table_len))
+		return NULL;
+
+	len = ((p = strchr(cmd, '.')) == NULL) ? strlen(cmd) : (p - cmd);
+	for (slot = cmd_hash_name(cmd, len) & cmd_hash_mask;
+	     cmd_hash[slot] != CMD_HASH_EMPTY;
+	     slot = (slot + 1) & cmd_hash_mask) {
+		cmd_tbl_t *cmdtp = &table[cmd_hash[slot]];
+
+		if (!strncmp(cmd, cmdtp->name, len) && !cmdtp->name[len])
+			return cmdtp;
+	}
+
+	return NULL;
+}
+#endif /* CONFIG_CMDLINE */
+
 cmd_tbl_t *find_cmd(const char *cmd)
 {
 	cmd_tbl_t *start = ll_entry_start(cmd_tbl_t, cmd);
 	const int len = ll_entry_count(cmd_tbl_t, cmd);
+#ifdef CONFIG_CMDLINE
+	cmd_tbl_t *cmdtp;
+
+	/* Full names are found in the index, abbreviations need a search */
+	if (cmd) {
+		cmdtp = find_cmd_hashed(cmd, start, len);
+		if (cmdtp)
+			return cmdtp;
+	}
+#endif
 	return find_cmd_tbl(cmd, start, len);
 }
 
@@ -98,6 +98,13 @@ int run_usb_dnl_gadget(int usbctrl_index, char *usb_dnl_gadget)
 
 		WATCHDOG_RESET();
 		usb_gadget_handle_interrupts(usbctrl_index);
+
+		/*
+		 * Write a full buffer now that its last block is received,
+		 * while the host sends more. Errors are reported to the host
+		 * on the next download request.
+		 */
+		dfu_write_queued();
 	}
 exit:
 	g_dnl_unregister();
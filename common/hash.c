@@ -12,12 +12,15 @@
 #ifndef USE_HOSTCC
 #include <common.h>
 #include <command.h>
+#include <display_options.h>
 #include <env.h>
 #include <malloc.h>
 #include <mapmem.h>
 #include <hw_sha.h>
 #include <asm/io.h>
 #include <linux/errno.h>
+#include <linux/math64.h>
+#include <linux/sizes.h>
 #include <u-boot/crc.h>
 #else
 #include "mkimage.h"
@@ -443,10 +446,28 @@ static void hash_show(struct hash_algo *algo, ulong addr, ulong len, uint8_t *ou
 		printf("%02x", output[i]);
 }
 
+/*
+ * Print how long hashing took and how fast it was, if the range was big
+ * enough to be worth timing. This goes on its own line before the result,
+ * since scripts expect the output to end with the hash.
+ */
+static void hash_show_speed(ulong len, ulong time)
+{
+	if (len < SZ_1M)
+		return;
+	printf("%lu bytes in %lu ms", len, time);
+	if (time > 0) {
+		puts(" (");
+		print_size(div_u64((u64)len * 1000, time), "/s");
+		puts(")");
+	}
+	puts("\n");
+}
+
 int hash_command(const char *algo_name, int flags, cmd_tbl_t *cmdtp, int flag,
 		 int argc, char * const argv[])
 {
-	ulong addr, len;
+	ulong addr, len, start;
 
 	if ((argc < 2) || ((flags & HASH_FLAG_VERIFY) && (argc < 3)))
 		return CMD_RET_USAGE;
@@ -475,7 +496,9 @@ int hash_command(const char *algo_name, int flags, cmd_tbl_t *cmdtp, int flag,
 				  sizeof(uint32_t) * HASH_MAX_DIGEST_SIZE);
 
 		buf = map_sysmem(addr, len);
+		start = get_timer(0);
 		algo->hash_func_ws(buf, len, output, algo->chunk_size);
+		hash_show_speed(len, get_timer(start));
 		unmap_sysmem(buf);
 
 		/* Try to avoid code bloat when verify is not needed */
@@ -518,7 +541,9 @@ int hash_command(const char *algo_name, int flags, cmd_tbl_t *cmdtp, int flag,
 		ulong crc;
 		ulong *ptr;
 
+		start = get_timer(0);
 		crc = crc32_wd(0, (const uchar *)addr, len, CHUNKSZ_CRC32);
+		hash_show_speed(len, get_timer(start));
 
 		printf("CRC32 for %08lx ... %08lx ==> %08lx\n",
 				addr, addr + len - 1, crc);
@@ -181,16 +181,30 @@ static bool log_passes_filters(struct log_device *ldev, struct log_rec *rec)
  * The log record is sent to each log device in turn, skipping those which have
  * filters which block the record
  *
+ * The message is only formatted when the first device which needs the text
+ * accepts the record. Devices with LOGDF_DEFERRED use @rec->fmt and
+ * @rec->args directly, so if they are the only ones to accept the record, it
+ * is never formatted.
+ *
  * @rec: Log record to dispatch
  * @return 0 (meaning success)
  */
 static int log_dispatch(struct log_rec *rec)
 {
+	char buf[CONFIG_SYS_CBSIZE];
 	struct log_device *ldev;
+	va_list args;
 
 	list_for_each_entry(ldev, &gd->log_head, sibling_node) {
-		if (log_passes_filters(ldev, rec))
-			ldev->drv->emit(ldev, rec);
+		if (!log_passes_filters(ldev, rec))
+			continue;
+		if (!rec->msg && !(ldev->drv->flags & LOGDF_DEFERRED)) {
+			va_copy(args, *rec->args);
+			vsnprintf(buf, sizeof(buf), rec->fmt, args);
+			va_end(args);
+			rec->msg = buf;
+		}
+		ldev->drv->emit(ldev, rec);
 	}
 
 	return 0;
@@ -199,25 +213,25 @@ static int log_dispatch(struct log_rec *rec)
 int _log(enum log_category_t cat, enum log_level_t level, const char *file,
 	 int line, const char *func, const char *fmt, ...)
 {
-	char buf[CONFIG_SYS_CBSIZE];
 	struct log_rec rec;
 	va_list args;
 
+	if (!gd || !(gd->flags & GD_FLG_LOG_READY)) {
+		if (gd)
+			gd->log_drop_count++;
+		return -ENOSYS;
+	}
 	rec.cat = cat;
 	rec.level = level;
 	rec.file = file;
 	rec.line = line;
 	rec.func = func;
+	rec.msg = NULL;
+	rec.fmt = fmt;
+	rec.args = &args;
 	va_start(args, fmt);
-	vsnprintf(buf, sizeof(buf), fmt, args);
-	va_end(args);
-	rec.msg = buf;
-	if (!gd || !(gd->flags & GD_FLG_LOG_READY)) {
-		if (gd)
-			gd->log_drop_count++;
-		return -ENOSYS;
-	}
 	log_dispatch(&rec);
+	va_end(args);
 
 	return 0;
 }
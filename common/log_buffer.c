@@ -0,0 +1,516 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Log driver which records messages in a memory buffer
+ *
+ * Records are stored in binary form: the format string is copied and the
+ * arguments are packed after it. Formatting is put off until the buffer is
+ * dumped or exported, so that logging to the buffer is cheap even when
+ * nothing is displayed on the console.
+ *
+ * The filename, function name and format string are copied rather than kept
+ * as pointers, since they may be in a temporary buffer, e.g. with 'log rec'.
+ */
+
+#include <common.h>
+#include <bloblist.h>
+#include <log.h>
+#include <malloc.h>
+#include <linux/ctype.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+enum {
+	/* Largest record, including its header */
+	LOG_BUFFER_REC_MAX	= 256,
+
+	/* Longest conversion specification, including the '%' */
+	LOG_BUFFER_SPEC_MAX	= 16,
+
+	/* Space for each of the filename and function name in a record */
+	LOG_BUFFER_NAME_MAX	= 64,
+};
+
+/* Types of packed arguments, following the qualifiers used by vsnprintf() */
+enum log_buffer_arg {
+	LBA_NONE,		/* No argument, e.g. '%%' */
+	LBA_INT,		/* int, also used for 'h' and 'c' */
+	LBA_LONG,		/* 'l' */
+	LBA_LLONG,		/* 'll' or 'L' */
+	LBA_SIZE,		/* 'z', 'Z' or 't' */
+	LBA_PTR,		/* 'p' */
+	LBA_STR,		/* 's', stored inline */
+};
+
+/**
+ * struct log_buffer_hdr - Header for each record in the buffer
+ *
+ * The nul-terminated filename and function name follow the header. If
+ * @packed is set, the format string comes next, followed by the packed
+ * arguments: 32 bits for LBA_INT, 64 bits for other numbers and a
+ * nul-terminated string for LBA_STR. Otherwise the record could not be
+ * packed and the formatted message follows instead.
+ *
+ * @size: Size of the record including this header, or 0 to mark that the
+ *	next record is at the start of the buffer
+ * @cat: Log category (enum log_category_t)
+ * @line: Line number
+ * @level: Log level (enum log_level_t)
+ * @packed: true if the record holds a format string and its arguments
+ */
+struct log_buffer_hdr {
+	u16 size;
+	u16 cat;
+	u16 line;
+	u8 level;
+	u8 packed;
+};
+
+/**
+ * struct log_buffer - Information about the ring buffer
+ *
+ * @buf: Buffer memory, NULL if not allocated yet
+ * @size: Size of buffer in bytes
+ * @rd: Offset of oldest record
+ * @wr: Offset where the next record is written
+ * @count: Number of records in the buffer
+ * @dropped: Number of records discarded to make space for new ones
+ */
+struct log_buffer {
+	char *buf;
+	uint size;
+	uint rd;
+	uint wr;
+	uint count;
+	ulong dropped;
+};
+
+static struct log_buffer log_buf;
+
+/**
+ * log_buffer_parse() - Parse a conversion specification
+ *
+ * This accepts the same flags and qualifiers as vsnprintf(). Conversions
+ * which cannot be packed are rejected: '*' widths, '%n' and '%p' with an
+ * extension (such as %pM), since that reads data through the pointer.
+ *
+ * @p: Pointer to the character after the '%'
+ * @typep: Returns the type of argument used by the conversion
+ * @return length of the specification after the '%', or 0 if not supported
+ */
+static int log_buffer_parse(const char *p, enum log_buffer_arg *typep)
+{
+	const char *s = p;
+	int qualifier = 0;
+
+	while (*s && strchr("-+ #0", *s))
+		s++;
+	while (isdigit(*s))
+		s++;
+	if (*s == '.') {
+		s++;
+		while (isdigit(*s))
+			s++;
+	}
+	if (*s == 'h' || *s == 'l' || *s == 'L' || *s == 'Z' || *s == 'z' ||
+	    *s == 't') {
+		qualifier = *s++;
+		if (qualifier == 'l' && *s == 'l') {
+			qualifier = 'L';
+			s++;
+		}
+	}
+	if (s + 1 - p >= LOG_BUFFER_SPEC_MAX)
+		return 0;
+
+	switch (*s) {
+	case 'c':
+	case 'd':
+	case 'i':
+	case 'o':
+	case 'u':
+	case 'x':
+	case 'X':
+		if (qualifier == 'L')
+			*typep = LBA_LLONG;
+		else if (qualifier == 'l')
+			*typep = LBA_LONG;
+		else if (qualifier == 'Z' || qualifier == 'z' ||
+			 qualifier == 't')
+			*typep = LBA_SIZE;
+		else
+			*typep = LBA_INT;
+		break;
+	case 's':
+		if (qualifier)
+			return 0;
+		*typep = LBA_STR;
+		break;
+	case 'p':
+		if (isalnum(s[1]))
+			return 0;
+		*typep = LBA_PTR;
+		break;
+	case '%':
+		*typep = LBA_NONE;
+		break;
+	default:
+		return 0;
+	}
+
+	return s + 1 - p;
+}
+
+/*
+ * Copy a string to @ptr, truncating it to fit before @end. Returns a pointer
+ * to what follows it, which is @end if it was truncated.
+ */
+static char *log_buffer_add_str(char *ptr, char *end, const char *str)
+{
+	if (ptr >= end)
+		return end;
+	ptr += strlcpy(ptr, str, end - ptr);
+
+	return min(ptr, end - 1) + 1;
+}
+
+/*
+ * Copy @fmt to @ptr and pack its arguments after it, stopping at @end.
+ * Returns a pointer to what follows them, or NULL if they do not fit.
+ */
+static char *log_buffer_pack(char *ptr, char *end, const char *fmt,
+			     va_list args)
+{
+	enum log_buffer_arg type;
+	const char *str;
+	u32 val32;
+	u64 val;
+	int len;
+
+	if (strlen(fmt) >= end - ptr)
+		return NULL;
+	ptr = log_buffer_add_str(ptr, end, fmt);
+	for (fmt = strchr(fmt, '%'); fmt; fmt = strchr(fmt + len + 1, '%')) {
+		len = log_buffer_parse(fmt + 1, &type);
+		if (!len)
+			return NULL;
+		switch (type) {
+		case LBA_NONE:
+			continue;
+		case LBA_INT:
+			if (ptr + sizeof(val32) > end)
+				return NULL;
+			val32 = va_arg(args, int);
+			memcpy(ptr, &val32, sizeof(val32));
+			ptr += sizeof(val32);
+			continue;
+		case LBA_LONG:
+			val = va_arg(args, long);
+			break;
+		case LBA_LLONG:
+			val = va_arg(args, long long);
+			break;
+		case LBA_SIZE:
+			val = va_arg(args, size_t);
+			break;
+		case LBA_PTR:
+			val = (uintptr_t)va_arg(args, void *);
+			break;
+		case LBA_STR:
+			str = va_arg(args, const char *);
+			if (!str)
+				str = "<NULL>";
+			if (ptr >= end)
+				return NULL;
+			ptr = log_buffer_add_str(ptr, end, str);
+			continue;
+		}
+		if (ptr + sizeof(val) > end)
+			return NULL;
+		memcpy(ptr, &val, sizeof(val));
+		ptr += sizeof(val);
+	}
+
+	return ptr;
+}
+
+/* Get the filename and function name of a record, and what follows them */
+static const char *log_buffer_names(struct log_buffer_hdr *hdr,
+				    const char **filep, const char **funcp)
+{
+	const char *ptr = (const char *)(hdr + 1);
+
+	*filep = ptr;
+	ptr += strlen(ptr) + 1;
+	*funcp = ptr;
+
+	return ptr + strlen(ptr) + 1;
+}
+
+/*
+ * Format the message for a record into @buf, returning its length. @ptr
+ * points to the format string or text, after the names.
+ */
+static int log_buffer_format(struct log_buffer_hdr *hdr, const char *ptr,
+			     char *buf, int size)
+{
+	char spec[LOG_BUFFER_SPEC_MAX + 1];
+	enum log_buffer_arg type;
+	const char *fmt, *p;
+	int len, left, upto = 0;
+	char *out;
+	u32 val32;
+	u64 val;
+
+	if (!hdr->packed)
+		return strlcpy(buf, ptr, size);
+	fmt = ptr;
+	ptr += strlen(ptr) + 1;
+	for (; upto < size - 1; fmt = p + 1 + len) {
+		p = strchrnul(fmt, '%');
+		len = min_t(int, p - fmt, size - 1 - upto);
+		memcpy(buf + upto, fmt, len);
+		upto += len;
+		if (!*p)
+			break;
+
+		len = log_buffer_parse(p + 1, &type);
+		strlcpy(spec, p, len + 2);
+		out = buf + upto;
+		left = size - upto;
+		switch (type) {
+		case LBA_NONE:
+			upto += scnprintf(out, left, "%%");
+			break;
+		case LBA_INT:
+			memcpy(&val32, ptr, sizeof(val32));
+			ptr += sizeof(val32);
+			upto += scnprintf(out, left, spec, (int)val32);
+			break;
+		case LBA_STR:
+			upto += scnprintf(out, left, spec, ptr);
+			ptr += strlen(ptr) + 1;
+			break;
+		default:
+			memcpy(&val, ptr, sizeof(val));
+			ptr += sizeof(val);
+			if (type == LBA_LONG)
+				upto += scnprintf(out, left, spec, (long)val);
+			else if (type == LBA_LLONG)
+				upto += scnprintf(out, left, spec,
+						  (long long)val);
+			else if (type == LBA_SIZE)
+				upto += scnprintf(out, left, spec, (size_t)val);
+			else
+				upto += scnprintf(out, left, spec,
+						  (void *)(uintptr_t)val);
+			break;
+		}
+	}
+	buf[upto] = '\0';
+
+	return upto;
+}
+
+/* Format a record in the same way as the console driver */
+static int log_buffer_show(struct log_buffer_hdr *hdr, char *buf, int size)
+{
+	char msg[CONFIG_SYS_CBSIZE];
+	const char *file, *func, *ptr;
+	int fmt = gd->log_fmt;
+	int len = 0;
+
+	ptr = log_buffer_names(hdr, &file, &func);
+	log_buffer_format(hdr, ptr, msg, sizeof(msg));
+	if (fmt & (1 << LOGF_LEVEL))
+		len += scnprintf(buf + len, size - len, "%s.",
+				 log_get_level_name(hdr->level));
+	if (fmt & (1 << LOGF_CAT))
+		len += scnprintf(buf + len, size - len, "%s,",
+				 log_get_cat_name(hdr->cat));
+	if (fmt & (1 << LOGF_FILE))
+		len += scnprintf(buf + len, size - len, "%s:", file);
+	if (fmt & (1 << LOGF_LINE))
+		len += scnprintf(buf + len, size - len, "%d-", hdr->line);
+	if (fmt & (1 << LOGF_FUNC))
+		len += scnprintf(buf + len, size - len, "%s()", func);
+	if (fmt & (1 << LOGF_MSG))
+		len += scnprintf(buf + len, size - len, "%s%s",
+				 fmt != (1 << LOGF_MSG) ? " " : "", msg);
+
+	return len;
+}
+
+static struct log_buffer_hdr *log_buffer_hdr(uint offset)
+{
+	return (struct log_buffer_hdr *)(log_buf.buf + offset);
+}
+
+/* Move on to the record after the one at @offset */
+static uint log_buffer_next(uint offset)
+{
+	offset += log_buffer_hdr(offset)->size;
+	if (offset + sizeof(struct log_buffer_hdr) > log_buf.size ||
+	    !log_buffer_hdr(offset)->size)
+		offset = 0;
+
+	return offset;
+}
+
+static void log_buffer_drop(void)
+{
+	log_buf.rd = log_buffer_next(log_buf.rd);
+	log_buf.dropped++;
+	if (!--log_buf.count)
+		log_buf.rd = log_buf.wr = 0;
+}
+
+/* Check whether a record can be written at @pos without losing another one */
+static bool log_buffer_fits(uint pos, uint size)
+{
+	if (!log_buf.count)
+		return true;
+	if (log_buf.rd < log_buf.wr)
+		return pos >= log_buf.wr || pos + size <= log_buf.rd;
+
+	return pos == log_buf.wr && pos + size <= log_buf.rd;
+}
+
+static void log_buffer_write(struct log_buffer_hdr *hdr)
+{
+	uint pos = log_buf.wr;
+
+	if (pos + hdr->size > log_buf.size)
+		pos = 0;
+	while (!log_buffer_fits(pos, hdr->size))
+		log_buffer_drop();
+	if (!log_buf.count) {
+		log_buf.rd = pos;
+	} else if (pos != log_buf.wr &&
+		   log_buf.wr + sizeof(*hdr) <= log_buf.size) {
+		log_buffer_hdr(log_buf.wr)->size = 0;
+	}
+	memcpy(log_buf.buf + pos, hdr, hdr->size);
+	log_buf.wr = pos + hdr->size;
+	log_buf.count++;
+}
+
+static int log_buffer_emit(struct log_device *ldev, struct log_rec *rec)
+{
+	ulong rec_buf[LOG_BUFFER_REC_MAX / sizeof(ulong)];
+	struct log_buffer_hdr *hdr = (struct log_buffer_hdr *)rec_buf;
+	char *end = (char *)rec_buf + LOG_BUFFER_REC_MAX;
+	char msg[CONFIG_SYS_CBSIZE];
+	char *ptr, *names, *body;
+	va_list args;
+
+	BUILD_BUG_ON(CONFIG_LOG_BUFFER_SIZE < LOG_BUFFER_REC_MAX);
+
+	/* The buffer is allocated from the full malloc() pool after relocation */
+	if (!(gd->flags & GD_FLG_RELOC))
+		return -ENOSYS;
+	if (!log_buf.buf) {
+		log_buf.buf = malloc(CONFIG_LOG_BUFFER_SIZE);
+		if (!log_buf.buf)
+			return -ENOMEM;
+		log_buf.size = CONFIG_LOG_BUFFER_SIZE;
+	}
+
+	hdr->cat = rec->cat;
+	hdr->line = rec->line;
+	hdr->level = rec->level;
+
+	/* Leave at least half of the record for the message */
+	names = (char *)(hdr + 1);
+	ptr = log_buffer_add_str(names, names + LOG_BUFFER_NAME_MAX,
+				 rec->file ? rec->file : "");
+	ptr = log_buffer_add_str(ptr, names + 2 * LOG_BUFFER_NAME_MAX,
+				 rec->func ? rec->func : "");
+
+	body = ptr;
+	va_copy(args, *rec->args);
+	ptr = log_buffer_pack(body, end, rec->fmt, args);
+	va_end(args);
+	hdr->packed = ptr != NULL;
+	if (!ptr) {
+		if (!rec->msg) {
+			va_copy(args, *rec->args);
+			vsnprintf(msg, sizeof(msg), rec->fmt, args);
+			va_end(args);
+			rec->msg = msg;
+		}
+		ptr = log_buffer_add_str(body, end, rec->msg);
+	}
+	hdr->size = ALIGN(ptr - (char *)hdr, sizeof(ulong));
+	log_buffer_write(hdr);
+
+	/* Don't leave the local buffer behind for later drivers */
+	if (rec->msg == msg)
+		rec->msg = NULL;
+
+	return 0;
+}
+
+void log_buffer_clear(void)
+{
+	log_buf.rd = 0;
+	log_buf.wr = 0;
+	log_buf.count = 0;
+	log_buf.dropped = 0;
+}
+
+int log_buffer_dump(int max_recs)
+{
+	char line[CONFIG_SYS_CBSIZE];
+	uint pos = log_buf.rd;
+	int i, skip;
+
+	skip = max_recs < 0 ? 0 : max(0, (int)log_buf.count - max_recs);
+	if (!skip && log_buf.dropped)
+		printf("(%lu older records dropped)\n", log_buf.dropped);
+	for (i = 0; i < log_buf.count; i++, pos = log_buffer_next(pos)) {
+		if (i < skip)
+			continue;
+		log_buffer_show(log_buffer_hdr(pos), line, sizeof(line));
+		puts(line);
+	}
+
+	return i - skip;
+}
+
+int log_buffer_export(void)
+{
+	char line[CONFIG_SYS_CBSIZE];
+	int size, upto, i, len;
+	char *blob;
+	uint pos;
+	int ret;
+
+	if (!log_buf.buf)
+		return -ENOENT;
+	size = 1;
+	for (i = 0, pos = log_buf.rd; i < log_buf.count;
+	     i++, pos = log_buffer_next(pos))
+		size += log_buffer_show(log_buffer_hdr(pos), line,
+					sizeof(line));
+	ret = bloblist_ensure_size_ret(BLOBLISTT_LOG, &size, (void **)&blob);
+	if (ret)
+		return ret;
+
+	for (i = 0, upto = 0, pos = log_buf.rd; i < log_buf.count;
+	     i++, pos = log_buffer_next(pos)) {
+		len = log_buffer_show(log_buffer_hdr(pos), line, sizeof(line));
+		if (upto + len >= size)
+			break;
+		memcpy(blob + upto, line, len);
+		upto += len;
+	}
+	blob[upto] = '\0';
+
+	return 0;
+}
+
+LOG_DRIVER(buffer) = {
+	.name	= "buffer",
+	.flags	= LOGDF_DEFERRED,
+	.emit	= log_buffer_emit,
+};
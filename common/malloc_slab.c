@@ -0,0 +1,254 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Size-class allocator for small fixed-size objects
+ *
+ * Each size class holds a list of pages obtained from malloc(). A page is
+ * split into objects of the class size, which are handed out in order and
+ * then reused via a per-page free list once freed. Before relocation the
+ * pages come from the simple malloc() pool, which cannot free anything, so
+ * reusing objects here is the only way that memory is reclaimed. Once the
+ * full malloc() is available, a page is returned to the heap as soon as its
+ * last object is freed.
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <slab.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+/* Size of the pages used before and after full malloc() is available */
+#define SLAB_PAGE_SIZE_F	512
+#define SLAB_PAGE_SIZE		4096
+
+/* Alignment of the first object in a page */
+#define SLAB_ALIGN		16
+
+static const u16 slab_sizes[SLAB_CLASS_COUNT] = {
+	16, 32, 48, 64, 96, 128, 192, SLAB_MAX_SIZE,
+};
+
+/**
+ * struct slab_page - A page holding objects of the same size
+ *
+ * @next: Next page in the same size class
+ * @free: First freed object in this page, or NULL if none. Each freed object
+ *	holds a pointer to the next one.
+ * @base: First object in the page
+ * @count: Number of objects the page can hold
+ * @carved: Number of objects which have been handed out at least once. The
+ *	remaining objects have never been used.
+ * @used: Number of objects currently in use
+ */
+struct slab_page {
+	struct slab_page *next;
+	void *free;
+	char *base;
+	uint count;
+	uint carved;
+	uint used;
+};
+
+/**
+ * struct slab_class - A size class
+ *
+ * @pages: Pages in this class, most recently allocated first
+ * @stats: Statistics for this class
+ */
+struct slab_class {
+	struct slab_page *pages;
+	struct slab_stats stats;
+};
+
+/**
+ * struct slab_state - State of the slab allocator
+ *
+ * This is allocated from the pool the pages come from. Whether that is the
+ * full malloc() is recorded in gd->slab_full_malloc rather than here, since
+ * the pre-relocation pool may not be readable after relocation.
+ *
+ * @cls: Size classes
+ */
+struct slab_state {
+	struct slab_class cls[SLAB_CLASS_COUNT];
+};
+
+static bool slab_full_malloc(void)
+{
+#if CONFIG_VAL(SYS_MALLOC_F_LEN)
+	return gd->flags & GD_FLG_FULL_MALLOC_INIT;
+#else
+	return true;
+#endif
+}
+
+static int slab_class(size_t size)
+{
+	int i;
+
+	for (i = 0; i < SLAB_CLASS_COUNT; i++) {
+		if (size <= slab_sizes[i])
+			return i;
+	}
+
+	return -1;
+}
+
+/* Get the state, ignoring (without reading) one left from before relocation */
+static struct slab_state *slab_cur_state(void)
+{
+	if (gd->slab && gd->slab_full_malloc == slab_full_malloc())
+		return gd->slab;
+
+	return NULL;
+}
+
+static struct slab_state *slab_get_state(void)
+{
+	struct slab_state *state = slab_cur_state();
+	int i;
+
+	if (state)
+		return state;
+
+	/*
+	 * Objects allocated before relocation are left where they are, since
+	 * the pre-relocation pool may not survive. Start again with no pages.
+	 */
+	state = malloc(sizeof(*state));
+	if (!state)
+		return NULL;
+	memset(state, '\0', sizeof(*state));
+	for (i = 0; i < SLAB_CLASS_COUNT; i++)
+		state->cls[i].stats.size = slab_sizes[i];
+	gd->slab = state;
+	gd->slab_full_malloc = slab_full_malloc();
+
+	return state;
+}
+
+static struct slab_page *slab_add_page(struct slab_class *cls)
+{
+	uint hdr_size = ALIGN(sizeof(struct slab_page), SLAB_ALIGN);
+	uint page_size;
+	struct slab_page *page;
+
+	page_size = gd->slab_full_malloc ? SLAB_PAGE_SIZE : SLAB_PAGE_SIZE_F;
+	page_size = max(page_size, hdr_size + cls->stats.size);
+	page = malloc(page_size);
+	if (!page)
+		return NULL;
+	page->free = NULL;
+	page->base = (char *)page + hdr_size;
+	page->count = (page_size - hdr_size) / cls->stats.size;
+	page->carved = 0;
+	page->used = 0;
+	page->next = cls->pages;
+	cls->pages = page;
+	cls->stats.pages++;
+
+	return page;
+}
+
+void *slab_alloc(size_t size)
+{
+	struct slab_state *state;
+	struct slab_class *cls;
+	struct slab_page *page;
+	void *ptr;
+	int i;
+
+	i = slab_class(size);
+	if (i < 0)
+		return calloc(1, size);
+	state = slab_get_state();
+	if (!state)
+		return NULL;
+	cls = &state->cls[i];
+
+	for (page = cls->pages; page; page = page->next) {
+		if (page->free || page->carved < page->count)
+			break;
+	}
+	if (!page) {
+		page = slab_add_page(cls);
+		if (!page)
+			return NULL;
+	}
+	if (page->free) {
+		ptr = page->free;
+		page->free = *(void **)ptr;
+	} else {
+		ptr = page->base + page->carved++ * cls->stats.size;
+	}
+	page->used++;
+
+	cls->stats.allocs++;
+	if (++cls->stats.objs > cls->stats.peak)
+		cls->stats.peak = cls->stats.objs;
+	memset(ptr, '\0', size);
+
+	return ptr;
+}
+
+void slab_free(void *ptr, size_t size)
+{
+	struct slab_state *state = slab_cur_state();
+	struct slab_page *page, **pagep;
+	struct slab_class *cls;
+	char *obj = ptr;
+	int i;
+
+	if (!ptr)
+		return;
+	i = slab_class(size);
+	if (i < 0) {
+		free(ptr);
+		return;
+	}
+
+	/* Pre-relocation objects are never freed, as with free() */
+	if (!state)
+		return;
+	cls = &state->cls[i];
+	for (pagep = &cls->pages; (page = *pagep); pagep = &page->next) {
+		if (obj >= page->base &&
+		    obj < page->base + page->count * cls->stats.size)
+			break;
+	}
+	if (!page) {
+		debug("%s: Object %p not found in size class %u\n", __func__,
+		      ptr, cls->stats.size);
+		return;
+	}
+
+	*(void **)ptr = page->free;
+	page->free = ptr;
+	page->used--;
+	cls->stats.objs--;
+	cls->stats.frees++;
+
+	/* A page can only be released if free() is able to reclaim it */
+	if (!page->used && gd->slab_full_malloc &&
+	    !CONFIG_IS_ENABLED(SYS_MALLOC_SIMPLE)) {
+		*pagep = page->next;
+		cls->stats.pages--;
+		free(page);
+	}
+}
+
+int slab_get_stats(int class, struct slab_stats *stats)
+{
+	struct slab_state *state = slab_cur_state();
+
+	if (class < 0 || class >= SLAB_CLASS_COUNT)
+		return -ENOENT;
+	if (state) {
+		*stats = state->cls[class].stats;
+	} else {
+		memset(stats, '\0', sizeof(*stats));
+		stats->size = slab_sizes[class];
+	}
+
+	return 0;
+}
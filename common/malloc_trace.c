@@ -0,0 +1,266 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tracing of malloc() calls
+ *
+ * The public allocation functions are defined here. They call the dlmalloc
+ * implementation (which is built with a 'dl' prefix when tracing is enabled)
+ * and record each call in a ring buffer. Calls made within dlmalloc itself,
+ * e.g. from realloc() to malloc(), are therefore not recorded twice.
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <malloc_trace.h>
+#include <sort.h>
+#include <time.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+static struct malloc_trace_rec trace_ring[CONFIG_MALLOC_TRACE_SIZE];
+static struct malloc_trace_stats trace_stats;
+
+/*
+ * Set while a record is being written. Reading the timer may itself call
+ * malloc(), e.g. to probe the timer device, and such calls are not recorded.
+ */
+static bool trace_busy;
+
+/* The ring buffer lives in BSS so is only usable after relocation */
+static bool trace_active(void)
+{
+	return gd->flags & GD_FLG_FULL_MALLOC_INIT;
+}
+
+/* Get the number of bytes used by an allocation, if it is in the heap */
+static ulong trace_chunk_size(void *ptr)
+{
+	ulong addr = (ulong)ptr;
+
+	if (!ptr || addr < mem_malloc_start || addr >= mem_malloc_end)
+		return 0;
+
+	return malloc_usable_size(ptr);
+}
+
+static void trace_add(enum malloc_trace_type type, void *caller, void *ptr,
+		      ulong size)
+{
+	struct malloc_trace_rec *rec;
+
+	if (trace_busy)
+		return;
+	trace_busy = true;
+	rec = &trace_ring[trace_stats.count++ % CONFIG_MALLOC_TRACE_SIZE];
+	rec->caller = caller;
+	rec->ptr = ptr;
+	rec->size = size;
+	rec->type = type;
+	rec->time = timer_get_us();
+	trace_busy = false;
+}
+
+static void trace_alloc(void *caller, void *ptr, ulong size)
+{
+	if (!trace_active())
+		return;
+	if (ptr) {
+		trace_stats.allocs++;
+		trace_stats.in_use += trace_chunk_size(ptr);
+		if (trace_stats.in_use > trace_stats.peak)
+			trace_stats.peak = trace_stats.in_use;
+	} else {
+		trace_stats.failed++;
+	}
+	trace_add(MALLOC_TRACE_ALLOC, caller, ptr, size);
+}
+
+static void trace_free(void *caller, void *ptr, ulong chunk_size)
+{
+	if (!ptr || !trace_active())
+		return;
+	trace_stats.frees++;
+	trace_stats.in_use -= chunk_size;
+	trace_add(MALLOC_TRACE_FREE, caller, ptr, 0);
+}
+
+void *malloc(size_t bytes)
+{
+	void *ptr = dlmalloc(bytes);
+
+	trace_alloc(__builtin_return_address(0), ptr, bytes);
+
+	return ptr;
+}
+
+void *calloc(size_t n, size_t elem_size)
+{
+	void *ptr = dlcalloc(n, elem_size);
+
+	trace_alloc(__builtin_return_address(0), ptr, n * elem_size);
+
+	return ptr;
+}
+
+void *memalign(size_t alignment, size_t bytes)
+{
+	void *ptr = dlmemalign(alignment, bytes);
+
+	trace_alloc(__builtin_return_address(0), ptr, bytes);
+
+	return ptr;
+}
+
+void *valloc(size_t bytes)
+{
+	void *ptr = dlvalloc(bytes);
+
+	trace_alloc(__builtin_return_address(0), ptr, bytes);
+
+	return ptr;
+}
+
+void *pvalloc(size_t bytes)
+{
+	void *ptr = dlpvalloc(bytes);
+
+	trace_alloc(__builtin_return_address(0), ptr, bytes);
+
+	return ptr;
+}
+
+void *realloc(void *oldmem, size_t bytes)
+{
+	void *caller = __builtin_return_address(0);
+	ulong old_size = trace_chunk_size(oldmem);
+	void *ptr;
+
+	ptr = dlrealloc(oldmem, bytes);
+	if (ptr || !bytes)
+		trace_free(caller, oldmem, old_size);
+	if (ptr || bytes)
+		trace_alloc(caller, ptr, bytes);
+
+	return ptr;
+}
+
+void free(void *ptr)
+{
+	trace_free(__builtin_return_address(0), ptr, trace_chunk_size(ptr));
+	dlfree(ptr);
+}
+
+void malloc_trace_get_stats(struct malloc_trace_stats *stats)
+{
+	*stats = trace_stats;
+}
+
+static int trace_held(void)
+{
+	return min_t(ulong, trace_stats.count, CONFIG_MALLOC_TRACE_SIZE);
+}
+
+static struct malloc_trace_rec *trace_rec(int seq)
+{
+	ulong first = trace_stats.count - trace_held();
+
+	return &trace_ring[(first + seq) % CONFIG_MALLOC_TRACE_SIZE];
+}
+
+int malloc_trace_get_rec(int seq, struct malloc_trace_rec *rec)
+{
+	if (seq < 0 || seq >= trace_held())
+		return -ENOENT;
+	*rec = *trace_rec(seq);
+
+	return 0;
+}
+
+static int trace_site_cmp(const void *a, const void *b)
+{
+	const struct malloc_trace_site *sa = a, *sb = b;
+
+	if (sa->live_bytes != sb->live_bytes)
+		return sa->live_bytes < sb->live_bytes ? 1 : -1;
+	if (sa->allocs != sb->allocs)
+		return sa->allocs < sb->allocs ? 1 : -1;
+
+	return 0;
+}
+
+int malloc_trace_get_sites(struct malloc_trace_site *sites, int max_sites)
+{
+	struct malloc_trace_site *all, *site;
+	int held = trace_held();
+	int count, seq, i;
+	char *freed;
+
+	/* Use dlmalloc directly so that this does not disturb the trace */
+	freed = dlcalloc(held + 1, 1);
+	all = dlcalloc(held + 1, sizeof(*all));
+	if (!freed || !all) {
+		dlfree(freed);
+		dlfree(all);
+		return -ENOMEM;
+	}
+
+	/* Match each free with the latest unfreed allocation of its pointer */
+	for (seq = 0; seq < held; seq++) {
+		struct malloc_trace_rec *rec = trace_rec(seq);
+
+		if (rec->type != MALLOC_TRACE_FREE)
+			continue;
+		for (i = seq - 1; i >= 0; i--) {
+			struct malloc_trace_rec *prev = trace_rec(i);
+
+			if (prev->type == MALLOC_TRACE_ALLOC &&
+			    prev->ptr == rec->ptr && !freed[i]) {
+				freed[i] = true;
+				break;
+			}
+		}
+	}
+
+	count = 0;
+	for (seq = 0; seq < held; seq++) {
+		struct malloc_trace_rec *rec = trace_rec(seq);
+
+		if (rec->type != MALLOC_TRACE_ALLOC || !rec->ptr)
+			continue;
+		for (site = all; site < all + count; site++) {
+			if (site->caller == rec->caller)
+				break;
+		}
+		if (site == all + count) {
+			site->caller = rec->caller;
+			count++;
+		}
+		site->allocs++;
+		site->bytes += rec->size;
+		if (!freed[seq]) {
+			site->live++;
+			site->live_bytes += rec->size;
+		}
+	}
+	qsort(all, count, sizeof(*all), trace_site_cmp);
+	memcpy(sites, all, min(count, max_sites) * sizeof(*all));
+	dlfree(freed);
+	dlfree(all);
+
+	return count;
+}
+
+void malloc_trace_reset(void)
+{
+	trace_stats.allocs = 0;
+	trace_stats.frees = 0;
+	trace_stats.failed = 0;
+	trace_stats.count = 0;
+	trace_stats.peak = trace_stats.in_use;
+}
+
+void malloc_trace_report(void)
+{
+	printf("malloc: %#lx bytes in use, high-water mark %#lx of %#lx\n",
+	       trace_stats.in_use, trace_stats.peak,
+	       mem_malloc_end - mem_malloc_start);
+}
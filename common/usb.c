@@ -285,6 +285,66 @@ int usb_bulk_msg(struct usb_device *dev, unsigned int pipe,
 		return -EIO;
 }
 
+#if !CONFIG_IS_ENABLED(DM_USB)
+/* Legacy controller drivers cannot queue bulk transfers */
+int submit_bulk_req(struct usb_device *dev, struct usb_bulk_req *req)
+{
+	return -ENOSYS;
+}
+
+int reap_bulk_req(struct usb_device *dev, struct usb_bulk_req *req,
+		  int timeout)
+{
+	return -ENOSYS;
+}
+
+int cancel_bulk_reqs(struct usb_device *dev, unsigned long pipe)
+{
+	return -ENOSYS;
+}
+#endif
+
+int usb_bulk_submit(struct usb_device *dev, struct usb_bulk_req *req)
+{
+	int ret;
+
+	req->act_len = 0;
+	req->status = USB_ST_NOT_PROC;
+	req->done = false;
+	if (req->length < 0)
+		return -EINVAL;
+	ret = submit_bulk_req(dev, req);
+
+	/* If the controller cannot queue it, it is done when reaped */
+	return ret == -ENOSYS ? 0 : ret;
+}
+
+int usb_bulk_reap(struct usb_device *dev, struct usb_bulk_req *req,
+		  int timeout)
+{
+	int ret;
+
+	if (!req->done) {
+		ret = reap_bulk_req(dev, req, timeout);
+		if (ret == -ENOSYS) {
+			usb_bulk_msg(dev, req->pipe, req->buffer, req->length,
+				     &req->act_len, timeout);
+			req->status = dev->status;
+			req->done = true;
+		} else if (ret) {
+			return ret;
+		}
+	}
+
+	return req->status ? -EIO : 0;
+}
+
+void usb_bulk_cancel(struct usb_device *dev, unsigned long pipe)
+{
+	/* Without a queue, unreaped requests were never started */
+	cancel_bulk_reqs(dev, pipe);
+}
+
 
 /*-------------------------------------------------------------------
  * Max Packet stuff
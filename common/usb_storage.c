@@ -35,11 +35,13 @@
 #include <common.h>
 #include <command.h>
 #include <dm.h>
+#include <env.h>
 #include <errno.h>
 #include <mapmem.h>
 #include <memalign.h>
 #include <asm/byteorder.h>
 #include <asm/processor.h>
+#include <asm/unaligned.h>
 #include <dm/device-internal.h>
 #include <dm/lists.h>
 
@@ -62,6 +64,9 @@ static const unsigned char us_direction[256/8] = {
 #define US_DIRECTION(x) ((us_direction[x>>3] >> (x & 7)) & 1)
 
 static struct scsi_cmd usb_ccb __aligned(ARCH_DMA_MINALIGN);
+#ifdef CONFIG_USB_STORAGE_UAS
+static struct scsi_cmd usb_uas_ccb[CONFIG_USB_STORAGE_UAS_QUEUE];
+#endif
 static __u32 CBWTag;
 
 static int usb_max_devs; /* number of highest available usb device */
@@ -79,10 +84,15 @@ struct us_data {
 
 	unsigned int	flags;			/* from filter initially */
 #	define USB_READY	(1 << 0)
+	unsigned int	quirks;			/* from usb_storage_quirks */
+#	define US_FL_LARGE_XFER	(1 << 0)	/* large USB3 transfers */
+#	define US_FL_IGNORE_UAS	(1 << 1)	/* use BBB even if UAS */
 	unsigned char	ifnum;			/* interface number */
 	unsigned char	ep_in;			/* in endpoint */
 	unsigned char	ep_out;			/* out ....... */
 	unsigned char	ep_int;			/* interrupt . */
+	unsigned char	ep_cmd;			/* UAS command */
+	unsigned char	ep_status;		/* UAS status */
 	unsigned char	subclass;		/* as in overview */
 	unsigned char	protocol;		/* .............. */
 	unsigned char	attention_done;		/* force attn on first cmd */
@@ -706,6 +716,8 @@ static int usb_stor_BBB_transport(struct scsi_cmd *srb, struct us_data *us)
 	int dir_in;
 	int actlen, data_actlen;
 	unsigned int pipe, pipein, pipeout;
+	struct usb_bulk_req data_req, csw_req;
+	bool csw_queued = false;
 	ALLOC_CACHE_ALIGN_BUFFER(struct umass_bbb_csw, csw, 1);
 #ifdef BBB_XPORT_TRACE
 	unsigned char *ptr;
@@ -738,8 +750,30 @@ static int usb_stor_BBB_transport(struct scsi_cmd *srb, struct us_data *us)
 	else
 		pipe = pipeout;
 
-	result = usb_bulk_msg(us->pusb_dev, pipe, srb->pdata, srb->datalen,
-			      &data_actlen, USB_CNTL_TIMEOUT * 5);
+	/*
+	 * Queue the CSW behind the data, so that the controller can go
+	 * straight on to it without waiting for us
+	 */
+	data_req.pipe = pipe;
+	data_req.buffer = srb->pdata;
+	data_req.length = srb->datalen;
+	result = usb_bulk_submit(us->pusb_dev, &data_req);
+	if (!result) {
+		csw_req.pipe = pipein;
+		csw_req.buffer = csw;
+		csw_req.length = UMASS_BBB_CSW_SIZE;
+		csw_queued = !usb_bulk_submit(us->pusb_dev, &csw_req);
+		result = usb_bulk_reap(us->pusb_dev, &data_req,
+				       USB_CNTL_TIMEOUT * 5);
+	}
+	if (result < 0) {
+		usb_bulk_cancel(us->pusb_dev, pipe);
+		if (csw_queued && pipe != pipein)
+			usb_bulk_cancel(us->pusb_dev, pipein);
+		csw_queued = false;
+	}
+	data_actlen = data_req.act_len;
+	us->pusb_dev->status = data_req.status;
 	/* special handling of STALL in DATA phase */
 	if ((result < 0) && (us->pusb_dev->status & USB_ST_STALLED)) {
 		debug("DATA:stall\n");
@@ -766,8 +800,18 @@ st:
 	retry = 0;
 again:
 	debug("STATUS phase\n");
-	result = usb_bulk_msg(us->pusb_dev, pipein, csw, UMASS_BBB_CSW_SIZE,
-				&actlen, USB_CNTL_TIMEOUT*5);
+	if (csw_queued) {
+		csw_queued = false;
+		result = usb_bulk_reap(us->pusb_dev, &csw_req,
+				       USB_CNTL_TIMEOUT * 5);
+		if (result == -ETIMEDOUT)
+			usb_bulk_cancel(us->pusb_dev, pipein);
+		us->pusb_dev->status = csw_req.status;
+	} else {
+		result = usb_bulk_msg(us->pusb_dev, pipein, csw,
+				      UMASS_BBB_CSW_SIZE, &actlen,
+				      USB_CNTL_TIMEOUT * 5);
+	}
 
 	/* special handling of STALL in STATUS phase */
 	if ((result < 0) && (retry < 1) &&
@@ -823,6 +867,133 @@ again:
 	return result;
 }
 
+#ifdef CONFIG_USB_STORAGE_UAS
+static int usb_stor_UAS_reset(struct us_data *us)
+{
+	struct usb_device *udev = us->pusb_dev;
+
+	/* There is no class reset request, so just clear halted pipes */
+	debug("UAS_reset\n");
+	usb_clear_halt(udev, usb_sndbulkpipe(udev, us->ep_cmd));
+	usb_clear_halt(udev, usb_rcvbulkpipe(udev, us->ep_status));
+	usb_clear_halt(udev, usb_rcvbulkpipe(udev, us->ep_in));
+	usb_clear_halt(udev, usb_sndbulkpipe(udev, us->ep_out));
+
+	return 0;
+}
+
+/**
+ * usb_stor_UAS_queue() - run several commands over UAS
+ *
+ * All the commands are sent before any status is read, tagged with their
+ * position in @srb plus one. The device then says on the status pipe which
+ * command it is ready to move data for, and finally sends its sense IU.
+ * This is done without streams, so the data pipes carry one command's data
+ * at a time, but the device can work on the next command meanwhile.
+ *
+ * @us:		UAS device
+ * @srb:	Commands to run
+ * @count:	Number of commands, at most 32
+ * @return number of commands at the start of @srb which succeeded
+ */
+static int usb_stor_UAS_queue(struct us_data *us, struct scsi_cmd **srb,
+			      int count)
+{
+	ALLOC_CACHE_ALIGN_BUFFER(struct uas_command_iu, cmd, 1);
+	ALLOC_CACHE_ALIGN_BUFFER(struct uas_sense_iu, iu, 1);
+	struct usb_device *udev = us->pusb_dev;
+	u32 pending = 0, failed = 0;
+	unsigned int pipe;
+	int result, actlen, len;
+	int i, tag;
+
+	for (i = 0; i < count; i++) {
+		memset(cmd, '\0', sizeof(*cmd));
+		cmd->iu_id = UAS_IU_ID_COMMAND;
+		cmd->tag = cpu_to_be16(i + 1);
+		cmd->lun[1] = srb[i]->lun;
+		memcpy(cmd->cdb, srb[i]->cmd,
+		       min_t(int, srb[i]->cmdlen, sizeof(cmd->cdb)));
+		result = usb_bulk_msg(udev, usb_sndbulkpipe(udev, us->ep_cmd),
+				      cmd, UAS_COMMAND_IU_SIZE, &actlen,
+				      USB_CNTL_TIMEOUT * 5);
+		if (result < 0) {
+			debug("UAS: failed to send command %d\n", i + 1);
+			break;
+		}
+		pending |= BIT(i);
+	}
+	/* Commands which could not be sent count as failed */
+	for (tag = i; tag < count; tag++)
+		failed |= BIT(tag);
+
+	while (pending) {
+		pipe = usb_rcvbulkpipe(udev, us->ep_status);
+		result = usb_bulk_msg(udev, pipe, iu, sizeof(*iu), &actlen,
+				      USB_CNTL_TIMEOUT * 5);
+		if (result < 0 || actlen < 4)
+			goto err;
+		tag = be16_to_cpu(iu->tag);
+		if (tag < 1 || tag > count || !(pending & BIT(tag - 1))) {
+			debug("UAS: unexpected tag %d\n", tag);
+			goto err;
+		}
+		i = tag - 1;
+
+		switch (iu->iu_id) {
+		case UAS_IU_ID_READ_READY:
+		case UAS_IU_ID_WRITE_READY:
+			if (iu->iu_id == UAS_IU_ID_READ_READY)
+				pipe = usb_rcvbulkpipe(udev, us->ep_in);
+			else
+				pipe = usb_sndbulkpipe(udev, us->ep_out);
+			result = usb_bulk_msg(udev, pipe, srb[i]->pdata,
+					      srb[i]->datalen, &actlen,
+					      USB_CNTL_TIMEOUT * 5);
+			if (result < 0)
+				goto err;
+			break;
+		case UAS_IU_ID_SENSE:
+			if (actlen < UAS_SENSE_IU_HDR_SIZE)
+				goto err;
+			pending &= ~BIT(i);
+			if (!iu->status)
+				break;
+			debug("UAS: command %d status %x\n", tag, iu->status);
+			failed |= BIT(i);
+			len = min_t(int, be16_to_cpu(iu->len),
+				    actlen - UAS_SENSE_IU_HDR_SIZE);
+			len = min_t(int, len, sizeof(srb[i]->sense_buf));
+			memset(srb[i]->sense_buf, '\0',
+			       sizeof(srb[i]->sense_buf));
+			memcpy(srb[i]->sense_buf, iu->sense, len);
+			break;
+		default:
+			debug("UAS: unexpected IU %x\n", iu->iu_id);
+			goto err;
+		}
+	}
+
+	goto done;
+err:
+	usb_stor_UAS_reset(us);
+	failed |= pending;
+done:
+	for (i = 0; i < count && !(failed & BIT(i)); i++)
+		;
+
+	return i;
+}
+
+static int usb_stor_UAS_transport(struct scsi_cmd *srb, struct us_data *us)
+{
+	if (usb_stor_UAS_queue(us, &srb, 1) != 1)
+		return USB_STOR_TRANSPORT_FAILED;
+
+	return USB_STOR_TRANSPORT_GOOD;
+}
+#endif
+
 static int usb_stor_CB_transport(struct scsi_cmd *srb, struct us_data *us)
 {
 	int result, status;
@@ -961,6 +1132,14 @@ static void usb_stor_set_max_xfer_blk(struct usb_device *udev,
 	size_t size;
 	int ret;
 
+	/*
+	 * USB3 devices which have been found to cope can be listed in the
+	 * usb_storage_quirks environment variable, to move several MB per
+	 * command, as far as the host controller allows
+	 */
+	if ((us->quirks & US_FL_LARGE_XFER) && udev->speed >= USB_SPEED_SUPER)
+		blk = CONFIG_USB_STORAGE_LARGE_XFER_BLK;
+
 	ret = usb_get_max_xfer_size(udev, (size_t *)&size);
 	if ((ret >= 0) && (size < blk * 512))
 		blk = size / 512;
@@ -997,6 +1176,11 @@ static int usb_request_sense(struct scsi_cmd *srb, struct us_data *ss)
 {
 	char *ptr;
 
+#ifdef CONFIG_USB_STORAGE_UAS
+	/* UAS devices send the sense data along with the status */
+	if (ss->protocol == US_PR_UAS)
+		return 0;
+#endif
 	ptr = (char *)srb->pdata;
 	memset(&srb->cmd[0], 0, 12);
 	srb->cmd[0] = SCSI_REQ_SENSE;
@@ -1120,6 +1304,53 @@ static void usb_bin_fixup(struct usb_device_descriptor descriptor,
 }
 #endif /* CONFIG_USB_BIN_FIXUP */
 
+#ifdef CONFIG_USB_STORAGE_UAS
+/*
+ * Read with up to CONFIG_USB_STORAGE_UAS_QUEUE READ(10) commands queued on
+ * the device at once. Returns the number of blocks read, so that the caller
+ * can go on with the rest one command at a time, with its usual retries.
+ */
+static lbaint_t usb_stor_UAS_read(struct us_data *ss,
+				  struct blk_desc *block_dev, lbaint_t start,
+				  lbaint_t blkcnt, uintptr_t buf_addr)
+{
+	struct scsi_cmd *srbs[CONFIG_USB_STORAGE_UAS_QUEUE];
+	struct scsi_cmd *srb;
+	lbaint_t done = 0, pos, blks;
+	int count, ok, i;
+
+	while (done < blkcnt) {
+		pos = done;
+		for (count = 0; count < CONFIG_USB_STORAGE_UAS_QUEUE &&
+		     pos < blkcnt; count++) {
+			blks = min(blkcnt - pos, (lbaint_t)ss->max_xfer_blk);
+			srb = &usb_uas_ccb[count];
+			memset(srb->cmd, '\0', sizeof(srb->cmd));
+			srb->cmd[0] = SCSI_READ10;
+			put_unaligned_be32(start + pos, &srb->cmd[2]);
+			put_unaligned_be16(blks, &srb->cmd[7]);
+			srb->cmdlen = 10;
+			srb->lun = block_dev->lun;
+			srb->pdata = (unsigned char *)buf_addr +
+				     pos * block_dev->blksz;
+			srb->datalen = blks * block_dev->blksz;
+			srbs[count] = srb;
+			pos += blks;
+		}
+		if (blkcnt >= ss->max_xfer_blk)
+			usb_show_progress();
+
+		ok = usb_stor_UAS_queue(ss, srbs, count);
+		for (i = 0; i < ok; i++)
+			done += srbs[i]->datalen / block_dev->blksz;
+		if (ok < count)
+			break;
+	}
+
+	return done;
+}
+#endif
+
 #if CONFIG_IS_ENABLED(BLK)
 static unsigned long usb_stor_read(struct udevice *dev, lbaint_t blknr,
 				   lbaint_t blkcnt, void *buffer)
@@ -1130,7 +1361,7 @@ static unsigned long usb_stor_read(struct blk_desc *block_dev, lbaint_t blknr,
 {
 	lbaint_t start, blks;
 	uintptr_t buf_addr;
-	unsigned short smallblks;
+	unsigned short smallblks = 0;
 	struct usb_device *udev;
 	struct us_data *ss;
 	int retry;
@@ -1165,7 +1396,18 @@ static unsigned long usb_stor_read(struct blk_desc *block_dev, lbaint_t blknr,
 	debug("\nusb_read: dev %d startblk " LBAF ", blccnt " LBAF " buffer %lx\n",
 	      block_dev->devnum, start, blks, buf_addr);
 
-	do {
+#ifdef CONFIG_USB_STORAGE_UAS
+	if (ss->protocol == US_PR_UAS) {
+		lbaint_t done;
+
+		done = usb_stor_UAS_read(ss, block_dev, start, blks, buf_addr);
+		start += done;
+		blks -= done;
+		buf_addr += done * block_dev->blksz;
+	}
+#endif
+
+	while (blks) {
 		/* XXX need some comment here */
 		retry = 2;
 		srb->pdata = (unsigned char *)buf_addr;
@@ -1190,7 +1432,7 @@ retry_it:
 		start += smallblks;
 		blks -= smallblks;
 		buf_addr += srb->datalen;
-	} while (blks != 0);
+	}
 
 	debug("usb_read: end startblk " LBAF ", blccnt %x buffer %lx\n",
 	      start, smallblks, buf_addr);
@@ -1287,6 +1529,116 @@ retry_it:
 
 }
 
+/*
+ * Look up a device in the usb_storage_quirks environment variable. This is a
+ * comma-separated list of VID:PID:FLAGS entries, as for the usb-storage.quirks
+ * parameter in Linux, where the flags are 'l' to allow large transfers on
+ * USB3 and 'u' to use Bulk-Only Transport even if the device offers UAS.
+ */
+static unsigned int usb_stor_get_quirks(struct usb_device *dev)
+{
+	const char *p = env_get("usb_storage_quirks");
+	unsigned int vid, pid, quirks;
+	char *end;
+
+	while (p && *p) {
+		vid = simple_strtoul(p, &end, 16);
+		if (*end != ':')
+			break;
+		pid = simple_strtoul(end + 1, &end, 16);
+		if (*end != ':')
+			break;
+		for (quirks = 0, p = end + 1; *p && *p != ','; p++) {
+			if (*p == 'l')
+				quirks |= US_FL_LARGE_XFER;
+			else if (*p == 'u')
+				quirks |= US_FL_IGNORE_UAS;
+		}
+		if (vid == dev->descriptor.idVendor &&
+		    pid == dev->descriptor.idProduct)
+			return quirks;
+		if (*p == ',')
+			p++;
+	}
+
+	return 0;
+}
+
+#ifdef CONFIG_USB_STORAGE_UAS
+/*
+ * Look for a UAS alternate setting of an interface and its four pipes. The
+ * pipe usage descriptors which tell these apart are not kept when the
+ * configuration is parsed, so it is read again here. Returns the alternate
+ * setting, or -ve if there is none.
+ */
+static int usb_stor_UAS_find(struct usb_device *dev, int ifnum,
+			     struct us_data *ss)
+{
+	struct usb_interface_descriptor *idesc = NULL;
+	struct usb_endpoint_descriptor *edesc = NULL;
+	struct usb_descriptor_header *head;
+	struct uas_pipe_usage_desc *pdesc;
+	unsigned char ep[UAS_PIPE_ID_DATA_OUT + 1];
+	unsigned char *buf;
+	bool uas = false;
+	int len, pos, ret;
+
+	len = usb_get_configuration_len(dev, 0);
+	if (len < 0)
+		return len;
+	buf = malloc_cache_aligned(len);
+	if (!buf)
+		return -ENOMEM;
+	len = usb_get_configuration_no(dev, 0, buf, len);
+
+	memset(ep, '\0', sizeof(ep));
+	for (pos = 0; pos + 2 <= len; pos += head->bLength) {
+		head = (struct usb_descriptor_header *)&buf[pos];
+		if (head->bLength < 2 || pos + head->bLength > len)
+			break;
+		if (head->bDescriptorType == USB_DT_INTERFACE &&
+		    head->bLength >= USB_DT_INTERFACE_SIZE) {
+			idesc = (struct usb_interface_descriptor *)head;
+			uas = idesc->bInterfaceNumber == ifnum &&
+			      idesc->bInterfaceClass ==
+					USB_CLASS_MASS_STORAGE &&
+			      idesc->bInterfaceSubClass == US_SC_SCSI &&
+			      idesc->bInterfaceProtocol == US_PR_UAS;
+			memset(ep, '\0', sizeof(ep));
+			edesc = NULL;
+		} else if (uas && head->bDescriptorType == USB_DT_ENDPOINT &&
+			   head->bLength >= USB_DT_ENDPOINT_SIZE) {
+			edesc = (struct usb_endpoint_descriptor *)head;
+		} else if (uas && edesc &&
+			   head->bDescriptorType == USB_DT_PIPE_USAGE &&
+			   head->bLength >= sizeof(*pdesc)) {
+			pdesc = (struct uas_pipe_usage_desc *)head;
+			if (pdesc->bPipeID >= UAS_PIPE_ID_CMD &&
+			    pdesc->bPipeID <= UAS_PIPE_ID_DATA_OUT)
+				ep[pdesc->bPipeID] = edesc->bEndpointAddress &
+						     USB_ENDPOINT_NUMBER_MASK;
+			if (ep[UAS_PIPE_ID_CMD] && ep[UAS_PIPE_ID_STATUS] &&
+			    ep[UAS_PIPE_ID_DATA_IN] && ep[UAS_PIPE_ID_DATA_OUT])
+				break;
+		}
+	}
+
+	if (uas && ep[UAS_PIPE_ID_CMD] && ep[UAS_PIPE_ID_STATUS] &&
+	    ep[UAS_PIPE_ID_DATA_IN] && ep[UAS_PIPE_ID_DATA_OUT]) {
+		ss->ep_cmd = ep[UAS_PIPE_ID_CMD];
+		ss->ep_status = ep[UAS_PIPE_ID_STATUS];
+		ss->ep_in = ep[UAS_PIPE_ID_DATA_IN];
+		ss->ep_out = ep[UAS_PIPE_ID_DATA_OUT];
+		ret = idesc->bAlternateSetting;
+	} else {
+		ret = -ENOENT;
+	}
+	free(buf);
+
+	return ret;
+}
+#endif
+
 /* Probe to see if a new device is actually a Storage device */
 int usb_storage_probe(struct usb_device *dev, unsigned int ifnum,
 		      struct us_data *ss)
@@ -1320,6 +1672,30 @@ int usb_storage_probe(struct usb_device *dev, unsigned int ifnum,
 	ss->attention_done = 0;
 	ss->subclass = iface->desc.bInterfaceSubClass;
 	ss->protocol = iface->desc.bInterfaceProtocol;
+	ss->quirks = usb_stor_get_quirks(dev);
+
+#ifdef CONFIG_USB_STORAGE_UAS
+	/*
+	 * UAS needs streams on SuperSpeed, which the host controller drivers
+	 * do not support, so such devices stay with Bulk-Only Transport
+	 */
+	if (dev->speed < USB_SPEED_SUPER && !(ss->quirks & US_FL_IGNORE_UAS)) {
+		i = usb_stor_UAS_find(dev, iface->desc.bInterfaceNumber, ss);
+		if (i >= 0 &&
+		    !usb_set_interface(dev, iface->desc.bInterfaceNumber, i)) {
+			debug("Transport: USB Attached SCSI\n");
+			ss->subclass = US_SC_SCSI;
+			ss->protocol = US_PR_UAS;
+			ss->transport = usb_stor_UAS_transport;
+			ss->transport_reset = usb_stor_UAS_reset;
+			goto found;
+		}
+		ss->ep_cmd = 0;
+		ss->ep_status = 0;
+		ss->ep_in = 0;
+		ss->ep_out = 0;
+	}
+#endif
 
 	/* set the handler pointers based on the protocol */
 	debug("Transport: ");
@@ -1393,6 +1769,9 @@ int usb_storage_probe(struct usb_device *dev, unsigned int ifnum,
 		printf("Sorry, protocol %d not yet supported.\n", ss->subclass);
 		return 0;
 	}
+#ifdef CONFIG_USB_STORAGE_UAS
+found:
+#endif
 	if (ss->ep_int) {
 		/* we had found an interrupt endpoint, prepare irq pipe
 		 * set up the IRQ pipe and handler
@@ -236,6 +236,7 @@ void part_init(struct blk_desc *dev_desc)
 	struct part_driver *entry;
 
 	blkcache_invalidate(dev_desc->if_type, dev_desc->devnum);
+	gpt_cache_recheck(dev_desc);
 
 	dev_desc->part_type = PART_TYPE_UNKNOWN;
 	for (entry = drv; entry != drv + n_ents; entry++) {
@@ -645,8 +646,35 @@ cleanup:
 	return ret;
 }
 
-int part_get_info_by_name_type(struct blk_desc *dev_desc, const char *name,
-			       disk_partition_t *info, int part_type)
+/**
+ * part_key_match() - Check whether a partition matches a search
+ *
+ * @info: Partition information, from get_info()
+ * @key: What to match
+ * @value: Partition name, or GUID as a string
+ * @return true if the partition matches
+ */
+static bool part_key_match(disk_partition_t *info, enum part_key key,
+			   const char *value)
+{
+	switch (key) {
+	case PART_KEY_NAME:
+		return !strcmp(value, (const char *)info->name);
+#if CONFIG_IS_ENABLED(PARTITION_UUIDS)
+	case PART_KEY_UUID:
+		return !strcasecmp(value, info->uuid);
+#endif
+#ifdef CONFIG_PARTITION_TYPE_GUID
+	case PART_KEY_TYPE_GUID:
+		return !strcasecmp(value, info->type_guid);
+#endif
+	default:
+		return false;
+	}
+}
+
+static int part_find(struct blk_desc *dev_desc, enum part_key key,
+		     const char *value, disk_partition_t *info)
 {
 	struct part_driver *part_drv;
 	int ret;
@@ -655,13 +683,17 @@ int part_get_info_by_name_type(struct blk_desc *dev_desc, const char *name,
 	part_drv = part_driver_lookup_type(dev_desc);
 	if (!part_drv)
 		return -1;
+	if (part_drv->find) {
+		ret = part_drv->find(dev_desc, key, value, info);
+		return ret > 0 ? ret : -1;
+	}
 	for (i = 1; i < part_drv->max_entries; i++) {
 		ret = part_drv->get_info(dev_desc, i, info);
 		if (ret != 0) {
 			/* no more entries in table */
 			break;
 		}
-		if (strcmp(name, (const char *)info->name) == 0) {
+		if (part_key_match(info, key, value)) {
 			/* matched */
 			return i;
 		}
@@ -670,12 +702,30 @@ int part_get_info_by_name_type(struct blk_desc *dev_desc, const char *name,
 	return -1;
 }
 
+int part_get_info_by_name_type(struct blk_desc *dev_desc, const char *name,
+			       disk_partition_t *info, int part_type)
+{
+	return part_find(dev_desc, PART_KEY_NAME, name, info);
+}
+
 int part_get_info_by_name(struct blk_desc *dev_desc, const char *name,
 			  disk_partition_t *info)
 {
 	return part_get_info_by_name_type(dev_desc, name, info, PART_TYPE_ALL);
 }
 
+int part_get_info_by_uuid(struct blk_desc *dev_desc, const char *uuid,
+			  disk_partition_t *info)
+{
+	return part_find(dev_desc, PART_KEY_UUID, uuid, info);
+}
+
+int part_get_info_by_type_guid(struct blk_desc *dev_desc,
+			       const char *type_guid, disk_partition_t *info)
+{
+	return part_find(dev_desc, PART_KEY_TYPE_GUID, type_guid, info);
+}
+
 /**
  * Get partition info from device number and partition name.
  *
@@ -180,6 +180,116 @@ static void prepare_backup_gpt_header(gpt_header *gpt_h)
 }
 
 #if CONFIG_IS_ENABLED(EFI_PARTITION)
+/**
+ * struct gpt_cache - Validated GPT of a block device
+ *
+ * Finding a partition by name looks at each partition in turn, and reading
+ * the table for each of them means reading and checking the CRCs of the
+ * header and all of the entries again. So the table is kept once it has been
+ * read, until something writes to the blocks holding it.
+ *
+ * @lba: Size of the device when the table was read
+ * @hwpart: Hardware partition the table was read from
+ * @recheck: Compare the header with the one on the disk before next use
+ * @header: Header of the table in use (primary or backup)
+ * @pte: Partition table entries
+ * @names: Partition names, as printed by print_efiname()
+ */
+struct gpt_cache {
+	lbaint_t lba;
+	int hwpart;
+	bool recheck;
+	gpt_header header;
+	gpt_entry *pte;
+	char (*names)[PARTNAME_SZ + 1];
+};
+
+static void gpt_cache_drop(struct blk_desc *dev_desc)
+{
+	struct gpt_cache *cache = dev_desc->gpt_cache;
+
+	if (!cache)
+		return;
+	free(cache->pte);
+	free(cache->names);
+	free(cache);
+	dev_desc->gpt_cache = NULL;
+}
+
+void gpt_cache_invalidate(struct blk_desc *dev_desc, lbaint_t start,
+			  lbaint_t blkcnt)
+{
+	struct gpt_cache *cache = dev_desc->gpt_cache;
+
+	if (!cache)
+		return;
+	if (!start ||
+	    start < le64_to_cpu(cache->header.first_usable_lba) ||
+	    start + blkcnt > le64_to_cpu(cache->header.last_usable_lba) + 1)
+		gpt_cache_drop(dev_desc);
+}
+
+void gpt_cache_recheck(struct blk_desc *dev_desc)
+{
+	if (dev_desc->gpt_cache)
+		dev_desc->gpt_cache->recheck = true;
+}
+
+/**
+ * gpt_cache_get() - Get the validated GPT of a device
+ *
+ * @dev_desc: Block device descriptor
+ * @return the cached table, reading it first if needed, or NULL if there is
+ *	no valid GPT
+ */
+static struct gpt_cache *gpt_cache_get(struct blk_desc *dev_desc)
+{
+	ALLOC_CACHE_ALIGN_BUFFER_PAD(gpt_header, gpt_head, 1, dev_desc->blksz);
+	struct gpt_cache *cache = dev_desc->gpt_cache;
+	gpt_entry *gpt_pte = NULL;
+	int i, count;
+
+	if (cache && (cache->lba != dev_desc->lba ||
+		      cache->hwpart != dev_desc->hwpart)) {
+		gpt_cache_drop(dev_desc);
+	} else if (cache && cache->recheck) {
+		/* The header holds the CRC of the entries too */
+		if (blk_dread(dev_desc, le64_to_cpu(cache->header.my_lba), 1,
+			      gpt_head) != 1 ||
+		    memcmp(gpt_head, &cache->header, sizeof(cache->header)))
+			gpt_cache_drop(dev_desc);
+		else
+			cache->recheck = false;
+	}
+	if (dev_desc->gpt_cache)
+		return dev_desc->gpt_cache;
+
+	/* This function validates AND fills in the GPT header and PTE */
+	if (find_valid_gpt(dev_desc, gpt_head, &gpt_pte) != 1)
+		return NULL;
+
+	count = le32_to_cpu(gpt_head->num_partition_entries);
+	cache = calloc(1, sizeof(*cache));
+	if (cache)
+		cache->names = calloc(count, sizeof(*cache->names));
+	if (!cache || !cache->names) {
+		printf("GPT: Failed to allocate memory for cache\n");
+		free(cache);
+		free(gpt_pte);
+		return NULL;
+	}
+
+	cache->lba = dev_desc->lba;
+	cache->hwpart = dev_desc->hwpart;
+	memcpy(&cache->header, gpt_head, sizeof(cache->header));
+	cache->pte = gpt_pte;
+	for (i = 0; i < count; i++)
+		strcpy(cache->names[i], print_efiname(&gpt_pte[i]));
+	dev_desc->gpt_cache = cache;
+
+	return cache;
+}
+
 /*
  * Public Functions (include/part.h)
  */
@@ -190,33 +300,29 @@ static void prepare_backup_gpt_header(gpt_header *gpt_h)
  */
 int get_disk_guid(struct blk_desc * dev_desc, char *guid)
 {
-	ALLOC_CACHE_ALIGN_BUFFER_PAD(gpt_header, gpt_head, 1, dev_desc->blksz);
-	gpt_entry *gpt_pte = NULL;
-	unsigned char *guid_bin;
+	struct gpt_cache *cache;
 
-	/* This function validates AND fills in the GPT header and PTE */
-	if (find_valid_gpt(dev_desc, gpt_head, &gpt_pte) != 1)
+	cache = gpt_cache_get(dev_desc);
+	if (!cache)
 		return -EINVAL;
 
-	guid_bin = gpt_head->disk_guid.b;
-	uuid_bin_to_str(guid_bin, guid, UUID_STR_FORMAT_GUID);
+	uuid_bin_to_str(cache->header.disk_guid.b, guid, UUID_STR_FORMAT_GUID);
 
-	/* Remember to free pte */
-	free(gpt_pte);
 	return 0;
 }
 
 void part_print_efi(struct blk_desc *dev_desc)
 {
-	ALLOC_CACHE_ALIGN_BUFFER_PAD(gpt_header, gpt_head, 1, dev_desc->blksz);
-	gpt_entry *gpt_pte = NULL;
+	struct gpt_cache *cache;
+	gpt_entry *gpt_pte;
 	int i = 0;
 	char uuid[UUID_STR_LEN + 1];
 	unsigned char *uuid_bin;
 
-	/* This function validates AND fills in the GPT header and PTE */
-	if (find_valid_gpt(dev_desc, gpt_head, &gpt_pte) != 1)
+	cache = gpt_cache_get(dev_desc);
+	if (!cache)
 		return;
+	gpt_pte = cache->pte;
 
 	debug("%s: gpt-entry at %p\n", __func__, gpt_pte);
 
@@ -225,7 +331,7 @@ void part_print_efi(struct blk_desc *dev_desc)
 	printf("\tType GUID\n");
 	printf("\tPartition GUID\n");
 
-	for (i = 0; i < le32_to_cpu(gpt_head->num_partition_entries); i++) {
+	for (i = 0; i < le32_to_cpu(cache->header.num_partition_entries); i++) {
 		/* Stop at the first non valid PTE */
 		if (!is_pte_valid(&gpt_pte[i]))
 			break;
@@ -233,7 +339,7 @@ void part_print_efi(struct blk_desc *dev_desc)
 		printf("%3d\t0x%08llx\t0x%08llx\t\"%s\"\n", (i + 1),
 			le64_to_cpu(gpt_pte[i].starting_lba),
 			le64_to_cpu(gpt_pte[i].ending_lba),
-			print_efiname(&gpt_pte[i]));
+			cache->names[i]);
 		printf("\tattrs:\t0x%016llx\n", gpt_pte[i].attributes.raw);
 		uuid_bin = (unsigned char *)gpt_pte[i].partition_type_guid.b;
 		uuid_bin_to_str(uuid_bin, uuid, UUID_STR_FORMAT_GUID);
@@ -246,17 +352,13 @@ void part_print_efi(struct blk_desc *dev_desc)
 		uuid_bin_to_str(uuid_bin, uuid, UUID_STR_FORMAT_GUID);
 		printf("\tguid:\t%s\n", uuid);
 	}
-
-	/* Remember to free pte */
-	free(gpt_pte);
-	return;
 }
 
 int part_get_info_efi(struct blk_desc *dev_desc, int part,
 		      disk_partition_t *info)
 {
-	ALLOC_CACHE_ALIGN_BUFFER_PAD(gpt_header, gpt_head, 1, dev_desc->blksz);
-	gpt_entry *gpt_pte = NULL;
+	struct gpt_cache *cache;
+	gpt_entry *pte;
 
 	/* "part" argument must be at least 1 */
 	if (part < 1) {
@@ -264,46 +366,96 @@ int part_get_info_efi(struct blk_desc *dev_desc, int part,
 		return -1;
 	}
 
-	/* This function validates AND fills in the GPT header and PTE */
-	if (find_valid_gpt(dev_desc, gpt_head, &gpt_pte) != 1)
+	cache = gpt_cache_get(dev_desc);
+	if (!cache)
 		return -1;
 
-	if (part > le32_to_cpu(gpt_head->num_partition_entries) ||
-	    !is_pte_valid(&gpt_pte[part - 1])) {
+	if (part > le32_to_cpu(cache->header.num_partition_entries) ||
+	    !is_pte_valid(&cache->pte[part - 1])) {
 		debug("%s: *** ERROR: Invalid partition number %d ***\n",
 			__func__, part);
-		free(gpt_pte);
 		return -1;
 	}
+	pte = &cache->pte[part - 1];
 
 	/* The 'lbaint_t' casting may limit the maximum disk size to 2 TB */
-	info->start = (lbaint_t)le64_to_cpu(gpt_pte[part - 1].starting_lba);
+	info->start = (lbaint_t)le64_to_cpu(pte->starting_lba);
 	/* The ending LBA is inclusive, to calculate size, add 1 to it */
-	info->size = (lbaint_t)le64_to_cpu(gpt_pte[part - 1].ending_lba) + 1
+	info->size = (lbaint_t)le64_to_cpu(pte->ending_lba) + 1
 		     - info->start;
 	info->blksz = dev_desc->blksz;
 
 	snprintf((char *)info->name, sizeof(info->name), "%s",
-		 print_efiname(&gpt_pte[part - 1]));
+		 cache->names[part - 1]);
 	strcpy((char *)info->type, "U-Boot");
-	info->bootable = is_bootable(&gpt_pte[part - 1]);
+	info->bootable = is_bootable(pte);
 #if CONFIG_IS_ENABLED(PARTITION_UUIDS)
-	uuid_bin_to_str(gpt_pte[part - 1].unique_partition_guid.b, info->uuid,
+	uuid_bin_to_str(pte->unique_partition_guid.b, info->uuid,
 			UUID_STR_FORMAT_GUID);
 #endif
 #ifdef CONFIG_PARTITION_TYPE_GUID
-	uuid_bin_to_str(gpt_pte[part - 1].partition_type_guid.b,
-			info->type_guid, UUID_STR_FORMAT_GUID);
+	uuid_bin_to_str(pte->partition_type_guid.b, info->type_guid,
+			UUID_STR_FORMAT_GUID);
 #endif
 
 	debug("%s: start 0x" LBAF ", size 0x" LBAF ", name %s\n", __func__,
 	      info->start, info->size, info->name);
 
-	/* Remember to free pte */
-	free(gpt_pte);
 	return 0;
 }
 
+/*
+ * Search the cached table directly, rather than converting each entry with
+ * part_get_info_efi() in turn. As with that, the search stops at the first
+ * unused entry.
+ */
+static int __maybe_unused part_find_efi(struct blk_desc *dev_desc,
+					enum part_key key, const char *value,
+					disk_partition_t *info)
+{
+	struct gpt_cache *cache;
+	efi_guid_t guid;
+	gpt_entry *pte;
+	bool match;
+	int i;
+
+	cache = gpt_cache_get(dev_desc);
+	if (!cache)
+		return -1;
+
+	if (key != PART_KEY_NAME &&
+	    uuid_str_to_bin((char *)value, guid.b, UUID_STR_FORMAT_GUID))
+		return -EINVAL;
+
+	for (i = 0; i < le32_to_cpu(cache->header.num_partition_entries);
+	     i++) {
+		pte = &cache->pte[i];
+		if (!is_pte_valid(pte))
+			break;
+
+		switch (key) {
+		case PART_KEY_NAME:
+			match = !strcmp(value, cache->names[i]);
+			break;
+		case PART_KEY_UUID:
+			match = !memcmp(&pte->unique_partition_guid, &guid,
+					sizeof(guid));
+			break;
+		case PART_KEY_TYPE_GUID:
+			match = !memcmp(&pte->partition_type_guid, &guid,
+					sizeof(guid));
+			break;
+		default:
+			return -EINVAL;
+		}
+		if (match)
+			return part_get_info_efi(dev_desc, i + 1, info) ?
+				-1 : i + 1;
+	}
+
+	return -1;
+}
+
 static int part_test_efi(struct blk_desc *dev_desc)
 {
 	ALLOC_CACHE_ALIGN_BUFFER_PAD(legacy_mbr, legacymbr, 1, dev_desc->blksz);
@@ -1102,5 +1254,6 @@ U_BOOT_PART_TYPE(a_efi) = {
 	.get_info	= part_get_info_ptr(part_get_info_efi),
 	.print		= part_print_ptr(part_print_efi),
 	.test		= part_test_efi,
+	.find		= part_get_info_ptr(part_find_efi),
 };
 #endif
@@ -459,6 +459,9 @@ unsigned long blk_dwrite(struct blk_desc *block_dev, lbaint_t start,
 		return -ENOSYS;
 
 	blkcache_invalidate(block_dev->if_type, block_dev->devnum);
+	gpt_cache_invalidate(block_dev, start, blkcnt);
+	fs_blk_invalidate(block_dev, false);
+	efi_disk_invalidate(block_dev);
 	return ops->write(dev, start, blkcnt, buffer);
 }
 
@@ -472,6 +475,9 @@ unsigned long blk_derase(struct blk_desc *block_dev, lbaint_t start,
 		return -ENOSYS;
 
 	blkcache_invalidate(block_dev->if_type, block_dev->devnum);
+	gpt_cache_invalidate(block_dev, start, blkcnt);
+	fs_blk_invalidate(block_dev, false);
+	efi_disk_invalidate(block_dev);
 	return ops->erase(dev, start, blkcnt);
 }
 
@@ -651,9 +657,22 @@ static int blk_post_probe(struct udevice *dev)
 	return 0;
 }
 
+static int blk_pre_remove(struct udevice *dev)
+{
+	struct blk_desc *desc = dev_get_uclass_platdata(dev);
+
+	/* Free the cached partition table */
+	gpt_cache_invalidate(desc, 0, 1);
+	fs_blk_invalidate(desc, true);
+	efi_disk_invalidate(desc);
+
+	return 0;
+}
+
 UCLASS_DRIVER(blk) = {
 	.id		= UCLASS_BLK,
 	.name		= "blk",
 	.post_probe	= blk_post_probe,
+	.pre_remove	= blk_pre_remove,
 	.per_device_platdata_auto_alloc_size = sizeof(struct blk_desc),
 };
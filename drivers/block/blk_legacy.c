@@ -246,6 +246,9 @@ ulong blk_write_devnum(enum if_type if_type, int devnum, lbaint_t start,
 	ret = get_desc(drv, devnum, &desc);
 	if (ret)
 		return ret;
+	gpt_cache_invalidate(desc, start, blkcnt);
+	fs_blk_invalidate(desc, false);
+	efi_disk_invalidate(desc);
 	return desc->block_write(desc, start, blkcnt, buffer);
 }
 
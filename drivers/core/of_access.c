@@ -22,6 +22,7 @@
 #include <common.h>
 #include <malloc.h>
 #include <linux/libfdt.h>
+#include <of_live.h>
 #include <dm/of_access.h>
 #include <linux/ctype.h>
 #include <linux/err.h>
@@ -120,15 +121,27 @@ int of_simple_size_cells(const struct device_node *np)
 	return 2;
 }
 
+struct property *of_get_properties(const struct device_node *np)
+{
+	if (IS_ENABLED(CONFIG_OF_LIVE_COMPACT) &&
+	    of_live_load_props((struct device_node *)np))
+		return NULL;
+
+	return np->properties;
+}
+
 struct property *of_find_property(const struct device_node *np,
 				  const char *name, int *lenp)
 {
 	struct property *pp;
 
-	if (!np)
+	if (!np) {
+		if (lenp)
+			*lenp = -FDT_ERR_NOTFOUND;
 		return NULL;
+	}
 
-	for (pp = np->properties; pp; pp = pp->next) {
+	for (pp = of_get_properties(np); pp; pp = pp->next) {
 		if (strcmp(pp->name, name) == 0) {
 			if (lenp)
 				*lenp = pp->length;
@@ -166,23 +179,30 @@ struct device_node *of_find_all_nodes(struct device_node *prev)
 const void *of_get_property(const struct device_node *np, const char *name,
 			    int *lenp)
 {
-	struct property *pp = of_find_property(np, name, lenp);
+	struct property *pp;
+
+	/* avoid materialising the property list if only the value is needed */
+	if (IS_ENABLED(CONFIG_OF_LIVE_COMPACT) && np && np->offset >= 0)
+		return of_live_get_prop(np, name, lenp);
+
+	pp = of_find_property(np, name, lenp);
 
 	return pp ? pp->value : NULL;
 }
 
-static const char *of_prop_next_string(struct property *prop, const char *cur)
+static const char *of_prop_next_string(const void *value, int length,
+				       const char *cur)
 {
 	const void *curv = cur;
 
-	if (!prop)
+	if (!value)
 		return NULL;
 
 	if (!cur)
-		return prop->value;
+		return value;
 
 	curv += strlen(cur) + 1;
-	if (curv >= prop->value + prop->length)
+	if (curv >= value + length)
 		return NULL;
 
 	return curv;
@@ -192,15 +212,16 @@ int of_device_is_compatible(const struct device_node *device,
 			    const char *compat, const char *type,
 			    const char *name)
 {
-	struct property *prop;
+	const void *prop;
 	const char *cp;
 	int index = 0, score = 0;
+	int len;
 
 	/* Compatible match has highest priority */
 	if (compat && compat[0]) {
-		prop = of_find_property(device, "compatible", NULL);
-		for (cp = of_prop_next_string(prop, NULL); cp;
-		     cp = of_prop_next_string(prop, cp), index++) {
+		prop = of_get_property(device, "compatible", &len);
+		for (cp = of_prop_next_string(prop, len, NULL); cp;
+		     cp = of_prop_next_string(prop, len, cp), index++) {
 			if (of_compat_cmp(cp, compat, strlen(compat)) == 0) {
 				score = INT_MAX/2 - (index << 2);
 				break;
@@ -296,9 +317,8 @@ static struct device_node *__of_find_node_by_path(struct device_node *parent,
 		return NULL;
 
 	__for_each_child_of_node(parent, child) {
-		const char *name = strrchr(child->full_name, '/');
+		const char *name = of_node_unit_name(child);
 
-		name++;
 		if (strncmp(path, name, len) == 0 && (strlen(name) == len))
 			return child;
 	}
@@ -306,7 +326,7 @@ static struct device_node *__of_find_node_by_path(struct device_node *parent,
 }
 
 #define for_each_property_of_node(dn, pp) \
-	for (pp = dn->properties; pp != NULL; pp = pp->next)
+	for (pp = of_get_properties(dn); pp != NULL; pp = pp->next)
 
 struct device_node *of_find_node_opts_by_path(const char *path,
 					      const char **opts)
@@ -381,11 +401,13 @@ static int of_device_has_prop_value(const struct device_node *device,
 				    const char *propname, const void *propval,
 				    int proplen)
 {
-	struct property *prop = of_find_property(device, propname, NULL);
+	const void *value;
+	int len;
 
-	if (!prop || !prop->value || prop->length != proplen)
+	value = of_get_property(device, propname, &len);
+	if (!value || len != proplen)
 		return 0;
-	return !memcmp(prop->value, propval, proplen);
+	return !memcmp(value, propval, proplen);
 }
 
 struct device_node *of_find_node_by_prop_value(struct device_node *from,
@@ -435,16 +457,16 @@ struct device_node *of_find_node_by_phandle(phandle handle)
 static void *of_find_property_value_of_size(const struct device_node *np,
 					    const char *propname, u32 len)
 {
-	struct property *prop = of_find_property(np, propname, NULL);
+	const void *value;
+	int length;
 
-	if (!prop)
-		return ERR_PTR(-EINVAL);
-	if (!prop->value)
-		return ERR_PTR(-ENODATA);
-	if (len > prop->length)
+	value = of_get_property(np, propname, &length);
+	if (!value)
+		return ERR_PTR(length < 0 ? -EINVAL : -ENODATA);
+	if (len > length)
 		return ERR_PTR(-EOVERFLOW);
 
-	return prop->value;
+	return (void *)value;
 }
 
 int of_read_u32(const struct device_node *np, const char *propname, u32 *outp)
@@ -508,18 +530,15 @@ int of_read_u64(const struct device_node *np, const char *propname, u64 *outp)
 int of_property_match_string(const struct device_node *np, const char *propname,
 			     const char *string)
 {
-	const struct property *prop = of_find_property(np, propname, NULL);
 	size_t l;
-	int i;
+	int i, len;
 	const char *p, *end;
 
-	if (!prop)
-		return -EINVAL;
-	if (!prop->value)
-		return -ENODATA;
+	p = of_get_property(np, propname, &len);
+	if (!p)
+		return len < 0 ? -EINVAL : -ENODATA;
 
-	p = prop->value;
-	end = p + prop->length;
+	end = p + len;
 
 	for (i = 0; p < end; i++, p += l) {
 		l = strnlen(p, end - p) + 1;
@@ -547,16 +566,13 @@ int of_property_read_string_helper(const struct device_node *np,
 				   const char *propname, const char **out_strs,
 				   size_t sz, int skip)
 {
-	const struct property *prop = of_find_property(np, propname, NULL);
-	int l = 0, i = 0;
+	int l = 0, i = 0, len;
 	const char *p, *end;
 
-	if (!prop)
-		return -EINVAL;
-	if (!prop->value)
-		return -ENODATA;
-	p = prop->value;
-	end = p + prop->length;
+	p = of_get_property(np, propname, &len);
+	if (!p)
+		return len < 0 ? -EINVAL : -ENODATA;
+	end = p + len;
 
 	for (i = 0; p < end && (!out_strs || i < skip + sz); i++, p += l) {
 		l = strnlen(p, end - p) + 1;
@@ -612,7 +628,7 @@ static int __of_parse_phandle_with_args(const struct device_node *np,
 				node = of_find_node_by_phandle(phandle);
 				if (!node) {
 					debug("%s: could not find phandle\n",
-					      np->full_name);
+					      of_node_full_name(np));
 					goto err;
 				}
 			}
@@ -620,8 +636,8 @@ static int __of_parse_phandle_with_args(const struct device_node *np,
 			if (cells_name) {
 				if (of_read_u32(node, cells_name, &count)) {
 					debug("%s: could not get %s for %s\n",
-					      np->full_name, cells_name,
-					      node->full_name);
+					      of_node_full_name(np), cells_name,
+					      of_node_full_name(node));
 					goto err;
 				}
 			} else {
@@ -634,7 +650,7 @@ static int __of_parse_phandle_with_args(const struct device_node *np,
 			 */
 			if (list + count > list_end) {
 				debug("%s: arguments longer than property\n",
-				      np->full_name);
+				      of_node_full_name(np));
 				goto err;
 			}
 		}
@@ -338,7 +338,7 @@ static int __of_address_to_resource(const struct device_node *dev,
 	r->start = taddr;
 	r->end = taddr + size - 1;
 	r->flags = flags;
-	r->name = name ? name : dev->full_name;
+	r->name = name ? name : of_node_full_name(dev);
 
 	return 0;
 }
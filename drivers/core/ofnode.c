@@ -111,13 +111,7 @@ const void *ofnode_read_prop(ofnode node, const char *propname, int *sizep)
 	debug("%s: %s: ", __func__, propname);
 
 	if (ofnode_is_np(node)) {
-		struct property *prop = of_find_property(
-				ofnode_to_np(node), propname, &len);
-
-		if (prop) {
-			val = prop->value;
-			len = prop->length;
-		}
+		val = of_get_property(ofnode_to_np(node), propname, &len);
 	} else {
 		val = fdt_getprop(gd->fdt_blob, ofnode_to_offset(node),
 				  propname, &len);
@@ -246,7 +240,7 @@ const char *ofnode_get_name(ofnode node)
 	}
 
 	if (ofnode_is_np(node))
-		return strrchr(node.np->full_name, '/') + 1;
+		return of_node_unit_name(node.np);
 
 	return fdt_get_name(gd->fdt_blob, ofnode_to_offset(node), NULL);
 }
@@ -850,7 +844,7 @@ int ofnode_write_prop(ofnode node, const char *propname, int len,
 	if (!np)
 		return -EINVAL;
 
-	for (pp = np->properties; pp; pp = pp->next) {
+	for (pp = of_get_properties(np); pp; pp = pp->next) {
 		if (strcmp(pp->name, propname) == 0) {
 			/* Property exists -> change value */
 			pp->value = (void *)value;
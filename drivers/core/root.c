@@ -11,6 +11,7 @@
 #include <fdtdec.h>
 #include <malloc.h>
 #include <linux/libfdt.h>
+#include <u-boot/crc.h>
 #include <dm/device.h>
 #include <dm/device-internal.h>
 #include <dm/lists.h>
@@ -144,6 +145,13 @@ int dm_init(bool of_live)
 	fix_uclass();
 	fix_devices();
 #endif
+#if CONFIG_IS_ENABLED(OF_BIND_TABLE)
+	/*
+	 * The device tree may have been relocated or fixed up since the last
+	 * scan, and the table itself moves with U-Boot, so check it again
+	 */
+	dm_bind_table_set(gd->fdt_blob, &dm_bind_table);
+#endif
 
 	ret = device_bind_by_name(NULL, false, &root_info, &DM_ROOT_NON_CONST);
 	if (ret)
@@ -233,6 +241,112 @@ static int dm_scan_fdt_live(struct udevice *parent,
 #endif /* CONFIG_IS_ENABLED(OF_LIVE) */
 
 #if CONFIG_IS_ENABLED(OF_CONTROL) && !CONFIG_IS_ENABLED(OF_PLATDATA)
+#if CONFIG_IS_ENABLED(OF_BIND_TABLE)
+int dm_bind_table_set(const void *blob, const struct dm_bind_table *table)
+{
+	gd->dm_bind_table = NULL;
+	if (!blob || !table || fdt_totalsize(blob) != table->fdt_size ||
+	    crc32(0, blob, table->fdt_size) != table->fdt_crc32) {
+		log_debug("Bind table does not match device tree\n");
+		return -EINVAL;
+	}
+	gd->dm_bind_table = table;
+
+	return 0;
+}
+
+/**
+ * dm_bind_table_node() - Bind a device using a pre-resolved binding
+ *
+ * This falls back to lists_bind_fdt() if the driver is not present, or
+ * refuses to bind.
+ *
+ * @parent: Parent device for the device that will be created
+ * @bind: Binding to use
+ * @pre_reloc_only: If true, bind only drivers with the DM_FLAG_PRE_RELOC
+ * flag. If false bind all drivers.
+ * @return 0 if OK, -ve on error
+ */
+static int dm_bind_table_node(struct udevice *parent,
+			      const struct dm_bind_node *bind,
+			      bool pre_reloc_only)
+{
+	ofnode node = offset_to_ofnode(bind->offset);
+	const struct udevice_id *id = NULL;
+	struct driver *drv = NULL;
+	int ret;
+
+	if (bind->drv_name)
+		drv = lists_driver_lookup_name(bind->drv_name);
+	for (id = drv ? drv->of_match : NULL; id && id->compatible; id++) {
+		if (!strcmp(id->compatible, bind->compat))
+			break;
+	}
+	if (!id || !id->compatible)
+		return lists_bind_fdt(parent, node, NULL, pre_reloc_only);
+
+	if (pre_reloc_only && !bind->pre_reloc &&
+	    !(drv->flags & DM_FLAG_PRE_RELOC))
+		return 0;
+
+	ret = device_bind_with_driver_data(parent, drv, ofnode_get_name(node),
+					   id->data, node, NULL);
+	if (ret == -ENODEV)
+		return lists_bind_fdt(parent, node, NULL, pre_reloc_only);
+	if (ret)
+		dm_warn("Error binding driver '%s': %d\n", drv->name, ret);
+
+	return ret;
+}
+
+/**
+ * dm_scan_fdt_table() - Bind drivers for a node using the bind table
+ *
+ * @parent: Parent device for the devices that will be created
+ * @table: Bind table to use
+ * @offset: Offset of node to scan
+ * @pre_reloc_only: If true, bind only drivers with the DM_FLAG_PRE_RELOC
+ * flag. If false bind all drivers.
+ * @return 0 if OK, -ve on error
+ */
+static int dm_scan_fdt_table(struct udevice *parent,
+			     const struct dm_bind_table *table, int offset,
+			     bool pre_reloc_only)
+{
+	const struct dm_bind_node *bind = table->nodes;
+	const struct dm_bind_node *end = table->nodes + table->count;
+	int ret = 0, err;
+	int lo, hi;
+
+	/* find the first binding for this parent */
+	lo = 0;
+	hi = table->count;
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+
+		if (bind[mid].parent < offset)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	for (bind += lo; bind < end && bind->parent == offset; bind++) {
+		err = dm_bind_table_node(parent, bind, pre_reloc_only);
+		if (err && !ret) {
+			ret = err;
+			debug("%s: ret=%d\n", fdt_get_name(gd->fdt_blob,
+							   bind->offset, NULL),
+			      ret);
+		}
+	}
+
+	if (ret)
+		dm_warn("Some drivers failed to bind\n");
+
+	return ret;
+}
+#endif /* CONFIG_IS_ENABLED(OF_BIND_TABLE) */
+
 /**
  * dm_scan_fdt_node() - Scan the device tree and bind drivers for a node
  *
@@ -251,6 +365,11 @@ static int dm_scan_fdt_node(struct udevice *parent, const void *blob,
 {
 	int ret = 0, err;
 
+#if CONFIG_IS_ENABLED(OF_BIND_TABLE)
+	if (gd->dm_bind_table && blob == gd->fdt_blob)
+		return dm_scan_fdt_table(parent, gd->dm_bind_table, offset,
+					 pre_reloc_only);
+#endif
 	for (offset = fdt_first_subnode(blob, offset);
 	     offset > 0;
 	     offset = fdt_next_subnode(blob, offset)) {
@@ -12,6 +12,7 @@
 #include <dm.h>
 #include <errno.h>
 #include <malloc.h>
+#include <slab.h>
 #include <dm/device.h>
 #include <dm/device-internal.h>
 #include <dm/lists.h>
@@ -67,11 +68,11 @@ static int uclass_add(enum uclass_id id, struct uclass **ucp)
 		 */
 		return -EPFNOSUPPORT;
 	}
-	uc = calloc(1, sizeof(*uc));
+	uc = slab_alloc(sizeof(*uc));
 	if (!uc)
 		return -ENOMEM;
 	if (uc_drv->priv_auto_alloc_size) {
-		uc->priv = calloc(1, uc_drv->priv_auto_alloc_size);
+		uc->priv = slab_alloc(uc_drv->priv_auto_alloc_size);
 		if (!uc->priv) {
 			ret = -ENOMEM;
 			goto fail_mem;
@@ -93,12 +94,12 @@ static int uclass_add(enum uclass_id id, struct uclass **ucp)
 	return 0;
 fail:
 	if (uc_drv->priv_auto_alloc_size) {
-		free(uc->priv);
+		slab_free(uc->priv, uc_drv->priv_auto_alloc_size);
 		uc->priv = NULL;
 	}
 	list_del(&uc->sibling_node);
 fail_mem:
-	free(uc);
+	slab_free(uc, sizeof(*uc));
 
 	return ret;
 }
@@ -131,8 +132,8 @@ int uclass_destroy(struct uclass *uc)
 		uc_drv->destroy(uc);
 	list_del(&uc->sibling_node);
 	if (uc_drv->priv_auto_alloc_size)
-		free(uc->priv);
-	free(uc);
+		slab_free(uc->priv, uc_drv->priv_auto_alloc_size);
+	slab_free(uc, sizeof(*uc));
 
 	return 0;
 }
@@ -21,6 +21,7 @@ static LIST_HEAD(dfu_list);
 static int dfu_alt_num;
 static int alt_num_cnt;
 static struct hash_algo *dfu_hash_algo;
+static struct dfu_entity *dfu_queued;
 #ifdef CONFIG_DFU_TIMEOUT
 static unsigned long dfu_timeout = 0;
 #endif
@@ -201,7 +202,10 @@ unsigned char *dfu_get_buf(struct dfu_entity *dfu)
 	if (dfu->max_buf_size && dfu_buf_size > dfu->max_buf_size)
 		dfu_buf_size = dfu->max_buf_size;
 
-	dfu_buf = memalign(CONFIG_SYS_CACHELINE_SIZE, dfu_buf_size);
+	/* With CONFIG_DFU_WRITE_ALT_BUF, the second half is the other buffer */
+	dfu_buf = memalign(CONFIG_SYS_CACHELINE_SIZE,
+			   dfu_buf_size *
+			   (IS_ENABLED(CONFIG_DFU_WRITE_ALT_BUF) ? 2 : 1));
 	if (dfu_buf == NULL)
 		printf("%s: Could not memalign 0x%lx bytes\n",
 		       __func__, dfu_buf_size);
@@ -227,11 +231,50 @@ static char *dfu_get_hash_algo(void)
 	return NULL;
 }
 
+static int dfu_write_buffer_medium(struct dfu_entity *dfu, void *buf,
+				   long w_size)
+{
+	ulong start = get_timer(0);
+	int ret;
+
+	ret = dfu->write_medium(dfu, dfu->offset, buf, &w_size);
+	if (ret)
+		debug("%s: Write error!\n", __func__);
+
+	/* update offset */
+	dfu->offset += w_size;
+	dfu->i_write_ms = get_timer(start);
+
+	puts("#");
+
+	return ret;
+}
+
+/* Write the buffer queued by dfu_write_buffer_queue(), if any */
+static int dfu_write_buffer_queued(struct dfu_entity *dfu)
+{
+	long w_size = dfu->i_queued_len;
+
+	if (w_size == 0)
+		return 0;
+
+	dfu->i_queued_len = 0;
+	if (dfu_queued == dfu)
+		dfu_queued = NULL;
+
+	return dfu_write_buffer_medium(dfu, dfu->i_buf_alt, w_size);
+}
+
 static int dfu_write_buffer_drain(struct dfu_entity *dfu)
 {
 	long w_size;
 	int ret;
 
+	/* the queued buffer holds the earlier data */
+	ret = dfu_write_buffer_queued(dfu);
+	if (ret)
+		return ret;
+
 	/* flush size? */
 	w_size = dfu->i_buf - dfu->i_buf_start;
 	if (w_size == 0)
@@ -241,21 +284,77 @@ static int dfu_write_buffer_drain(struct dfu_entity *dfu)
 		dfu_hash_algo->hash_update(dfu_hash_algo, &dfu->crc,
 					   dfu->i_buf_start, w_size, 0);
 
-	ret = dfu->write_medium(dfu, dfu->offset, dfu->i_buf_start, &w_size);
-	if (ret)
-		debug("%s: Write error!\n", __func__);
+	ret = dfu_write_buffer_medium(dfu, dfu->i_buf_start, w_size);
 
 	/* point back */
 	dfu->i_buf = dfu->i_buf_start;
+	dfu->i_full = 0;
 
-	/* update offset */
-	dfu->offset += w_size;
+	return ret;
+}
 
-	puts("#");
+/*
+ * Queue the full buffer to be written by dfu_write_queued() and carry on in
+ * the other one. If that has not been written yet, the full buffer stays
+ * where it is until it has.
+ */
+static int dfu_write_buffer_queue(struct dfu_entity *dfu)
+{
+	long w_size;
+	u8 *buf;
+
+	if (!IS_ENABLED(CONFIG_DFU_WRITE_ALT_BUF))
+		return dfu_write_buffer_drain(dfu);
+
+	w_size = dfu->i_buf - dfu->i_buf_start;
+	if (w_size == 0)
+		return 0;
+	if (dfu->i_queued_len) {
+		dfu->i_full = 1;
+		return 0;
+	}
+
+	if (dfu_hash_algo)
+		dfu_hash_algo->hash_update(dfu_hash_algo, &dfu->crc,
+					   dfu->i_buf_start, w_size, 0);
+
+	buf = dfu->i_buf_start;
+	dfu->i_buf_start = dfu->i_buf_alt;
+	dfu->i_buf_end = dfu->i_buf_start + dfu_get_buf_size();
+	dfu->i_buf = dfu->i_buf_start;
+	dfu->i_buf_alt = buf;
+	dfu->i_queued_len = w_size;
+	dfu->i_full = 0;
+	dfu_queued = dfu;
+
+	return 0;
+}
+
+int dfu_write_queued(void)
+{
+	struct dfu_entity *dfu = dfu_queued;
+	int ret;
+
+	if (!dfu)
+		return 0;
+
+	ret = dfu_write_buffer_queued(dfu);
+	if (!ret && dfu->i_full)
+		ret = dfu_write_buffer_queue(dfu);
+	if (ret)
+		dfu->i_err = ret;
 
 	return ret;
 }
 
+unsigned int dfu_write_busy(struct dfu_entity *dfu)
+{
+	if (!dfu || !dfu->i_full)
+		return 0;
+
+	return max(dfu->i_write_ms, (ulong)DFU_BUSY_POLL_TIMEOUT);
+}
+
 void dfu_transaction_cleanup(struct dfu_entity *dfu)
 {
 	/* clear everything */
@@ -269,6 +368,15 @@ void dfu_transaction_cleanup(struct dfu_entity *dfu)
 	dfu->b_left = 0;
 	dfu->bad_skip = 0;
 
+	/* drop anything queued */
+	dfu->i_buf_alt = dfu->i_buf_start ?
+			 dfu->i_buf_start + dfu_get_buf_size() : NULL;
+	dfu->i_queued_len = 0;
+	dfu->i_err = 0;
+	dfu->i_full = 0;
+	if (dfu_queued == dfu)
+		dfu_queued = NULL;
+
 	dfu->inited = 0;
 }
 
@@ -303,7 +411,9 @@ int dfu_flush(struct dfu_entity *dfu, void *buf, int size, int blk_seq_num)
 {
 	int ret = 0;
 
-	ret = dfu_write_buffer_drain(dfu);
+	ret = dfu->i_err;
+	if (!ret)
+		ret = dfu_write_buffer_drain(dfu);
 	if (ret)
 		return ret;
 
@@ -340,6 +450,13 @@ int dfu_write(struct dfu_entity *dfu, void *buf, int size, int blk_seq_num)
 		return -1;
 	}
 
+	/* a queued buffer failed to write */
+	if (dfu->i_err) {
+		ret = dfu->i_err;
+		dfu_transaction_cleanup(dfu);
+		return ret;
+	}
+
 	/* DFU 1.1 standard says:
 	 * The wBlockNum field is a block sequence number. It increments each
 	 * time a block is transferred, wrapping to zero from 65,535. It is used
@@ -356,9 +473,11 @@ int dfu_write(struct dfu_entity *dfu, void *buf, int size, int blk_seq_num)
 	/* handle rollover */
 	dfu->i_blk_seq_num = (dfu->i_blk_seq_num + 1) & 0xffff;
 
-	/* flush buffer if overflow */
+	/* flush buffer if overflow, writing the queued one first */
 	if ((dfu->i_buf + size) > dfu->i_buf_end) {
-		ret = dfu_write_buffer_drain(dfu);
+		ret = dfu_write_buffer_queued(dfu);
+		if (!ret)
+			ret = dfu_write_buffer_queue(dfu);
 		if (ret) {
 			dfu_transaction_cleanup(dfu);
 			return ret;
@@ -376,13 +495,14 @@ int dfu_write(struct dfu_entity *dfu, void *buf, int size, int blk_seq_num)
 	memcpy(dfu->i_buf, buf, size);
 	dfu->i_buf += size;
 
-	/* if end or if buffer full flush */
-	if (size == 0 || (dfu->i_buf + size) > dfu->i_buf_end) {
+	/* if end flush, if buffer full queue it (or flush) */
+	if (size == 0)
 		ret = dfu_write_buffer_drain(dfu);
-		if (ret) {
-			dfu_transaction_cleanup(dfu);
-			return ret;
-		}
+	else if ((dfu->i_buf + size) > dfu->i_buf_end)
+		ret = dfu_write_buffer_queue(dfu);
+	if (ret) {
+		dfu_transaction_cleanup(dfu);
+		return ret;
 	}
 
 	return 0;
@@ -526,6 +646,7 @@ void dfu_free_entities(void)
 	struct dfu_entity *dfu, *p, *t = NULL;
 
 	dfu_free_buf();
+	dfu_queued = NULL;
 	list_for_each_entry_safe_reverse(dfu, p, &dfu_list, list) {
 		list_del(&dfu->list);
 		if (dfu->free_entity)
@@ -10,6 +10,7 @@
 #include <fastboot-internal.h>
 #include <fb_mmc.h>
 #include <fb_nand.h>
+#include <image-sparse.h>
 #include <part.h>
 #include <stdlib.h>
 
@@ -28,6 +29,27 @@ static u32 fastboot_bytes_received;
  */
 static u32 fastboot_bytes_expected;
 
+#if CONFIG_IS_ENABLED(FASTBOOT_STREAM)
+/**
+ * struct fastboot_stream - State of a download written as it arrives
+ *
+ * @part_name: Partition selected by "oem stream", empty if none
+ * @info: Storage the download is written to
+ * @ss: Sparse image parser and buffers
+ * @active: true while a download is being streamed
+ * @done: true once a streamed download completed, until it is flashed
+ * @ret: Result of the streamed download
+ */
+static struct fastboot_stream {
+	char part_name[PART_NAME_LEN];
+	struct sparse_storage info;
+	struct sparse_stream ss;
+	bool active;
+	bool done;
+	int ret;
+} fb_stream;
+#endif
+
 static void okay(char *, char *);
 static void getvar(char *, char *);
 static void download(char *, char *);
@@ -39,6 +61,9 @@ static void reboot_bootloader(char *, char *);
 #if CONFIG_IS_ENABLED(FASTBOOT_CMD_OEM_FORMAT)
 static void oem_format(char *, char *);
 #endif
+#if CONFIG_IS_ENABLED(FASTBOOT_STREAM)
+static void oem_stream(char *, char *);
+#endif
 
 static const struct {
 	const char *command;
@@ -88,6 +113,12 @@ static const struct {
 		.dispatch = oem_format,
 	},
 #endif
+#if CONFIG_IS_ENABLED(FASTBOOT_STREAM)
+	[FASTBOOT_COMMAND_OEM_STREAM] = {
+		.command = "oem stream",
+		.dispatch = oem_stream,
+	},
+#endif
 };
 
 /**
@@ -149,6 +180,50 @@ static void getvar(char *cmd_parameter, char *response)
 	fastboot_getvar(cmd_parameter, response);
 }
 
+#if CONFIG_IS_ENABLED(FASTBOOT_STREAM)
+bool fastboot_stream_armed(void)
+{
+	return fb_stream.part_name[0];
+}
+
+/**
+ * download_stream() - Set up writing a download as it arrives
+ *
+ * The download buffer only holds the data on its way to storage, so the
+ * image may be larger than the buffer.
+ *
+ * @response: Pointer to fastboot response buffer
+ * Return: 0 if OK, -ve on error (response is filled in)
+ */
+static int download_stream(char *response)
+{
+	u32 size = min_t(u32, fastboot_buf_size,
+			 2 * CONFIG_FASTBOOT_STREAM_BUF_SIZE);
+	int ret;
+
+	fb_stream.active = false;
+	fb_stream.done = false;
+	ret = fastboot_mmc_stream_init(fb_stream.part_name, &fb_stream.info,
+				       response);
+	if (ret)
+		return ret;
+	ret = sparse_stream_init(&fb_stream.ss, &fb_stream.info,
+				 fastboot_buf_addr, size);
+	if (ret) {
+		fastboot_fail("buffer too small to stream", response);
+		return ret;
+	}
+	fb_stream.active = true;
+
+	return 0;
+}
+#else
+bool fastboot_stream_armed(void)
+{
+	return false;
+}
+#endif
+
 /**
  * fastboot_download() - Start a download transfer from the client
  *
@@ -175,13 +250,18 @@ static void download(char *cmd_parameter, char *response)
 	 *
 	 * where cmd_parameter is an 8 digit hexadecimal number
 	 */
+#if CONFIG_IS_ENABLED(FASTBOOT_STREAM)
+	if (fastboot_stream_armed()) {
+		if (download_stream(response))
+			return;
+	} else
+#endif
 	if (fastboot_bytes_expected > fastboot_buf_size) {
 		fastboot_fail(cmd_parameter, response);
-	} else {
-		printf("Starting download of %d bytes\n",
-		       fastboot_bytes_expected);
-		fastboot_response("DATA", response, "%s", cmd_parameter);
+		return;
 	}
+	printf("Starting download of %d bytes\n", fastboot_bytes_expected);
+	fastboot_response("DATA", response, "%s", cmd_parameter);
 }
 
 /**
@@ -222,6 +302,13 @@ void fastboot_data_download(const void *fastboot_data,
 			      response);
 		return;
 	}
+#if CONFIG_IS_ENABLED(FASTBOOT_STREAM)
+	/* Errors are reported once the download is complete */
+	if (fb_stream.active)
+		sparse_stream_write(&fb_stream.ss, fastboot_data,
+				    fastboot_data_len);
+	else
+#endif
 	/* Download data to fastboot_buf_addr */
 	memcpy(fastboot_buf_addr + fastboot_bytes_received,
 	       fastboot_data, fastboot_data_len);
@@ -238,6 +325,19 @@ void fastboot_data_download(const void *fastboot_data,
 	*response = '\0';
 }
 
+/**
+ * fastboot_data_flush() - Write out received image data
+ *
+ * Writes the buffer queued by fastboot_data_download() when streaming.
+ */
+void fastboot_data_flush(void)
+{
+#if CONFIG_IS_ENABLED(FASTBOOT_STREAM)
+	if (fb_stream.active)
+		sparse_stream_flush(&fb_stream.ss);
+#endif
+}
+
 /**
  * fastboot_data_complete() - Mark current transfer complete
  *
@@ -252,6 +352,16 @@ void fastboot_data_complete(char *response)
 	printf("\ndownloading of %d bytes finished\n", fastboot_bytes_received);
 	image_size = fastboot_bytes_received;
 	env_set_hex("filesize", image_size);
+#if CONFIG_IS_ENABLED(FASTBOOT_STREAM)
+	if (fb_stream.active) {
+		/* Nothing is left in the buffer to be flashed */
+		fb_stream.ret = sparse_stream_finish(&fb_stream.ss,
+						     fb_stream.part_name);
+		fb_stream.active = false;
+		fb_stream.done = true;
+		image_size = 0;
+	}
+#endif
 	fastboot_bytes_expected = 0;
 	fastboot_bytes_received = 0;
 }
@@ -268,6 +378,21 @@ void fastboot_data_complete(char *response)
  */
 static void flash(char *cmd_parameter, char *response)
 {
+#if CONFIG_IS_ENABLED(FASTBOOT_STREAM)
+	if (fb_stream.done) {
+		/* The image was already written while it was downloaded */
+		if (!cmd_parameter || strcmp(cmd_parameter, fb_stream.part_name))
+			fastboot_fail("image was streamed to another partition",
+				      response);
+		else if (fb_stream.ret)
+			fastboot_fail(fb_stream.ss.err, response);
+		else
+			fastboot_okay(NULL, response);
+		fb_stream.done = false;
+		fb_stream.part_name[0] = '\0';
+		return;
+	}
+#endif
 #if CONFIG_IS_ENABLED(FASTBOOT_FLASH_MMC)
 	fastboot_mmc_flash_write(cmd_parameter, fastboot_buf_addr, image_size,
 				 response);
@@ -335,3 +460,37 @@ static void oem_format(char *cmd_parameter, char *response)
 	}
 }
 #endif
+
+#if CONFIG_IS_ENABLED(FASTBOOT_STREAM)
+/**
+ * oem_stream() - Select the partition to write the next download to
+ *
+ * @cmd_parameter: Pointer to partition name, or NULL to go back to
+ *	downloading to memory
+ * @response: Pointer to fastboot response buffer
+ *
+ * The next download is written to the partition as it arrives, and must then
+ * be followed by a flash command for that partition, which reports the result.
+ */
+static void oem_stream(char *cmd_parameter, char *response)
+{
+	struct blk_desc *dev_desc;
+	disk_partition_t info;
+
+	fb_stream.part_name[0] = '\0';
+	fb_stream.done = false;
+	if (!cmd_parameter || !*cmd_parameter) {
+		fastboot_okay(NULL, response);
+		return;
+	}
+	if (strlen(cmd_parameter) >= sizeof(fb_stream.part_name)) {
+		fastboot_fail("partition name too long", response);
+		return;
+	}
+	if (fastboot_mmc_get_part_info(cmd_parameter, &dev_desc, &info,
+				       response) < 0)
+		return;
+	strcpy(fb_stream.part_name, cmd_parameter);
+	fastboot_okay(NULL, response);
+}
+#endif
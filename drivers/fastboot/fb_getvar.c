@@ -136,7 +136,12 @@ static void getvar_version_bootloader(char *var_parameter, char *response)
 
 static void getvar_downloadsize(char *var_parameter, char *response)
 {
-	fastboot_response("OKAY", response, "0x%08x", fastboot_buf_size);
+	/* A streamed download only passes through the buffer */
+	if (fastboot_stream_armed())
+		fastboot_response("OKAY", response, "0x%08x", 0xfffff000);
+	else
+		fastboot_response("OKAY", response, "0x%08x",
+				  fastboot_buf_size);
 }
 
 static void getvar_serialno(char *var_parameter, char *response)
@@ -15,6 +15,7 @@
 #include <mmc.h>
 #include <div64.h>
 #include <linux/compat.h>
+#include <linux/log2.h>
 #include <android_image.h>
 
 #define FASTBOOT_MAX_BLK_WRITE 16384
@@ -97,6 +98,53 @@ static lbaint_t fb_mmc_sparse_reserve(struct sparse_storage *info,
 	return blkcnt;
 }
 
+static lbaint_t fb_mmc_sparse_erase(struct sparse_storage *info,
+		lbaint_t blk, lbaint_t blkcnt)
+{
+	struct fb_mmc_sparse *sparse = info->priv;
+	struct blk_desc *dev_desc = sparse->dev_desc;
+
+	return fb_mmc_blk_write(dev_desc, blk, blkcnt, NULL);
+}
+
+/**
+ * fb_mmc_sparse_init() - Set up writing a sparse image to a partition
+ *
+ * FILL chunks are erased where possible. This needs an eMMC, which reports
+ * what erased blocks read back as; for SD cards this depends on the card.
+ *
+ * @sparse: Storage description to fill in
+ * @sparse_priv: Private data for the storage, to fill in
+ * @dev_desc: MMC device descriptor
+ * @info: Partition to write
+ */
+static void fb_mmc_sparse_init(struct sparse_storage *sparse,
+			       struct fb_mmc_sparse *sparse_priv,
+			       struct blk_desc *dev_desc,
+			       disk_partition_t *info)
+{
+	struct mmc *mmc = find_mmc_device(CONFIG_FASTBOOT_FLASH_MMC_DEV);
+
+	sparse_priv->dev_desc = dev_desc;
+
+	sparse->blksz = info->blksz;
+	sparse->start = info->start;
+	sparse->size = info->size;
+	sparse->write = fb_mmc_sparse_write;
+	sparse->reserve = fb_mmc_sparse_reserve;
+	sparse->erase = NULL;
+	sparse->mssg = fastboot_fail;
+	sparse->priv = sparse_priv;
+
+	if (mmc && !IS_SD(mmc) && mmc->ext_csd && mmc->erase_grp_size &&
+	    is_power_of_2(mmc->erase_grp_size)) {
+		sparse->erase = fb_mmc_sparse_erase;
+		sparse->erase_val =
+			mmc->ext_csd[EXT_CSD_ERASED_MEM_CONT] ? ~0 : 0;
+		sparse->erase_grp = mmc->erase_grp_size;
+	}
+}
+
 static void write_raw_image(struct blk_desc *dev_desc, disk_partition_t *info,
 		const char *part_name, void *buffer,
 		u32 download_bytes, char *response)
@@ -394,6 +442,36 @@ int fastboot_mmc_get_part_info(const char *part_name,
 	return r;
 }
 
+#if CONFIG_IS_ENABLED(FASTBOOT_STREAM)
+/**
+ * fastboot_mmc_stream_init() - Set up writing a download as it arrives
+ *
+ * @part_name: Named partition to write to
+ * @sparse: Returns the storage description
+ * @response: Pointer to fastboot response buffer
+ * @return 0 if OK, -ve on error (response is filled in)
+ */
+int fastboot_mmc_stream_init(const char *part_name,
+			     struct sparse_storage *sparse, char *response)
+{
+	static struct fb_mmc_sparse sparse_priv;
+	struct blk_desc *dev_desc;
+	disk_partition_t info;
+	int ret;
+
+	ret = fastboot_mmc_get_part_info(part_name, &dev_desc, &info,
+					 response);
+	if (ret < 0)
+		return ret;
+
+	fb_mmc_sparse_init(sparse, &sparse_priv, dev_desc, &info);
+	printf("Streaming to '%s' at offset " LBAFU "\n", part_name,
+	       sparse->start);
+
+	return 0;
+}
+#endif
+
 /**
  * fastboot_mmc_flash_write() - Write image to eMMC for fastboot
  *
@@ -490,19 +568,11 @@ void fastboot_mmc_flash_write(const char *cmd, void *download_buffer,
 		struct sparse_storage sparse;
 		int err;
 
-		sparse_priv.dev_desc = dev_desc;
-
-		sparse.blksz = info.blksz;
-		sparse.start = info.start;
-		sparse.size = info.size;
-		sparse.write = fb_mmc_sparse_write;
-		sparse.reserve = fb_mmc_sparse_reserve;
-		sparse.mssg = fastboot_fail;
+		fb_mmc_sparse_init(&sparse, &sparse_priv, dev_desc, &info);
 
 		printf("Flashing sparse image at offset " LBAFU "\n",
 		       sparse.start);
 
-		sparse.priv = &sparse_priv;
 		err = write_sparse_image(&sparse, cmd, download_buffer,
 					 response);
 		if (!err)
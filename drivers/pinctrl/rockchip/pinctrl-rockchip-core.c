@@ -5,6 +5,7 @@
 
 #include <common.h>
 #include <dm.h>
+#include <dm/of_access.h>
 #include <dm/pinctrl.h>
 #include <regmap.h>
 #include <syscon.h>
@@ -438,7 +439,7 @@ static int rockchip_pinctrl_set_state(struct udevice *dev,
 			return -ENODEV;
 #ifdef CONFIG_OF_LIVE
 		np = ofnode_to_np(node);
-		for (pp = np->properties; pp; pp = pp->next) {
+		for (pp = of_get_properties(np); pp; pp = pp->next) {
 			prop_name = pp->name;
 			prop_len = pp->length;
 			value = pp->value;
@@ -23,6 +23,9 @@ DECLARE_GLOBAL_DATA_PTR;
 #define UART_MCRVAL (UART_MCR_DTR | \
 		     UART_MCR_RTS)		/* RTS/DTR */
 
+/* Number of characters the TX FIFO holds on a 16550A, if not given */
+#define NS16550_TX_FIFO_SIZE	16
+
 #if !CONFIG_IS_ENABLED(DM_SERIAL)
 #ifdef CONFIG_SYS_NS16550_PORT_MAPPED
 #define serial_out(x, y)	outb(x, (ulong)y)
@@ -394,6 +397,29 @@ static int ns16550_serial_putc(struct udevice *dev, const char ch)
 	return 0;
 }
 
+static ssize_t ns16550_serial_puts(struct udevice *dev, const char *s,
+				   size_t len)
+{
+	struct NS16550 *const com_port = dev_get_priv(dev);
+	size_t count = 1;
+	size_t i;
+
+	if (!(serial_in(&com_port->lsr) & UART_LSR_THRE))
+		return -EAGAIN;
+
+	/* With the FIFO enabled, THRE means that the whole FIFO is empty */
+	if (com_port->plat->fcr & UART_FCR_FIFO_EN)
+		count = com_port->plat->fifo_size ?: NS16550_TX_FIFO_SIZE;
+	count = min(count, len);
+	for (i = 0; i < count; i++) {
+		serial_out(s[i], &com_port->thr);
+		if (s[i] == '\n')
+			WATCHDOG_RESET();
+	}
+
+	return count;
+}
+
 static int ns16550_serial_pending(struct udevice *dev, bool input)
 {
 	struct NS16550 *const com_port = dev_get_priv(dev);
@@ -525,6 +551,8 @@ int ns16550_serial_ofdata_to_platdata(struct udevice *dev)
 	plat->reg_offset = dev_read_u32_default(dev, "reg-offset", 0);
 	plat->reg_shift = dev_read_u32_default(dev, "reg-shift", 0);
 	plat->reg_width = dev_read_u32_default(dev, "reg-io-width", 1);
+	plat->fifo_size = dev_read_u32_default(dev, "fifo-size",
+					       NS16550_TX_FIFO_SIZE);
 
 	err = clk_get_by_index(dev, 0, &clk);
 	if (!err) {
@@ -554,6 +582,7 @@ int ns16550_serial_ofdata_to_platdata(struct udevice *dev)
 
 const struct dm_serial_ops ns16550_serial_ops = {
 	.putc = ns16550_serial_putc,
+	.puts = ns16550_serial_puts,
 	.pending = ns16550_serial_pending,
 	.getc = ns16550_serial_getc,
 	.setbrg = ns16550_serial_setbrg,
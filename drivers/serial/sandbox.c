@@ -19,6 +19,7 @@
 #include <video.h>
 #include <linux/compiler.h>
 #include <asm/state.h>
+#include <asm/test.h>
 
 DECLARE_GLOBAL_DATA_PTR;
 
@@ -37,6 +38,10 @@ static unsigned char serial_buf[16];
 static unsigned int serial_buf_write;
 static unsigned int serial_buf_read;
 
+/* For testing: refuse output as if the UART were busy, and count output */
+static bool serial_tx_busy;
+static size_t serial_tx_count;
+
 struct sandbox_serial_platdata {
 	int colour;	/* Text colour to use for output, -1 for none */
 };
@@ -93,18 +98,57 @@ static int sandbox_serial_putc(struct udevice *dev, const char ch)
 	struct sandbox_serial_priv *priv = dev_get_priv(dev);
 	struct sandbox_serial_platdata *plat = dev->platdata;
 
+	if (serial_tx_busy)
+		return -EAGAIN;
 	if (priv->start_of_line && plat->colour != -1) {
 		priv->start_of_line = false;
 		output_ansi_colour(plat->colour);
 	}
 
 	os_write(1, &ch, 1);
+	serial_tx_count++;
 	if (ch == '\n')
 		priv->start_of_line = true;
 
 	return 0;
 }
 
+static ssize_t sandbox_serial_puts(struct udevice *dev, const char *s,
+				   size_t len)
+{
+	struct sandbox_serial_priv *priv = dev_get_priv(dev);
+	struct sandbox_serial_platdata *plat = dev->platdata;
+	const char *nl;
+	size_t count;
+
+	if (serial_tx_busy)
+		return -EAGAIN;
+	if (priv->start_of_line && plat->colour != -1) {
+		priv->start_of_line = false;
+		output_ansi_colour(plat->colour);
+	}
+
+	/* Write up to the end of the line, so the colour can be set again */
+	nl = memchr(s, '\n', len);
+	count = nl ? nl - s + 1 : len;
+	os_write(1, s, count);
+	serial_tx_count += count;
+	if (nl)
+		priv->start_of_line = true;
+
+	return count;
+}
+
+void sandbox_serial_set_tx_busy(bool busy)
+{
+	serial_tx_busy = busy;
+}
+
+size_t sandbox_serial_get_tx_count(void)
+{
+	return serial_tx_count;
+}
+
 static unsigned int increment_buffer_index(unsigned int index)
 {
 	return (index + 1) % ARRAY_SIZE(serial_buf);
@@ -239,6 +283,7 @@ static int sandbox_serial_ofdata_to_platdata(struct udevice *dev)
 
 static const struct dm_serial_ops sandbox_serial_ops = {
 	.putc = sandbox_serial_putc,
+	.puts = sandbox_serial_puts,
 	.pending = sandbox_serial_pending,
 	.getc = sandbox_serial_getc,
 	.getconfig = sandbox_serial_getconfig,
@@ -173,23 +173,140 @@ void serial_initialize(void)
 	serial_init();
 }
 
-static void _serial_putc(struct udevice *dev, char ch)
+/**
+ * serial_write() - Write characters to a device
+ *
+ * @dev: Device to write to
+ * @str: Characters to write
+ * @len: Number of characters to write
+ * @wait: true to wait until all characters are written, false to write only
+ *	those which the device can accept without waiting
+ * @return number of characters consumed
+ */
+static size_t serial_write(struct udevice *dev, const char *str, size_t len,
+			   bool wait)
 {
 	struct dm_serial_ops *ops = serial_get_ops(dev);
-	int err;
+	size_t done = 0;
+	ssize_t ret;
 
-	if (ch == '\n')
-		_serial_putc(dev, '\r');
+	while (done < len) {
+		if (ops->puts) {
+			ret = ops->puts(dev, str + done, len - done);
+		} else {
+			ret = ops->putc(dev, str[done]);
+			if (!ret)
+				ret = 1;
+		}
+		if (ret == -EAGAIN) {
+			if (!wait)
+				break;
+			continue;
+		}
 
-	do {
-		err = ops->putc(dev, ch);
-	} while (err == -EAGAIN);
+		/* As with putc(), drop a character which cannot be written */
+		done += ret > 0 ? ret : 1;
+	}
+
+	return done;
+}
+
+#if CONFIG_IS_ENABLED(SERIAL_TX_BUFFER)
+/**
+ * serial_tx_drain() - Send characters from the TX buffer
+ *
+ * @dev: Device to drain
+ * @all: true to wait until the buffer is empty, false to send only what the
+ *	device can accept without waiting
+ */
+static void serial_tx_drain(struct udevice *dev, bool all)
+{
+	struct serial_dev_priv *upriv = dev_get_uclass_priv(dev);
+	uint pos, len, done;
+
+	while (upriv->tx_rd != upriv->tx_wr) {
+		pos = upriv->tx_rd % CONFIG_SERIAL_TX_BUFFER_SIZE;
+		len = min(upriv->tx_wr - upriv->tx_rd,
+			  CONFIG_SERIAL_TX_BUFFER_SIZE - pos);
+		done = serial_write(dev, upriv->tx_buf + pos, len, false);
+		if (!done && !all)
+			break;
+		upriv->tx_rd += done;
+	}
+}
+
+static void serial_tx_add(struct udevice *dev, char ch)
+{
+	struct serial_dev_priv *upriv = dev_get_uclass_priv(dev);
+
+	/* When full, wait for the device to take some characters */
+	while (upriv->tx_wr - upriv->tx_rd == CONFIG_SERIAL_TX_BUFFER_SIZE)
+		serial_tx_drain(dev, false);
+
+	upriv->tx_buf[upriv->tx_wr++ % CONFIG_SERIAL_TX_BUFFER_SIZE] = ch;
+}
+
+static bool serial_tx_buffered(struct udevice *dev)
+{
+	struct serial_dev_priv *upriv = dev_get_uclass_priv(dev);
+
+	return upriv->tx_buf;
+}
+
+static void _serial_flush(struct udevice *dev)
+{
+	if (serial_tx_buffered(dev))
+		serial_tx_drain(dev, true);
+}
+#else
+static void serial_tx_drain(struct udevice *dev, bool all) {}
+static void serial_tx_add(struct udevice *dev, char ch) {}
+
+static bool serial_tx_buffered(struct udevice *dev)
+{
+	return false;
+}
+
+static void _serial_flush(struct udevice *dev) {}
+#endif /* CONFIG_IS_ENABLED(SERIAL_TX_BUFFER) */
+
+static void _serial_putc(struct udevice *dev, char ch)
+{
+	if (serial_tx_buffered(dev)) {
+		if (ch == '\n')
+			serial_tx_add(dev, '\r');
+		serial_tx_add(dev, ch);
+		serial_tx_drain(dev, false);
+	} else if (ch == '\n') {
+		serial_write(dev, "\r\n", 2, true);
+	} else {
+		serial_write(dev, &ch, 1, true);
+	}
 }
 
 static void _serial_puts(struct udevice *dev, const char *str)
 {
-	while (*str)
-		_serial_putc(dev, *str++);
+	const char *end;
+
+	if (serial_tx_buffered(dev)) {
+		for (; *str; str++) {
+			if (*str == '\n')
+				serial_tx_add(dev, '\r');
+			serial_tx_add(dev, *str);
+		}
+		serial_tx_drain(dev, false);
+		return;
+	}
+
+	/* Write each line in one go, adding a carriage return */
+	while (*str) {
+		end = strchrnul(str, '\n');
+		serial_write(dev, str, end - str, true);
+		if (!*end)
+			break;
+		serial_write(dev, "\r\n", 2, true);
+		str = end + 1;
+	}
 }
 
 static int __serial_getc(struct udevice *dev)
@@ -199,8 +316,10 @@ static int __serial_getc(struct udevice *dev)
 
 	do {
 		err = ops->getc(dev);
-		if (err == -EAGAIN)
+		if (err == -EAGAIN) {
 			WATCHDOG_RESET();
+			serial_tx_drain(dev, false);
+		}
 	} while (err == -EAGAIN);
 
 	return err >= 0 ? err : 0;
@@ -210,6 +329,8 @@ static int __serial_tstc(struct udevice *dev)
 {
 	struct dm_serial_ops *ops = serial_get_ops(dev);
 
+	/* Send buffered output while waiting for input */
+	serial_tx_drain(dev, false);
 	if (ops->pending)
 		return ops->pending(dev, true);
 
@@ -285,6 +406,19 @@ int serial_tstc(void)
 	return _serial_tstc(gd->cur_serial_dev);
 }
 
+void serial_flush(void)
+{
+	struct udevice *dev;
+	struct uclass *uc;
+
+	if (uclass_get(UCLASS_SERIAL, &uc))
+		return;
+	uclass_foreach_dev(dev, uc) {
+		if (device_active(dev))
+			_serial_flush(dev);
+	}
+}
+
 void serial_setbrg(void)
 {
 	struct dm_serial_ops *ops;
@@ -292,6 +426,8 @@ void serial_setbrg(void)
 	if (!gd->cur_serial_dev)
 		return;
 
+	/* Send buffered output at the old baud rate */
+	_serial_flush(gd->cur_serial_dev);
 	ops = serial_get_ops(gd->cur_serial_dev);
 	if (ops->setbrg)
 		ops->setbrg(gd->cur_serial_dev, gd->baudrate);
@@ -442,6 +578,8 @@ static int serial_post_probe(struct udevice *dev)
 		ops->getc += gd->reloc_off;
 	if (ops->putc)
 		ops->putc += gd->reloc_off;
+	if (ops->puts)
+		ops->puts += gd->reloc_off;
 	if (ops->pending)
 		ops->pending += gd->reloc_off;
 	if (ops->clear)
@@ -481,6 +619,10 @@ static int serial_post_probe(struct udevice *dev)
 	/* Allocate the RX buffer */
 	upriv->buf = malloc(CONFIG_SERIAL_RX_BUFFER_SIZE);
 #endif
+#if CONFIG_IS_ENABLED(SERIAL_TX_BUFFER)
+	/* Allocate the TX buffer */
+	upriv->tx_buf = malloc(CONFIG_SERIAL_TX_BUFFER_SIZE);
+#endif
 
 	stdio_register_dev(&sdev, &upriv->sdev);
 #endif
@@ -489,12 +631,19 @@ static int serial_post_probe(struct udevice *dev)
 
 static int serial_pre_remove(struct udevice *dev)
 {
-#if CONFIG_IS_ENABLED(SYS_STDIO_DEREGISTER)
-	struct serial_dev_priv *upriv = dev_get_uclass_priv(dev);
+	struct serial_dev_priv *upriv __maybe_unused;
+
+	upriv = dev_get_uclass_priv(dev);
 
+#if CONFIG_IS_ENABLED(SYS_STDIO_DEREGISTER)
 	if (stdio_deregister_dev(upriv->sdev, true))
 		return -EPERM;
 #endif
+#if CONFIG_IS_ENABLED(SERIAL_TX_BUFFER)
+	_serial_flush(dev);
+	free(upriv->tx_buf);
+	upriv->tx_buf = NULL;
+#endif
 
 	return 0;
 }
@@ -14,12 +14,19 @@
  * This driver emulates a flash stick using the UFI command specification and
  * the BBB (bulk/bulk/bulk) protocol. It supports only a single logical unit
  * number (LUN 0).
+ *
+ * With the sandbox,uas property it also offers UAS (USB Attached SCSI) as an
+ * alternate setting, without streams. Commands are queued and then handled
+ * newest first, so that the host has to go by their tags.
  */
 
 enum {
 	SANDBOX_FLASH_EP_OUT		= 1,	/* endpoints */
 	SANDBOX_FLASH_EP_IN		= 2,
+	SANDBOX_FLASH_EP_CMD		= 3,	/* UAS only */
+	SANDBOX_FLASH_EP_STATUS		= 4,
 	SANDBOX_FLASH_BLOCK_LEN		= 512,
+	SANDBOX_FLASH_UAS_QUEUE		= 32,	/* UAS commands queued */
 };
 
 enum cmd_phase {
@@ -36,6 +43,17 @@ enum {
 	STRINGID_COUNT,
 };
 
+/**
+ * struct sandbox_flash_uas_cmd - a UAS command waiting to be handled
+ *
+ * @tag:	Tag from the command IU
+ * @cdb:	SCSI command
+ */
+struct sandbox_flash_uas_cmd {
+	u16 tag;
+	u8 cdb[16];
+};
+
 /**
  * struct sandbox_flash_priv - private state for this driver
  *
@@ -49,6 +67,9 @@ enum {
  * @status_buff:	Data buffer for outgoing status
  * @buff_used:	Number of bytes ready to transfer back to host
  * @buff:	Data buffer for outgoing data
+ * @uas:	true if the UAS alternate setting is selected
+ * @uas_count:	Number of UAS commands in @uas_queue
+ * @uas_queue:	UAS commands not yet handled
  */
 struct sandbox_flash_priv {
 	bool error;
@@ -62,10 +83,14 @@ struct sandbox_flash_priv {
 	struct umass_bbb_csw status;
 	int buff_used;
 	u8 buff[512];
+	bool uas;
+	int uas_count;
+	struct sandbox_flash_uas_cmd uas_queue[SANDBOX_FLASH_UAS_QUEUE];
 };
 
 struct sandbox_flash_plat {
 	const char *pathname;
+	bool uas;
 	struct usb_string flash_strings[STRINGID_COUNT];
 };
 
@@ -158,6 +183,77 @@ static struct usb_endpoint_descriptor flash_endpoint1_in = {
 	.bInterval		= 0,
 };
 
+/* A separate copy, since wTotalLength is different */
+static struct usb_config_descriptor flash_config0_uas = {
+	.bLength		= sizeof(flash_config0_uas),
+	.bDescriptorType	= USB_DT_CONFIG,
+
+	/* wTotalLength is set up by usb-emul-uclass */
+	.bNumInterfaces		= 1,
+	.bConfigurationValue	= 0,
+	.iConfiguration		= 0,
+	.bmAttributes		= 1 << 7,
+	.bMaxPower		= 50,
+};
+
+static struct usb_interface_descriptor flash_interface0_uas = {
+	.bLength		= sizeof(flash_interface0_uas),
+	.bDescriptorType	= USB_DT_INTERFACE,
+
+	.bInterfaceNumber	= 0,
+	.bAlternateSetting	= 1,
+	.bNumEndpoints		= 4,
+	.bInterfaceClass	= USB_CLASS_MASS_STORAGE,
+	.bInterfaceSubClass	= US_SC_SCSI,
+	.bInterfaceProtocol	= US_PR_UAS,
+	.iInterface		= 0,
+};
+
+static struct usb_endpoint_descriptor flash_endpoint_cmd = {
+	.bLength		= USB_DT_ENDPOINT_SIZE,
+	.bDescriptorType	= USB_DT_ENDPOINT,
+
+	.bEndpointAddress	= SANDBOX_FLASH_EP_CMD,
+	.bmAttributes		= USB_ENDPOINT_XFER_BULK,
+	.wMaxPacketSize		= __constant_cpu_to_le16(1024),
+	.bInterval		= 0,
+};
+
+static struct usb_endpoint_descriptor flash_endpoint_status = {
+	.bLength		= USB_DT_ENDPOINT_SIZE,
+	.bDescriptorType	= USB_DT_ENDPOINT,
+
+	.bEndpointAddress	= SANDBOX_FLASH_EP_STATUS |
+				  USB_ENDPOINT_DIR_MASK,
+	.bmAttributes		= USB_ENDPOINT_XFER_BULK,
+	.wMaxPacketSize		= __constant_cpu_to_le16(1024),
+	.bInterval		= 0,
+};
+
+static struct uas_pipe_usage_desc flash_pipe_cmd = {
+	.bLength		= sizeof(flash_pipe_cmd),
+	.bDescriptorType	= USB_DT_PIPE_USAGE,
+	.bPipeID		= UAS_PIPE_ID_CMD,
+};
+
+static struct uas_pipe_usage_desc flash_pipe_status = {
+	.bLength		= sizeof(flash_pipe_status),
+	.bDescriptorType	= USB_DT_PIPE_USAGE,
+	.bPipeID		= UAS_PIPE_ID_STATUS,
+};
+
+static struct uas_pipe_usage_desc flash_pipe_data_in = {
+	.bLength		= sizeof(flash_pipe_data_in),
+	.bDescriptorType	= USB_DT_PIPE_USAGE,
+	.bPipeID		= UAS_PIPE_ID_DATA_IN,
+};
+
+static struct uas_pipe_usage_desc flash_pipe_data_out = {
+	.bLength		= sizeof(flash_pipe_data_out),
+	.bDescriptorType	= USB_DT_PIPE_USAGE,
+	.bPipeID		= UAS_PIPE_ID_DATA_OUT,
+};
+
 static void *flash_desc_list[] = {
 	&flash_device_desc,
 	&flash_config0,
@@ -167,10 +263,30 @@ static void *flash_desc_list[] = {
 	NULL,
 };
 
+/* The data pipes are the same endpoints as for BBB */
+static void *flash_uas_desc_list[] = {
+	&flash_device_desc,
+	&flash_config0_uas,
+	&flash_interface0,
+	&flash_endpoint0_out,
+	&flash_endpoint1_in,
+	&flash_interface0_uas,
+	&flash_endpoint_cmd,
+	&flash_pipe_cmd,
+	&flash_endpoint_status,
+	&flash_pipe_status,
+	&flash_endpoint1_in,
+	&flash_pipe_data_in,
+	&flash_endpoint0_out,
+	&flash_pipe_data_out,
+	NULL,
+};
+
 static int sandbox_flash_control(struct udevice *dev, struct usb_device *udev,
 				 unsigned long pipe, void *buff, int len,
 				 struct devrequest *setup)
 {
+	struct sandbox_flash_plat *plat = dev_get_platdata(dev);
 	struct sandbox_flash_priv *priv = dev_get_priv(dev);
 
 	if (pipe == usb_rcvctrlpipe(udev, 0)) {
@@ -185,6 +301,17 @@ static int sandbox_flash_control(struct udevice *dev, struct usb_device *udev,
 			debug("request=%x\n", setup->request);
 			break;
 		}
+	} else if (pipe == usb_sndctrlpipe(udev, 0)) {
+		switch (setup->request) {
+		case USB_REQ_SET_INTERFACE:
+			priv->uas = plat->uas && le16_to_cpu(setup->value) == 1;
+			priv->phase = PHASE_START;
+			priv->uas_count = 0;
+			return 0;
+		default:
+			debug("request=%x\n", setup->request);
+			break;
+		}
 	}
 	debug("pipe=%lx\n", pipe);
 
@@ -293,6 +420,70 @@ static int handle_ufi_command(struct sandbox_flash_plat *plat,
 	return 0;
 }
 
+/* Queue a UAS command until the host asks for status */
+static int handle_uas_command(struct sandbox_flash_priv *priv,
+			      const void *buff, int len)
+{
+	const struct uas_command_iu *iu = buff;
+	struct sandbox_flash_uas_cmd *cmd;
+
+	if (len != UAS_COMMAND_IU_SIZE || iu->iu_id != UAS_IU_ID_COMMAND ||
+	    iu->lun[1] != 0 || priv->uas_count == SANDBOX_FLASH_UAS_QUEUE)
+		return -EIO;
+	cmd = &priv->uas_queue[priv->uas_count++];
+	cmd->tag = be16_to_cpu(iu->tag);
+	memcpy(cmd->cdb, iu->cdb, sizeof(cmd->cdb));
+
+	return len;
+}
+
+/*
+ * Send the next IU on the status pipe: either Read Ready for the newest
+ * queued command, if it has data, or the sense IU for the current command
+ */
+static int handle_uas_status(struct sandbox_flash_plat *plat,
+			     struct sandbox_flash_priv *priv, void *buff,
+			     int len)
+{
+	struct uas_sense_iu *iu = buff;
+	struct sandbox_flash_uas_cmd *cmd;
+
+	if (len < UAS_SENSE_IU_HDR_SIZE)
+		return -EIO;
+	memset(iu, '\0', UAS_SENSE_IU_HDR_SIZE);
+	switch (priv->phase) {
+	case PHASE_START:
+		if (!priv->uas_count)
+			return -EIO;
+		cmd = &priv->uas_queue[--priv->uas_count];
+		priv->tag = cmd->tag;
+		priv->alloc_len = 0;
+		priv->read_len = 0;
+		priv->transfer_len = 0;
+		if (handle_ufi_command(plat, priv, cmd->cdb, sizeof(cmd->cdb)))
+			setup_fail_response(priv);
+		if (priv->buff_used) {
+			priv->phase = PHASE_DATA;
+			iu->iu_id = UAS_IU_ID_READ_READY;
+			iu->tag = cpu_to_be16(priv->tag);
+			return 4;
+		}
+		break;
+	case PHASE_DATA:
+		return -EIO;
+	default:
+		break;
+	}
+
+	priv->phase = PHASE_START;
+	iu->iu_id = UAS_IU_ID_SENSE;
+	iu->tag = cpu_to_be16(priv->tag);
+	/* Check Condition */
+	iu->status = priv->status.bCSWStatus == CSWSTATUS_GOOD ? 0 : 2;
+
+	return UAS_SENSE_IU_HDR_SIZE;
+}
+
 static int sandbox_flash_bulk(struct udevice *dev, struct usb_device *udev,
 			      unsigned long pipe, void *buff, int len)
 {
@@ -303,6 +494,21 @@ static int sandbox_flash_bulk(struct udevice *dev, struct usb_device *udev,
 
 	debug("%s: dev=%s, pipe=%lx, ep=%x, len=%x, phase=%d\n", __func__,
 	      dev->name, pipe, ep, len, priv->phase);
+	if (priv->uas) {
+		switch (ep) {
+		case SANDBOX_FLASH_EP_CMD:
+			return handle_uas_command(priv, buff, len);
+		case SANDBOX_FLASH_EP_STATUS:
+			return handle_uas_status(plat, priv, buff, len);
+		case SANDBOX_FLASH_EP_IN:
+			/* Data goes as for BBB */
+			if (priv->phase != PHASE_DATA)
+				goto err;
+			break;
+		default:
+			goto err;
+		}
+	}
 	switch (ep) {
 	case SANDBOX_FLASH_EP_OUT:
 		switch (priv->phase) {
@@ -387,7 +593,11 @@ static int sandbox_flash_bind(struct udevice *dev)
 	fs[2].id = STRINGID_SERIAL;
 	fs[2].s = dev->name;
 
-	return usb_emul_setup_device(dev, plat->flash_strings, flash_desc_list);
+	plat->uas = dev_read_bool(dev, "sandbox,uas");
+
+	return usb_emul_setup_device(dev, plat->flash_strings,
+				     plat->uas ? flash_uas_desc_list :
+				     flash_desc_list);
 }
 
 static int sandbox_flash_probe(struct udevice *dev)
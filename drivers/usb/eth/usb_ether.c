@@ -23,7 +23,7 @@ int usb_ether_register(struct udevice *dev, struct ueth_data *ueth, int rxsize)
 	bool ep_in_found = false, ep_out_found = false;
 	struct usb_interface *iface;
 	const int ifnum = 0; /* Always use interface 0 */
-	int ret, i;
+	int ret, i, size;
 
 	iface = &udev->config.if_desc[ifnum];
 	iface_desc = &udev->config.if_desc[ifnum].desc;
@@ -72,9 +72,12 @@ int usb_ether_register(struct udevice *dev, struct ueth_data *ueth, int rxsize)
 	}
 
 	ueth->rxsize = rxsize;
-	ueth->rxbuf = memalign(ARCH_DMA_MINALIGN, rxsize);
+	size = roundup(rxsize, ARCH_DMA_MINALIGN);
+	ueth->rxbuf = memalign(ARCH_DMA_MINALIGN, size * USB_ETHER_RX_QUEUE);
 	if (!ueth->rxbuf)
 		return -ENOMEM;
+	for (i = 0; i < USB_ETHER_RX_QUEUE; i++)
+		ueth->rxreq[i].buffer = ueth->rxbuf + i * size;
 
 	ret = usb_set_interface(udev, iface_desc->bInterfaceNumber, ifnum);
 	if (ret) {
@@ -89,33 +92,80 @@ int usb_ether_register(struct udevice *dev, struct ueth_data *ueth, int rxsize)
 
 int usb_ether_deregister(struct ueth_data *ueth)
 {
+	/* Take the receive buffers back from the controller */
+	if (ueth->rxqueued)
+		usb_bulk_cancel(ueth->pusb_dev,
+				usb_rcvbulkpipe(ueth->pusb_dev, ueth->ep_in));
+	ueth->rxqueued = false;
+
 	return 0;
 }
 
+static int usb_ether_queue_rx(struct ueth_data *ueth, int index, int rxsize)
+{
+	struct usb_bulk_req *req = &ueth->rxreq[index];
+
+	req->pipe = usb_rcvbulkpipe(ueth->pusb_dev, ueth->ep_in);
+	req->length = rxsize;
+
+	return usb_bulk_submit(ueth->pusb_dev, req);
+}
+
 int usb_ether_receive(struct ueth_data *ueth, int rxsize)
 {
-	int actual_len;
-	int ret;
+	struct usb_bulk_req *req;
+	int ret, i;
 
 	if (rxsize > ueth->rxsize)
 		return -EINVAL;
-	ret = usb_bulk_msg(ueth->pusb_dev,
-			   usb_rcvbulkpipe(ueth->pusb_dev, ueth->ep_in),
-			   ueth->rxbuf, rxsize, &actual_len,
-			   USB_BULK_RECV_TIMEOUT);
-	debug("Rx: len = %u, actual = %u, err = %d\n", rxsize, actual_len, ret);
+
+	/*
+	 * Keep every buffer queued except the one being processed, which
+	 * goes to the back of the queue once we are asked for more
+	 */
+	if (!ueth->rxqueued) {
+		ueth->rxhead = 0;
+		ueth->rxqueued = true;
+		for (i = 0; i < USB_ETHER_RX_QUEUE; i++) {
+			ret = usb_ether_queue_rx(ueth, i, rxsize);
+			if (ret)
+				goto err;
+		}
+	} else if (ueth->rxheld) {
+		ret = usb_ether_queue_rx(ueth, ueth->rxhead, rxsize);
+		if (ret)
+			goto err;
+		ueth->rxhead = (ueth->rxhead + 1) % USB_ETHER_RX_QUEUE;
+	}
+	ueth->rxheld = false;
+
+	req = &ueth->rxreq[ueth->rxhead];
+	ret = usb_bulk_reap(ueth->pusb_dev, req, USB_BULK_RECV_TIMEOUT);
+	if (ret == -ETIMEDOUT)
+		return -EAGAIN;
+	ueth->rxheld = true;
+	debug("Rx: len = %u, actual = %u, err = %d\n", rxsize, req->act_len,
+	      ret);
 	if (ret) {
 		printf("Rx: failed to receive: %d\n", ret);
-		return ret;
+		goto err;
 	}
-	if (actual_len > rxsize) {
-		debug("Rx: received too many bytes %d\n", actual_len);
+	if (req->act_len > rxsize) {
+		debug("Rx: received too many bytes %d\n", req->act_len);
 		return -ENOSPC;
 	}
-	ueth->rxlen = actual_len;
+	ueth->rxbuf = req->buffer;
+	ueth->rxlen = req->act_len;
 	ueth->rxptr = 0;
 
-	return actual_len ? 0 : -EAGAIN;
+	return req->act_len ? 0 : -EAGAIN;
+
+err:
+	/* Start again with a fresh queue next time */
+	usb_ether_deregister(ueth);
+	ueth->rxheld = false;
+
+	return ret;
 }
 
 void usb_ether_advance_rxbuf(struct ueth_data *ueth, int num_bytes)
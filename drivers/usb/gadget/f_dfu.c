@@ -183,13 +183,21 @@ static int handle_getstatus(struct usb_request *req)
 	struct dfu_status *dstat = (struct dfu_status *)req->buf;
 	struct f_dfu *f_dfu = req->context;
 	struct dfu_entity *dfu = dfu_get_entity(f_dfu->altsetting);
+	unsigned int busy;
 
 	dfu_set_poll_timeout(dstat, 0);
 
 	switch (f_dfu->dfu_state) {
 	case DFU_STATE_dfuDNLOAD_SYNC:
 	case DFU_STATE_dfuDNBUSY:
-		f_dfu->dfu_state = DFU_STATE_dfuDNLOAD_IDLE;
+		/* Both buffers full: hold off the host while one is written */
+		busy = dfu_write_busy(dfu);
+		if (busy) {
+			f_dfu->dfu_state = DFU_STATE_dfuDNBUSY;
+			dfu_set_poll_timeout(dstat, busy);
+		} else {
+			f_dfu->dfu_state = DFU_STATE_dfuDNLOAD_IDLE;
+		}
 		break;
 	case DFU_STATE_dfuMANIFEST_SYNC:
 		f_dfu->dfu_state = DFU_STATE_dfuMANIFEST;
@@ -11,6 +11,7 @@
 
 struct sandbox_usb_ctrl {
 	int rootdev;
+	struct list_head bulk_reqs;	/* Queued bulk transfers, oldest first */
 };
 
 static void usbmon_trace(struct udevice *bus, ulong pipe,
@@ -97,6 +98,62 @@ static int sandbox_submit_bulk(struct udevice *bus, struct usb_device *udev,
 	return ret;
 }
 
+static int sandbox_submit_bulk_req(struct udevice *bus,
+				   struct usb_device *udev,
+				   struct usb_bulk_req *req)
+{
+	struct sandbox_usb_ctrl *ctrl = dev_get_priv(bus);
+
+	req->hcpriv[0] = udev;
+	list_add_tail(&req->list, &ctrl->bulk_reqs);
+
+	return 0;
+}
+
+/*
+ * Carry out queued transfers in the order they were submitted, until @req is
+ * done. The emulators respond at once, so there is no need to wait.
+ */
+static int sandbox_reap_bulk_req(struct udevice *bus, struct usb_device *udev,
+				 struct usb_bulk_req *req, int timeout)
+{
+	struct sandbox_usb_ctrl *ctrl = dev_get_priv(bus);
+	struct usb_bulk_req *cur;
+	int ret;
+
+	while (!req->done && !list_empty(&ctrl->bulk_reqs)) {
+		cur = list_first_entry(&ctrl->bulk_reqs, struct usb_bulk_req,
+				       list);
+		list_del(&cur->list);
+		ret = sandbox_submit_bulk(bus, cur->hcpriv[0], cur->pipe,
+					  cur->buffer, cur->length);
+		/* An emulator error is what a device would report as a stall */
+		cur->act_len = ret < 0 ? 0 : ret;
+		cur->status = ret < 0 ? USB_ST_STALLED : 0;
+		cur->done = true;
+	}
+
+	return req->done ? 0 : -ETIMEDOUT;
+}
+
+static int sandbox_cancel_bulk_reqs(struct udevice *bus,
+				    struct usb_device *udev, unsigned long pipe)
+{
+	struct sandbox_usb_ctrl *ctrl = dev_get_priv(bus);
+	struct usb_bulk_req *req, *next;
+
+	list_for_each_entry_safe(req, next, &ctrl->bulk_reqs, list) {
+		if (req->hcpriv[0] != udev ||
+		    usb_pipeendpoint(req->pipe) != usb_pipeendpoint(pipe) ||
+		    usb_pipein(req->pipe) != usb_pipein(pipe))
+			continue;
+		list_del(&req->list);
+		req->done = true;
+	}
+
+	return 0;
+}
+
 static int sandbox_submit_int(struct udevice *bus, struct usb_device *udev,
 			      unsigned long pipe, void *buffer, int length,
 			      int interval, bool nonblock)
@@ -133,6 +190,10 @@ static int sandbox_alloc_device(struct udevice *dev, struct usb_device *udev)
 
 static int sandbox_usb_probe(struct udevice *dev)
 {
+	struct sandbox_usb_ctrl *ctrl = dev_get_priv(dev);
+
+	INIT_LIST_HEAD(&ctrl->bulk_reqs);
+
 	return 0;
 }
 
@@ -141,6 +202,9 @@ static const struct dm_usb_ops sandbox_usb_ops = {
 	.bulk		= sandbox_submit_bulk,
 	.interrupt	= sandbox_submit_int,
 	.alloc_device	= sandbox_alloc_device,
+	.submit_bulk_req = sandbox_submit_bulk_req,
+	.reap_bulk_req	= sandbox_reap_bulk_req,
+	.cancel_bulk_reqs = sandbox_cancel_bulk_reqs,
 };
 
 static const struct udevice_id sandbox_usb_ids[] = {
@@ -114,6 +114,40 @@ int destroy_int_queue(struct usb_device *udev, struct int_queue *queue)
 	return ops->destroy_int_queue(bus, udev, queue);
 }
 
+int submit_bulk_req(struct usb_device *udev, struct usb_bulk_req *req)
+{
+	struct udevice *bus = udev->controller_dev;
+	struct dm_usb_ops *ops = usb_get_ops(bus);
+
+	if (!ops->submit_bulk_req)
+		return -ENOSYS;
+
+	return ops->submit_bulk_req(bus, udev, req);
+}
+
+int reap_bulk_req(struct usb_device *udev, struct usb_bulk_req *req,
+		  int timeout)
+{
+	struct udevice *bus = udev->controller_dev;
+	struct dm_usb_ops *ops = usb_get_ops(bus);
+
+	if (!ops->reap_bulk_req)
+		return -ENOSYS;
+
+	return ops->reap_bulk_req(bus, udev, req, timeout);
+}
+
+int cancel_bulk_reqs(struct usb_device *udev, unsigned long pipe)
+{
+	struct udevice *bus = udev->controller_dev;
+	struct dm_usb_ops *ops = usb_get_ops(bus);
+
+	if (!ops->cancel_bulk_reqs)
+		return -ENOSYS;
+
+	return ops->cancel_bulk_reqs(bus, udev, pipe);
+}
+
 int usb_alloc_device(struct usb_device *udev)
 {
 	struct udevice *bus = udev->controller_dev;
@@ -423,16 +423,123 @@ static int event_ready(struct xhci_ctrl *ctrl)
 	return 1;
 }
 
+static void get_transfer_result(union xhci_trb *event, int length,
+				int *act_len, unsigned long *status)
+{
+	*act_len = min(length, length -
+		(int)EVENT_TRB_LEN(le32_to_cpu(event->trans_event.transfer_len)));
+
+	switch (GET_COMP_CODE(le32_to_cpu(event->trans_event.transfer_len))) {
+	case COMP_SUCCESS:
+		BUG_ON(*act_len != length);
+		/* fallthrough */
+	case COMP_SHORT_TX:
+		*status = 0;
+		break;
+	case COMP_STALL:
+		*status = USB_ST_STALLED;
+		break;
+	case COMP_DB_ERR:
+	case COMP_TRB_ERR:
+		*status = USB_ST_BUF_ERR;
+		break;
+	case COMP_BABBLE:
+		*status = USB_ST_BABBLE_DET;
+		break;
+	default:
+		*status = 0x80;  /* USB_ST_TOO_LAZY_TO_MAKE_A_NEW_MACRO */
+	}
+}
+
+/**
+ * Completes the queued bulk request that a transfer event is for, if any
+ *
+ * @param ctrl	Host controller data structure
+ * @param event	Transfer event TRB
+ * @return true if the event completed a request, else false
+ */
+static bool complete_bulk_req(struct xhci_ctrl *ctrl, union xhci_trb *event)
+{
+	u32 field = le32_to_cpu(event->trans_event.flags);
+	int code = GET_COMP_CODE(le32_to_cpu(event->trans_event.transfer_len));
+	struct xhci_virt_device *virt_dev;
+	union xhci_trb *trb, *first, *last;
+	struct usb_bulk_req *req;
+	struct xhci_virt_ep *ep;
+
+	/* Stopping an endpoint reports where it got to, but completes nothing */
+	if (code == COMP_STOP || code == COMP_STOP_INVAL)
+		return false;
+
+	virt_dev = ctrl->devs[TRB_TO_SLOT_ID(field)];
+	if (!virt_dev)
+		return false;
+	ep = &virt_dev->eps[TRB_TO_EP_INDEX(field)];
+	if (list_empty(&ep->bulk_reqs))
+		return false;
+
+	/* TDs complete in order, so this can only be for the oldest one */
+	req = list_first_entry(&ep->bulk_reqs, struct usb_bulk_req, list);
+	first = req->hcpriv[0];
+	last = req->hcpriv[1];
+	trb = (union xhci_trb *)(uintptr_t)
+		le64_to_cpu(event->trans_event.buffer);
+
+	/* The TD may wrap around the end of the ring */
+	if (first <= last ? trb < first || trb > last :
+	    trb < first && trb > last)
+		return false;
+
+	get_transfer_result(event, req->length, &req->act_len, &req->status);
+	xhci_inval_cache((uintptr_t)req->buffer, req->length);
+	ep->bulk_trbs -= (uintptr_t)req->hcpriv[2];
+	list_del(&req->list);
+	req->done = true;
+
+	return true;
+}
+
+/**
+ * Skips an event which nothing is waiting for
+ *
+ * @param event	Event TRB
+ * @return none
+ */
+static void discard_event(union xhci_trb *event)
+{
+	trb_type type = TRB_FIELD_TO_TYPE(le32_to_cpu(event->event_cmd.flags));
+	int code = GET_COMP_CODE(le32_to_cpu(event->generic.field[2]));
+
+	if (type == TRB_PORT_STATUS)
+	/* TODO: remove this once enumeration has been reworked */
+		/*
+		 * Port status change events always have a
+		 * successful completion code
+		 */
+		BUG_ON(code != COMP_SUCCESS);
+	else if (type == TRB_TRANSFER &&
+		 (code == COMP_STOP || code == COMP_STOP_INVAL))
+		/* Where xhci_bulk_cancel() stopped the endpoint */
+		debug("Endpoint stopped\n");
+	else
+		printf("Unexpected XHCI event TRB, skipping... "
+			"(%08x %08x %08x %08x)\n",
+			le32_to_cpu(event->generic.field[0]),
+			le32_to_cpu(event->generic.field[1]),
+			le32_to_cpu(event->generic.field[2]),
+			le32_to_cpu(event->generic.field[3]));
+}
+
 /**
- * Waits for a specific type of event and returns it. Discards unexpected
- * events. Caller *must* call xhci_acknowledge_event() after it is finished
- * processing the event, and must not access the returned pointer afterwards.
+ * Waits for a specific type of event and returns it, as
+ * xhci_wait_for_event(), but returns NULL on a timeout for any type of event
  *
  * @param ctrl		Host controller data structure
  * @param expected	TRB type expected from Event TRB
- * @return pointer to event trb
+ * @return pointer to event trb, or NULL if it did not arrive in time
  */
-union xhci_trb *xhci_wait_for_event(struct xhci_ctrl *ctrl, trb_type expected)
+static union xhci_trb *wait_for_event(struct xhci_ctrl *ctrl,
+				      trb_type expected)
 {
 	trb_type type;
 	unsigned long ts = get_timer(0);
@@ -444,31 +551,36 @@ union xhci_trb *xhci_wait_for_event(struct xhci_ctrl *ctrl, trb_type expected)
 			continue;
 
 		type = TRB_FIELD_TO_TYPE(le32_to_cpu(event->event_cmd.flags));
+		if (type == TRB_TRANSFER && complete_bulk_req(ctrl, event)) {
+			xhci_acknowledge_event(ctrl);
+			continue;
+		}
 		if (type == expected)
 			return event;
 
-		if (type == TRB_PORT_STATUS)
-		/* TODO: remove this once enumeration has been reworked */
-			/*
-			 * Port status change events always have a
-			 * successful completion code
-			 */
-			BUG_ON(GET_COMP_CODE(
-				le32_to_cpu(event->generic.field[2])) !=
-								COMP_SUCCESS);
-		else
-			printf("Unexpected XHCI event TRB, skipping... "
-				"(%08x %08x %08x %08x)\n",
-				le32_to_cpu(event->generic.field[0]),
-				le32_to_cpu(event->generic.field[1]),
-				le32_to_cpu(event->generic.field[2]),
-				le32_to_cpu(event->generic.field[3]));
-
+		discard_event(event);
 		xhci_acknowledge_event(ctrl);
 	} while (get_timer(ts) < XHCI_TIMEOUT);
 
-	if (expected == TRB_TRANSFER)
-		return NULL;
+	return NULL;
+}
+
+/**
+ * Waits for a specific type of event and returns it. Completes queued bulk
+ * requests and discards unexpected events on the way. Caller *must* call
+ * xhci_acknowledge_event() after it is finished processing the event, and
+ * must not access the returned pointer afterwards.
+ *
+ * @param ctrl		Host controller data structure
+ * @param expected	TRB type expected from Event TRB
+ * @return pointer to event trb
+ */
+union xhci_trb *xhci_wait_for_event(struct xhci_ctrl *ctrl, trb_type expected)
+{
+	union xhci_trb *event = wait_for_event(ctrl, expected);
+
+	if (event || expected == TRB_TRANSFER)
+		return event;
 
 	printf("XHCI timeout on event type %d... cannot recover.\n", expected);
 	BUG();
@@ -517,46 +629,66 @@ static void abort_td(struct usb_device *udev, int ep_index)
 static void record_transfer_result(struct usb_device *udev,
 				   union xhci_trb *event, int length)
 {
-	udev->act_len = min(length, length -
-		(int)EVENT_TRB_LEN(le32_to_cpu(event->trans_event.transfer_len)));
+	get_transfer_result(event, length, &udev->act_len, &udev->status);
+}
 
-	switch (GET_COMP_CODE(le32_to_cpu(event->trans_event.transfer_len))) {
-	case COMP_SUCCESS:
-		BUG_ON(udev->act_len != length);
-		/* fallthrough */
-	case COMP_SHORT_TX:
-		udev->status = 0;
-		break;
-	case COMP_STALL:
-		udev->status = USB_ST_STALLED;
-		break;
-	case COMP_DB_ERR:
-	case COMP_TRB_ERR:
-		udev->status = USB_ST_BUF_ERR;
-		break;
-	case COMP_BABBLE:
-		udev->status = USB_ST_BABBLE_DET;
-		break;
-	default:
-		udev->status = 0x80;  /* USB_ST_TOO_LAZY_TO_MAKE_A_NEW_MACRO */
+/**** Bulk and Control transfer methods ****/
+/**
+ * Works out how many TRBs a BULK Request needs
+ *
+ * @param buffer	buffer to be read/written based on the request
+ * @param length	length of the buffer
+ * @return number of TRBs
+ */
+static int bulk_trbs(void *buffer, int length)
+{
+	u64 val_64 = (uintptr_t)buffer;
+	int running_total;
+	int num_trbs = 0;
+
+	/*
+	 * How much data is (potentially) left before the 64KB boundary?
+	 * XHCI Spec puts restriction( TABLE 49 and 6.4.1 section of XHCI Spec)
+	 * that the buffer should not span 64KB boundary. if so
+	 * we send request in more than 1 TRB by chaining them.
+	 */
+	running_total = TRB_MAX_BUFF_SIZE -
+			(lower_32_bits(val_64) & (TRB_MAX_BUFF_SIZE - 1));
+	running_total &= TRB_MAX_BUFF_SIZE - 1;
+
+	/*
+	 * If there's some data on this 64KB chunk, or we have to send a
+	 * zero-length transfer, we need at least one TRB
+	 */
+	if (running_total != 0 || length == 0)
+		num_trbs++;
+
+	/* How many more 64KB chunks to transfer, how many more TRBs? */
+	while (running_total < length) {
+		num_trbs++;
+		running_total += TRB_MAX_BUFF_SIZE;
 	}
+
+	return num_trbs;
 }
 
-/**** Bulk and Control transfer methods ****/
 /**
- * Queues up the BULK Request
+ * Queues up the TRBs for a BULK Request and rings the doorbell
  *
  * @param udev		pointer to the USB device structure
  * @param pipe		contains the DIR_IN or OUT , devnum
  * @param length	length of the buffer
  * @param buffer	buffer to be read/written based on the request
- * @return returns 0 if successful else -1 on failure
+ * @param first		returns the first TRB of the TD
+ * @param last		returns the last TRB of the TD
+ * @return 0 if successful else error code on failure
  */
-int xhci_bulk_tx(struct usb_device *udev, unsigned long pipe,
-			int length, void *buffer)
+static int queue_bulk_td(struct usb_device *udev, unsigned long pipe,
+			 int length, void *buffer, union xhci_trb **first,
+			 union xhci_trb **last)
 {
-	int num_trbs = 0;
-	struct xhci_generic_trb *start_trb;
+	int num_trbs;
+	struct xhci_generic_trb *start_trb, *trb;
 	bool first_trb = false;
 	int start_cycle;
 	u32 field = 0;
@@ -567,7 +699,6 @@ int xhci_bulk_tx(struct usb_device *udev, unsigned long pipe,
 	struct xhci_virt_device *virt_dev;
 	struct xhci_ep_ctx *ep_ctx;
 	struct xhci_ring *ring;		/* EP transfer ring */
-	union xhci_trb *event;
 
 	int running_total, trb_buff_len;
 	unsigned int total_packet_count;
@@ -577,9 +708,6 @@ int xhci_bulk_tx(struct usb_device *udev, unsigned long pipe,
 	u32 trb_fields[4];
 	u64 val_64 = (uintptr_t)buffer;
 
-	debug("dev=%p, pipe=%lx, buffer=%p, length=%d\n",
-		udev, pipe, buffer, length);
-
 	ep_index = usb_pipe_ep_index(pipe);
 	virt_dev = ctrl->devs[slot_id];
 
@@ -589,34 +717,13 @@ int xhci_bulk_tx(struct usb_device *udev, unsigned long pipe,
 	ep_ctx = xhci_get_ep_ctx(ctrl, virt_dev->out_ctx, ep_index);
 
 	ring = virt_dev->eps[ep_index].ring;
-	/*
-	 * How much data is (potentially) left before the 64KB boundary?
-	 * XHCI Spec puts restriction( TABLE 49 and 6.4.1 section of XHCI Spec)
-	 * that the buffer should not span 64KB boundary. if so
-	 * we send request in more than 1 TRB by chaining them.
-	 */
-	running_total = TRB_MAX_BUFF_SIZE -
-			(lower_32_bits(val_64) & (TRB_MAX_BUFF_SIZE - 1));
-	trb_buff_len = running_total;
-	running_total &= TRB_MAX_BUFF_SIZE - 1;
-
-	/*
-	 * If there's some data on this 64KB chunk, or we have to send a
-	 * zero-length transfer, we need at least one TRB
-	 */
-	if (running_total != 0 || length == 0)
-		num_trbs++;
-
-	/* How many more 64KB chunks to transfer, how many more TRBs? */
-	while (running_total < length) {
-		num_trbs++;
-		running_total += TRB_MAX_BUFF_SIZE;
-	}
+	num_trbs = bulk_trbs(buffer, length);
 
 	/*
 	 * XXX: Calling routine prepare_ring() called in place of
-	 * prepare_trasfer() as there in 'Linux' since we are not
-	 * maintaining multiple TDs/transfer at the same time.
+	 * prepare_trasfer() as there in 'Linux'. The ring is never more than
+	 * one segment, so xhci_bulk_submit() checks that there is room for
+	 * any TDs it keeps queued.
 	 */
 	ret = prepare_ring(ctrl, ring,
 			   le32_to_cpu(ep_ctx->ep_info) & EP_STATE_MASK);
@@ -644,6 +751,8 @@ int xhci_bulk_tx(struct usb_device *udev, unsigned long pipe,
 	 * we send request in more than 1 TRB by chaining them.
 	 */
 	addr = val_64;
+	trb_buff_len = TRB_MAX_BUFF_SIZE -
+		       (lower_32_bits(val_64) & (TRB_MAX_BUFF_SIZE - 1));
 
 	if (trb_buff_len > length)
 		trb_buff_len = length;
@@ -699,7 +808,7 @@ int xhci_bulk_tx(struct usb_device *udev, unsigned long pipe,
 		trb_fields[2] = length_field;
 		trb_fields[3] = field | (TRB_NORMAL << TRB_TYPE_SHIFT);
 
-		queue_trb(ctrl, ring, (num_trbs > 1), trb_fields);
+		trb = queue_trb(ctrl, ring, (num_trbs > 1), trb_fields);
 
 		--num_trbs;
 
@@ -711,6 +820,38 @@ int xhci_bulk_tx(struct usb_device *udev, unsigned long pipe,
 	} while (running_total < length);
 
 	giveback_first_trb(udev, ep_index, start_cycle, start_trb);
+	*first = (union xhci_trb *)start_trb;
+	*last = (union xhci_trb *)trb;
+
+	return 0;
+}
+
+/**
+ * Queues up the BULK Request and waits for it to complete
+ *
+ * @param udev		pointer to the USB device structure
+ * @param pipe		contains the DIR_IN or OUT , devnum
+ * @param length	length of the buffer
+ * @param buffer	buffer to be read/written based on the request
+ * @return returns 0 if successful else -1 on failure
+ */
+int xhci_bulk_tx(struct usb_device *udev, unsigned long pipe,
+			int length, void *buffer)
+{
+	struct xhci_ctrl *ctrl = xhci_get_ctrl(udev);
+	int slot_id = udev->slot_id;
+	int ep_index = usb_pipe_ep_index(pipe);
+	union xhci_trb *first, *last;
+	union xhci_trb *event;
+	u32 field;
+	int ret;
+
+	debug("dev=%p, pipe=%lx, buffer=%p, length=%d\n",
+		udev, pipe, buffer, length);
+
+	ret = queue_bulk_td(udev, pipe, length, buffer, &first, &last);
+	if (ret < 0)
+		return ret;
 
 	event = xhci_wait_for_event(ctrl, TRB_TRANSFER);
 	if (!event) {
@@ -734,6 +875,174 @@ int xhci_bulk_tx(struct usb_device *udev, unsigned long pipe,
 	return (udev->status != USB_ST_NOT_PROC) ? 0 : -1;
 }
 
+/**
+ * Queues up a BULK Request without waiting for it. It completes when
+ * xhci_bulk_reap() or xhci_wait_for_event() sees its transfer event.
+ *
+ * @param udev	pointer to the USB device structure
+ * @param req	request to queue
+ * @return 0 if successful, -EBUSY if the ring is too full, else error code
+ */
+int xhci_bulk_submit(struct usb_device *udev, struct usb_bulk_req *req)
+{
+	struct xhci_ctrl *ctrl = xhci_get_ctrl(udev);
+	union xhci_trb *first, *last;
+	struct xhci_virt_ep *ep;
+	int num_trbs;
+	int ret;
+
+	debug("dev=%p, pipe=%lx, buffer=%p, length=%d\n",
+	      udev, req->pipe, req->buffer, req->length);
+
+	ep = &ctrl->devs[udev->slot_id]->eps[usb_pipe_ep_index(req->pipe)];
+	num_trbs = bulk_trbs(req->buffer, req->length);
+
+	/*
+	 * The ring has one segment, ending in a link TRB, and must not fill
+	 * up completely, so see xhci_get_max_xfer_size()
+	 */
+	if (ep->bulk_trbs + num_trbs > TRBS_PER_SEGMENT - 2)
+		return list_empty(&ep->bulk_reqs) ? -EINVAL : -EBUSY;
+
+	ret = queue_bulk_td(udev, req->pipe, req->length, req->buffer,
+			    &first, &last);
+	if (ret < 0)
+		return ret;
+
+	req->hcpriv[0] = first;
+	req->hcpriv[1] = last;
+	req->hcpriv[2] = (void *)(uintptr_t)num_trbs;
+	ep->bulk_trbs += num_trbs;
+	list_add_tail(&req->list, &ep->bulk_reqs);
+
+	return 0;
+}
+
+/**
+ * Handles events until a queued BULK Request completes
+ *
+ * @param udev		pointer to the USB device structure
+ * @param req		request to wait for
+ * @param timeout	time to wait in milliseconds, 0 to just check
+ * @return 0 if the request is done, -ETIMEDOUT if not
+ */
+int xhci_bulk_reap(struct usb_device *udev, struct usb_bulk_req *req,
+		   int timeout)
+{
+	struct xhci_ctrl *ctrl = xhci_get_ctrl(udev);
+	unsigned long ts = get_timer(0);
+
+	do {
+		while (!req->done && event_ready(ctrl)) {
+			union xhci_trb *event = ctrl->event_ring->dequeue;
+			u32 flags = le32_to_cpu(event->event_cmd.flags);
+
+			if (TRB_FIELD_TO_TYPE(flags) != TRB_TRANSFER ||
+			    !complete_bulk_req(ctrl, event))
+				discard_event(event);
+			xhci_acknowledge_event(ctrl);
+		}
+		if (req->done)
+			return 0;
+	} while (get_timer(ts) < timeout);
+
+	return -ETIMEDOUT;
+}
+
+/**
+ * Reads the state of an endpoint from its output context
+ *
+ * @param ctrl		Host controller data structure
+ * @param virt_dev	Device the endpoint belongs to
+ * @param ep_index	index of the endpoint
+ * @return EP_STATE_... value
+ */
+static u32 get_ep_state(struct xhci_ctrl *ctrl,
+			struct xhci_virt_device *virt_dev, int ep_index)
+{
+	struct xhci_ep_ctx *ep_ctx;
+
+	xhci_inval_cache((uintptr_t)virt_dev->out_ctx->bytes,
+			 virt_dev->out_ctx->size);
+	ep_ctx = xhci_get_ep_ctx(ctrl, virt_dev->out_ctx, ep_index);
+
+	return le32_to_cpu(ep_ctx->ep_info) & EP_STATE_MASK;
+}
+
+/**
+ * Cancels the BULK Requests still queued on a pipe. The endpoint is stopped,
+ * or reset if it halted on an error, and the xHC's dequeue pointer is moved
+ * past the TDs, as in abort_td(). The requests are marked as not processed
+ * even if the xHC does not respond.
+ *
+ * @param udev	pointer to the USB device structure
+ * @param pipe	contains the DIR_IN or OUT , devnum
+ * @return none
+ */
+void xhci_bulk_cancel(struct usb_device *udev, unsigned long pipe)
+{
+	struct xhci_ctrl *ctrl = xhci_get_ctrl(udev);
+	struct xhci_virt_device *virt_dev = ctrl->devs[udev->slot_id];
+	int ep_index = usb_pipe_ep_index(pipe);
+	struct xhci_virt_ep *ep = &virt_dev->eps[ep_index];
+	struct xhci_ring *ring = ep->ring;
+	struct usb_bulk_req *req, *next;
+	union xhci_trb *event;
+	u32 state;
+
+	if (list_empty(&ep->bulk_reqs))
+		return;
+
+	/* Requests may still complete while we wait here */
+	state = get_ep_state(ctrl, virt_dev, ep_index);
+	if (state == EP_STATE_RUNNING || state == EP_STATE_HALTED) {
+		xhci_queue_command(ctrl, NULL, udev->slot_id, ep_index,
+				   state == EP_STATE_HALTED ? TRB_RESET_EP :
+				   TRB_STOP_RING);
+		event = wait_for_event(ctrl, TRB_COMPLETION);
+		if (!event) {
+			printf("XHCI timeout stopping endpoint %d\n",
+			       ep_index);
+			goto done;
+		}
+		if (GET_COMP_CODE(le32_to_cpu(event->event_cmd.status)) !=
+		    COMP_SUCCESS)
+			debug("XHCI could not stop endpoint %d\n", ep_index);
+		xhci_acknowledge_event(ctrl);
+		state = get_ep_state(ctrl, virt_dev, ep_index);
+	}
+
+	/* The dequeue pointer cannot be set on these endpoints */
+	if (state == EP_STATE_ERROR || state == EP_STATE_DISABLED) {
+		debug("XHCI endpoint %d in state %d, not moving dequeue\n",
+		      ep_index, state);
+		goto done;
+	}
+
+	xhci_queue_command(ctrl, (void *)((uintptr_t)ring->enqueue |
+		ring->cycle_state), udev->slot_id, ep_index, TRB_SET_DEQ);
+	event = wait_for_event(ctrl, TRB_COMPLETION);
+	if (!event) {
+		printf("XHCI timeout cancelling transfers on endpoint %d\n",
+		       ep_index);
+		goto done;
+	}
+	if (GET_COMP_CODE(le32_to_cpu(event->event_cmd.status)) !=
+	    COMP_SUCCESS)
+		printf("XHCI failed to cancel transfers on endpoint %d\n",
+		       ep_index);
+	xhci_acknowledge_event(ctrl);
+
+done:
+	list_for_each_entry_safe(req, next, &ep->bulk_reqs, list) {
+		list_del(&req->list);
+		req->act_len = 0;
+		req->status = USB_ST_NOT_PROC;
+		req->done = true;
+	}
+	ep->bulk_trbs = 0;
+}
+
 /**
  * Queues up the Control Transfer Request
  *
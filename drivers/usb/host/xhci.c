@@ -1387,6 +1387,33 @@ static int xhci_submit_bulk_msg(struct udevice *dev, struct usb_device *udev,
 	return _xhci_submit_bulk_msg(udev, pipe, buffer, length);
 }
 
+static int xhci_submit_bulk_req(struct udevice *dev, struct usb_device *udev,
+				struct usb_bulk_req *req)
+{
+	debug("%s: dev='%s', udev=%p\n", __func__, dev->name, udev);
+	if (usb_pipetype(req->pipe) != PIPE_BULK) {
+		printf("non-bulk pipe (type=%lu)", usb_pipetype(req->pipe));
+		return -EINVAL;
+	}
+
+	return xhci_bulk_submit(udev, req);
+}
+
+static int xhci_reap_bulk_req(struct udevice *dev, struct usb_device *udev,
+			      struct usb_bulk_req *req, int timeout)
+{
+	return xhci_bulk_reap(udev, req, timeout);
+}
+
+static int xhci_cancel_bulk_reqs(struct udevice *dev, struct usb_device *udev,
+				 unsigned long pipe)
+{
+	debug("%s: dev='%s', udev=%p\n", __func__, dev->name, udev);
+	xhci_bulk_cancel(udev, pipe);
+
+	return 0;
+}
+
 static int xhci_submit_int_msg(struct udevice *dev, struct usb_device *udev,
 			       unsigned long pipe, void *buffer, int length,
 			       int interval, bool nonblock)
@@ -1536,6 +1563,9 @@ struct dm_usb_ops xhci_usb_ops = {
 	.alloc_device = xhci_alloc_device,
 	.update_hub_device = xhci_update_hub_device,
 	.get_max_xfer_size  = xhci_get_max_xfer_size,
+	.submit_bulk_req = xhci_submit_bulk_req,
+	.reap_bulk_req = xhci_reap_bulk_req,
+	.cancel_bulk_reqs = xhci_cancel_bulk_reqs,
 };
 
 #endif
@@ -49,6 +49,7 @@ static int console_normal_set_row(struct udevice *dev, uint row, int clr)
 	default:
 		return -ENOSYS;
 	}
+	video_damage(dev->parent, row * VIDEO_FONT_HEIGHT, VIDEO_FONT_HEIGHT);
 
 	return 0;
 }
@@ -56,13 +57,21 @@ static int console_normal_set_row(struct udevice *dev, uint row, int clr)
 static int console_normal_move_rows(struct udevice *dev, uint rowdst,
 				     uint rowsrc, uint count)
 {
+	struct vidconsole_priv *vc_priv = dev_get_uclass_priv(dev);
 	struct video_priv *vid_priv = dev_get_uclass_priv(dev->parent);
 	void *dst;
 	void *src;
 
+	/* Scrolling the whole display is cheaper done by panning */
+	if (!rowdst && rowsrc + count == vc_priv->rows &&
+	    !video_scroll_pan(dev->parent, rowsrc * VIDEO_FONT_HEIGHT))
+		return 0;
+
 	dst = vid_priv->fb + rowdst * VIDEO_FONT_HEIGHT * vid_priv->line_length;
 	src = vid_priv->fb + rowsrc * VIDEO_FONT_HEIGHT * vid_priv->line_length;
 	memmove(dst, src, VIDEO_FONT_HEIGHT * vid_priv->line_length * count);
+	video_damage(dev->parent, rowdst * VIDEO_FONT_HEIGHT,
+		     count * VIDEO_FONT_HEIGHT);
 
 	return 0;
 }
@@ -126,6 +135,7 @@ static int console_normal_putc_xy(struct udevice *dev, uint x_frac, uint y,
 		}
 		line += vid_priv->line_length;
 	}
+	video_damage(vid, y, VIDEO_FONT_HEIGHT);
 
 	return VID_TO_POS(VIDEO_FONT_WIDTH);
 }
@@ -51,6 +51,7 @@ static int console_set_row_1(struct udevice *dev, uint row, int clr)
 		}
 		line += vid_priv->line_length;
 	}
+	video_damage(dev->parent, 0, vid_priv->ysize);
 
 	return 0;
 }
@@ -74,6 +75,7 @@ static int console_move_rows_1(struct udevice *dev, uint rowdst, uint rowsrc,
 		src += vid_priv->line_length;
 		dst += vid_priv->line_length;
 	}
+	video_damage(dev->parent, 0, vid_priv->ysize);
 
 	return 0;
 }
@@ -135,6 +137,7 @@ static int console_putc_xy_1(struct udevice *dev, uint x_frac, uint y, char ch)
 		line += vid_priv->line_length;
 		mask >>= 1;
 	}
+	video_damage(vid, VID_TO_PIXEL(x_frac), VIDEO_FONT_HEIGHT);
 
 	return VID_TO_POS(VIDEO_FONT_WIDTH);
 }
@@ -177,6 +180,9 @@ static int console_set_row_2(struct udevice *dev, uint row, int clr)
 	default:
 		return -ENOSYS;
 	}
+	video_damage(dev->parent,
+		     vid_priv->ysize - (row + 1) * VIDEO_FONT_HEIGHT,
+		     VIDEO_FONT_HEIGHT);
 
 	return 0;
 }
@@ -195,6 +201,9 @@ static int console_move_rows_2(struct udevice *dev, uint rowdst, uint rowsrc,
 	src = end - (rowsrc + count) * VIDEO_FONT_HEIGHT *
 		vid_priv->line_length;
 	memmove(dst, src, VIDEO_FONT_HEIGHT * vid_priv->line_length * count);
+	video_damage(dev->parent,
+		     vid_priv->ysize - (rowdst + count) * VIDEO_FONT_HEIGHT,
+		     count * VIDEO_FONT_HEIGHT);
 
 	return 0;
 }
@@ -261,6 +270,8 @@ static int console_putc_xy_2(struct udevice *dev, uint x_frac, uint y, char ch)
 		}
 		line -= vid_priv->line_length;
 	}
+	video_damage(vid, vid_priv->ysize - y - VIDEO_FONT_HEIGHT,
+		     VIDEO_FONT_HEIGHT);
 
 	return VID_TO_POS(VIDEO_FONT_WIDTH);
 }
@@ -304,6 +315,7 @@ static int console_set_row_3(struct udevice *dev, uint row, int clr)
 		}
 		line += vid_priv->line_length;
 	}
+	video_damage(dev->parent, 0, vid_priv->ysize);
 
 	return 0;
 }
@@ -325,6 +337,7 @@ static int console_move_rows_3(struct udevice *dev, uint rowdst, uint rowsrc,
 		src += vid_priv->line_length;
 		dst += vid_priv->line_length;
 	}
+	video_damage(dev->parent, 0, vid_priv->ysize);
 
 	return 0;
 }
@@ -386,6 +399,8 @@ static int console_putc_xy_3(struct udevice *dev, uint x_frac, uint y, char ch)
 		line -= vid_priv->line_length;
 		mask >>= 1;
 	}
+	video_damage(vid, vid_priv->ysize - VID_TO_PIXEL(x_frac) -
+		     VIDEO_FONT_HEIGHT, VIDEO_FONT_HEIGHT);
 
 	return VID_TO_POS(VIDEO_FONT_WIDTH);
 }
@@ -8,6 +8,7 @@
 #include <malloc.h>
 #include <video.h>
 #include <video_console.h>
+#include <linux/list.h>
 
 /* Functions needed by stb_truetype.h */
 static int tt_floor(double val)
@@ -122,6 +123,251 @@ struct console_tt_priv {
 	double scale;
 };
 
+/* Number of sub-pixel X positions at which each character is rendered */
+#define TT_SUBPIXELS		4
+
+/* Number of hash chains used to look up glyphs in the cache */
+#define TT_CACHE_HASH_SIZE	64
+
+/**
+ * struct tt_glyph - Image of a character, ready to write to the display
+ *
+ * The image depends on the font, its size, the character, the sub-pixel
+ * position at which it is drawn and the display's depth and background
+ * colour, so all of these make up the key used to find it in the cache.
+ *
+ * @lru:	Position in the cache, most recently used first. This is empty
+ *		if the glyph is not in the cache
+ * @hash:	Position in the cache's hash chain
+ * @font_data:	Font the character comes from
+ * @font_size:	Font size in pixels
+ * @ch:		Character
+ * @subpixel:	Sub-pixel X position, in units of 1 / TT_SUBPIXELS pixels
+ * @bpix:	Display depth the image is for
+ * @invert:	true if the image is inverted for a non-black background
+ * @width:	Width of the image in pixels
+ * @height:	Height of the image in pixels
+ * @xoff:	X offset of the image from the cursor position
+ * @yoff:	Y offset of the image from the baseline
+ * @size:	Number of bytes of memory used by this glyph
+ * @pixels:	Image, in the display's pixel format, so VNBYTES(@bpix) bytes
+ *		per pixel. This is declared as u32 to keep it aligned
+ */
+struct tt_glyph {
+	struct list_head lru;
+	struct list_head hash;
+	u8 *font_data;
+	int font_size;
+	int ch;
+	int subpixel;
+	enum video_log2_bpp bpix;
+	bool invert;
+	int width;
+	int height;
+	int xoff;
+	int yoff;
+	uint size;
+	u32 pixels[];
+};
+
+/**
+ * struct tt_cache - Cache of character images, shared by all consoles
+ *
+ * @lru:	List of glyphs, most recently used first
+ * @hash:	Hash chains of glyphs
+ * @stats:	Statistics, including the maximum size of the cache
+ * @inited:	true once the lists are set up
+ */
+static struct tt_cache {
+	struct list_head lru;
+	struct list_head hash[TT_CACHE_HASH_SIZE];
+	struct console_tt_cache_stats stats;
+	bool inited;
+} tt_cache;
+
+static void tt_cache_init(void)
+{
+	int i;
+
+	if (tt_cache.inited)
+		return;
+	INIT_LIST_HEAD(&tt_cache.lru);
+	for (i = 0; i < TT_CACHE_HASH_SIZE; i++)
+		INIT_LIST_HEAD(&tt_cache.hash[i]);
+	tt_cache.stats.max_size = CONFIG_CONSOLE_TRUETYPE_CACHE_SIZE;
+	tt_cache.inited = true;
+}
+
+static struct list_head *tt_cache_chain(int ch, int subpixel)
+{
+	return &tt_cache.hash[((u8)ch * TT_SUBPIXELS + subpixel) %
+			      TT_CACHE_HASH_SIZE];
+}
+
+static void tt_cache_drop(struct tt_glyph *glyph)
+{
+	list_del(&glyph->lru);
+	list_del(&glyph->hash);
+	tt_cache.stats.size -= glyph->size;
+	tt_cache.stats.entries--;
+	free(glyph);
+}
+
+/* Add a glyph to the cache, dropping the least recently used ones to fit */
+static void tt_cache_add(struct tt_glyph *glyph)
+{
+	struct console_tt_cache_stats *stats = &tt_cache.stats;
+
+	if (glyph->size > stats->max_size)
+		return;
+	while (stats->size + glyph->size > stats->max_size)
+		tt_cache_drop(list_last_entry(&tt_cache.lru, struct tt_glyph,
+					      lru));
+	list_add(&glyph->lru, &tt_cache.lru);
+	list_add(&glyph->hash, tt_cache_chain(glyph->ch, glyph->subpixel));
+	stats->size += glyph->size;
+	stats->entries++;
+}
+
+void console_truetype_cache_configure(uint max_size)
+{
+	tt_cache_init();
+	while (!list_empty(&tt_cache.lru))
+		tt_cache_drop(list_first_entry(&tt_cache.lru, struct tt_glyph,
+					       lru));
+	tt_cache.stats.max_size = max_size;
+	tt_cache.stats.hits = 0;
+	tt_cache.stats.misses = 0;
+}
+
+void console_truetype_cache_stats(struct console_tt_cache_stats *stats)
+{
+	tt_cache_init();
+	memcpy(stats, &tt_cache.stats, sizeof(*stats));
+	tt_cache.stats.hits = 0;
+	tt_cache.stats.misses = 0;
+}
+
+/**
+ * console_truetype_render() - Render a character into a new glyph
+ *
+ * This converts the 8-bit-per-pixel image from the font library into the
+ * colour depth of the display. We only expect white-on-black or the reverse
+ * so the code only handles this simple case.
+ *
+ * @dev:	Console device
+ * @ch:		Character to render
+ * @subpixel:	Sub-pixel X position, in units of 1 / TT_SUBPIXELS pixels
+ * @return new glyph, which is not in the cache, or NULL if out of memory
+ */
+static struct tt_glyph *console_truetype_render(struct udevice *dev, int ch,
+						int subpixel)
+{
+	struct video_priv *vid_priv = dev_get_uclass_priv(dev->parent);
+	struct console_tt_priv *priv = dev_get_priv(dev);
+	int width, height, xoff, yoff;
+	struct tt_glyph *glyph;
+	int count, size, i;
+	u8 *data;
+
+	/*
+	 * The render returns a 8-bit-per-pixel image of the character. For
+	 * empty characters, like ' ', data will return NULL
+	 */
+	data = stbtt_GetCodepointBitmapSubpixel(&priv->font, priv->scale,
+						priv->scale,
+						(double)subpixel / TT_SUBPIXELS,
+						0, ch, &width, &height,
+						&xoff, &yoff);
+	if (!data)
+		width = height = 0;
+	count = width * height;
+	size = sizeof(*glyph) + count * VNBYTES(vid_priv->bpix);
+	glyph = malloc(size);
+	if (!glyph) {
+		free(data);
+		return NULL;
+	}
+	INIT_LIST_HEAD(&glyph->lru);
+	glyph->font_data = priv->font_data;
+	glyph->font_size = priv->font_size;
+	glyph->ch = ch;
+	glyph->subpixel = subpixel;
+	glyph->bpix = vid_priv->bpix;
+	glyph->invert = vid_priv->colour_bg != 0;
+	glyph->width = width;
+	glyph->height = height;
+	glyph->xoff = xoff;
+	glyph->yoff = yoff;
+	glyph->size = size;
+
+	for (i = 0; i < count; i++) {
+		int val = data[i];
+
+		if (glyph->invert)
+			val = 255 - val;
+		switch (vid_priv->bpix) {
+#ifdef CONFIG_VIDEO_BPP16
+		case VIDEO_BPP16:
+			((u16 *)glyph->pixels)[i] = val >> 3 |
+				(val >> 2) << 5 |
+				(val >> 3) << 11;
+			break;
+#endif
+#ifdef CONFIG_VIDEO_BPP32
+		case VIDEO_BPP32:
+			glyph->pixels[i] = val | val << 8 | val << 16;
+			break;
+#endif
+		default:
+			break;
+		}
+	}
+	free(data);
+
+	return glyph;
+}
+
+/**
+ * console_truetype_get_glyph() - Get the image of a character
+ *
+ * This looks in the cache first, then renders the character and adds it to
+ * the cache.
+ *
+ * @dev:	Console device
+ * @ch:		Character to render
+ * @subpixel:	Sub-pixel X position, in units of 1 / TT_SUBPIXELS pixels
+ * @return glyph, or NULL if out of memory. The caller must free the glyph
+ *	if it is not in the cache (its @lru list is empty)
+ */
+static struct tt_glyph *console_truetype_get_glyph(struct udevice *dev, int ch,
+						   int subpixel)
+{
+	struct video_priv *vid_priv = dev_get_uclass_priv(dev->parent);
+	struct console_tt_priv *priv = dev_get_priv(dev);
+	bool invert = vid_priv->colour_bg != 0;
+	struct tt_glyph *glyph;
+
+	tt_cache_init();
+	list_for_each_entry(glyph, tt_cache_chain(ch, subpixel), hash) {
+		if (glyph->ch == ch && glyph->subpixel == subpixel &&
+		    glyph->font_data == priv->font_data &&
+		    glyph->font_size == priv->font_size &&
+		    glyph->bpix == vid_priv->bpix && glyph->invert == invert) {
+			list_move(&glyph->lru, &tt_cache.lru);
+			tt_cache.stats.hits++;
+			return glyph;
+		}
+	}
+
+	tt_cache.stats.misses++;
+	glyph = console_truetype_render(dev, ch, subpixel);
+	if (glyph)
+		tt_cache_add(glyph);
+
+	return glyph;
+}
+
 static int console_truetype_set_row(struct udevice *dev, uint row, int clr)
 {
 	struct video_priv *vid_priv = dev_get_uclass_priv(dev->parent);
@@ -162,6 +408,7 @@ static int console_truetype_set_row(struct udevice *dev, uint row, int clr)
 	default:
 		return -ENOSYS;
 	}
+	video_damage(dev->parent, row * priv->font_size, priv->font_size);
 
 	return 0;
 }
@@ -169,15 +416,25 @@ static int console_truetype_set_row(struct udevice *dev, uint row, int clr)
 static int console_truetype_move_rows(struct udevice *dev, uint rowdst,
 				     uint rowsrc, uint count)
 {
+	struct vidconsole_priv *vc_priv = dev_get_uclass_priv(dev);
 	struct video_priv *vid_priv = dev_get_uclass_priv(dev->parent);
 	struct console_tt_priv *priv = dev_get_priv(dev);
 	void *dst;
 	void *src;
 	int i, diff;
 
-	dst = vid_priv->fb + rowdst * priv->font_size * vid_priv->line_length;
-	src = vid_priv->fb + rowsrc * priv->font_size * vid_priv->line_length;
-	memmove(dst, src, priv->font_size * vid_priv->line_length * count);
+	/* Scrolling the whole display is cheaper done by panning */
+	if (rowdst || rowsrc + count != vc_priv->rows ||
+	    video_scroll_pan(dev->parent, rowsrc * priv->font_size)) {
+		dst = vid_priv->fb + rowdst * priv->font_size *
+			vid_priv->line_length;
+		src = vid_priv->fb + rowsrc * priv->font_size *
+			vid_priv->line_length;
+		memmove(dst, src,
+			priv->font_size * vid_priv->line_length * count);
+		video_damage(dev->parent, rowdst * priv->font_size,
+			     count * priv->font_size);
+	}
 
 	/* Scroll up our position history */
 	diff = (rowsrc - rowdst) * priv->font_size;
@@ -195,15 +452,14 @@ static int console_truetype_putc_xy(struct udevice *dev, uint x, uint y,
 	struct video_priv *vid_priv = dev_get_uclass_priv(vid);
 	struct console_tt_priv *priv = dev_get_priv(dev);
 	stbtt_fontinfo *font = &priv->font;
-	int width, height, xoff, yoff;
 	double xpos, x_shift;
 	int lsb;
 	int width_frac, linenum;
 	struct pos_info *pos;
-	u8 *bits, *data;
+	struct tt_glyph *glyph;
 	int advance;
-	void *line;
-	int row;
+	void *line, *bits;
+	int row, ret;
 
 	/* First get some basic metrics about this character */
 	stbtt_GetCodepointHMetrics(font, ch, &advance, &lsb);
@@ -239,86 +495,72 @@ static int console_truetype_putc_xy(struct udevice *dev, uint x, uint y,
 	}
 
 	/*
-	 * Figure out how much past the start of a pixel we are, and pass this
-	 * information into the render, which will return a 8-bit-per-pixel
-	 * image of the character. For empty characters, like ' ', data will
-	 * return NULL;
+	 * Figure out how much past the start of a pixel we are, and get the
+	 * image of the character for that position. This is rounded down to a
+	 * fraction of a pixel, so that images can be reused from the cache.
 	 */
-	data = stbtt_GetCodepointBitmapSubpixel(font, priv->scale, priv->scale,
-						x_shift, 0, ch, &width, &height,
-						&xoff, &yoff);
-	if (!data)
-		return width_frac;
+	glyph = console_truetype_get_glyph(dev, ch,
+					   (int)(x_shift * TT_SUBPIXELS));
+	if (!glyph || !glyph->height)
+		goto done;
 
 	/* Figure out where to write the character in the frame buffer */
-	bits = data;
+	bits = glyph->pixels;
 	line = vid_priv->fb + y * vid_priv->line_length +
 		VID_TO_PIXEL(x) * VNBYTES(vid_priv->bpix);
-	linenum = priv->baseline + yoff;
+	linenum = priv->baseline + glyph->yoff;
 	if (linenum > 0)
 		line += linenum * vid_priv->line_length;
 
-	/*
-	 * Write a row at a time, converting the 8bpp image into the colour
-	 * depth of the display. We only expect white-on-black or the reverse
-	 * so the code only handles this simple case.
-	 */
-	for (row = 0; row < height; row++) {
+	/* Write a row at a time, combining the image with the display */
+	for (row = 0; row < glyph->height; row++) {
 		switch (vid_priv->bpix) {
 #ifdef CONFIG_VIDEO_BPP16
 		case VIDEO_BPP16: {
-			uint16_t *dst = (uint16_t *)line + xoff;
+			uint16_t *dst = (uint16_t *)line + glyph->xoff;
+			uint16_t *src = bits;
 			int i;
 
-			for (i = 0; i < width; i++) {
-				int val = *bits;
-				int out;
-
-				if (vid_priv->colour_bg)
-					val = 255 - val;
-				out = val >> 3 |
-					(val >> 2) << 5 |
-					(val >> 3) << 11;
+			for (i = 0; i < glyph->width; i++) {
 				if (vid_priv->colour_fg)
-					*dst++ |= out;
+					*dst++ |= *src++;
 				else
-					*dst++ &= out;
-				bits++;
+					*dst++ &= *src++;
 			}
 			break;
 		}
 #endif
 #ifdef CONFIG_VIDEO_BPP32
 		case VIDEO_BPP32: {
-			u32 *dst = (u32 *)line + xoff;
+			u32 *dst = (u32 *)line + glyph->xoff;
+			u32 *src = bits;
 			int i;
 
-			for (i = 0; i < width; i++) {
-				int val = *bits;
-				int out;
-
-				if (vid_priv->colour_bg)
-					val = 255 - val;
-				out = val | val << 8 | val << 16;
+			for (i = 0; i < glyph->width; i++) {
 				if (vid_priv->colour_fg)
-					*dst++ |= out;
+					*dst++ |= *src++;
 				else
-					*dst++ &= out;
-				bits++;
+					*dst++ &= *src++;
 			}
 			break;
 		}
 #endif
 		default:
-			free(data);
-			return -ENOSYS;
+			ret = -ENOSYS;
+			goto err;
 		}
 
 		line += vid_priv->line_length;
+		bits += glyph->width * VNBYTES(vid_priv->bpix);
 	}
-	free(data);
-
-	return width_frac;
+	video_damage(vid, y + max(linenum, 0), glyph->height);
+done:
+	ret = width_frac;
+err:
+	if (glyph && list_empty(&glyph->lru))
+		free(glyph);
+
+	return ret;
 }
 
 /**
@@ -379,6 +621,7 @@ static int console_truetype_erase(struct udevice *dev, int xstart, int ystart,
 		}
 		line += vid_priv->line_length;
 	}
+	video_damage(dev->parent, ystart, yend - ystart);
 
 	return 0;
 }
@@ -39,10 +39,20 @@ static int sandbox_sdl_probe(struct udevice *dev)
 	uc_priv->rot = plat->rot;
 	uc_priv->vidconsole_drv_name = plat->vidconsole_drv_name;
 	uc_priv->font_size = plat->font_size;
+	uc_priv->yvirt = plat->yvirt;
 
 	return 0;
 }
 
+static int sandbox_sdl_set_pan(struct udevice *dev, uint yoffset)
+{
+	/*
+	 * video_sync() passes SDL the frame buffer from the first row shown,
+	 * so there is no register to set here
+	 */
+	return 0;
+}
+
 static int sandbox_sdl_bind(struct udevice *dev)
 {
 	struct video_uc_platdata *uc_plat = dev_get_uclass_platdata(dev);
@@ -52,12 +62,18 @@ static int sandbox_sdl_bind(struct udevice *dev)
 	plat->xres = dev_read_u32_default(dev, "xres", LCD_MAX_WIDTH);
 	plat->yres = dev_read_u32_default(dev, "yres", LCD_MAX_HEIGHT);
 	plat->bpix = dev_read_u32_default(dev, "log2-depth", VIDEO_BPP16);
-	uc_plat->size = plat->xres * plat->yres * (1 << plat->bpix) / 8;
+	plat->yvirt = dev_read_u32_default(dev, "yres-virtual", 0);
+	uc_plat->size = plat->xres * max(plat->yres, plat->yvirt) *
+		(1 << plat->bpix) / 8;
 	debug("%s: Frame buffer size %x\n", __func__, uc_plat->size);
 
 	return ret;
 }
 
+static const struct video_ops sandbox_sdl_ops = {
+	.set_pan	= sandbox_sdl_set_pan,
+};
+
 static const struct udevice_id sandbox_sdl_ids[] = {
 	{ .compatible = "sandbox,lcd-sdl" },
 	{ }
@@ -69,5 +85,6 @@ U_BOOT_DRIVER(sdl_sandbox) = {
 	.of_match = sandbox_sdl_ids,
 	.bind	= sandbox_sdl_bind,
 	.probe	= sandbox_sdl_probe,
+	.ops	= &sandbox_sdl_ops,
 	.platdata_auto_alloc_size	= sizeof(struct sandbox_sdl_plat),
 };
@@ -40,6 +40,13 @@
  * video_post_probe(). This function also clears the frame buffer and
  * allocates a suitable text console device. This can then be used to write
  * text to the video device.
+ *
+ * Code which draws in the frame buffer records the rows it changes with
+ * video_damage(), so that video_sync() only flushes those from the cache.
+ * Where the display controller can start the display part-way down the frame
+ * buffer, the driver sets @yvirt and provides a set_pan() method. The text
+ * console then scrolls by moving the display down the frame buffer, rather
+ * than by copying the whole of it each time.
  */
 DECLARE_GLOBAL_DATA_PTR;
 
@@ -50,6 +57,23 @@ void video_set_flush_dcache(struct udevice *dev, bool flush)
 	priv->flush_dcache = flush;
 }
 
+/* Mark the whole display as changed if nothing else will say what has */
+static void video_damage_all(struct video_priv *priv)
+{
+	if (!priv->sync_all)
+		return;
+	priv->dirty_ystart = priv->yoffset;
+	priv->dirty_yend = priv->yoffset + priv->ysize;
+}
+
+void video_set_sync_all(struct udevice *dev, bool sync_all)
+{
+	struct video_priv *priv = dev_get_uclass_priv(dev);
+
+	priv->sync_all = sync_all;
+	video_damage_all(priv);
+}
+
 static ulong alloc_fb(struct udevice *dev, ulong *addrp)
 {
 	struct video_uc_platdata *plat = dev_get_uclass_platdata(dev);
@@ -88,15 +112,14 @@ int video_reserve(ulong *addrp)
 	return 0;
 }
 
-int video_clear(struct udevice *dev)
+/* Fill part of the frame buffer with the background colour */
+static void video_fill_bg(struct video_priv *priv, void *start, int size)
 {
-	struct video_priv *priv = dev_get_uclass_priv(dev);
-
 	switch (priv->bpix) {
 	case VIDEO_BPP16:
 		if (IS_ENABLED(CONFIG_VIDEO_BPP16)) {
-			u16 *ppix = priv->fb;
-			u16 *end = priv->fb + priv->fb_size;
+			u16 *ppix = start;
+			u16 *end = start + size;
 
 			while (ppix < end)
 				*ppix++ = priv->colour_bg;
@@ -104,17 +127,125 @@ int video_clear(struct udevice *dev)
 		}
 	case VIDEO_BPP32:
 		if (IS_ENABLED(CONFIG_VIDEO_BPP32)) {
-			u32 *ppix = priv->fb;
-			u32 *end = priv->fb + priv->fb_size;
+			u32 *ppix = start;
+			u32 *end = start + size;
 
 			while (ppix < end)
 				*ppix++ = priv->colour_bg;
 			break;
 		}
 	default:
-		memset(priv->fb, priv->colour_bg, priv->fb_size);
+		memset(start, priv->colour_bg, size);
 		break;
 	}
+}
+
+int video_clear(struct udevice *dev)
+{
+	struct video_priv *priv = dev_get_uclass_priv(dev);
+
+	video_fill_bg(priv, priv->fb, priv->fb_size);
+	video_damage(dev, 0, priv->ysize);
+
+	return 0;
+}
+
+void video_damage(struct udevice *dev, int y, int height)
+{
+	struct video_priv *priv = dev_get_uclass_priv(dev);
+	int end = y + height;
+
+	if (y < 0)
+		y = 0;
+	if (end > priv->ysize)
+		end = priv->ysize;
+	if (y >= end)
+		return;
+
+	/* Keep track of frame buffer rows, which do not move when panning */
+	y += priv->yoffset;
+	end += priv->yoffset;
+	if (priv->dirty_yend == priv->dirty_ystart) {
+		priv->dirty_ystart = y;
+		priv->dirty_yend = end;
+	} else {
+		priv->dirty_ystart = min(priv->dirty_ystart, y);
+		priv->dirty_yend = max(priv->dirty_yend, end);
+	}
+}
+
+/* Show the frame buffer from @yoffset, which must be in range */
+static int video_set_pan(struct udevice *dev, int yoffset)
+{
+	struct video_priv *priv = dev_get_uclass_priv(dev);
+	struct video_ops *ops = video_get_ops(dev);
+	void *base = priv->fb - priv->yoffset * priv->line_length;
+	int ret;
+
+	ret = ops->set_pan(dev, yoffset);
+	if (ret)
+		return ret;
+	priv->yoffset = yoffset;
+	priv->fb = base + yoffset * priv->line_length;
+
+	return 0;
+}
+
+int video_scroll_pan(struct udevice *dev, int lines)
+{
+	struct video_priv *priv = dev_get_uclass_priv(dev);
+	struct video_ops *ops = video_get_ops(dev);
+	int keep = priv->ysize - lines;
+	int yoffset = priv->yoffset + lines;
+	bool wrap = false;
+	int ret;
+
+	if (!ops || !ops->set_pan || priv->no_pan ||
+	    priv->yvirt <= priv->ysize)
+		return -ENOSYS;
+	if (lines <= 0 || keep < 0)
+		return -EINVAL;
+
+	if (yoffset + priv->ysize > priv->yvirt) {
+		void *base = priv->fb - priv->yoffset * priv->line_length;
+
+		/*
+		 * Out of room, so move what stays on the display back to the
+		 * start. This is the only copy for every yvirt - ysize rows
+		 * scrolled.
+		 */
+		memmove(base, priv->fb + lines * priv->line_length,
+			keep * priv->line_length);
+		yoffset = 0;
+		wrap = true;
+	}
+	ret = video_set_pan(dev, yoffset);
+	if (ret)
+		return ret;
+	video_fill_bg(priv, priv->fb + keep * priv->line_length,
+		      lines * priv->line_length);
+	if (wrap)
+		video_damage(dev, 0, priv->ysize);
+	else
+		video_damage(dev, keep, lines);
+
+	return 0;
+}
+
+int video_pan_disable(struct udevice *dev)
+{
+	struct video_priv *priv = dev_get_uclass_priv(dev);
+	void *base = priv->fb - priv->yoffset * priv->line_length;
+	int ret;
+
+	priv->no_pan = true;
+	if (!priv->yoffset)
+		return 0;
+	memmove(base, priv->fb, priv->fb_size);
+	ret = video_set_pan(dev, 0);
+	if (ret)
+		return ret;
+	video_damage(dev, 0, priv->ysize);
 
 	return 0;
 }
@@ -148,28 +279,35 @@ void video_set_default_colors(struct udevice *dev, bool invert)
 /* Flush video activity to the caches */
 void video_sync(struct udevice *vid, bool force)
 {
+	struct video_priv *priv = dev_get_uclass_priv(vid);
+
 	/*
 	 * flush_dcache_range() is declared in common.h but it seems that some
 	 * architectures do not actually implement it. Is there a way to find
 	 * out whether it exists? For now, ARM is safe.
 	 */
 #if defined(CONFIG_ARM) && !CONFIG_IS_ENABLED(SYS_DCACHE_OFF)
-	struct video_priv *priv = dev_get_uclass_priv(vid);
-
-	if (priv->flush_dcache) {
-		flush_dcache_range((ulong)priv->fb,
-				   ALIGN((ulong)priv->fb + priv->fb_size,
+	if (priv->flush_dcache && priv->dirty_yend != priv->dirty_ystart) {
+		ulong base = (ulong)priv->fb - priv->yoffset * priv->line_length;
+
+		flush_dcache_range(ALIGN_DOWN(base + priv->dirty_ystart *
+					      priv->line_length,
+					      CONFIG_SYS_CACHELINE_SIZE),
+				   ALIGN(base + priv->dirty_yend *
+					 priv->line_length,
 					 CONFIG_SYS_CACHELINE_SIZE));
 	}
 #elif defined(CONFIG_VIDEO_SANDBOX_SDL)
-	struct video_priv *priv = dev_get_uclass_priv(vid);
 	static ulong last_sync;
 
-	if (force || get_timer(last_sync) > 10) {
-		sandbox_sdl_sync(priv->fb);
-		last_sync = get_timer(0);
-	}
+	if (!force && get_timer(last_sync) <= 10)
+		return;
+	sandbox_sdl_sync(priv->fb);
+	last_sync = get_timer(0);
 #endif
+	priv->dirty_ystart = 0;
+	priv->dirty_yend = 0;
+	video_damage_all(priv);
 }
 
 void video_sync_all(void)
@@ -235,6 +373,11 @@ static int video_post_probe(struct udevice *dev)
 		priv->line_length = priv->xsize * VNBYTES(priv->bpix);
 
 	priv->fb_size = priv->line_length * priv->ysize;
+	if (priv->yvirt * priv->line_length > plat->size) {
+		debug("%s: Frame buffer too small to pan, disabling\n",
+		      __func__);
+		priv->yvirt = 0;
+	}
 
 	/* Set up colors  */
 	video_set_default_colors(dev, false);
@@ -6,11 +6,168 @@
 #include <common.h>
 #include <bmp_layout.h>
 #include <dm.h>
+#include <malloc.h>
 #include <mapmem.h>
 #include <splash.h>
 #include <video.h>
 #include <watchdog.h>
 #include <asm/unaligned.h>
+#include <u-boot/crc.h>
+
+/**
+ * typedef bmp_row_func - Convert a row of pixels to the display's format
+ *
+ * @dst:	Place to write the converted pixels
+ * @src:	Pixels from the bitmap
+ * @palette:	Bitmap's colour table, as display pixel values
+ * @width:	Number of pixels to convert
+ */
+typedef void (*bmp_row_func)(uchar *dst, const uchar *src, const u32 *palette,
+			     uint width);
+
+__weak void fb_put_byte(uchar **fb, uchar **from)
+{
+	*(*fb)++ = *(*from)++;
+}
+
+#if defined(CONFIG_BMP_16BPP)
+__weak void fb_put_word(uchar **fb, uchar **from)
+{
+	*(*fb)++ = *(*from)++;
+	*(*fb)++ = *(*from)++;
+}
+#endif /* CONFIG_BMP_16BPP */
+
+static void bmp_row_8_8(uchar *dst, const uchar *src, const u32 *palette,
+			uint width)
+{
+	uchar *from = (uchar *)src;
+
+	while (width--)
+		fb_put_byte(&dst, &from);
+}
+
+static void bmp_row_8_16(uchar *dst, const uchar *src, const u32 *palette,
+			 uint width)
+{
+	u16 *fb = (u16 *)dst;
+
+	for (; width >= 4; width -= 4) {
+		fb[0] = palette[src[0]];
+		fb[1] = palette[src[1]];
+		fb[2] = palette[src[2]];
+		fb[3] = palette[src[3]];
+		fb += 4;
+		src += 4;
+	}
+	while (width--)
+		*fb++ = palette[*src++];
+}
+
+static void bmp_row_8_32(uchar *dst, const uchar *src, const u32 *palette,
+			 uint width)
+{
+	u32 *fb = (u32 *)dst;
+
+	for (; width >= 4; width -= 4) {
+		fb[0] = palette[src[0]];
+		fb[1] = palette[src[1]];
+		fb[2] = palette[src[2]];
+		fb[3] = palette[src[3]];
+		fb += 4;
+		src += 4;
+	}
+	while (width--)
+		*fb++ = palette[*src++];
+}
+
+#if defined(CONFIG_BMP_16BPP)
+static void bmp_row_16_16(uchar *dst, const uchar *src, const u32 *palette,
+			  uint width)
+{
+	uchar *from = (uchar *)src;
+
+	while (width--)
+		fb_put_word(&dst, &from);
+}
+#endif /* CONFIG_BMP_16BPP */
+
+#if defined(CONFIG_BMP_24BPP)
+static void bmp_row_24_16(uchar *dst, const uchar *src, const u32 *palette,
+			  uint width)
+{
+	u16 *fb = (u16 *)dst;
+
+	/* 16bit 555RGB format */
+	for (; width; width--, src += 3)
+		*fb++ = ((src[2] >> 3) << 10) | ((src[1] >> 3) << 5) |
+			(src[0] >> 3);
+}
+
+static void bmp_row_24_32(uchar *dst, const uchar *src, const u32 *palette,
+			  uint width)
+{
+	u32 *fb = (u32 *)dst;
+
+	for (; width; width--, src += 3)
+		*fb++ = cpu_to_le32(src[0] | src[1] << 8 | src[2] << 16);
+}
+#endif /* CONFIG_BMP_24BPP */
+
+#if defined(CONFIG_BMP_32BPP)
+static void bmp_row_32_32(uchar *dst, const uchar *src, const u32 *palette,
+			  uint width)
+{
+	memcpy(dst, src, width * 4);
+}
+#endif /* CONFIG_BMP_32BPP */
+
+/**
+ * video_bmp_get_row_func() - Get the function to convert a bitmap's rows
+ *
+ * @bmp_bpix:	Bits per pixel of the bitmap
+ * @bpix:	Bits per pixel of the display
+ * @return conversion function, or NULL if not supported
+ */
+static bmp_row_func video_bmp_get_row_func(uint bmp_bpix, uint bpix)
+{
+	switch (bmp_bpix) {
+	case 1:
+	case 8:
+		if (bpix == 16)
+			return bmp_row_8_16;
+		else if (bpix == 32)
+			return bmp_row_8_32;
+		return bmp_row_8_8;
+#if defined(CONFIG_BMP_16BPP)
+	case 16:
+		return bmp_row_16_16;
+#endif
+#if defined(CONFIG_BMP_24BPP)
+	case 24:
+		return bpix == 16 ? bmp_row_24_16 : bmp_row_24_32;
+#endif
+#if defined(CONFIG_BMP_32BPP)
+	case 32:
+		return bmp_row_32_32;
+#endif
+	}
+
+	return NULL;
+}
+
+/* Convert an uncompressed bitmap, bottom row first */
+static void video_bmp_convert(const uchar *bmap, ulong src_stride, uchar *dst,
+			      long dst_stride, bmp_row_func row,
+			      const u32 *palette, ulong width, ulong height)
+{
+	for (; height; height--) {
+		WATCHDOG_RESET();
+		row(dst, bmap, palette, width);
+		bmap += src_stride;
+		dst += dst_stride;
+	}
+}
 
 #ifdef CONFIG_VIDEO_BMP_RLE8
 #define BMP_RLE8_ESCAPE		0
@@ -18,126 +175,202 @@
 #define BMP_RLE8_EOBMP		1
 #define BMP_RLE8_DELTA		2
 
-static void draw_unencoded_bitmap(ushort **fbp, uchar *bmap, ushort *cmap,
-				  int cnt)
-{
-	while (cnt > 0) {
-		*(*fbp)++ = cmap[*bmap++];
-		cnt--;
-	}
-}
-
-static void draw_encoded_bitmap(ushort **fbp, ushort col, int cnt)
+static void video_bmp_fill(uchar *dst, uint pbytes, u32 colour, uint count)
 {
-	ushort *fb = *fbp;
+	u16 *fb16 = (u16 *)dst;
+	u32 *fb32 = (u32 *)dst;
 
-	while (cnt > 0) {
-		*fb++ = col;
-		cnt--;
+	switch (pbytes) {
+	case 1:
+		memset(dst, colour, count);
+		break;
+	case 2:
+		while (count--)
+			*fb16++ = colour;
+		break;
+	case 4:
+		while (count--)
+			*fb32++ = colour;
+		break;
 	}
-	*fbp = fb;
 }
 
-static void video_display_rle8_bitmap(struct udevice *dev,
-				      struct bmp_image *bmp, ushort *cmap,
-				      uchar *fb, int x_off, int y_off,
-				      ulong width, ulong height)
+/**
+ * video_bmp_rle8() - Decode an RLE8 bitmap
+ *
+ * Pixels outside the area are dropped and those which the bitmap skips over
+ * are left as they are.
+ *
+ * @bmap:	Compressed pixel data
+ * @dst:	Place to write the bottom row of the bitmap
+ * @dst_stride:	Bytes from one row of @dst to the one above
+ * @pbytes:	Bytes per pixel of @dst
+ * @row:	Function to convert runs of pixels
+ * @palette:	Bitmap's colour table, as display pixel values
+ * @width:	Width of the area to write in pixels
+ * @height:	Height of the area to write in pixels
+ * @return true if every pixel of the area was written
+ */
+static bool video_bmp_rle8(const uchar *bmap, uchar *dst, long dst_stride,
+			   uint pbytes, bmp_row_func row, const u32 *palette,
+			   ulong width, ulong height)
 {
-	struct video_priv *priv = dev_get_uclass_priv(dev);
-	uchar *bmap;
-	ulong cnt, runlen;
-	int x, y;
-	int decode = 1;
+	ulong x = 0, y = 0, written = 0;
+	bool skipped = false;
+	ulong cnt;
 
 	debug("%s\n", __func__);
-	bmap = (uchar *)bmp + get_unaligned_le32(&bmp->header.data_offset);
-
-	x = 0;
-	y = height - 1;
-
-	while (decode) {
-		if (bmap[0] == BMP_RLE8_ESCAPE) {
-			switch (bmap[1]) {
-			case BMP_RLE8_EOL:
-				/* end of line */
-				bmap += 2;
-				x = 0;
-				y--;
-				/* 16bpix, 2-byte per pixel, width should *2 */
-				fb -= (width * 2 + priv->line_length);
-				break;
-			case BMP_RLE8_EOBMP:
-				/* end of bitmap */
-				decode = 0;
-				break;
-			case BMP_RLE8_DELTA:
-				/* delta run */
-				x += bmap[2];
-				y -= bmap[3];
-				/* 16bpix, 2-byte per pixel, x should *2 */
-				fb = (uchar *)(priv->fb + (y + y_off - 1)
-					* priv->line_length + (x + x_off) * 2);
-				bmap += 4;
-				break;
-			default:
-				/* unencoded run */
-				runlen = bmap[1];
-				bmap += 2;
-				if (y < height) {
-					if (x < width) {
-						if (x + runlen > width)
-							cnt = width - x;
-						else
-							cnt = runlen;
-						draw_unencoded_bitmap(
-							(ushort **)&fb,
-							bmap, cmap, cnt);
-					}
-					x += runlen;
-				}
-				bmap += runlen;
-				if (runlen & 1)
-					bmap++;
-			}
-		} else {
+	while (1) {
+		if (bmap[0] != BMP_RLE8_ESCAPE) {
 			/* encoded run */
-			if (y < height) {
-				runlen = bmap[0];
-				if (x < width) {
-					/* aggregate the same code */
-					while (bmap[0] == 0xff &&
-					       bmap[2] != BMP_RLE8_ESCAPE &&
-					       bmap[1] == bmap[3]) {
-						runlen += bmap[2];
-						bmap += 2;
-					}
-					if (x + runlen > width)
-						cnt = width - x;
-					else
-						cnt = runlen;
-					draw_encoded_bitmap((ushort **)&fb,
-						cmap[bmap[1]], cnt);
-				}
-				x += runlen;
+			if (y < height && x < width) {
+				cnt = min(width - x, (ulong)bmap[0]);
+				video_bmp_fill(dst + y * dst_stride +
+					       x * pbytes, pbytes,
+					       palette[bmap[1]], cnt);
+				written += cnt;
 			}
+			x += bmap[0];
+			bmap += 2;
+			continue;
+		}
+
+		switch (bmap[1]) {
+		case BMP_RLE8_EOL:
+			x = 0;
+			y++;
 			bmap += 2;
+			break;
+		case BMP_RLE8_EOBMP:
+			return !skipped && written == width * height;
+		case BMP_RLE8_DELTA:
+			x += bmap[2];
+			y += bmap[3];
+			skipped = true;
+			bmap += 4;
+			break;
+		default:
+			/* unencoded run */
+			if (y < height && x < width) {
+				cnt = min(width - x, (ulong)bmap[1]);
+				WATCHDOG_RESET();
+				row(dst + y * dst_stride + x * pbytes, bmap + 2,
+				    palette, cnt);
+				written += cnt;
+			}
+			x += bmap[1];
+			bmap += 2 + ALIGN(bmap[1], 2);
 		}
 	}
 }
 #endif
 
-__weak void fb_put_byte(uchar **fb, uchar **from)
+/**
+ * struct video_bmp_cache - The last bitmap displayed, converted for display
+ *
+ * Only bitmaps which fit in CONFIG_VIDEO_BMP_CACHE_SIZE bytes once converted
+ * are kept. The bitmap is checked against @crc each time it is displayed,
+ * since it may have been loaded again or changed in memory since.
+ *
+ * @addr:	Address of the bitmap
+ * @size:	Size of the bitmap in bytes
+ * @crc:	CRC32 of the bitmap
+ * @bpix:	Display format which the pixels are converted to
+ * @line_length:	Length of each row of @pixels in bytes
+ * @pixels:	Converted pixels, bottom row first, or NULL if empty
+ */
+static struct video_bmp_cache {
+	ulong addr;
+	ulong size;
+	u32 crc;
+	enum video_log2_bpp bpix;
+	ulong line_length;
+	uchar *pixels;
+} bmp_cache;
+
+static void video_bmp_cache_drop(void)
 {
-	*(*fb)++ = *(*from)++;
+	free(bmp_cache.pixels);
+	bmp_cache.pixels = NULL;
 }
 
-#if defined(CONFIG_BMP_16BPP)
-__weak void fb_put_word(uchar **fb, uchar **from)
+/**
+ * video_bmp_cache_get() - Get a bitmap's converted pixels from the cache
+ *
+ * If the bitmap is not in the cache, this converts it and adds it, if it
+ * fits.
+ *
+ * @bmp:	Bitmap
+ * @addr:	Address of the bitmap
+ * @bpix:	Display format
+ * @row:	Function to convert rows of pixels
+ * @palette:	Bitmap's colour table, as display pixel values
+ * @return converted pixels, bottom row first, or NULL if not cached
+ */
+static uchar *video_bmp_cache_get(struct bmp_image *bmp, ulong addr,
+				  enum video_log2_bpp bpix, bmp_row_func row,
+				  const u32 *palette)
 {
-	*(*fb)++ = *(*from)++;
-	*(*fb)++ = *(*from)++;
+	ulong width = get_unaligned_le32(&bmp->header.width);
+	ulong height = get_unaligned_le32(&bmp->header.height);
+	ulong size = get_unaligned_le32(&bmp->header.file_size);
+	uint bmp_bpix = get_unaligned_le16(&bmp->header.bit_count);
+	ulong offset = get_unaligned_le32(&bmp->header.data_offset);
+	uchar *bmap = (uchar *)bmp + offset;
+	uint pbytes = VNBITS(bpix) / 8;
+	ulong line_length, src_stride;
+	bool complete;
+	u32 crc;
+
+	if (!CONFIG_VIDEO_BMP_CACHE_SIZE || !pbytes || !width)
+		return NULL;
+	line_length = width * pbytes;
+	if (line_length * height > CONFIG_VIDEO_BMP_CACHE_SIZE)
+		return NULL;
+
+	/* RLE8 takes up to two bytes a pixel, so a bigger size must be wrong */
+	src_stride = ALIGN(width * bmp_bpix / 8, 4);
+	if (size <= offset ||
+	    size - offset > max(src_stride, width * 2 + 2) * height + 2)
+		return NULL;
+
+	crc = crc32(0, (uchar *)bmp, size);
+	if (bmp_cache.pixels && bmp_cache.addr == addr &&
+	    bmp_cache.size == size && bmp_cache.crc == crc &&
+	    bmp_cache.bpix == bpix)
+		return bmp_cache.pixels;
+
+	video_bmp_cache_drop();
+	bmp_cache.pixels = malloc(line_length * height);
+	if (!bmp_cache.pixels)
+		return NULL;
+
+#ifdef CONFIG_VIDEO_BMP_RLE8
+	if (bmp_bpix == 8 &&
+	    get_unaligned_le32(&bmp->header.compression) == BMP_BI_RLE8) {
+		complete = video_bmp_rle8(bmap, bmp_cache.pixels, line_length,
+					  pbytes, row, palette, width, height);
+	} else
+#endif
+	{
+		video_bmp_convert(bmap, src_stride, bmp_cache.pixels,
+				  line_length, row, palette, width, height);
+		complete = true;
+	}
+
+	/* Bitmaps with pixels left out depend on what is on the display */
+	if (!complete) {
+		video_bmp_cache_drop();
+		return NULL;
+	}
+	bmp_cache.addr = addr;
+	bmp_cache.size = size;
+	bmp_cache.crc = crc;
+	bmp_cache.bpix = bpix;
+	bmp_cache.line_length = line_length;
+
+	return bmp_cache.pixels;
 }
-#endif /* CONFIG_BMP_16BPP */
 
 /**
  * video_splash_align_axis() - Align a single coordinate
@@ -169,7 +402,8 @@ static void video_splash_align_axis(int *axis, unsigned long panel_size,
 }
 
 static void video_set_cmap(struct udevice *dev,
-			   struct bmp_color_table_entry *cte, unsigned colours)
+			   struct bmp_color_table_entry *cte, unsigned colours,
+			   u32 *palette)
 {
 	struct video_priv *priv = dev_get_uclass_priv(dev);
 	int i;
@@ -180,6 +414,13 @@ static void video_set_cmap(struct udevice *dev,
 		*cmap = ((cte->red   << 8) & 0xf800) |
 			((cte->green << 3) & 0x07e0) |
 			((cte->blue  >> 3) & 0x001f);
+		if (priv->bpix == VIDEO_BPP32)
+			palette[i] = cte->red << 16 | cte->green << 8 |
+				cte->blue;
+		else if (priv->bpix == VIDEO_BPP16)
+			palette[i] = *cmap;
+		else
+			palette[i] = i;
 		cmap++;
 		cte++;
 	}
@@ -189,16 +430,17 @@ int video_bmp_display(struct udevice *dev, ulong bmp_image, int x, int y,
 		      bool align)
 {
 	struct video_priv *priv = dev_get_uclass_priv(dev);
-	ushort *cmap_base = NULL;
-	int i, j;
+	int i;
 	uchar *fb;
 	struct bmp_image *bmp = map_sysmem(bmp_image, 0);
-	uchar *bmap;
+	uchar *bmap, *pixels;
 	ushort padded_width;
-	unsigned long width, height, byte_width;
+	unsigned long width, height, src_stride;
 	unsigned long pwidth = priv->xsize;
-	unsigned colours, bpix, bmp_bpix;
+	unsigned colours, bpix, bmp_bpix, pbytes;
 	struct bmp_color_table_entry *palette;
+	u32 pal[256];
+	bmp_row_func row;
 	int hdr_size;
 
 	if (!bmp || !(bmp->header.signature[0] == 'B' &&
@@ -227,11 +469,12 @@ int video_bmp_display(struct udevice *dev, ulong bmp_image, int x, int y,
 	}
 
 	/*
-	 * We support displaying 8bpp and 24bpp BMPs on 16bpp LCDs
-	 * and displaying 24bpp BMPs on 32bpp LCDs
+	 * We support displaying 8bpp BMPs on 16bpp and 32bpp LCDs
+	 * and displaying 24bpp BMPs on 16bpp and 32bpp LCDs
 	 */
 	if (bpix != bmp_bpix &&
 	    !(bmp_bpix == 8 && bpix == 16) &&
+	    !(bmp_bpix == 8 && bpix == 32) &&
 	    !(bmp_bpix == 24 && bpix == 16) &&
 	    !(bmp_bpix == 24 && bpix == 32)) {
 		printf("Error: %d bit/pixel mode, but BMP has %d bit/pixel\n",
@@ -243,118 +486,56 @@ int video_bmp_display(struct udevice *dev, ulong bmp_image, int x, int y,
 	      (int)width, (int)height, (int)colours, 1 << bpix);
 
 	if (bmp_bpix == 8)
-		video_set_cmap(dev, palette, colours);
+		video_set_cmap(dev, palette, colours, pal);
 
 	padded_width = (width & 0x3 ? (width & ~0x3) + 4 : width);
+	if (bmp_bpix == 1 || bmp_bpix == 8)
+		src_stride = padded_width;
+	else
+		src_stride = ALIGN(width * bmp_bpix / 8, 4);
 
 	if (align) {
 		video_splash_align_axis(&x, priv->xsize, width);
 		video_splash_align_axis(&y, priv->ysize, height);
 	}
 
+	row = video_bmp_get_row_func(bmp_bpix, bpix);
+	pixels = row ? video_bmp_cache_get(bmp, bmp_image, priv->bpix, row,
+					   pal) : NULL;
+
 	if ((x + width) > pwidth)
 		width = pwidth - x;
 	if ((y + height) > priv->ysize)
 		height = priv->ysize - y;
 
 	bmap = (uchar *)bmp + get_unaligned_le32(&bmp->header.data_offset);
+	pbytes = bpix < 8 ? 1 : bpix / 8;
 	fb = (uchar *)(priv->fb +
 		(y + height - 1) * priv->line_length + x * bpix / 8);
 
-	switch (bmp_bpix) {
-	case 1:
-	case 8: {
-		cmap_base = priv->cmap;
+	if (pixels) {
+		for (i = 0; i < height; i++) {
+			memcpy(fb, pixels, width * pbytes);
+			pixels += bmp_cache.line_length;
+			fb -= priv->line_length;
+		}
+	} else if (row) {
 #ifdef CONFIG_VIDEO_BMP_RLE8
 		u32 compression = get_unaligned_le32(&bmp->header.compression);
-		debug("compressed %d %d\n", compression, BMP_BI_RLE8);
-		if (compression == BMP_BI_RLE8) {
-			if (bpix != 16) {
-				/* TODO implement render code for bpix != 16 */
-				printf("Error: only support 16 bpix");
-				return -EPROTONOSUPPORT;
-			}
-			video_display_rle8_bitmap(dev, bmp, cmap_base, fb, x,
-						  y, width, height);
-			break;
-		}
-#endif
 
-		if (bpix != 16)
-			byte_width = width;
+		debug("compressed %d %d\n", compression, BMP_BI_RLE8);
+		if (bmp_bpix == 8 && compression == BMP_BI_RLE8)
+			video_bmp_rle8(bmap, fb, -priv->line_length, pbytes,
+				       row, pal, width, height);
 		else
-			byte_width = width * 2;
-
-		for (i = 0; i < height; ++i) {
-			WATCHDOG_RESET();
-			for (j = 0; j < width; j++) {
-				if (bpix != 16) {
-					fb_put_byte(&fb, &bmap);
-				} else {
-					*(uint16_t *)fb = cmap_base[*bmap];
-					bmap++;
-					fb += sizeof(uint16_t) / sizeof(*fb);
-				}
-			}
-			bmap += (padded_width - width);
-			fb -= byte_width + priv->line_length;
-		}
-		break;
+#endif
+			video_bmp_convert(bmap, src_stride, fb,
+					  -priv->line_length, row, pal, width,
+					  height);
 	}
-#if defined(CONFIG_BMP_16BPP)
-	case 16:
-		for (i = 0; i < height; ++i) {
-			WATCHDOG_RESET();
-			for (j = 0; j < width; j++)
-				fb_put_word(&fb, &bmap);
-
-			bmap += (padded_width - width) * 2;
-			fb -= width * 2 + priv->line_length;
-		}
-		break;
-#endif /* CONFIG_BMP_16BPP */
-#if defined(CONFIG_BMP_24BPP)
-	case 24:
-		for (i = 0; i < height; ++i) {
-			for (j = 0; j < width; j++) {
-				if (bpix == 16) {
-					/* 16bit 555RGB format */
-					*(u16 *)fb = ((bmap[2] >> 3) << 10) |
-						((bmap[1] >> 3) << 5) |
-						(bmap[0] >> 3);
-					bmap += 3;
-					fb += 2;
-				} else {
-					*(fb++) = *(bmap++);
-					*(fb++) = *(bmap++);
-					*(fb++) = *(bmap++);
-					*(fb++) = 0;
-				}
-			}
-			fb -= priv->line_length + width * (bpix / 8);
-			bmap += (padded_width - width) * 3;
-		}
-		break;
-#endif /* CONFIG_BMP_24BPP */
-#if defined(CONFIG_BMP_32BPP)
-	case 32:
-		for (i = 0; i < height; ++i) {
-			for (j = 0; j < width; j++) {
-				*(fb++) = *(bmap++);
-				*(fb++) = *(bmap++);
-				*(fb++) = *(bmap++);
-				*(fb++) = *(bmap++);
-			}
-			fb -= priv->line_length + width * (bpix / 8);
-		}
-		break;
-#endif /* CONFIG_BMP_32BPP */
-	default:
-		break;
-	};
 
+	video_damage(dev, y, height);
 	video_sync(dev, false);
 
 	return 0;
 }
-
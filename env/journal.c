@@ -0,0 +1,391 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Journaling storage for the environment
+ *
+ * Saving the environment normally rewrites the whole storage area, which on
+ * SPI flash means erasing it each time. Here the area holds a log instead:
+ * saving appends a record for each variable which changed, and the area is
+ * only erased and rewritten with a snapshot of the environment when the log
+ * is full. See include/env_internal.h for the interface.
+ */
+
+#include <common.h>
+#include <env.h>
+#include <env_internal.h>
+#include <malloc.h>
+#include <search.h>
+#include <linux/stddef.h>
+#include <u-boot/crc.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+#define ENV_JOURNAL_MAGIC	0x4a564e45	/* "ENVJ" */
+
+/**
+ * struct env_journal_hdr - Header at the start of the storage area
+ *
+ * @magic: ENV_JOURNAL_MAGIC
+ * @seq: Sequence number, increased each time the journal is compacted
+ * @crc: CRC32 of @magic and @seq
+ */
+struct env_journal_hdr {
+	u32 magic;
+	u32 seq;
+	u32 crc;
+};
+
+/* Record types */
+enum env_journal_type {
+	ENV_JOURNAL_FULL = 1,	/* "name=value\0...\0", replaces everything */
+	ENV_JOURNAL_SET,	/* "name=value\0" */
+	ENV_JOURNAL_DEL,	/* "name\0" */
+};
+
+/**
+ * struct env_journal_rec - Header of a record, followed by its data
+ *
+ * Records start at 4-byte boundaries. A @len of 0xffffffff (erased storage)
+ * marks the end of the log.
+ *
+ * @crc: CRC32 of the rest of the header and the data
+ * @len: Number of data bytes
+ * @type: Record type (enum env_journal_type)
+ * @pad: Zero
+ */
+struct env_journal_rec {
+	u32 crc;
+	u32 len;
+	u8 type;
+	u8 pad[3];
+};
+
+#define ENV_JOURNAL_END		0xffffffff
+
+/*
+ * Longest variable name which can be deleted with a record. A longer one is
+ * handled by writing a snapshot instead.
+ */
+#define ENV_JOURNAL_NAME_MAX	256
+
+/* Largest snapshot which fits in the storage area */
+#define ENV_JOURNAL_MAX_DATA	(CONFIG_ENV_SIZE - \
+				 sizeof(struct env_journal_hdr) - \
+				 sizeof(struct env_journal_rec))
+
+static u32 env_journal_rec_crc(struct env_journal_rec *rec)
+{
+	return crc32(0, (u8 *)&rec->len,
+		     sizeof(*rec) - offsetof(struct env_journal_rec, len) +
+		     rec->len);
+}
+
+static u32 env_journal_hdr_crc(struct env_journal_hdr *hdr)
+{
+	return crc32(0, (u8 *)hdr, offsetof(struct env_journal_hdr, crc));
+}
+
+/**
+ * env_journal_put() - Add a record to the image of the storage area
+ *
+ * @jnl: Journal state
+ * @offset: Offset at which to add the record, updated to follow it
+ * @type: Record type
+ * @data: Record data
+ * @len: Number of bytes of data
+ * @return 0 if OK, -ENOSPC if the record does not fit
+ */
+static int env_journal_put(struct env_journal *jnl, u32 *offset,
+			   enum env_journal_type type, const char *data,
+			   u32 len)
+{
+	struct env_journal_rec *rec;
+	u32 size = ALIGN(sizeof(*rec) + len, 4);
+
+	if (size > CONFIG_ENV_SIZE - *offset)
+		return -ENOSPC;
+
+	rec = (struct env_journal_rec *)(jnl->area + *offset);
+	rec->len = len;
+	rec->type = type;
+	memset(rec->pad, '\0', sizeof(rec->pad));
+	memcpy(rec + 1, data, len);
+	rec->crc = env_journal_rec_crc(rec);
+	*offset += size;
+
+	return 0;
+}
+
+static int env_journal_alloc(struct env_journal *jnl)
+{
+	if (!jnl->area)
+		jnl->area = memalign(ARCH_DMA_MINALIGN, CONFIG_ENV_SIZE);
+	if (!jnl->state)
+		jnl->state = malloc(CONFIG_ENV_SIZE);
+
+	return jnl->area && jnl->state ? 0 : -ENOMEM;
+}
+
+/**
+ * env_journal_export() - Export the environment
+ *
+ * Variables are sorted by name, as needed by env_journal_diff().
+ *
+ * @buf: Buffer of CONFIG_ENV_SIZE bytes
+ * @return number of bytes used, including the final '\0', or -ve on error
+ */
+static ssize_t env_journal_export(char *buf)
+{
+	const char *p;
+	ssize_t len;
+
+	len = hexport_r(&env_htab, '\0', 0, &buf, ENV_JOURNAL_MAX_DATA, 0,
+			NULL);
+	if (len < 0) {
+		pr_err("Cannot export environment: errno = %d\n", errno);
+		return len;
+	}
+
+	for (p = buf; *p; p += strlen(p) + 1)
+		;
+
+	return p - buf + 1;
+}
+
+/**
+ * env_journal_replay() - Import the records in the storage area
+ *
+ * @jnl: Journal state, with the area image read from storage
+ * @return 0 if OK, -EINVAL if the journal has no snapshot, -EIO if import
+ *	failed
+ */
+static int env_journal_replay(struct env_journal *jnl)
+{
+	u32 offset = sizeof(struct env_journal_hdr);
+	struct env_journal_rec *rec;
+	int flag;
+
+	jnl->end = CONFIG_ENV_SIZE;
+	while (offset + sizeof(*rec) <= CONFIG_ENV_SIZE) {
+		rec = (struct env_journal_rec *)(jnl->area + offset);
+		if (rec->len == ENV_JOURNAL_END) {
+			jnl->end = offset;
+			break;
+		}
+
+		/*
+		 * A record which is cut short or corrupted (e.g. by a power
+		 * failure while it was written) ends the log. Nothing can be
+		 * appended after it, so the next save compacts the journal.
+		 */
+		if (rec->len > CONFIG_ENV_SIZE - offset - sizeof(*rec) ||
+		    env_journal_rec_crc(rec) != rec->crc) {
+			printf("Environment journal: bad record at %x\n",
+			       offset);
+			break;
+		}
+
+		if (rec->type < ENV_JOURNAL_FULL ||
+		    rec->type > ENV_JOURNAL_DEL) {
+			printf("Environment journal: bad record type %d\n",
+			       rec->type);
+			break;
+		}
+		if (offset == sizeof(struct env_journal_hdr) &&
+		    rec->type != ENV_JOURNAL_FULL)
+			return -EINVAL;
+		flag = rec->type == ENV_JOURNAL_FULL ? 0 : H_NOCLEAR;
+		if (!himport_r(&env_htab, (char *)(rec + 1), rec->len, '\0',
+			       flag, 0, 0, NULL)) {
+			pr_err("Cannot import environment: errno = %d\n",
+			       errno);
+			return -EIO;
+		}
+		offset += ALIGN(sizeof(*rec) + rec->len, 4);
+	}
+
+	/* The snapshot is the first record, so it must be complete */
+	if (offset == sizeof(struct env_journal_hdr))
+		return -EINVAL;
+
+	return 0;
+}
+
+int env_journal_load(struct env_journal *jnl,
+		     const struct env_journal_ops *ops)
+{
+	struct env_journal_hdr *hdr;
+	int ret;
+
+	jnl->valid = false;
+	ret = env_journal_alloc(jnl);
+	if (ret) {
+		env_set_default("malloc() failed", 0);
+		return ret;
+	}
+
+	ret = ops->read(jnl->area);
+	if (ret) {
+		env_set_default("!read failed", 0);
+		return -EIO;
+	}
+
+	hdr = (struct env_journal_hdr *)jnl->area;
+	if (hdr->magic != ENV_JOURNAL_MAGIC ||
+	    hdr->crc != env_journal_hdr_crc(hdr)) {
+		/* Not a journal (yet), so try a plain environment */
+		return env_import((char *)jnl->area, 1);
+	}
+
+	ret = env_journal_replay(jnl);
+	if (ret) {
+		env_set_default(ret == -EINVAL ? "bad journal" :
+				"import failed", 0);
+		return ret;
+	}
+	gd->flags |= GD_FLG_ENV_READY;
+
+	if (env_journal_export(jnl->state) < 0)
+		return 0;
+	jnl->seq = hdr->seq;
+	jnl->valid = true;
+
+	return 0;
+}
+
+/*
+ * Compare the names of two "name=value" entries, as hexport_r() does when
+ * sorting them
+ */
+static int env_journal_namecmp(const char *a, const char *b)
+{
+	while (*a && *a != '=' && *a == *b) {
+		a++;
+		b++;
+	}
+
+	return (*a == '=' ? 0 : (u8)*a) - (*b == '=' ? 0 : (u8)*b);
+}
+
+/**
+ * env_journal_diff() - Add records for the changes to the environment
+ *
+ * Both lists are sorted by name, so a single pass finds the variables which
+ * were added, changed or removed.
+ *
+ * @jnl: Journal state
+ * @new: Environment to save, as exported by hexport_r()
+ * @offset: Offset at which to add the records, updated to follow them
+ * @return 0 if OK, -ENOSPC if the records do not fit
+ */
+static int env_journal_diff(struct env_journal *jnl, const char *new,
+			    u32 *offset)
+{
+	const char *old = jnl->state;
+	int cmp, ret = 0;
+
+	while (!ret && (*old || *new)) {
+		if (!*old)
+			cmp = 1;
+		else if (!*new)
+			cmp = -1;
+		else
+			cmp = env_journal_namecmp(old, new);
+
+		if (cmp < 0) {
+			u32 len = strchrnul(old, '=') - old;
+			char name[ENV_JOURNAL_NAME_MAX];
+
+			if (len >= sizeof(name))
+				return -E2BIG;
+			memcpy(name, old, len);
+			name[len] = '\0';
+			ret = env_journal_put(jnl, offset, ENV_JOURNAL_DEL,
+					      name, len + 1);
+		} else if (cmp > 0 || strcmp(old, new)) {
+			ret = env_journal_put(jnl, offset, ENV_JOURNAL_SET,
+					      new, strlen(new) + 1);
+		}
+		if (cmp <= 0)
+			old += strlen(old) + 1;
+		if (cmp >= 0)
+			new += strlen(new) + 1;
+	}
+
+	return ret;
+}
+
+/* Rewrite the area with a header and a snapshot of the environment */
+static int env_journal_compact(struct env_journal *jnl,
+			       const struct env_journal_ops *ops,
+			       const char *new, u32 len, u32 *offset)
+{
+	struct env_journal_hdr *hdr = (struct env_journal_hdr *)jnl->area;
+	int ret;
+
+	memset(jnl->area, 0xff, CONFIG_ENV_SIZE);
+	hdr->magic = ENV_JOURNAL_MAGIC;
+	hdr->seq = jnl->seq + 1;
+	hdr->crc = env_journal_hdr_crc(hdr);
+	*offset = sizeof(*hdr);
+	ret = env_journal_put(jnl, offset, ENV_JOURNAL_FULL, new, len);
+	if (ret)
+		return ret;
+
+	if (ops->erase) {
+		ret = ops->erase();
+		if (ret)
+			return ret;
+		return ops->write(jnl->area, 0, *offset);
+	}
+
+	/* Overwrite any old records too */
+	return ops->write(jnl->area, 0, CONFIG_ENV_SIZE);
+}
+
+int env_journal_save(struct env_journal *jnl,
+		     const struct env_journal_ops *ops)
+{
+	u32 offset = jnl->end;
+	ssize_t len;
+	char *new;
+	int ret;
+
+	ret = env_journal_alloc(jnl);
+	if (ret)
+		return ret;
+	new = malloc(CONFIG_ENV_SIZE);
+	if (!new)
+		return -ENOMEM;
+	len = env_journal_export(new);
+	if (len < 0) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	if (jnl->valid)
+		ret = env_journal_diff(jnl, new, &offset);
+	if (!jnl->valid || ret) {
+		/* Only a copy in RAM would be left if this fails */
+		jnl->valid = false;
+		ret = env_journal_compact(jnl, ops, new, len, &offset);
+		if (ret)
+			goto out;
+		jnl->seq++;
+	} else if (offset != jnl->end) {
+		/* Until this succeeds, the area image is ahead of storage */
+		jnl->valid = false;
+		ret = ops->write(jnl->area, jnl->end, offset - jnl->end);
+		if (ret)
+			goto out;
+	}
+
+	jnl->end = offset;
+	jnl->valid = true;
+	free(jnl->state);
+	jnl->state = new;
+	new = NULL;
+out:
+	free(new);
+
+	return ret;
+}
@@ -188,6 +188,7 @@ static inline int write_env(struct mmc *mmc, unsigned long size,
 	return (n == blk_cnt) ? 0 : -1;
 }
 
+#ifndef CONFIG_ENV_JOURNAL
 static int env_mmc_save(void)
 {
 	ALLOC_CACHE_ALIGN_BUFFER(env_t, env_new, 1);
@@ -234,6 +235,7 @@ fini:
 	fini_mmc_for_env(mmc);
 	return ret;
 }
+#endif /* !CONFIG_ENV_JOURNAL */
 
 #if defined(CONFIG_CMD_ERASEENV)
 static inline int erase_env(struct mmc *mmc, unsigned long size,
@@ -343,6 +345,97 @@ err:
 #endif
 	return ret;
 }
+#elif defined(CONFIG_ENV_JOURNAL)
+static struct env_journal env_mmc_journal;
+static struct mmc *env_mmc_journal_dev;
+static u32 env_mmc_journal_offset;
+
+static int env_mmc_journal_read(void *buf)
+{
+	return read_env(env_mmc_journal_dev, CONFIG_ENV_SIZE,
+			env_mmc_journal_offset, buf);
+}
+
+#if defined(CONFIG_CMD_SAVEENV) && !defined(CONFIG_SPL_BUILD)
+/* Write the blocks holding the requested bytes */
+static int env_mmc_journal_write(const void *area, u32 offset, u32 len)
+{
+	uint blksz = env_mmc_journal_dev->write_bl_len;
+	u32 start = rounddown(offset, blksz);
+
+	return write_env(env_mmc_journal_dev,
+			 ALIGN(offset + len, blksz) - start,
+			 env_mmc_journal_offset + start, area + start);
+}
+#endif
+
+static const struct env_journal_ops env_mmc_journal_ops = {
+	.read	= env_mmc_journal_read,
+#if defined(CONFIG_CMD_SAVEENV) && !defined(CONFIG_SPL_BUILD)
+	.write	= env_mmc_journal_write,
+#endif
+};
+
+#if defined(CONFIG_CMD_SAVEENV) && !defined(CONFIG_SPL_BUILD)
+static int env_mmc_save(void)
+{
+	int dev = mmc_get_env_dev();
+	struct mmc *mmc = find_mmc_device(dev);
+	const char *errmsg;
+	int ret = 1;
+
+	errmsg = init_mmc_for_env(mmc);
+	if (errmsg) {
+		printf("%s\n", errmsg);
+		return 1;
+	}
+
+	if (mmc_get_env_addr(mmc, 0, &env_mmc_journal_offset))
+		goto fini;
+	env_mmc_journal_dev = mmc;
+
+	printf("Writing to MMC(%d)... ", dev);
+	if (env_journal_save(&env_mmc_journal, &env_mmc_journal_ops)) {
+		puts("failed\n");
+		goto fini;
+	}
+
+	ret = 0;
+
+fini:
+	fini_mmc_for_env(mmc);
+	return ret;
+}
+#endif
+
+static int env_mmc_load(void)
+{
+	struct mmc *mmc;
+	int ret;
+	int dev = mmc_get_env_dev();
+	const char *errmsg;
+
+	mmc = find_mmc_device(dev);
+
+	errmsg = init_mmc_for_env(mmc);
+	if (errmsg) {
+		env_set_default(errmsg, 0);
+		return -EIO;
+	}
+
+	if (mmc_get_env_addr(mmc, 0, &env_mmc_journal_offset)) {
+		env_set_default(NULL, 0);
+		ret = -EIO;
+		goto fini;
+	}
+	env_mmc_journal_dev = mmc;
+
+	ret = env_journal_load(&env_mmc_journal, &env_mmc_journal_ops);
+
+fini:
+	fini_mmc_for_env(mmc);
+	return ret;
+}
 #else /* ! CONFIG_ENV_OFFSET_REDUND */
 static int env_mmc_load(void)
 {
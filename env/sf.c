@@ -186,6 +186,104 @@ out:
 
 	return ret;
 }
+#elif defined(CONFIG_ENV_JOURNAL)
+static struct env_journal env_sf_journal;
+
+static int env_sf_journal_read(void *buf)
+{
+	return spi_flash_read(env_flash, CONFIG_ENV_OFFSET, CONFIG_ENV_SIZE,
+			      buf);
+}
+
+#ifdef CMD_SAVEENV
+static int env_sf_journal_write(const void *area, u32 offset, u32 len)
+{
+	return spi_flash_write(env_flash, CONFIG_ENV_OFFSET + offset, len,
+			       area + offset);
+}
+
+static int env_sf_journal_erase(void)
+{
+	u32	saved_size, saved_offset, sector;
+	char	*saved_buffer = NULL;
+	int	ret;
+
+	/* Is the sector larger than the env (i.e. embedded) */
+	if (CONFIG_ENV_SECT_SIZE > CONFIG_ENV_SIZE) {
+		saved_size = CONFIG_ENV_SECT_SIZE - CONFIG_ENV_SIZE;
+		saved_offset = CONFIG_ENV_OFFSET + CONFIG_ENV_SIZE;
+		saved_buffer = malloc(saved_size);
+		if (!saved_buffer)
+			return -ENOMEM;
+
+		ret = spi_flash_read(env_flash, saved_offset,
+			saved_size, saved_buffer);
+		if (ret)
+			goto done;
+	}
+
+	sector = DIV_ROUND_UP(CONFIG_ENV_SIZE, CONFIG_ENV_SECT_SIZE);
+
+	ret = spi_flash_erase(env_flash, CONFIG_ENV_OFFSET,
+		sector * CONFIG_ENV_SECT_SIZE);
+	if (ret)
+		goto done;
+
+	if (CONFIG_ENV_SECT_SIZE > CONFIG_ENV_SIZE)
+		ret = spi_flash_write(env_flash, saved_offset,
+			saved_size, saved_buffer);
+
+ done:
+	free(saved_buffer);
+
+	return ret;
+}
+#endif /* CMD_SAVEENV */
+
+static const struct env_journal_ops env_sf_journal_ops = {
+	.read	= env_sf_journal_read,
+#ifdef CMD_SAVEENV
+	.write	= env_sf_journal_write,
+	.erase	= env_sf_journal_erase,
+#endif
+};
+
+#ifdef CMD_SAVEENV
+static int env_sf_save(void)
+{
+	int ret;
+
+	ret = setup_flash_device();
+	if (ret)
+		return ret;
+
+	puts("Writing to SPI flash...");
+	ret = env_journal_save(&env_sf_journal, &env_sf_journal_ops);
+	if (ret)
+		return ret;
+	puts("done\n");
+
+	return 0;
+}
+#endif /* CMD_SAVEENV */
+
+static int env_sf_load(void)
+{
+	int ret;
+
+	ret = setup_flash_device();
+	if (ret)
+		return ret;
+
+	ret = env_journal_load(&env_sf_journal, &env_sf_journal_ops);
+	if (!ret)
+		gd->env_valid = ENV_VALID;
+
+	spi_flash_free(env_flash);
+	env_flash = NULL;
+
+	return ret;
+}
 #else
 #ifdef CMD_SAVEENV
 static int env_sf_save(void)
@@ -80,6 +80,7 @@ int btrfs_probe(struct blk_desc *fs_dev_desc, disk_partition_t *fs_partition)
 	btrfs_part_info = fs_partition;
 
 	memset(&btrfs_info, 0, sizeof(btrfs_info));
+	btrfs_tree_cache_exit();
 
 	btrfs_hash_init();
 	if (btrfs_read_superblock())
@@ -210,6 +211,9 @@ int btrfs_read(const char *file, void *buf, loff_t offset, loff_t len,
 void btrfs_close(void)
 {
 	btrfs_chunk_map_exit();
+	btrfs_tree_cache_exit();
+	btrfs_extent_io_exit();
+	btrfs_decompress_exit();
 }
 
 int btrfs_uuid(char *uuid_str)
@@ -48,6 +48,7 @@ int btrfs_read_chunk_tree(void);
 
 /* compression.c */
 u32 btrfs_decompress(u8 type, const char *, u32, char *, u32);
+void btrfs_decompress_exit(void);
 
 /* super.c */
 int btrfs_read_superblock(void);
@@ -78,10 +79,22 @@ u64 btrfs_file_read(const struct btrfs_root *, u64, u64, u64, char *);
 u64 btrfs_get_default_subvol_objectid(void);
 
 /* extent-io.c */
+/*
+ * Pending device read of uncompressed extents. Consecutive extents of a
+ * file are often adjacent on the device too, and are then read at once.
+ */
+struct btrfs_devread_batch {
+	u64 physical;
+	u64 len;
+	char *buf;
+};
+
+int btrfs_devread_batch_flush(struct btrfs_devread_batch *);
 u64 btrfs_read_extent_inline(struct btrfs_path *,
 			      struct btrfs_file_extent_item *, u64, u64,
 			      char *);
 u64 btrfs_read_extent_reg(struct btrfs_path *, struct btrfs_file_extent_item *,
-			   u64, u64, char *);
+			   u64, u64, char *, struct btrfs_devread_batch *);
+void btrfs_extent_io_exit(void);
 
 #endif /* !__BTRFS_BTRFS_H__ */
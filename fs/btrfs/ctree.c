@@ -104,14 +104,106 @@ void btrfs_free_path(struct btrfs_path *p)
 	clear_path(p);
 }
 
-static int read_tree_node(u64 physical, union btrfs_tree_node **buf)
+/*
+ * Every search walks down from the root of a tree, so the nodes near the
+ * root are read over and over. Recently read nodes are kept here, keyed by
+ * logical address, and replaced in LRU order.
+ */
+struct tree_cache_entry {
+	u64 logical;
+	u32 size;
+	u32 used;
+	union btrfs_tree_node *node;
+};
+
+static struct tree_cache_entry tree_cache[CONFIG_FS_BTRFS_TREE_CACHE];
+static u32 tree_cache_stamp;
+
+void btrfs_tree_cache_exit(void)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(tree_cache); ++i) {
+		free(tree_cache[i].node);
+		tree_cache[i].node = NULL;
+		tree_cache[i].logical = -1ULL;
+	}
+	tree_cache_stamp = 0;
+}
+
+static struct tree_cache_entry *tree_cache_find(u64 logical)
+{
+	struct tree_cache_entry *entry;
+	int i;
+
+	++tree_cache_stamp;
+	for (i = 0; i < ARRAY_SIZE(tree_cache); ++i) {
+		entry = &tree_cache[i];
+		if (entry->node && entry->logical == logical) {
+			entry->used = tree_cache_stamp;
+			return entry;
+		}
+	}
+
+	return NULL;
+}
+
+static void tree_cache_add(u64 logical, union btrfs_tree_node *node,
+			   u32 size)
+{
+	struct tree_cache_entry *entry, *lru = &tree_cache[0];
+	int i;
+
+	for (i = 1; i < ARRAY_SIZE(tree_cache); ++i) {
+		entry = &tree_cache[i];
+		if (lru->node && (!entry->node ||
+				  tree_cache_stamp - entry->used >
+				  tree_cache_stamp - lru->used))
+			lru = entry;
+	}
+
+	if (!lru->node) {
+		lru->node = malloc_cache_aligned(btrfs_info.sb.nodesize);
+		if (!lru->node)
+			return;
+	}
+
+	memcpy(lru->node, node, size);
+	lru->logical = logical;
+	lru->size = size;
+	lru->used = tree_cache_stamp;
+}
+
+static int read_tree_node(u64 logical, union btrfs_tree_node **buf)
 {
 	ALLOC_CACHE_ALIGN_BUFFER(struct btrfs_header, hdr,
 				 sizeof(struct btrfs_header));
 	unsigned long size, offset = sizeof(*hdr);
+	struct tree_cache_entry *cached;
 	union btrfs_tree_node *res;
+	u64 physical;
 	u32 i;
 
+	/*
+	 * Callers convert item data in place, so they get a copy of the
+	 * cached node rather than the node itself
+	 */
+	cached = tree_cache_find(logical);
+	if (cached) {
+		res = malloc_cache_aligned(cached->size);
+		if (!res) {
+			debug("%s: malloc failed\n", __func__);
+			return -1;
+		}
+		memcpy(res, cached->node, cached->size);
+		*buf = res;
+		return 0;
+	}
+
+	physical = btrfs_map_logical_to_physical(logical);
+	if (physical == -1ULL)
+		return -1;
+
 	if (!btrfs_devread(physical, sizeof(*hdr), hdr))
 		return -1;
 
@@ -123,6 +215,11 @@ static int read_tree_node(u64 physical, union btrfs_tree_node **buf)
 	else
 		size = btrfs_info.sb.nodesize;
 
+	if (size > btrfs_info.sb.nodesize) {
+		printf("%s: invalid node at %llu\n", __func__, logical);
+		return -1;
+	}
+
 	res = malloc_cache_aligned(size);
 	if (!res) {
 		debug("%s: malloc failed\n", __func__);
@@ -143,6 +240,7 @@ static int read_tree_node(u64 physical, union btrfs_tree_node **buf)
 		for (i = 0; i < hdr->nritems; ++i)
 			btrfs_item_to_cpu(&res->leaf.items[i]);
 
+	tree_cache_add(logical, res, size);
 	*buf = res;
 
 	return 0;
@@ -153,7 +251,7 @@ int btrfs_search_tree(const struct btrfs_root *root, struct btrfs_key *key,
 {
 	u8 lvl, prev_lvl;
 	int i, slot, ret;
-	u64 logical, physical;
+	u64 logical;
 	union btrfs_tree_node *buf;
 
 	clear_path(p);
@@ -161,11 +259,7 @@ int btrfs_search_tree(const struct btrfs_root *root, struct btrfs_key *key,
 	logical = root->bytenr;
 
 	for (i = 0; i < BTRFS_MAX_LEVEL; ++i) {
-		physical = btrfs_map_logical_to_physical(logical);
-		if (physical == -1ULL)
-			goto err;
-
-		if (read_tree_node(physical, &buf))
+		if (read_tree_node(logical, &buf))
 			goto err;
 
 		lvl = buf->header.level;
@@ -237,15 +331,11 @@ static int jump_leaf(struct btrfs_path *path, int dir)
 	from_level = level;
 
 	while (level >= 0) {
-		u64 logical, physical;
+		u64 logical;
 
 		slot = p.slots[level + 1];
 		logical = p.nodes[level + 1]->node.ptrs[slot].blockptr;
-		physical = btrfs_map_logical_to_physical(logical);
-		if (physical == -1ULL)
-			goto err;
-
-		if (read_tree_node(physical, &p.nodes[level]))
+		if (read_tree_node(logical, &p.nodes[level]))
 			goto err;
 
 		if (dir > 0)
@@ -277,6 +277,7 @@ int btrfs_comp_keys(struct btrfs_key *, struct btrfs_key *);
 int btrfs_comp_keys_type(struct btrfs_key *, struct btrfs_key *);
 int btrfs_bin_search(union btrfs_tree_node *, struct btrfs_key *, int *);
 void btrfs_free_path(struct btrfs_path *);
+void btrfs_tree_cache_exit(void);
 int btrfs_search_tree(const struct btrfs_root *, struct btrfs_key *,
 		      struct btrfs_path *);
 int btrfs_prev_slot(struct btrfs_path *);
@@ -9,6 +9,68 @@
 #include <malloc.h>
 #include <memalign.h>
 
+/*
+ * Buffers for compressed extents, kept between reads rather than allocated
+ * for each extent. Compressed extents are at most 128KiB either way.
+ */
+static char *extent_cbuf, *extent_dbuf;
+static u32 extent_cbuf_size, extent_dbuf_size;
+
+static char *extent_buf(char **buf, u32 *buf_size, u64 size)
+{
+	if (*buf_size < size) {
+		free(*buf);
+		*buf = malloc_cache_aligned(size);
+		*buf_size = *buf ? size : 0;
+	}
+
+	return *buf;
+}
+
+void btrfs_extent_io_exit(void)
+{
+	free(extent_cbuf);
+	free(extent_dbuf);
+	extent_cbuf = NULL;
+	extent_dbuf = NULL;
+	extent_cbuf_size = 0;
+	extent_dbuf_size = 0;
+}
+
+int btrfs_devread_batch_flush(struct btrfs_devread_batch *batch)
+{
+	u64 len = batch->len;
+
+	batch->len = 0;
+	if (len && !btrfs_devread(batch->physical, len, batch->buf))
+		return -1;
+
+	return 0;
+}
+
+/*
+ * Add a device read to the batch, merging it with the pending one if both
+ * the device ranges and the buffers are adjacent
+ */
+static int btrfs_devread_batch_add(struct btrfs_devread_batch *batch,
+				   u64 physical, u64 len, char *buf)
+{
+	if (batch->len && batch->physical + batch->len == physical &&
+	    batch->buf + batch->len == buf && batch->len + len <= INT_MAX) {
+		batch->len += len;
+		return 0;
+	}
+
+	if (btrfs_devread_batch_flush(batch))
+		return -1;
+
+	batch->physical = physical;
+	batch->len = len;
+	batch->buf = buf;
+
+	return 0;
+}
+
 u64 btrfs_read_extent_inline(struct btrfs_path *path,
 			     struct btrfs_file_extent_item *extent, u64 offset,
 			     u64 size, char *out)
@@ -35,7 +97,7 @@ u64 btrfs_read_extent_inline(struct btrfs_path *path,
 	}
 
 	if (dlen > orig_size) {
-		dbuf = malloc(dlen);
+		dbuf = extent_buf(&extent_dbuf, &extent_dbuf_size, dlen);
 		if (!dbuf)
 			return -1ULL;
 	} else {
@@ -44,33 +106,27 @@ u64 btrfs_read_extent_inline(struct btrfs_path *path,
 
 	res = btrfs_decompress(extent->compression, cbuf, clen, dbuf, dlen);
 	if (res == -1 || res != dlen)
-		goto err;
+		return -1ULL;
 
-	if (dlen > orig_size) {
+	if (dlen > orig_size)
 		memcpy(out, dbuf + offset, size);
-		free(dbuf);
-	} else if (offset) {
+	else if (offset)
 		memmove(out, dbuf + offset, size);
-	}
 
 	return size;
-
-err:
-	if (dlen > orig_size)
-		free(dbuf);
-	return -1ULL;
 }
 
 u64 btrfs_read_extent_reg(struct btrfs_path *path,
 			  struct btrfs_file_extent_item *extent, u64 offset,
-			  u64 size, char *out)
+			  u64 size, char *out, struct btrfs_devread_batch *batch)
 {
-	u64 physical, clen, dlen, orig_size = size;
+	u64 physical, clen, dlen, ram_bytes, orig_size = size;
 	u32 res;
 	char *cbuf, *dbuf;
 
 	clen = extent->disk_num_bytes;
 	dlen = extent->num_bytes;
+	ram_bytes = extent->ram_bytes;
 
 	if (offset > dlen)
 		return -1ULL;
@@ -84,37 +140,43 @@ u64 btrfs_read_extent_reg(struct btrfs_path *path,
 
 	if (extent->compression == BTRFS_COMPRESS_NONE) {
 		physical += extent->offset + offset;
-		if (!btrfs_devread(physical, size, out))
+		if (btrfs_devread_batch_add(batch, physical, size, out))
 			return -1ULL;
 
 		return size;
 	}
 
-	cbuf = malloc_cache_aligned(dlen > size ? clen + dlen : clen);
+	/*
+	 * The file data is at extent->offset in the decompressed extent, so
+	 * decompress straight into the output if it is all wanted
+	 */
+	offset += extent->offset;
+	if (offset > ram_bytes || size > ram_bytes - offset)
+		return -1ULL;
+
+	cbuf = extent_buf(&extent_cbuf, &extent_cbuf_size, clen);
 	if (!cbuf)
 		return -1ULL;
 
-	if (dlen > orig_size)
-		dbuf = cbuf + clen;
+	if (ram_bytes > orig_size)
+		dbuf = extent_buf(&extent_dbuf, &extent_dbuf_size, ram_bytes);
 	else
 		dbuf = out;
+	if (!dbuf)
+		return -1ULL;
 
 	if (!btrfs_devread(physical, clen, cbuf))
-		goto err;
+		return -1ULL;
 
-	res = btrfs_decompress(extent->compression, cbuf, clen, dbuf, dlen);
-	if (res == -1)
-		goto err;
+	res = btrfs_decompress(extent->compression, cbuf, clen, dbuf,
+			       ram_bytes);
+	if (res == -1 || res < offset + size)
+		return -1ULL;
 
-	if (dlen > orig_size)
+	if (ram_bytes > orig_size)
 		memcpy(out, dbuf + offset, size);
-	else
+	else if (offset)
 		memmove(out, dbuf + offset, size);
 
-	free(cbuf);
-	return res;
-
-err:
-	free(cbuf);
-	return -1ULL;
+	return size;
 }
@@ -60,6 +60,7 @@ int fat_set_blk_dev(struct blk_desc *dev_desc, disk_partition_t *info)
 {
 	ALLOC_CACHE_ALIGN_BUFFER(unsigned char, buffer, dev_desc->blksz);
 
+	fs_driver_set_blk_dev(dev_desc, info);
 	cur_dev = dev_desc;
 	cur_part_info = *info;
 
@@ -301,6 +302,15 @@ get_cluster(fsdata *mydata, __u32 clustnum, __u8 *buffer, unsigned long size)
 	return 0;
 }
 
+/*
+ * Position in the cluster chain of a file, so that reads from an open file
+ * do not need to follow the chain from the first cluster each time
+ */
+typedef struct {
+	__u32	clust;		/* cluster number, 0 if not known */
+	loff_t	pos;		/* file offset of the start of clust */
+} fat_pos;
+
 /**
  * get_contents() - read from file
  *
@@ -314,10 +324,14 @@ get_cluster(fsdata *mydata, __u32 clustnum, __u8 *buffer, unsigned long size)
  * @buffer:	buffer into which to read
  * @maxsize:	maximum number of bytes to read
  * @gotsize:	number of bytes actually read
+ * @cursor:	if not NULL, a known position in the cluster chain. The search
+ *		for the cluster at 'pos' starts here if it lies before 'pos',
+ *		and it is updated to that cluster
  * Return:	-1 on error, otherwise 0
  */
 static int get_contents(fsdata *mydata, dir_entry *dentptr, loff_t pos,
-			__u8 *buffer, loff_t maxsize, loff_t *gotsize)
+			__u8 *buffer, loff_t maxsize, loff_t *gotsize,
+			fat_pos *cursor)
 {
 	loff_t filesize = FAT2CPU32(dentptr->size);
 	unsigned int bytesperclust = mydata->clust_size * mydata->sect_size;
@@ -339,6 +353,10 @@ static int get_contents(fsdata *mydata, dir_entry *dentptr, loff_t pos,
 	debug("%llu bytes\n", filesize);
 
 	actsize = bytesperclust;
+	if (cursor && cursor->clust && cursor->pos <= pos) {
+		curclust = cursor->clust;
+		actsize += cursor->pos;
+	}
 
 	/* go to cluster at pos */
 	while (actsize <= pos) {
@@ -353,6 +371,10 @@ static int get_contents(fsdata *mydata, dir_entry *dentptr, loff_t pos,
 
 	/* actsize > pos */
 	actsize -= bytesperclust;
+	if (cursor) {
+		cursor->clust = curclust;
+		cursor->pos = actsize;
+	}
 	filesize -= actsize;
 	pos -= actsize;
 
@@ -1215,7 +1237,8 @@ int file_fat_read_at(const char *filename, loff_t pos, void *buffer,
 	/* For saving default max clustersize memory allocated to malloc pool */
 	dir_entry *dentptr = itr->dent;
 
-	ret = get_contents(&fsdata, dentptr, pos, buffer, maxsize, actread);
+	ret = get_contents(&fsdata, dentptr, pos, buffer, maxsize, actread,
+			   NULL);
 
 out_free_both:
 	free(fsdata.fatbuf);
@@ -1248,6 +1271,68 @@ int fat_read_file(const char *filename, void *buf, loff_t offset, loff_t len,
 	return ret;
 }
 
+/* State for a file opened with fat_open() */
+typedef struct {
+	fsdata fsdata;		/* filesystem parameters and FAT buffer */
+	dir_entry dent;		/* directory entry of the file */
+	fat_pos cursor;		/* cluster where the last read started */
+} fat_file;
+
+int fat_open(struct fs_file *file)
+{
+	fat_file *ff;
+	fat_itr *itr;
+	int ret;
+
+	ff = calloc(1, sizeof(*ff));
+	itr = malloc_cache_aligned(sizeof(fat_itr));
+	if (!ff || !itr) {
+		ret = -ENOMEM;
+		goto out_free;
+	}
+	ret = fat_itr_root(itr, &ff->fsdata);
+	if (ret)
+		goto out_free;
+
+	ret = fat_itr_resolve(itr, file->name, TYPE_FILE);
+	if (ret) {
+		free(ff->fsdata.fatbuf);
+		goto out_free;
+	}
+	ff->dent = *itr->dent;
+	file->size = FAT2CPU32(ff->dent.size);
+	file->priv = ff;
+	ff = NULL;
+
+out_free:
+	free(itr);
+	free(ff);
+	return ret;
+}
+
+int fat_read_at(struct fs_file *file, void *buf, loff_t offset, loff_t len,
+		loff_t *actread)
+{
+	fat_file *ff = file->priv;
+	int ret;
+
+	ret = get_contents(&ff->fsdata, &ff->dent, offset, buf, len, actread,
+			   &ff->cursor);
+	if (ret)
+		printf("** Unable to read file %s **\n", file->name);
+
+	return ret;
+}
+
+void fat_close_file(struct fs_file *file)
+{
+	fat_file *ff = file->priv;
+
+	if (ff)
+		free(ff->fsdata.fatbuf);
+	free(ff);
+}
+
 typedef struct {
 	struct fs_dir_stream parent;
 	struct fs_dirent dirent;
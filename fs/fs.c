@@ -7,6 +7,7 @@
 #include <errno.h>
 #include <common.h>
 #include <env.h>
+#include <malloc.h>
 #include <mapmem.h>
 #include <part.h>
 #include <ext4fs.h>
@@ -15,6 +16,7 @@
 #include <sandboxfs.h>
 #include <ubifs_uboot.h>
 #include <btrfs.h>
+#include <squashfs.h>
 #include <asm/io.h>
 #include <div64.h>
 #include <linux/math64.h>
@@ -27,6 +29,21 @@ static int fs_dev_part;
 static disk_partition_t fs_partition;
 static int fs_type = FS_TYPE_ANY;
 
+/*
+ * Filesystem which was mounted by the last probe. This stays mounted while
+ * files opened with fs_open() are open, so that setting the same partition
+ * again does not need to probe it.
+ */
+static struct blk_desc *fs_mnt_desc;
+static int fs_mnt_part;
+static lbaint_t fs_mnt_start;
+static int fs_mnt_type = FS_TYPE_ANY;
+/* The device was written to outside the fs layer, so probe it again */
+static bool fs_mnt_stale;
+static LIST_HEAD(fs_open_files);
+/* Incremented on each change to a filesystem, so open files can be updated */
+static ulong fs_mnt_gen;
+
 static inline int fs_probe_unsupported(struct blk_desc *fs_dev_desc,
 				      disk_partition_t *fs_partition)
 {
@@ -162,8 +179,44 @@ struct fstype_info {
 	int (*unlink)(const char *filename);
 	int (*mkdir)(const char *dirname);
 	int (*ln)(const char *filename, const char *target);
+	/*
+	 * Open the file named by file->name for reading. On success return 0
+	 * with file->size set, and any private state in file->priv. On error
+	 * return -errno. See fs_open().
+	 */
+	int (*open)(struct fs_file *file);
+	/* Read from an open file. On error return -errno. See fs_read_at() */
+	int (*read_at)(struct fs_file *file, void *buf, loff_t offset,
+		       loff_t len, loff_t *actread);
+	/* Free file->priv. This must not access the device */
+	void (*close_file)(struct fs_file *file);
 };
 
+static struct fstype_info *fs_get_info(int fstype);
+
+/* generic implementation of open files in terms of size/read */
+static int fs_open_generic(struct fs_file *file)
+{
+	struct fstype_info *info = fs_get_info(fs_type);
+
+	if (!info->exists(file->name))
+		return -ENOENT;
+
+	return info->size(file->name, &file->size) ? -EIO : 0;
+}
+
+static int fs_read_at_generic(struct fs_file *file, void *buf, loff_t offset,
+			      loff_t len, loff_t *actread)
+{
+	struct fstype_info *info = fs_get_info(fs_type);
+
+	return info->read(file->name, buf, offset, len, actread) ? -EIO : 0;
+}
+
+static void fs_close_file_generic(struct fs_file *file)
+{
+}
+
 static struct fstype_info fstypes[] = {
 #ifdef CONFIG_FS_FAT
 	{
@@ -190,6 +243,9 @@ static struct fstype_info fstypes[] = {
 		.readdir = fat_readdir,
 		.closedir = fat_closedir,
 		.ln = fs_ln_unsupported,
+		.open = fat_open,
+		.read_at = fat_read_at,
+		.close_file = fat_close_file,
 	},
 #endif
 
@@ -215,6 +271,9 @@ static struct fstype_info fstypes[] = {
 		.opendir = fs_opendir_unsupported,
 		.unlink = fs_unlink_unsupported,
 		.mkdir = fs_mkdir_unsupported,
+		.open = fs_open_generic,
+		.read_at = fs_read_at_generic,
+		.close_file = fs_close_file_generic,
 	},
 #endif
 #ifdef CONFIG_SANDBOX
@@ -234,6 +293,9 @@ static struct fstype_info fstypes[] = {
 		.unlink = fs_unlink_unsupported,
 		.mkdir = fs_mkdir_unsupported,
 		.ln = fs_ln_unsupported,
+		.open = fs_open_generic,
+		.read_at = fs_read_at_generic,
+		.close_file = fs_close_file_generic,
 	},
 #endif
 #ifdef CONFIG_CMD_UBIFS
@@ -253,6 +315,9 @@ static struct fstype_info fstypes[] = {
 		.unlink = fs_unlink_unsupported,
 		.mkdir = fs_mkdir_unsupported,
 		.ln = fs_ln_unsupported,
+		.open = fs_open_generic,
+		.read_at = fs_read_at_generic,
+		.close_file = fs_close_file_generic,
 	},
 #endif
 #ifdef CONFIG_FS_BTRFS
@@ -272,6 +337,33 @@ static struct fstype_info fstypes[] = {
 		.unlink = fs_unlink_unsupported,
 		.mkdir = fs_mkdir_unsupported,
 		.ln = fs_ln_unsupported,
+		.open = fs_open_generic,
+		.read_at = fs_read_at_generic,
+		.close_file = fs_close_file_generic,
+	},
+#endif
+#ifdef CONFIG_FS_SQUASHFS
+	{
+		.fstype = FS_TYPE_SQUASHFS,
+		.name = "squashfs",
+		.null_dev_desc_ok = false,
+		.probe = sqfs_probe,
+		.close = sqfs_close,
+		.ls = fs_ls_generic,
+		.exists = sqfs_exists,
+		.size = sqfs_size,
+		.read = sqfs_read,
+		.write = fs_write_unsupported,
+		.uuid = fs_uuid_unsupported,
+		.opendir = sqfs_opendir,
+		.readdir = sqfs_readdir,
+		.closedir = sqfs_closedir,
+		.unlink = fs_unlink_unsupported,
+		.mkdir = fs_mkdir_unsupported,
+		.ln = fs_ln_unsupported,
+		.open = fs_open_generic,
+		.read_at = fs_read_at_generic,
+		.close_file = fs_close_file_generic,
 	},
 #endif
 	{
@@ -290,6 +382,9 @@ static struct fstype_info fstypes[] = {
 		.unlink = fs_unlink_unsupported,
 		.mkdir = fs_mkdir_unsupported,
 		.ln = fs_ln_unsupported,
+		.open = fs_open_generic,
+		.read_at = fs_read_at_generic,
+		.close_file = fs_close_file_generic,
 	},
 };
 
@@ -333,6 +428,96 @@ const char *fs_get_type_name(void)
 	return fs_get_info(fs_type)->name;
 }
 
+/* Close the filesystem mounted by the last probe */
+static void fs_unmount(void)
+{
+	if (fs_mnt_type != FS_TYPE_ANY)
+		fs_get_info(fs_mnt_type)->close();
+	fs_mnt_type = FS_TYPE_ANY;
+	fs_mnt_stale = false;
+}
+
+/**
+ * fs_mount_cached() - use the mounted filesystem if it matches
+ *
+ * This only applies while files are open. If a different filesystem is
+ * mounted it is unmounted, since the drivers can only handle one at a time.
+ *
+ * @desc:	block device wanted
+ * @part:	partition number wanted
+ * @fstype:	filesystem type wanted, or FS_TYPE_ANY
+ * Return:	true if the mounted filesystem is now the current one
+ */
+static bool fs_mount_cached(struct blk_desc *desc, int part, int fstype)
+{
+	/*
+	 * Without open files nothing tracks whether the device is still
+	 * there, so always probe again
+	 */
+	if (list_empty(&fs_open_files))
+		fs_mnt_type = FS_TYPE_ANY;
+	if (fs_mnt_type == FS_TYPE_ANY)
+		return false;
+	if (!fs_mnt_stale && desc == fs_mnt_desc && part == fs_mnt_part &&
+	    (fstype == FS_TYPE_ANY || fstype == fs_mnt_type)) {
+		fs_dev_desc = desc;
+		fs_dev_part = part;
+		fs_type = fs_mnt_type;
+		return true;
+	}
+	fs_unmount();
+
+	return false;
+}
+
+static void fs_set_mounted(struct blk_desc *desc, int part, int fstype)
+{
+	fs_type = fstype;
+	fs_dev_part = part;
+	fs_mnt_desc = desc;
+	fs_mnt_part = part;
+	fs_mnt_start = fs_partition.start;
+	fs_mnt_type = fstype;
+	fs_mnt_stale = false;
+}
+
+void fs_driver_set_blk_dev(struct blk_desc *desc, disk_partition_t *info)
+{
+	if (fs_mnt_type == FS_TYPE_ANY ||
+	    (desc == fs_mnt_desc && info->start == fs_mnt_start))
+		return;
+
+	/*
+	 * The driver now belongs to someone else. It has no state for our
+	 * filesystem left to close, so just forget that it was mounted.
+	 */
+	fs_mnt_type = FS_TYPE_ANY;
+	fs_mnt_stale = false;
+}
+
+void fs_blk_invalidate(struct blk_desc *desc, bool removed)
+{
+	struct fs_file *file;
+
+	list_for_each_entry(file, &fs_open_files, sibling) {
+		if (file->desc != desc)
+			continue;
+		/* Look the file up again before it is next used */
+		fs_mnt_gen++;
+		if (removed)
+			file->removed = true;
+	}
+
+	if (desc != fs_mnt_desc || fs_mnt_type == FS_TYPE_ANY)
+		return;
+	if (removed) {
+		fs_unmount();
+		fs_mnt_desc = NULL;
+	} else {
+		fs_mnt_stale = true;
+	}
+}
+
 int fs_set_blk_dev(const char *ifname, const char *dev_part_str, int fstype)
 {
 	struct fstype_info *info;
@@ -359,6 +544,9 @@ int fs_set_blk_dev(const char *ifname, const char *dev_part_str, int fstype)
 	if (part < 0)
 		return -1;
 
+	if (fs_mount_cached(fs_dev_desc, part, fstype))
+		return 0;
+
 	for (i = 0, info = fstypes; i < ARRAY_SIZE(fstypes); i++, info++) {
 		if (fstype != FS_TYPE_ANY && info->fstype != FS_TYPE_ANY &&
 				fstype != info->fstype)
@@ -368,8 +556,7 @@ int fs_set_blk_dev(const char *ifname, const char *dev_part_str, int fstype)
 			continue;
 
 		if (!info->probe(fs_dev_desc, &fs_partition)) {
-			fs_type = info->fstype;
-			fs_dev_part = part;
+			fs_set_mounted(fs_dev_desc, part, info->fstype);
 			return 0;
 		}
 	}
@@ -383,6 +570,10 @@ int fs_set_blk_dev_with_part(struct blk_desc *desc, int part)
 	struct fstype_info *info;
 	int ret, i;
 
+	/* The partition cannot have changed while it is still mounted */
+	if (fs_mount_cached(desc, part, FS_TYPE_ANY))
+		return 0;
+
 	if (part >= 1)
 		ret = part_get_info(desc, part, &fs_partition);
 	else
@@ -393,8 +584,7 @@ int fs_set_blk_dev_with_part(struct blk_desc *desc, int part)
 
 	for (i = 0, info = fstypes; i < ARRAY_SIZE(fstypes); i++, info++) {
 		if (!info->probe(fs_dev_desc, &fs_partition)) {
-			fs_type = info->fstype;
-			fs_dev_part = part;
+			fs_set_mounted(fs_dev_desc, part, info->fstype);
 			return 0;
 		}
 	}
@@ -404,9 +594,9 @@ int fs_set_blk_dev_with_part(struct blk_desc *desc, int part)
 
 void fs_close(void)
 {
-	struct fstype_info *info = fs_get_info(fs_type);
-
-	info->close();
+	/* Keep the filesystem mounted while there are open files */
+	if (list_empty(&fs_open_files))
+		fs_unmount();
 
 	fs_type = FS_TYPE_ANY;
 }
@@ -458,19 +648,13 @@ int fs_size(const char *filename, loff_t *size)
 }
 
 #ifdef CONFIG_LMB
-/* Check if a file may be read to the given address */
-static int fs_read_lmb_check(const char *filename, ulong addr, loff_t offset,
-			     loff_t len, struct fstype_info *info)
+/* Check if a file of the given size may be read to the given address */
+static int fs_read_lmb_check(ulong addr, loff_t offset, loff_t len,
+			     loff_t size)
 {
 	struct lmb lmb;
-	int ret;
-	loff_t size;
 	loff_t read_len;
 
-	/* get the actual size of the file */
-	ret = info->size(filename, &size);
-	if (ret)
-		return ret;
 	if (offset >= size) {
 		/* offset >= EOF, no bytes will be written */
 		return 0;
@@ -492,21 +676,13 @@ static int fs_read_lmb_check(const char *filename, ulong addr, loff_t offset,
 }
 #endif
 
-static int _fs_read(const char *filename, ulong addr, loff_t offset, loff_t len,
-		    int do_lmb_check, loff_t *actread)
+int fs_read(const char *filename, ulong addr, loff_t offset, loff_t len,
+	    loff_t *actread)
 {
 	struct fstype_info *info = fs_get_info(fs_type);
 	void *buf;
 	int ret;
 
-#ifdef CONFIG_LMB
-	if (do_lmb_check) {
-		ret = fs_read_lmb_check(filename, addr, offset, len, info);
-		if (ret)
-			return ret;
-	}
-#endif
-
 	/*
 	 * We don't actually know how many bytes are being read, since len==0
 	 * means read the whole file.
@@ -523,12 +699,6 @@ static int _fs_read(const char *filename, ulong addr, loff_t offset, loff_t len,
 	return ret;
 }
 
-int fs_read(const char *filename, ulong addr, loff_t offset, loff_t len,
-	    loff_t *actread)
-{
-	return _fs_read(filename, addr, offset, len, 0, actread);
-}
-
 int fs_write(const char *filename, ulong addr, loff_t offset, loff_t len,
 	     loff_t *actwrite)
 {
@@ -536,6 +706,7 @@ int fs_write(const char *filename, ulong addr, loff_t offset, loff_t len,
 	void *buf;
 	int ret;
 
+	fs_mnt_gen++;
 	buf = map_sysmem(addr, len);
 	ret = info->write(filename, buf, offset, len, actwrite);
 	unmap_sysmem(buf);
@@ -601,12 +772,135 @@ void fs_closedir(struct fs_dir_stream *dirs)
 	fs_close();
 }
 
+int fs_open(const char *filename, struct fs_file **filep)
+{
+	struct fstype_info *info = fs_get_info(fs_type);
+	struct fs_file *file;
+	int ret;
+
+	file = calloc(1, sizeof(*file));
+	if (!file) {
+		fs_close();
+		return -ENOMEM;
+	}
+	file->desc = fs_dev_desc;
+	file->part = fs_dev_part;
+	file->fstype = fs_type;
+	file->gen = fs_mnt_gen;
+	file->name = strdup(filename);
+	ret = file->name ? info->open(file) : -ENOMEM;
+	if (ret) {
+		free(file->name);
+		free(file);
+		fs_close();
+		return ret;
+	}
+	list_add_tail(&file->sibling, &fs_open_files);
+	fs_close();
+	*filep = file;
+
+	return 0;
+}
+
+/**
+ * fs_file_mount() - make the filesystem holding an open file current
+ *
+ * This is normally just a check, since the filesystem stays mounted while
+ * there are open files. If the filesystem has been written to, the file is
+ * opened again so that its size and location are up to date.
+ *
+ * @file:	open file
+ * Return:	0 if OK, -ve on error
+ */
+static int fs_file_mount(struct fs_file *file)
+{
+	struct fstype_info *info;
+	int ret;
+
+	if (file->removed)
+		return -ENODEV;
+	if (!fs_mount_cached(file->desc, file->part, file->fstype)) {
+		/* A virtual filesystem cannot be found again from its part */
+		if (!file->desc ||
+		    fs_set_blk_dev_with_part(file->desc, file->part))
+			return -ENODEV;
+		if (fs_type != file->fstype) {
+			fs_close();
+			return -ENODEV;
+		}
+	}
+	if (file->gen == fs_mnt_gen)
+		return 0;
+
+	info = fs_get_info(fs_type);
+	info->close_file(file);
+	file->priv = NULL;
+	ret = info->open(file);
+	if (ret) {
+		fs_close();
+		return ret;
+	}
+	file->gen = fs_mnt_gen;
+
+	return 0;
+}
+
+int fs_read_at(struct fs_file *file, ulong addr, loff_t offset, loff_t len,
+	       loff_t *actread)
+{
+	struct fstype_info *info;
+	void *buf;
+	int ret;
+
+	ret = fs_file_mount(file);
+	if (ret)
+		return ret;
+	info = fs_get_info(fs_type);
+
+	/* len==0 means read the rest of the file, as with fs_read() */
+	buf = map_sysmem(addr, len);
+	ret = info->read_at(file, buf, offset, len, actread);
+	unmap_sysmem(buf);
+	fs_close();
+
+	return ret;
+}
+
+int fs_file_size(struct fs_file *file, loff_t *size)
+{
+	int ret;
+
+	ret = fs_file_mount(file);
+	if (ret)
+		return ret;
+	*size = file->size;
+	fs_close();
+
+	return 0;
+}
+
+void fs_close_file(struct fs_file *file)
+{
+	if (!file)
+		return;
+
+	fs_get_info(file->fstype)->close_file(file);
+	list_del(&file->sibling);
+	free(file->name);
+	free(file);
+
+	/* Unmount once the last file is closed, unless still in use */
+	if (list_empty(&fs_open_files) && fs_type == FS_TYPE_ANY)
+		fs_unmount();
+}
+
 int fs_unlink(const char *filename)
 {
 	int ret;
 
 	struct fstype_info *info = fs_get_info(fs_type);
 
+	fs_mnt_gen++;
 	ret = info->unlink(filename);
 
 	fs_close();
@@ -620,6 +914,7 @@ int fs_mkdir(const char *dirname)
 
 	struct fstype_info *info = fs_get_info(fs_type);
 
+	fs_mnt_gen++;
 	ret = info->mkdir(dirname);
 
 	fs_close();
@@ -632,6 +927,7 @@ int fs_ln(const char *fname, const char *target)
 	struct fstype_info *info = fs_get_info(fs_type);
 	int ret;
 
+	fs_mnt_gen++;
 	ret = info->ln(fname, target);
 
 	if (ret < 0) {
@@ -662,6 +958,44 @@ int do_size(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[],
 	return 0;
 }
 
+/**
+ * fs_load_file() - load a file for the load command
+ *
+ * The file is opened once, so it is only looked up once for the memory
+ * reservation check and the read.
+ *
+ * @filename:	full path of the file to read from
+ * @addr:	address of the buffer to write to
+ * @offset:	offset in the file from where to start reading
+ * @len:	the number of bytes to read. Use 0 to read the rest of the file
+ * @actread:	returns the actual number of bytes read
+ * Return:	0 if OK with valid *actread, -ve on error
+ */
+static int fs_load_file(const char *filename, ulong addr, loff_t offset,
+			loff_t len, loff_t *actread)
+{
+	struct fs_file *file;
+	int ret;
+
+	ret = fs_open(filename, &file);
+	if (ret) {
+		printf("** Unable to read file %s **\n", filename);
+		return ret;
+	}
+#ifdef CONFIG_LMB
+	ret = fs_read_lmb_check(addr, offset, len, file->size);
+	if (!ret)
+#endif
+		ret = fs_read_at(file, addr, offset, len, actread);
+	fs_close_file(file);
+
+	/* If we requested a specific number of bytes, check we got it */
+	if (ret == 0 && len && *actread != len)
+		debug("** %s shorter than offset + len **\n", filename);
+
+	return ret;
+}
+
 int do_load(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[],
 		int fstype)
 {
@@ -717,7 +1051,7 @@ int do_load(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[],
 			(argc > 4) ? argv[4] : "");
 #endif
 	time = get_timer(0);
-	ret = _fs_read(filename, addr, pos, bytes, 1, &len_read);
+	ret = fs_load_file(filename, addr, pos, bytes, &len_read);
 	time = get_timer(time);
 	if (ret < 0)
 		return 1;
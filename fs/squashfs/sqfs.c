@@ -0,0 +1,924 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * SquashFS filesystem implementation for U-Boot
+ *
+ * This is a read-only driver for SquashFS 4.0 images. Inodes, directories
+ * and the fragment table are kept in compressed metadata blocks, and the
+ * tails of small files are packed together into compressed fragment blocks.
+ * Looking up a path or reading a few small files would decompress the same
+ * blocks again and again, so both kinds of block are kept in small LRU
+ * caches while the filesystem is mounted.
+ */
+
+#include <common.h>
+#include <errno.h>
+#include <fs.h>
+#include <fs_internal.h>
+#include <malloc.h>
+#include <memalign.h>
+#include <squashfs.h>
+#include <linux/kernel.h>
+
+#include "sqfs_decompressor.h"
+#include "sqfs_filesystem.h"
+
+/* Most symbolic links followed while looking up a path */
+#define SQFS_MAX_SYMLINKS	8
+
+/* Longest symbolic link target accepted, as with PATH_MAX in Linux */
+#define SQFS_MAX_SYMLINK_LEN	4096
+
+/* Cache entry not holding a block */
+#define SQFS_CACHE_EMPTY	(~0ULL)
+
+/**
+ * struct sqfs_cache_entry - A decompressed block
+ *
+ * @addr: Disk address of the block, or SQFS_CACHE_EMPTY
+ * @next: Disk address of the following block, for metadata blocks
+ * @len: Number of bytes in @data
+ * @used: Value of the cache's @stamp when the block was last used
+ * @data: Decompressed block
+ */
+struct sqfs_cache_entry {
+	u64 addr;
+	u64 next;
+	u32 len;
+	u32 used;
+	u8 *data;
+};
+
+/**
+ * struct sqfs_cache - Cache of decompressed blocks, replaced in LRU order
+ *
+ * @entries: Cache entries
+ * @count: Number of entries
+ * @stamp: Incremented on each lookup
+ */
+struct sqfs_cache {
+	struct sqfs_cache_entry *entries;
+	int count;
+	u32 stamp;
+};
+
+/**
+ * struct sqfs_meta_pos - Position in a metadata table
+ *
+ * @block: Disk address of the metadata block
+ * @offset: Offset in the decompressed block, which may be past its end if
+ *	the position is in a following block
+ */
+struct sqfs_meta_pos {
+	u64 block;
+	u32 offset;
+};
+
+/**
+ * struct sqfs_inode - Information from an inode, whatever its type
+ *
+ * @type: Inode type (enum sqfs_inode_type), basic or extended
+ * @size: File size, directory listing size or symlink target length
+ * @start: First data block of a file, or directory listing block offset
+ * @offset: Offset of a file in its fragment, or of a directory listing in
+ *	its block
+ * @fragment: Fragment index of a file, or SQFS_NO_FRAGMENT
+ * @pos: Position of the data which follows the inode: the data block sizes
+ *	of a file or the target of a symlink
+ */
+struct sqfs_inode {
+	u16 type;
+	u64 size;
+	u64 start;
+	u32 offset;
+	u32 fragment;
+	struct sqfs_meta_pos pos;
+};
+
+/**
+ * struct sqfs_dir_pos - Position in a directory listing
+ *
+ * @pos: Position in the directory table
+ * @remaining: Bytes of the listing left to read
+ * @count: Entries left under the current header
+ * @start_block: Inode block of the entries under the current header
+ */
+struct sqfs_dir_pos {
+	struct sqfs_meta_pos pos;
+	u32 remaining;
+	u32 count;
+	u32 start_block;
+};
+
+struct sqfs_dir_stream {
+	struct fs_dir_stream fs_dirs;
+	struct fs_dirent dirent;
+	struct sqfs_dir_pos dir;
+};
+
+static struct squashfs_ctxt {
+	struct blk_desc *cur_dev;
+	disk_partition_t cur_part_info;
+	struct sqfs_super_block sblk;
+	u32 block_size;
+	u16 block_log;
+	u16 comp;
+	/* Disk addresses of the metadata blocks of the fragment table */
+	u64 *frag_index;
+	struct sqfs_cache meta_cache;
+	/* Fragments, and data blocks which are only partly read */
+	struct sqfs_cache frag_cache;
+	/* Compressed data, read from disk before decompressing */
+	u8 *cbuf;
+} ctxt;
+
+static int sqfs_disk_read(u64 addr, u32 len, void *buf)
+{
+	lbaint_t sector = addr >> ctxt.cur_dev->log2blksz;
+	int offset = addr & (ctxt.cur_dev->blksz - 1);
+
+	if (!fs_devread(ctxt.cur_dev, &ctxt.cur_part_info, sector, offset, len,
+			buf))
+		return -EIO;
+
+	return 0;
+}
+
+/**
+ * sqfs_read_block() - Read a block and decompress it if needed
+ *
+ * @addr: Disk address of the block
+ * @size: Number of bytes of the block on disk
+ * @compressed: true if the block is compressed
+ * @dest: Destination buffer
+ * @dest_len: Size of @dest, updated to the number of bytes in the block
+ * @return 0 if OK, -ve on error
+ */
+static int sqfs_read_block(u64 addr, u32 size, bool compressed, void *dest,
+			   u32 *dest_len)
+{
+	int ret;
+
+	if (!compressed) {
+		if (size > *dest_len)
+			return -EIO;
+		*dest_len = size;
+		return sqfs_disk_read(addr, size, dest);
+	}
+
+	if (size > max_t(u32, ctxt.block_size, SQFS_METADATA_SIZE))
+		return -EIO;
+	ret = sqfs_disk_read(addr, size, ctxt.cbuf);
+	if (ret)
+		return ret;
+	ret = sqfs_decompress(ctxt.comp, dest, dest_len, ctxt.cbuf, size);
+	if (ret)
+		printf("SquashFS: cannot decompress block at %llx\n", addr);
+
+	return ret;
+}
+
+static int sqfs_cache_init(struct sqfs_cache *cache, int count, u32 size)
+{
+	int i;
+
+	cache->entries = calloc(count, sizeof(*cache->entries));
+	if (!cache->entries)
+		return -ENOMEM;
+	cache->count = count;
+	cache->stamp = 0;
+	for (i = 0; i < count; i++) {
+		cache->entries[i].addr = SQFS_CACHE_EMPTY;
+		cache->entries[i].data = malloc(size);
+		if (!cache->entries[i].data)
+			return -ENOMEM;
+	}
+
+	return 0;
+}
+
+static void sqfs_cache_free(struct sqfs_cache *cache)
+{
+	int i;
+
+	for (i = 0; cache->entries && i < cache->count; i++)
+		free(cache->entries[i].data);
+	free(cache->entries);
+	cache->entries = NULL;
+	cache->count = 0;
+}
+
+/**
+ * sqfs_cache_find() - Look up a block in a cache
+ *
+ * If the block is not cached, the least recently used entry is returned
+ * instead, with @addr set to SQFS_CACHE_EMPTY, for the caller to fill in.
+ *
+ * @cache: Cache to look in
+ * @addr: Disk address of the block
+ * @return cache entry
+ */
+static struct sqfs_cache_entry *sqfs_cache_find(struct sqfs_cache *cache,
+						u64 addr)
+{
+	struct sqfs_cache_entry *entry, *lru = NULL;
+	int i;
+
+	cache->stamp++;
+	for (i = 0; i < cache->count; i++) {
+		entry = &cache->entries[i];
+		if (entry->addr == addr) {
+			entry->used = cache->stamp;
+			return entry;
+		}
+		if (!lru || entry->addr == SQFS_CACHE_EMPTY ||
+		    (lru->addr != SQFS_CACHE_EMPTY &&
+		     cache->stamp - entry->used > cache->stamp - lru->used))
+			lru = entry;
+	}
+	lru->addr = SQFS_CACHE_EMPTY;
+	lru->used = cache->stamp;
+
+	return lru;
+}
+
+/* Get a metadata block, which starts with a header giving its size */
+static int sqfs_get_meta_block(u64 addr, struct sqfs_cache_entry **entryp)
+{
+	struct sqfs_cache_entry *entry;
+	__le16 header;
+	u16 size;
+	int ret;
+
+	entry = sqfs_cache_find(&ctxt.meta_cache, addr);
+	if (entry->addr != addr) {
+		ret = sqfs_disk_read(addr, sizeof(header), &header);
+		if (ret)
+			return ret;
+		size = le16_to_cpu(header) & SQFS_METADATA_SIZE_MASK;
+		entry->len = SQFS_METADATA_SIZE;
+		ret = sqfs_read_block(addr + sizeof(header), size,
+				      !(le16_to_cpu(header) &
+					SQFS_METADATA_UNCOMPRESSED),
+				      entry->data, &entry->len);
+		if (ret)
+			return ret;
+		entry->next = addr + sizeof(header) + size;
+		entry->addr = addr;
+	}
+	*entryp = entry;
+
+	return 0;
+}
+
+/* Get a fragment or data block, given the size from its block list */
+static int sqfs_get_data_block(u64 addr, u32 size,
+			       struct sqfs_cache_entry **entryp)
+{
+	struct sqfs_cache_entry *entry;
+	int ret;
+
+	entry = sqfs_cache_find(&ctxt.frag_cache, addr);
+	if (entry->addr != addr) {
+		entry->len = ctxt.block_size;
+		ret = sqfs_read_block(addr, size & SQFS_BLOCK_SIZE_MASK,
+				      !(size & SQFS_BLOCK_UNCOMPRESSED),
+				      entry->data, &entry->len);
+		if (ret)
+			return ret;
+		entry->addr = addr;
+	}
+	*entryp = entry;
+
+	return 0;
+}
+
+/**
+ * sqfs_meta_read() - Read from a metadata table
+ *
+ * @pos: Position to read from, updated to follow the data read
+ * @buf: Buffer for the data
+ * @len: Number of bytes to read
+ * @return 0 if OK, -ve on error
+ */
+static int sqfs_meta_read(struct sqfs_meta_pos *pos, void *buf, u32 len)
+{
+	struct sqfs_cache_entry *entry;
+	u32 count;
+	int ret;
+
+	while (len) {
+		ret = sqfs_get_meta_block(pos->block, &entry);
+		if (ret)
+			return ret;
+		if (pos->offset >= entry->len) {
+			if (!entry->len)
+				return -EIO;
+			pos->offset -= entry->len;
+			pos->block = entry->next;
+			continue;
+		}
+		count = min(len, entry->len - pos->offset);
+		memcpy(buf, entry->data + pos->offset, count);
+		buf += count;
+		len -= count;
+		pos->offset += count;
+	}
+
+	return 0;
+}
+
+/**
+ * sqfs_read_inode() - Read an inode
+ *
+ * @ref: Inode reference, relative to the inode table
+ * @inode: Returns information from the inode
+ * @return 0 if OK, -ve on error
+ */
+static int sqfs_read_inode(u64 ref, struct sqfs_inode *inode)
+{
+	union {
+		struct sqfs_base_inode base;
+		struct sqfs_dir_inode dir;
+		struct sqfs_ldir_inode ldir;
+		struct sqfs_reg_inode reg;
+		struct sqfs_lreg_inode lreg;
+		struct sqfs_symlink_inode symlink;
+	} i;
+	struct sqfs_meta_pos *pos = &inode->pos;
+	size_t size;
+	int ret;
+
+	pos->block = le64_to_cpu(ctxt.sblk.inode_table_start) +
+		     SQFS_REF_BLOCK(ref);
+	pos->offset = SQFS_REF_OFFSET(ref);
+	ret = sqfs_meta_read(pos, &i.base, sizeof(i.base));
+	if (ret)
+		return ret;
+
+	memset(inode, '\0', sizeof(*inode) - sizeof(*pos));
+	inode->type = le16_to_cpu(i.base.inode_type);
+	inode->fragment = SQFS_NO_FRAGMENT;
+	switch (inode->type) {
+	case SQFS_DIR_TYPE:
+		size = sizeof(i.dir);
+		break;
+	case SQFS_LDIR_TYPE:
+		size = sizeof(i.ldir);
+		break;
+	case SQFS_REG_TYPE:
+		size = sizeof(i.reg);
+		break;
+	case SQFS_LREG_TYPE:
+		size = sizeof(i.lreg);
+		break;
+	case SQFS_SYMLINK_TYPE:
+	case SQFS_LSYMLINK_TYPE:
+		size = sizeof(i.symlink);
+		break;
+	default:
+		/* Nothing else has any data to read */
+		if (inode->type < SQFS_DIR_TYPE ||
+		    inode->type > SQFS_LSOCKET_TYPE)
+			return -EIO;
+		return 0;
+	}
+	ret = sqfs_meta_read(pos, (void *)&i + sizeof(i.base),
+			     size - sizeof(i.base));
+	if (ret)
+		return ret;
+
+	switch (inode->type) {
+	case SQFS_DIR_TYPE:
+		inode->size = le16_to_cpu(i.dir.file_size);
+		inode->start = le32_to_cpu(i.dir.start_block);
+		inode->offset = le16_to_cpu(i.dir.offset);
+		break;
+	case SQFS_LDIR_TYPE:
+		inode->size = le32_to_cpu(i.ldir.file_size);
+		inode->start = le32_to_cpu(i.ldir.start_block);
+		inode->offset = le16_to_cpu(i.ldir.offset);
+		break;
+	case SQFS_REG_TYPE:
+		inode->size = le32_to_cpu(i.reg.file_size);
+		inode->start = le32_to_cpu(i.reg.start_block);
+		inode->offset = le32_to_cpu(i.reg.offset);
+		inode->fragment = le32_to_cpu(i.reg.fragment);
+		break;
+	case SQFS_LREG_TYPE:
+		inode->size = le64_to_cpu(i.lreg.file_size);
+		inode->start = le64_to_cpu(i.lreg.start_block);
+		inode->offset = le32_to_cpu(i.lreg.offset);
+		inode->fragment = le32_to_cpu(i.lreg.fragment);
+		break;
+	default:
+		inode->size = le32_to_cpu(i.symlink.symlink_size);
+		break;
+	}
+
+	return 0;
+}
+
+static bool sqfs_is_dir(struct sqfs_inode *inode)
+{
+	return inode->type == SQFS_DIR_TYPE || inode->type == SQFS_LDIR_TYPE;
+}
+
+static bool sqfs_is_reg(struct sqfs_inode *inode)
+{
+	return inode->type == SQFS_REG_TYPE || inode->type == SQFS_LREG_TYPE;
+}
+
+static bool sqfs_is_symlink(struct sqfs_inode *inode)
+{
+	return inode->type == SQFS_SYMLINK_TYPE ||
+	       inode->type == SQFS_LSYMLINK_TYPE;
+}
+
+static void sqfs_dir_start(struct sqfs_inode *inode, struct sqfs_dir_pos *dir)
+{
+	dir->pos.block = le64_to_cpu(ctxt.sblk.directory_table_start) +
+			 inode->start;
+	dir->pos.offset = inode->offset;
+	dir->remaining = inode->size > SQFS_DIR_EMPTY_SIZE ?
+			 inode->size - SQFS_DIR_EMPTY_SIZE : 0;
+	dir->count = 0;
+}
+
+/**
+ * sqfs_dir_next() - Read the next entry of a directory listing
+ *
+ * @dir: Position in the listing
+ * @name: Returns the name of the entry, nul-terminated (256 bytes)
+ * @type: Returns the inode type of the entry
+ * @ref: Returns the inode reference of the entry
+ * @return 0 if OK, -ENOENT at the end of the listing, other -ve on error
+ */
+static int sqfs_dir_next(struct sqfs_dir_pos *dir, char *name, u16 *type,
+			 u64 *ref)
+{
+	struct sqfs_dir_header header;
+	struct sqfs_dir_entry entry;
+	u32 len;
+	int ret;
+
+	if (!dir->count) {
+		if (dir->remaining < sizeof(header))
+			return -ENOENT;
+		ret = sqfs_meta_read(&dir->pos, &header, sizeof(header));
+		if (ret)
+			return ret;
+		dir->remaining -= sizeof(header);
+		dir->count = le32_to_cpu(header.count) + 1;
+		dir->start_block = le32_to_cpu(header.start_block);
+	}
+
+	if (dir->remaining < sizeof(entry))
+		return -EIO;
+	ret = sqfs_meta_read(&dir->pos, &entry, sizeof(entry));
+	if (ret)
+		return ret;
+	len = le16_to_cpu(entry.size) + 1;
+	if (len >= sizeof(((struct fs_dirent *)0)->name) ||
+	    dir->remaining < sizeof(entry) + len)
+		return -EIO;
+	ret = sqfs_meta_read(&dir->pos, name, len);
+	if (ret)
+		return ret;
+	name[len] = '\0';
+	dir->remaining -= sizeof(entry) + len;
+	dir->count--;
+
+	*type = le16_to_cpu(entry.type);
+	*ref = ((u64)dir->start_block << 16) | le16_to_cpu(entry.offset);
+
+	return 0;
+}
+
+/* Find an entry in a directory, whose entries are sorted by name */
+static int sqfs_dir_lookup(struct sqfs_inode *dir_inode, const char *name,
+			   u32 name_len, u64 *ref)
+{
+	struct sqfs_dir_pos dir;
+	char ent[256];
+	u16 type;
+	int cmp, ret;
+
+	sqfs_dir_start(dir_inode, &dir);
+	while (!(ret = sqfs_dir_next(&dir, ent, &type, ref))) {
+		cmp = strncmp(ent, name, name_len);
+		if (!cmp && !ent[name_len])
+			return 0;
+		if (cmp > 0)
+			break;
+	}
+
+	return ret == -ENOENT || !ret ? -ENOENT : ret;
+}
+
+/**
+ * sqfs_lookup() - Find the inode of a path, following symlinks
+ *
+ * @filename: Absolute path
+ * @inode: Returns the inode
+ * @return 0 if OK, -ENOENT if not found, -ENOTDIR if a directory in the path
+ *	is not one, -ELOOP on too many symlinks, -ENAMETOOLONG if a symlink
+ *	target is too long, other -ve on error
+ */
+static int sqfs_lookup(const char *filename, struct sqfs_inode *inode)
+{
+	u64 *refs, *new_refs;
+	int depth = 0, max_depth = 16, links = 0;
+	char *path, *new_path, *p;
+	size_t rest;
+	u32 len;
+	int ret;
+
+	path = strdup(filename);
+	refs = malloc(max_depth * sizeof(*refs));
+	if (!path || !refs) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	/* refs[] holds the directories from the root to the current one */
+	refs[0] = le64_to_cpu(ctxt.sblk.root_inode);
+	ret = sqfs_read_inode(refs[0], inode);
+	p = path;
+	while (!ret) {
+		while (*p == '/')
+			p++;
+		if (!*p)
+			break;
+		len = strchrnul(p, '/') - p;
+		if (!sqfs_is_dir(inode)) {
+			ret = -ENOTDIR;
+			break;
+		}
+
+		if (len == 1 && *p == '.') {
+			p += len;
+			continue;
+		}
+		if (len == 2 && !strncmp(p, "..", 2)) {
+			if (depth)
+				depth--;
+			ret = sqfs_read_inode(refs[depth], inode);
+			p += len;
+			continue;
+		}
+
+		if (depth + 1 == max_depth) {
+			max_depth *= 2;
+			new_refs = realloc(refs, max_depth * sizeof(*refs));
+			if (!new_refs) {
+				ret = -ENOMEM;
+				break;
+			}
+			refs = new_refs;
+		}
+		ret = sqfs_dir_lookup(inode, p, len, &refs[depth + 1]);
+		if (!ret)
+			ret = sqfs_read_inode(refs[depth + 1], inode);
+		if (ret)
+			break;
+		p += len;
+
+		if (!sqfs_is_symlink(inode)) {
+			depth++;
+			continue;
+		}
+
+		/* Carry on from the target, in the directory holding the link */
+		if (++links > SQFS_MAX_SYMLINKS) {
+			ret = -ELOOP;
+			break;
+		}
+		/* The size comes from the image, so do not trust it */
+		rest = strlen(p);
+		if (inode->size > SQFS_MAX_SYMLINK_LEN ||
+		    rest > SIZE_MAX - SQFS_MAX_SYMLINK_LEN - 1) {
+			ret = -ENAMETOOLONG;
+			break;
+		}
+		new_path = malloc(inode->size + rest + 1);
+		if (!new_path) {
+			ret = -ENOMEM;
+			break;
+		}
+		ret = sqfs_meta_read(&inode->pos, new_path, inode->size);
+		if (ret) {
+			free(new_path);
+			break;
+		}
+		strcpy(new_path + inode->size, p);
+		free(path);
+		path = new_path;
+		p = path;
+		if (*p == '/')
+			depth = 0;
+		ret = sqfs_read_inode(refs[depth], inode);
+	}
+
+out:
+	free(refs);
+	free(path);
+
+	return ret;
+}
+
+/**
+ * sqfs_read_fragment() - Read from the fragment holding the tail of a file
+ *
+ * @inode: File inode
+ * @offset: Offset in the tail
+ * @len: Number of bytes to read
+ * @buf: Buffer for the data
+ * @return 0 if OK, -ve on error
+ */
+static int sqfs_read_fragment(struct sqfs_inode *inode, u32 offset, u32 len,
+			      void *buf)
+{
+	struct sqfs_fragment_entry frag;
+	struct sqfs_cache_entry *entry;
+	struct sqfs_meta_pos pos;
+	u32 index = inode->fragment;
+	int ret;
+
+	if (index >= le32_to_cpu(ctxt.sblk.fragments))
+		return -EIO;
+	pos.block = ctxt.frag_index[index / SQFS_FRAGMENTS_PER_BLOCK];
+	pos.offset = index % SQFS_FRAGMENTS_PER_BLOCK * sizeof(frag);
+	ret = sqfs_meta_read(&pos, &frag, sizeof(frag));
+	if (ret)
+		return ret;
+
+	ret = sqfs_get_data_block(le64_to_cpu(frag.start),
+				  le32_to_cpu(frag.size), &entry);
+	if (ret)
+		return ret;
+	offset += inode->offset;
+	if (offset > entry->len || len > entry->len - offset)
+		return -EIO;
+	memcpy(buf, entry->data + offset, len);
+
+	return 0;
+}
+
+int sqfs_read(const char *filename, void *buf, loff_t offset, loff_t len,
+	      loff_t *actread)
+{
+	struct sqfs_cache_entry *entry;
+	struct sqfs_inode inode;
+	u64 addr, pos, end, block_end;
+	u32 nblocks, i, size, count;
+	__le32 block_size;
+	int ret;
+
+	*actread = 0;
+	ret = sqfs_lookup(filename, &inode);
+	if (ret)
+		return ret;
+	if (!sqfs_is_reg(&inode))
+		return -EISDIR;
+	if (offset >= inode.size)
+		return 0;
+	if (!len || len > inode.size - offset)
+		len = inode.size - offset;
+	end = offset + len;
+
+	/* Data blocks, then the tail of the file in a fragment if it has one */
+	nblocks = (inode.size + ctxt.block_size - 1) >> ctxt.block_log;
+	if (inode.fragment != SQFS_NO_FRAGMENT)
+		nblocks = inode.size >> ctxt.block_log;
+
+	addr = inode.start;
+	pos = 0;
+	for (i = 0; i < nblocks && pos < end; i++, pos = block_end) {
+		ret = sqfs_meta_read(&inode.pos, &block_size,
+				     sizeof(block_size));
+		if (ret)
+			return ret;
+		size = le32_to_cpu(block_size);
+		block_end = min(pos + ctxt.block_size, (u64)inode.size);
+		if (block_end <= offset) {
+			addr += size & SQFS_BLOCK_SIZE_MASK;
+			continue;
+		}
+
+		if (!size) {
+			/* Sparse block */
+			count = min(block_end, end) - max(pos, (u64)offset);
+			memset(buf + max(pos, (u64)offset) - offset, '\0',
+			       count);
+		} else if (pos >= offset && block_end <= end) {
+			/* All of the block is wanted, so skip the cache */
+			count = block_end - pos;
+			ret = sqfs_read_block(addr,
+					      size & SQFS_BLOCK_SIZE_MASK,
+					      !(size & SQFS_BLOCK_UNCOMPRESSED),
+					      buf + pos - offset, &count);
+			if (ret)
+				return ret;
+			if (count != block_end - pos)
+				return -EIO;
+		} else {
+			ret = sqfs_get_data_block(addr, size, &entry);
+			if (ret)
+				return ret;
+			if (entry->len != block_end - pos)
+				return -EIO;
+			count = min(block_end, end) - max(pos, (u64)offset);
+			memcpy(buf + max(pos, (u64)offset) - offset,
+			       entry->data + max(pos, (u64)offset) - pos,
+			       count);
+		}
+		*actread += count;
+		addr += size & SQFS_BLOCK_SIZE_MASK;
+	}
+
+	if (pos < end) {
+		pos = max(pos, (u64)offset);
+		ret = sqfs_read_fragment(&inode,
+					 pos - (u64)nblocks * ctxt.block_size,
+					 end - pos, buf + pos - offset);
+		if (ret)
+			return ret;
+		*actread += end - pos;
+	}
+
+	return 0;
+}
+
+int sqfs_size(const char *filename, loff_t *size)
+{
+	struct sqfs_inode inode;
+	int ret;
+
+	ret = sqfs_lookup(filename, &inode);
+	if (ret)
+		return ret;
+	*size = inode.size;
+
+	return 0;
+}
+
+int sqfs_exists(const char *filename)
+{
+	struct sqfs_inode inode;
+
+	return !sqfs_lookup(filename, &inode);
+}
+
+int sqfs_opendir(const char *filename, struct fs_dir_stream **dirsp)
+{
+	struct sqfs_dir_stream *dirs;
+	struct sqfs_inode inode;
+	int ret;
+
+	ret = sqfs_lookup(filename, &inode);
+	if (ret)
+		return ret;
+	if (!sqfs_is_dir(&inode))
+		return -ENOTDIR;
+
+	dirs = calloc(1, sizeof(*dirs));
+	if (!dirs)
+		return -ENOMEM;
+	sqfs_dir_start(&inode, &dirs->dir);
+	*dirsp = &dirs->fs_dirs;
+
+	return 0;
+}
+
+int sqfs_readdir(struct fs_dir_stream *fs_dirs, struct fs_dirent **dentp)
+{
+	struct sqfs_dir_stream *dirs;
+	struct fs_dirent *dent;
+	struct sqfs_inode inode;
+	u16 type;
+	u64 ref;
+	int ret;
+
+	dirs = container_of(fs_dirs, struct sqfs_dir_stream, fs_dirs);
+	dent = &dirs->dirent;
+	memset(dent, '\0', sizeof(*dent));
+	ret = sqfs_dir_next(&dirs->dir, dent->name, &type, &ref);
+	if (ret)
+		return ret;
+
+	switch (type) {
+	case SQFS_DIR_TYPE:
+		dent->type = FS_DT_DIR;
+		break;
+	case SQFS_SYMLINK_TYPE:
+		dent->type = FS_DT_LNK;
+		break;
+	default:
+		dent->type = FS_DT_REG;
+		break;
+	}
+	if (type != SQFS_DIR_TYPE) {
+		ret = sqfs_read_inode(ref, &inode);
+		if (ret)
+			return ret;
+		if (sqfs_is_reg(&inode) || sqfs_is_symlink(&inode))
+			dent->size = inode.size;
+	}
+	*dentp = dent;
+
+	return 0;
+}
+
+void sqfs_closedir(struct fs_dir_stream *fs_dirs)
+{
+	free(container_of(fs_dirs, struct sqfs_dir_stream, fs_dirs));
+}
+
+int sqfs_probe(struct blk_desc *fs_dev_desc, disk_partition_t *fs_partition)
+{
+	ALLOC_CACHE_ALIGN_BUFFER(u8, buf, fs_dev_desc->blksz);
+	struct sqfs_super_block *sblk;
+	u32 frags, index_size;
+	u16 block_log;
+	int ret;
+
+	ctxt.cur_dev = fs_dev_desc;
+	ctxt.cur_part_info = *fs_partition;
+	if (fs_dev_desc->blksz < sizeof(*sblk) ||
+	    sqfs_disk_read(0, fs_dev_desc->blksz, buf))
+		return -EIO;
+
+	sblk = (struct sqfs_super_block *)buf;
+	if (le32_to_cpu(sblk->s_magic) != SQFS_MAGIC)
+		return -EINVAL;
+	if (le16_to_cpu(sblk->s_major) != SQFS_MAJOR) {
+		printf("SquashFS: version %u is not supported\n",
+		       le16_to_cpu(sblk->s_major));
+		return -EINVAL;
+	}
+	block_log = le16_to_cpu(sblk->block_log);
+	if (block_log < 12 || block_log > 20 ||
+	    le32_to_cpu(sblk->block_size) != 1 << block_log) {
+		printf("SquashFS: bad block size\n");
+		return -EINVAL;
+	}
+	memcpy(&ctxt.sblk, sblk, sizeof(*sblk));
+	ctxt.block_size = 1 << block_log;
+	ctxt.block_log = block_log;
+	ctxt.comp = le16_to_cpu(sblk->compression);
+
+	ret = sqfs_decompressor_init(ctxt.comp);
+	if (ret)
+		return ret;
+
+	/* Compressed metadata blocks may be larger than the smallest blocks */
+	ctxt.cbuf = malloc(max_t(u32, ctxt.block_size, SQFS_METADATA_SIZE));
+	ret = ctxt.cbuf ? 0 : -ENOMEM;
+	if (!ret)
+		ret = sqfs_cache_init(&ctxt.meta_cache,
+				      CONFIG_FS_SQUASHFS_META_CACHE,
+				      SQFS_METADATA_SIZE);
+	if (!ret)
+		ret = sqfs_cache_init(&ctxt.frag_cache,
+				      CONFIG_FS_SQUASHFS_FRAG_CACHE,
+				      ctxt.block_size);
+	if (ret)
+		goto err;
+
+	/* The fragment table is located by a list of its metadata blocks */
+	frags = le32_to_cpu(sblk->fragments);
+	if (frags) {
+		index_size = DIV_ROUND_UP(frags, SQFS_FRAGMENTS_PER_BLOCK) *
+			     sizeof(u64);
+		ctxt.frag_index = malloc(index_size);
+		if (!ctxt.frag_index) {
+			ret = -ENOMEM;
+			goto err;
+		}
+		ret = sqfs_disk_read(le64_to_cpu(sblk->fragment_table_start),
+				     index_size, ctxt.frag_index);
+		if (ret)
+			goto err;
+		for (index_size /= sizeof(u64); index_size--; )
+			ctxt.frag_index[index_size] =
+				le64_to_cpu(ctxt.frag_index[index_size]);
+	}
+
+	return 0;
+
+err:
+	sqfs_close();
+
+	return ret;
+}
+
+void sqfs_close(void)
+{
+	sqfs_cache_free(&ctxt.meta_cache);
+	sqfs_cache_free(&ctxt.frag_cache);
+	free(ctxt.frag_index);
+	ctxt.frag_index = NULL;
+	free(ctxt.cbuf);
+	ctxt.cbuf = NULL;
+	sqfs_decompressor_cleanup();
+}
@@ -0,0 +1,121 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * SquashFS filesystem implementation for U-Boot
+ *
+ * Each block is compressed on its own, so this just hands it to the
+ * matching decompressor in lib/.
+ */
+
+#include <common.h>
+#include <errno.h>
+#include <lz4.h>
+#include <malloc.h>
+#include <linux/lzo.h>
+#include <linux/zstd.h>
+#include <u-boot/zlib.h>
+
+#include "sqfs_decompressor.h"
+#include "sqfs_filesystem.h"
+
+#ifdef CONFIG_ZSTD
+static void *sqfs_zstd_workspace;
+#endif
+
+int sqfs_decompressor_init(u16 comp)
+{
+	switch (comp) {
+	case SQFS_COMP_ZLIB:
+		return 0;
+#ifdef CONFIG_LZO
+	case SQFS_COMP_LZO:
+		return 0;
+#endif
+#ifdef CONFIG_LZ4
+	case SQFS_COMP_LZ4:
+		return 0;
+#endif
+#ifdef CONFIG_ZSTD
+	case SQFS_COMP_ZSTD:
+		if (!sqfs_zstd_workspace)
+			sqfs_zstd_workspace = malloc(ZSTD_DCtxWorkspaceBound());
+		return sqfs_zstd_workspace ? 0 : -ENOMEM;
+#endif
+	default:
+		printf("SquashFS: compression type %u is not supported\n",
+		       comp);
+		return -EPROTONOSUPPORT;
+	}
+}
+
+static int sqfs_decompress_zlib(void *dest, u32 *dest_len, const void *src,
+				u32 src_len)
+{
+	z_stream stream;
+	int ret;
+
+	memset(&stream, '\0', sizeof(stream));
+	stream.next_in = (void *)src;
+	stream.avail_in = src_len;
+	stream.next_out = dest;
+	stream.avail_out = *dest_len;
+
+	if (inflateInit(&stream) != Z_OK)
+		return -EIO;
+	ret = inflate(&stream, Z_FINISH);
+	*dest_len = stream.total_out;
+	inflateEnd(&stream);
+
+	return ret == Z_STREAM_END ? 0 : -EIO;
+}
+
+int sqfs_decompress(u16 comp, void *dest, u32 *dest_len, const void *src,
+		    u32 src_len)
+{
+	__maybe_unused size_t len;
+	__maybe_unused int ret;
+
+	switch (comp) {
+	case SQFS_COMP_ZLIB:
+		return sqfs_decompress_zlib(dest, dest_len, src, src_len);
+#ifdef CONFIG_LZO
+	case SQFS_COMP_LZO:
+		len = *dest_len;
+		ret = lzo1x_decompress_safe(src, src_len, dest, &len);
+		*dest_len = len;
+		return ret == LZO_E_OK ? 0 : -EIO;
+#endif
+#ifdef CONFIG_LZ4
+	case SQFS_COMP_LZ4:
+		ret = LZ4_decompress_safe(src, dest, src_len, *dest_len);
+		if (ret < 0)
+			return -EIO;
+		*dest_len = ret;
+		return 0;
+#endif
+#ifdef CONFIG_ZSTD
+	case SQFS_COMP_ZSTD: {
+		ZSTD_DCtx *ctx;
+
+		ctx = ZSTD_initDCtx(sqfs_zstd_workspace,
+				    ZSTD_DCtxWorkspaceBound());
+		if (!ctx)
+			return -EIO;
+		len = ZSTD_decompressDCtx(ctx, dest, *dest_len, src, src_len);
+		if (ZSTD_isError(len))
+			return -EIO;
+		*dest_len = len;
+		return 0;
+	}
+#endif
+	default:
+		return -EPROTONOSUPPORT;
+	}
+}
+
+void sqfs_decompressor_cleanup(void)
+{
+#ifdef CONFIG_ZSTD
+	free(sqfs_zstd_workspace);
+	sqfs_zstd_workspace = NULL;
+#endif
+}
@@ -0,0 +1,38 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * SquashFS filesystem implementation for U-Boot
+ */
+
+#ifndef __SQFS_DECOMPRESSOR_H__
+#define __SQFS_DECOMPRESSOR_H__
+
+#include <linux/types.h>
+
+/**
+ * sqfs_decompressor_init() - Set up decompression for a filesystem
+ *
+ * @comp: Compression type from the superblock (enum sqfs_compression)
+ * @return 0 if OK, -EPROTONOSUPPORT if the compression type is not supported
+ *	by this build, -ENOMEM if out of memory
+ */
+int sqfs_decompressor_init(u16 comp);
+
+/**
+ * sqfs_decompress() - Decompress a metadata or data block
+ *
+ * @comp: Compression type, as passed to sqfs_decompressor_init()
+ * @dest: Destination buffer
+ * @dest_len: Size of @dest, updated to the number of bytes decompressed
+ * @src: Compressed data
+ * @src_len: Number of bytes of compressed data
+ * @return 0 if OK, -EIO if the data is corrupted or does not fit in @dest
+ */
+int sqfs_decompress(u16 comp, void *dest, u32 *dest_len, const void *src,
+		    u32 src_len);
+
+/**
+ * sqfs_decompressor_cleanup() - Free anything set up for decompression
+ */
+void sqfs_decompressor_cleanup(void);
+
+#endif /* __SQFS_DECOMPRESSOR_H__ */
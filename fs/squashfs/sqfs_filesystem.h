@@ -0,0 +1,174 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * SquashFS filesystem implementation for U-Boot
+ *
+ * On-disk format of SquashFS 4.0, as described in the Linux kernel's
+ * Documentation/filesystems/squashfs.rst. Everything is little-endian.
+ */
+
+#ifndef __SQFS_FILESYSTEM_H__
+#define __SQFS_FILESYSTEM_H__
+
+#include <linux/types.h>
+
+#define SQFS_MAGIC			0x73717368	/* "hsqs" */
+#define SQFS_MAJOR			4
+
+/* Largest data block (block_log 20) and metadata block */
+#define SQFS_MAX_BLOCK_SIZE		(1 << 20)
+#define SQFS_METADATA_SIZE		8192
+
+/* Metadata block header: size, with this bit set if stored uncompressed */
+#define SQFS_METADATA_UNCOMPRESSED	0x8000
+#define SQFS_METADATA_SIZE_MASK		0x7fff
+
+/* Data and fragment block sizes: size, with this bit set if uncompressed */
+#define SQFS_BLOCK_UNCOMPRESSED		(1 << 24)
+#define SQFS_BLOCK_SIZE_MASK		(SQFS_BLOCK_UNCOMPRESSED - 1)
+
+/* Fragment index of a file which has no fragment */
+#define SQFS_NO_FRAGMENT		0xffffffff
+#define SQFS_FRAGMENTS_PER_BLOCK	(SQFS_METADATA_SIZE / \
+					 sizeof(struct sqfs_fragment_entry))
+
+/* A reference to metadata: block offset in the table and offset in it */
+#define SQFS_REF_BLOCK(ref)		((ref) >> 16)
+#define SQFS_REF_OFFSET(ref)		((ref) & 0xffff)
+
+enum sqfs_compression {
+	SQFS_COMP_ZLIB = 1,
+	SQFS_COMP_LZMA,
+	SQFS_COMP_LZO,
+	SQFS_COMP_XZ,
+	SQFS_COMP_LZ4,
+	SQFS_COMP_ZSTD,
+};
+
+/* Superblock flags */
+#define SQFS_FLAG_COMP_OPTIONS		0x0400
+
+enum sqfs_inode_type {
+	SQFS_DIR_TYPE = 1,
+	SQFS_REG_TYPE,
+	SQFS_SYMLINK_TYPE,
+	SQFS_BLKDEV_TYPE,
+	SQFS_CHRDEV_TYPE,
+	SQFS_FIFO_TYPE,
+	SQFS_SOCKET_TYPE,
+	SQFS_LDIR_TYPE,
+	SQFS_LREG_TYPE,
+	SQFS_LSYMLINK_TYPE,
+	SQFS_LBLKDEV_TYPE,
+	SQFS_LCHRDEV_TYPE,
+	SQFS_LFIFO_TYPE,
+	SQFS_LSOCKET_TYPE,
+};
+
+struct sqfs_super_block {
+	__le32 s_magic;
+	__le32 inodes;
+	__le32 mkfs_time;
+	__le32 block_size;
+	__le32 fragments;
+	__le16 compression;
+	__le16 block_log;
+	__le16 flags;
+	__le16 no_ids;
+	__le16 s_major;
+	__le16 s_minor;
+	__le64 root_inode;
+	__le64 bytes_used;
+	__le64 id_table_start;
+	__le64 xattr_id_table_start;
+	__le64 inode_table_start;
+	__le64 directory_table_start;
+	__le64 fragment_table_start;
+	__le64 export_table_start;
+};
+
+/* Header common to all inodes */
+struct sqfs_base_inode {
+	__le16 inode_type;
+	__le16 mode;
+	__le16 uid;
+	__le16 guid;
+	__le32 mtime;
+	__le32 inode_number;
+};
+
+struct sqfs_dir_inode {
+	struct sqfs_base_inode base;
+	__le32 start_block;
+	__le32 nlink;
+	__le16 file_size;
+	__le16 offset;
+	__le32 parent_inode;
+};
+
+/* Followed by i_count directory index entries, which are not used here */
+struct sqfs_ldir_inode {
+	struct sqfs_base_inode base;
+	__le32 nlink;
+	__le32 file_size;
+	__le32 start_block;
+	__le32 parent_inode;
+	__le16 i_count;
+	__le16 offset;
+	__le32 xattr;
+};
+
+/* Both file inodes are followed by the sizes of the data blocks (__le32) */
+struct sqfs_reg_inode {
+	struct sqfs_base_inode base;
+	__le32 start_block;
+	__le32 fragment;
+	__le32 offset;
+	__le32 file_size;
+};
+
+struct sqfs_lreg_inode {
+	struct sqfs_base_inode base;
+	__le64 start_block;
+	__le64 file_size;
+	__le64 sparse;
+	__le32 nlink;
+	__le32 fragment;
+	__le32 offset;
+	__le32 xattr;
+};
+
+/* Followed by the target, which is not nul-terminated */
+struct sqfs_symlink_inode {
+	struct sqfs_base_inode base;
+	__le32 nlink;
+	__le32 symlink_size;
+};
+
+/*
+ * A directory listing is a series of headers, each followed by count + 1
+ * entries whose inodes are in the same metadata block
+ */
+struct sqfs_dir_header {
+	__le32 count;
+	__le32 start_block;
+	__le32 inode_number;
+};
+
+/* Followed by size + 1 bytes of name, which is not nul-terminated */
+struct sqfs_dir_entry {
+	__le16 offset;
+	__le16 inode_offset;
+	__le16 type;
+	__le16 size;
+};
+
+/* Directory listing size includes the . and .. entries which are not stored */
+#define SQFS_DIR_EMPTY_SIZE		3
+
+struct sqfs_fragment_entry {
+	__le64 start;
+	__le32 size;
+	__le32 unused;
+};
+
+#endif /* __SQFS_FILESYSTEM_H__ */
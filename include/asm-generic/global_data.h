@@ -78,6 +78,10 @@ typedef struct global_data {
 #ifdef CONFIG_OF_LIVE
 	struct device_node *of_root;
 #endif
+#if CONFIG_IS_ENABLED(OF_BIND_TABLE)
+	/* Bind table for fdt_blob, NULL if it does not match */
+	const struct dm_bind_table *dm_bind_table;
+#endif
 
 #if CONFIG_IS_ENABLED(MULTI_DTB_FIT)
 	const void *multi_dtb_fit;	/* uncompressed multi-dtb FIT image */
@@ -97,6 +101,10 @@ typedef struct global_data {
 	unsigned long malloc_limit;	/* limit address */
 	unsigned long malloc_ptr;	/* current address */
 #endif
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)
+	struct slab_state *slab;	/* slab allocator state */
+	bool slab_full_malloc;		/* slab state is in the full heap */
+#endif
 #ifdef CONFIG_PCI
 	struct pci_controller *hose;	/* PCI hose for early use */
 	phys_addr_t pci_ram_top;	/* top of region accessible to PCI */
@@ -85,6 +85,9 @@ struct blk_desc {
 		uint32_t mbr_sig;	/* MBR integer signature */
 		efi_guid_t guid_sig;	/* GPT GUID Signature */
 	};
+#if CONFIG_IS_ENABLED(EFI_PARTITION) && defined(CONFIG_HAVE_BLOCK_DEVICE)
+	struct gpt_cache *gpt_cache;	/* Validated GPT, see part_efi.c */
+#endif
 #if CONFIG_IS_ENABLED(BLK)
 	/*
 	 * For now we have a few functions which take struct blk_desc as a
@@ -203,6 +206,57 @@ static inline void blkcache_invalidate(int iftype, int dev) {}
 
 #endif
 
+#if CONFIG_IS_ENABLED(EFI_PARTITION) && defined(CONFIG_HAVE_BLOCK_DEVICE)
+/**
+ * gpt_cache_invalidate() - discard the cached GPT of a device if a write
+ * or erase touches the blocks holding it
+ *
+ * Only the blocks before the first usable LBA and after the last usable LBA
+ * hold the table, so writes to the partitions keep the cache. Block 0 (the
+ * protective MBR) always counts, so a @start of 0 drops the cache.
+ *
+ * @param block_dev - block device descriptor
+ * @param start - first block written
+ * @param blkcnt - number of blocks written
+ */
+void gpt_cache_invalidate(struct blk_desc *block_dev, lbaint_t start,
+			  lbaint_t blkcnt);
+#else
+static inline void gpt_cache_invalidate(struct blk_desc *block_dev,
+					lbaint_t start, lbaint_t blkcnt) {}
+#endif
+
+#if !defined(CONFIG_SPL_BUILD) || defined(CONFIG_FS_LOADER)
+/**
+ * fs_blk_invalidate() - tell the fs layer that a device was changed or removed
+ *
+ * The fs layer keeps a filesystem mounted while files are open on it. This
+ * makes it look the files up again, and probe the filesystem again, after the
+ * device has been written to other than through the fs layer. If the device
+ * is being removed, files open on it fail from then on.
+ *
+ * @param block_dev - block device descriptor
+ * @param removed - true if the device is being removed
+ */
+void fs_blk_invalidate(struct blk_desc *block_dev, bool removed);
+#else
+static inline void fs_blk_invalidate(struct blk_desc *block_dev,
+				     bool removed) {}
+#endif
+
+#if CONFIG_IS_ENABLED(EFI_LOADER) && defined(CONFIG_PARTITIONS)
+/**
+ * efi_disk_invalidate() - drop data the EFI disk I/O protocol read ahead
+ *
+ * This must be called whenever a device is written, erased or removed.
+ *
+ * @param block_dev - block device descriptor
+ */
+void efi_disk_invalidate(struct blk_desc *block_dev);
+#else
+static inline void efi_disk_invalidate(struct blk_desc *block_dev) {}
+#endif
+
 #if CONFIG_IS_ENABLED(BLK)
 struct udevice;
 
@@ -456,6 +510,9 @@ static inline ulong blk_dwrite(struct blk_desc *block_dev, lbaint_t start,
 			       lbaint_t blkcnt, const void *buffer)
 {
 	blkcache_invalidate(block_dev->if_type, block_dev->devnum);
+	gpt_cache_invalidate(block_dev, start, blkcnt);
+	fs_blk_invalidate(block_dev, false);
+	efi_disk_invalidate(block_dev);
 	return block_dev->block_write(block_dev, start, blkcnt, buffer);
 }
 
@@ -463,6 +520,9 @@ static inline ulong blk_derase(struct blk_desc *block_dev, lbaint_t start,
 			       lbaint_t blkcnt)
 {
 	blkcache_invalidate(block_dev->if_type, block_dev->devnum);
+	gpt_cache_invalidate(block_dev, start, blkcnt);
+	fs_blk_invalidate(block_dev, false);
+	efi_disk_invalidate(block_dev);
 	return block_dev->block_erase(block_dev, start, blkcnt);
 }
 
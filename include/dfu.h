@@ -110,6 +110,9 @@ struct virt_internal_data {
 #ifndef DFU_MANIFEST_POLL_TIMEOUT
 #define DFU_MANIFEST_POLL_TIMEOUT	DFU_DEFAULT_POLL_TIMEOUT
 #endif
+#ifndef DFU_BUSY_POLL_TIMEOUT
+#define DFU_BUSY_POLL_TIMEOUT		1
+#endif
 
 struct dfu_entity {
 	char			name[DFU_NAME_SIZE];
@@ -153,9 +156,16 @@ struct dfu_entity {
 	u64 r_left;
 	long b_left;
 
+	/* with CONFIG_DFU_WRITE_ALT_BUF */
+	u8 *i_buf_alt;		/* other buffer, written while i_buf fills */
+	long i_queued_len;	/* bytes in i_buf_alt still to be written */
+	int i_err;		/* error from writing i_buf_alt */
+	unsigned long i_write_ms;	/* time taken by the last write */
+
 	u32 bad_skip;	/* for nand use */
 
 	unsigned int inited:1;
+	unsigned int i_full:1;	/* i_buf is full but i_buf_alt is in use */
 };
 
 #ifdef CONFIG_SET_DFU_ALT_INFO
@@ -187,6 +197,28 @@ int dfu_read(struct dfu_entity *de, void *buf, int size, int blk_seq_num);
 int dfu_write(struct dfu_entity *de, void *buf, int size, int blk_seq_num);
 int dfu_flush(struct dfu_entity *de, void *buf, int size, int blk_seq_num);
 
+/**
+ * dfu_write_queued() - Write out a buffer filled by dfu_write()
+ *
+ * With CONFIG_DFU_WRITE_ALT_BUF, dfu_write() carries on in a second buffer
+ * when the first is full, leaving the first to be written by this function.
+ * It is called from the main DFU loop, once the USB request which filled the
+ * buffer has completed, so that the host can send more data meanwhile. An
+ * error is reported by the next call to dfu_write() or dfu_flush().
+ *
+ * @return - 0 on success (or if nothing was queued), other value on failure
+ */
+int dfu_write_queued(void);
+
+/**
+ * dfu_write_busy() - Check whether dfu_write() can accept more data
+ *
+ * @param dfu - dfu entity being written, may be NULL
+ * @return - 0 if there is room for more data, else how long to wait for
+ *	     room to become available, in milliseconds
+ */
+unsigned int dfu_write_busy(struct dfu_entity *dfu);
+
 /**
  * dfu_initiated_callback - weak callback called on DFU transaction start
  *
@@ -34,8 +34,13 @@ struct property {
  * @name: Node name
  * @type: Node type (value of device_type property) or "<NULL>" if none
  * @phandle: Phandle value of this none, or 0 if none
+ * @offset: With CONFIG_OF_LIVE_COMPACT, offset of this node in the flat tree
+ *	while its properties have not yet been materialised into @properties,
+ *	else -1
  * @full_name: Full path to node, e.g. "/bus@1/spi@1100"
- * @properties: Pointer to head of list of properties, or NULL if none
+ * @properties: Pointer to head of list of properties, or NULL if none. With
+ *	CONFIG_OF_LIVE_COMPACT this is only valid once @offset is -1, so use
+ *	of_get_properties() to access it
  * @parent: Pointer to parent node, or NULL if this is the root node
  * @child: Pointer to head of child node list, or NULL if no children
  * @sibling: Pointer to the next sibling node, or NULL if this is the last
@@ -44,6 +49,7 @@ struct device_node {
 	const char *name;
 	const char *type;
 	phandle phandle;
+	int offset;
 	const char *full_name;
 
 	struct property *properties;
@@ -104,11 +110,34 @@ static inline bool of_live_active(void)
 
 #define OF_BAD_ADDR	((u64)-1)
 
+/**
+ * of_node_full_name() - get the name of a node for use in messages
+ *
+ * This is the full path of the node, e.g. "/bus@1/spi@1100". Use
+ * of_node_unit_name() or ofnode_get_name() for the unit name.
+ *
+ * @np: Node to check, may be NULL
+ * @return name of the node, or "<no-node>" if @np is NULL
+ */
 static inline const char *of_node_full_name(const struct device_node *np)
 {
 	return np ? np->full_name : "<no-node>";
 }
 
+/**
+ * of_node_unit_name() - get the unit name of a node
+ *
+ * @np: Node to check
+ * @return the last component of the node's path, e.g. "spi@1100", or "" for
+ *	the root node
+ */
+static inline const char *of_node_unit_name(const struct device_node *np)
+{
+	const char *name = strrchr(np->full_name, '/');
+
+	return name ? name + 1 : np->full_name;
+}
+
 /* Default #address and #size cells */
 #if !defined(OF_ROOT_NODE_ADDR_CELLS_DEFAULT)
 #define OF_ROOT_NODE_ADDR_CELLS_DEFAULT 2
@@ -79,6 +79,18 @@ int of_simple_addr_cells(const struct device_node *np);
  */
 int of_simple_size_cells(const struct device_node *np);
 
+/**
+ * of_get_properties() - get the list of properties in a node
+ *
+ * With CONFIG_OF_LIVE_COMPACT the property list of a node is only built from
+ * the flat tree when it is first needed, so this must be used instead of
+ * accessing @np->properties directly.
+ *
+ * @np: Pointer to device node holding the properties
+ * @return pointer to the first property, or NULL if none
+ */
+struct property *of_get_properties(const struct device_node *np);
+
 /**
  * of_find_property() - find a property in a node
  *
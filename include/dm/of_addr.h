@@ -70,6 +70,9 @@ struct resource;
  * pci_address_to_pio(), that is because it's either called to early or it
  * can't be matched to any host bridge IO space
  *
+ * If the node has no "reg-names", the resource is named after the node,
+ * using of_node_full_name().
+ *
  * @np: node to check
  * @index: index of address to read (0 = first)
  * @r: place to put resource information
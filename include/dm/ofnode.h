@@ -343,6 +343,9 @@ ofnode ofnode_get_parent(ofnode node);
 /**
  * ofnode_get_name() - get the name of a node
  *
+ * This is the unit name, e.g. "spi@1100", or "" for the root node. It is the
+ * same with a flat tree, a live tree and CONFIG_OF_LIVE_COMPACT.
+ *
  * @node: valid node to look up
  * @return name of node
  */
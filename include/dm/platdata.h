@@ -43,4 +43,44 @@ struct driver_info {
 #define U_BOOT_DEVICES(__name)						\
 	ll_entry_declare_list(struct driver_info, __name, driver_info)
 
+/**
+ * struct dm_bind_node - Pre-resolved binding for a device tree node
+ *
+ * This is generated by dtoc with CONFIG_OF_BIND_TABLE, to avoid matching
+ * compatible strings against every driver at run time.
+ *
+ * @offset:	Offset of the node in the device tree
+ * @parent:	Offset of the node whose subnodes are scanned to find this one
+ * @drv_name:	Name of driver to bind, or NULL to look it up at run time
+ * @compat:	Compatible string in the driver's of_match table to use
+ * @pre_reloc:	true if the node has a property requesting that it be bound
+ *		before relocation
+ */
+struct dm_bind_node {
+	int offset;
+	int parent;
+	const char *drv_name;
+	const char *compat;
+	bool pre_reloc;
+};
+
+/**
+ * struct dm_bind_table - Table of pre-resolved bindings for a device tree
+ *
+ * @fdt_size:	Total size of the device tree the table was generated from
+ * @fdt_crc32:	CRC32 of that device tree, so that the table is not used with a
+ *		different one
+ * @count:	Number of entries in @nodes
+ * @nodes:	Bindings, sorted by parent offset
+ */
+struct dm_bind_table {
+	u32 fdt_size;
+	u32 fdt_crc32;
+	int count;
+	const struct dm_bind_node *nodes;
+};
+
+/* Table generated by dtoc for U-Boot proper, see dts/Makefile */
+extern const struct dm_bind_table dm_bind_table;
+
 #endif
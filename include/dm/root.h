@@ -54,6 +54,23 @@ int dm_scan_platdata(bool pre_reloc_only);
  */
 int dm_scan_fdt(const void *blob, bool pre_reloc_only);
 
+struct dm_bind_table;
+/**
+ * dm_bind_table_set() - Select the bind table to use for the device tree
+ *
+ * With CONFIG_OF_BIND_TABLE, dm_scan_fdt() binds devices in the flat device
+ * tree using a table of pre-resolved bindings, generated by dtoc. This checks
+ * that the table was generated from @blob and selects it if so. dm_init()
+ * selects dm_bind_table for gd->fdt_blob each time it is called, so that the
+ * table is checked again after relocation.
+ *
+ * @blob: Pointer to device tree blob
+ * @table: Bind table to use
+ * @return 0 if OK, -EINVAL if @table does not match @blob, in which case no
+ * table is used
+ */
+int dm_bind_table_set(const void *blob, const struct dm_bind_table *table);
+
 /**
  * dm_extended_scan_fdt() - Scan the device tree and bind drivers
  *
@@ -209,6 +209,77 @@ struct env_driver {
 
 extern struct hsearch_data env_htab;
 
+/*
+ * Journaling environment storage (CONFIG_ENV_JOURNAL)
+ *
+ * The storage area of CONFIG_ENV_SIZE bytes holds a header followed by a log
+ * of records, each with its own CRC. The first record is a snapshot of the
+ * whole environment and later ones set or delete single variables. Saving
+ * appends records for the variables which changed; the log is only rewritten
+ * (compacted) into a new snapshot when there is no room left. Unused space
+ * reads as 0xff, as on erased flash.
+ */
+
+/**
+ * struct env_journal_ops - Access to the storage area holding a journal
+ *
+ * @read: Read the whole area into @buf
+ * @write: Write bytes @offset to @offset + @len - 1 of @area, an image of the
+ *	whole area, to the storage. Backends which can only write whole
+ *	blocks may write more of the image than requested.
+ * @erase: Erase the whole area so that it reads as 0xff, or NULL if the
+ *	storage can be overwritten in place
+ */
+struct env_journal_ops {
+	int (*read)(void *buf);
+	int (*write)(const void *area, u32 offset, u32 len);
+	int (*erase)(void);
+};
+
+/**
+ * struct env_journal - State of a journal, kept between loading and saving
+ *
+ * @area: Image of the storage area as last read or written
+ * @state: Environment as stored, as exported by hexport_r()
+ * @end: Offset of the free space following the last record in @area
+ * @seq: Sequence number of the snapshot, increased on compaction
+ * @valid: true if @area holds a journal which can be appended to
+ */
+struct env_journal {
+	u8 *area;
+	char *state;
+	u32 end;
+	u32 seq;
+	bool valid;
+};
+
+/**
+ * env_journal_load() - Load the environment from a journal
+ *
+ * The log is replayed into the environment. If the area does not hold a
+ * journal, it is imported as a normal environment (env_t) instead, so that
+ * the first save converts it.
+ *
+ * @jnl: Journal state
+ * @ops: Access to the storage
+ * @return 0 if OK, -ve on error, in which case the default environment is used
+ */
+int env_journal_load(struct env_journal *jnl,
+		     const struct env_journal_ops *ops);
+
+/**
+ * env_journal_save() - Save the environment to a journal
+ *
+ * Records are appended for the variables which changed since the journal was
+ * loaded or last saved. If they do not fit, the journal is compacted.
+ *
+ * @jnl: Journal state
+ * @ops: Access to the storage
+ * @return 0 if OK, -ve on error
+ */
+int env_journal_save(struct env_journal *jnl,
+		     const struct env_journal_ops *ops);
+
 #endif /* DO_DEPS_ONLY */
 
 #endif /* _ENV_INTERNAL_H_ */
@@ -33,4 +33,12 @@ extern void (*fastboot_progress_callback)(const char *msg);
  */
 void fastboot_getvar(char *cmd_parameter, char *response);
 
+/**
+ * fastboot_stream_armed() - Check whether the next download is streamed
+ *
+ * Return: true if "oem stream" selected a partition for the next download,
+ * which then need not fit in the download buffer
+ */
+bool fastboot_stream_armed(void);
+
 #endif
@@ -36,6 +36,9 @@ enum {
 #if CONFIG_IS_ENABLED(FASTBOOT_CMD_OEM_FORMAT)
 	FASTBOOT_COMMAND_OEM_FORMAT,
 #endif
+#if CONFIG_IS_ENABLED(FASTBOOT_STREAM)
+	FASTBOOT_COMMAND_OEM_STREAM,
+#endif
 
 	FASTBOOT_COMMAND_COUNT
 };
@@ -142,6 +145,16 @@ u32 fastboot_data_remaining(void);
 void fastboot_data_download(const void *fastboot_data,
 			    unsigned int fastboot_data_len, char *response);
 
+/**
+ * fastboot_data_flush() - Write out received image data
+ *
+ * When a download is written to storage as it arrives, the data is collected
+ * in buffers which are written here. The transport calls this after it has
+ * asked for the next data, so that receiving it overlaps with the write.
+ * Otherwise this does nothing.
+ */
+void fastboot_data_flush(void);
+
 /**
  * fastboot_data_complete() - Mark current transfer complete
  *
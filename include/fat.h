@@ -203,6 +203,10 @@ int fat_read_file(const char *filename, void *buf, loff_t offset, loff_t len,
 int fat_opendir(const char *filename, struct fs_dir_stream **dirsp);
 int fat_readdir(struct fs_dir_stream *dirs, struct fs_dirent **dentp);
 void fat_closedir(struct fs_dir_stream *dirs);
+int fat_open(struct fs_file *file);
+int fat_read_at(struct fs_file *file, void *buf, loff_t offset, loff_t len,
+		loff_t *actread);
+void fat_close_file(struct fs_file *file);
 int fat_unlink(const char *filename);
 int fat_mkdir(const char *dirname);
 void fat_close(void);
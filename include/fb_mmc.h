@@ -6,6 +6,8 @@
 #ifndef _FB_MMC_H_
 #define _FB_MMC_H_
 
+struct sparse_storage;
+
 /**
  * fastboot_mmc_get_part_info() - Lookup eMMC partion by name
  *
@@ -28,6 +30,18 @@ int fastboot_mmc_get_part_info(const char *part_name,
  */
 void fastboot_mmc_flash_write(const char *cmd, void *download_buffer,
 			      u32 download_bytes, char *response);
+
+/**
+ * fastboot_mmc_stream_init() - Set up writing a download as it arrives
+ *
+ * @part_name: Named partition to write to
+ * @sparse: Returns the storage description
+ * @response: Pointer to fastboot response buffer
+ * @return 0 if OK, -ve on error (response is filled in)
+ */
+int fastboot_mmc_stream_init(const char *part_name,
+			     struct sparse_storage *sparse, char *response);
+
 /**
  * fastboot_mmc_flash_erase() - Erase eMMC for fastboot
  *
@@ -6,6 +6,7 @@
 #define _FS_H
 
 #include <common.h>
+#include <linux/list.h>
 
 #define FS_TYPE_ANY	0
 #define FS_TYPE_FAT	1
@@ -13,6 +14,7 @@
 #define FS_TYPE_SANDBOX	3
 #define FS_TYPE_UBIFS	4
 #define FS_TYPE_BTRFS	5
+#define FS_TYPE_SQUASHFS	6
 
 /**
  * do_fat_fsload - Run the fatload command
@@ -202,6 +204,96 @@ struct fs_dirent *fs_readdir(struct fs_dir_stream *dirs);
  */
 void fs_closedir(struct fs_dir_stream *dirs);
 
+/*
+ * An open file, returned by fs_open(). The filesystem stays mounted while
+ * files are open on it, so reads do not have to probe the partition and look
+ * up the file again.
+ *
+ * Note: fs_file should be treated as opaque to the user of fs layer, apart
+ * from @size
+ */
+struct fs_file {
+	/* private to fs. layer: */
+	struct list_head sibling;
+	struct blk_desc *desc;
+	int part;
+	int fstype;
+	ulong gen;
+	bool removed;
+	char *name;
+	/* private to the filesystem driver: */
+	void *priv;
+	/* size of the file in bytes: */
+	loff_t size;
+};
+
+/*
+ * fs_open - Open a file for reading
+ *
+ * The file is opened on the partition previously set by fs_set_blk_dev().
+ * It may then be read with fs_read_at() without setting the partition again.
+ *
+ * @filename: full path of the file to open
+ * @filep: returns the open file
+ * @return 0 on success, -ve on error
+ */
+int fs_open(const char *filename, struct fs_file **filep);
+
+/*
+ * fs_read_at - Read from an open file
+ *
+ * If the filesystem has been written to since the file was opened, the file
+ * is looked up again first.
+ *
+ * @file: the open file
+ * @addr: address of the buffer to write to
+ * @offset: offset in the file from where to start reading
+ * @len: the number of bytes to read. Use 0 to read the rest of the file.
+ * @actread: returns the actual number of bytes read
+ * @return 0 if OK with valid *actread, -ve on error
+ */
+int fs_read_at(struct fs_file *file, ulong addr, loff_t offset, loff_t len,
+	       loff_t *actread);
+
+/*
+ * fs_file_size - Get the size of an open file
+ *
+ * Unlike reading @file->size directly, this picks up any change made by a
+ * write since the file was opened.
+ *
+ * @file: the open file
+ * @size: returns the size of the file in bytes
+ * @return 0 if OK, -ve on error
+ */
+int fs_file_size(struct fs_file *file, loff_t *size);
+
+/*
+ * fs_close_file - Close a file opened with fs_open()
+ *
+ * When the last open file is closed the filesystem is unmounted.
+ *
+ * @file: the file to close, may be NULL
+ */
+void fs_close_file(struct fs_file *file);
+
+#if !defined(CONFIG_SPL_BUILD) || defined(CONFIG_FS_LOADER)
+/*
+ * fs_driver_set_blk_dev - Note that a filesystem driver was pointed at a device
+ *
+ * Filesystem drivers can only handle one device at a time. Some code, such as
+ * the FAT environment, sets the device of a driver directly rather than
+ * through fs_set_blk_dev(). The drivers call this so that the fs layer knows
+ * that the filesystem it kept mounted for open files must be probed again.
+ *
+ * @desc: block device the driver now uses
+ * @info: partition the driver now uses
+ */
+void fs_driver_set_blk_dev(struct blk_desc *desc, disk_partition_t *info);
+#else
+static inline void fs_driver_set_blk_dev(struct blk_desc *desc,
+					 disk_partition_t *info) {}
+#endif
+
 /*
  * fs_unlink - delete a file or directory
  *
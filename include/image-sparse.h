@@ -23,9 +23,75 @@ struct sparse_storage {
 				 lbaint_t blk,
 				 lbaint_t blkcnt);
 
+	/*
+	 * Optional: erase blocks, which then read back as @erase_val. FILL
+	 * chunks of that value are erased rather than written, in units of
+	 * @erase_grp blocks (a power of two).
+	 */
+	lbaint_t	(*erase)(struct sparse_storage *info,
+				 lbaint_t blk,
+				 lbaint_t blkcnt);
+	uint32_t	erase_val;
+	lbaint_t	erase_grp;
+
 	void		(*mssg)(const char *str, char *response);
 };
 
+/**
+ * struct sparse_stream - State for writing an image as it is received
+ *
+ * The image is parsed as it arrives, so it does not need to fit in memory.
+ * Data of RAW chunks is collected in one of two buffers; when that is full,
+ * it is queued and the other buffer is filled. The caller writes the queued
+ * buffer with sparse_stream_flush() once it has arranged for more data to
+ * arrive in the meantime.
+ *
+ * @info: Storage to write to
+ * @state: What the next bytes received are (enum sparse_stream_state)
+ * @next: State to move to after skipping @skip bytes
+ * @raw: true if the image is not sparse, and is written as it is
+ * @sparse_header: Header of the image
+ * @chunk_header: Header of the current chunk
+ * @fill_val: Value of the current FILL chunk
+ * @hdr_len: Number of bytes of the current header received so far
+ * @skip: Number of bytes still to be skipped
+ * @chunk: Number of chunks processed
+ * @left: Number of bytes of the current chunk still to be received
+ * @blk: Block at which the next data goes
+ * @total_blocks: Number of blocks of the image processed
+ * @bytes_written: Number of bytes written to storage
+ * @buf: The two buffers
+ * @buf_size: Size of each buffer, a multiple of the block size
+ * @cur: Index of the buffer being filled
+ * @len: Number of bytes in the buffer being filled
+ * @start: Block at which the data in each buffer goes
+ * @pending: Number of blocks in the other buffer still to be written
+ * @err: Description of the first error, NULL if none
+ */
+struct sparse_stream {
+	struct sparse_storage	*info;
+	int			state;
+	int			next;
+	bool			raw;
+	sparse_header_t		sparse_header;
+	chunk_header_t		chunk_header;
+	uint32_t		fill_val;
+	uint32_t		hdr_len;
+	uint32_t		skip;
+	uint32_t		chunk;
+	uint64_t		left;
+	lbaint_t		blk;
+	uint32_t		total_blocks;
+	uint64_t		bytes_written;
+	char			*buf[2];
+	uint32_t		buf_size;
+	int			cur;
+	uint32_t		len;
+	lbaint_t		start[2];
+	lbaint_t		pending;
+	const char		*err;
+};
+
 static inline int is_sparse_image(void *buf)
 {
 	sparse_header_t *s_header = (sparse_header_t *)buf;
@@ -39,3 +105,46 @@ static inline int is_sparse_image(void *buf)
 
 int write_sparse_image(struct sparse_storage *info, const char *part_name,
 		       void *data, char *response);
+
+/**
+ * sparse_stream_init() - Start writing an image as it is received
+ *
+ * @ss: Stream state to set up
+ * @info: Storage to write to, which must remain valid until
+ *	sparse_stream_finish()
+ * @buf: Memory to use for the two buffers
+ * @size: Size of @buf in bytes
+ * @return 0 if OK, -EINVAL if @buf is too small
+ */
+int sparse_stream_init(struct sparse_stream *ss, struct sparse_storage *info,
+		       void *buf, u32 size);
+
+/**
+ * sparse_stream_write() - Process received image data
+ *
+ * This may write a queued buffer first, if both buffers are full.
+ *
+ * @ss: Stream state
+ * @data: Data received
+ * @len: Number of bytes received
+ * @return 0 if OK, -EIO if an error was found (see @ss->err); further data
+ *	is then ignored
+ */
+int sparse_stream_write(struct sparse_stream *ss, const void *data, u32 len);
+
+/**
+ * sparse_stream_flush() - Write the queued buffer, if any
+ *
+ * @ss: Stream state
+ * @return 0 if OK, -EIO on error
+ */
+int sparse_stream_flush(struct sparse_stream *ss);
+
+/**
+ * sparse_stream_finish() - Write what is left and check the image
+ *
+ * @ss: Stream state
+ * @part_name: Partition name, for the summary message
+ * @return 0 if OK, -EIO on error (see @ss->err)
+ */
+int sparse_stream_finish(struct sparse_stream *ss, const char *part_name);
@@ -10,6 +10,7 @@
 #define __LOG_H
 
 #include <command.h>
+#include <stdarg.h>
 #include <dm/uclass-id.h>
 #include <linux/list.h>
 
@@ -278,7 +279,10 @@ void __assert_fail(const char *assertion, const char *file, unsigned int line,
  * @file: Name of file where the log record was generated (not allocated)
  * @line: Line number where the log record was generated
  * @func: Function where the log record was generated (not allocated)
- * @msg: Log message (allocated)
+ * @msg: Log message (allocated), or NULL if it has not been formatted yet.
+ *	This is always set for drivers without LOGDF_DEFERRED
+ * @fmt: printf()-style format string for the message (not allocated)
+ * @args: Arguments for @fmt. Drivers must use va_copy() to access these
  */
 struct log_rec {
 	enum log_category_t cat;
@@ -287,17 +291,25 @@ struct log_rec {
 	int line;
 	const char *func;
 	const char *msg;
+	const char *fmt;
+	va_list *args;
 };
 
 struct log_device;
 
+enum log_driver_flags {
+	LOGDF_DEFERRED	= 1 << 0,	/* Driver can handle an unformatted msg */
+};
+
 /**
  * struct log_driver - a driver which accepts and processes log records
  *
  * @name: Name of driver
+ * @flags: Flags for this driver (LOGDF_...)
  */
 struct log_driver {
 	const char *name;
+	unsigned short flags;
 	/**
 	 * emit() - emit a log record
 	 *
@@ -441,6 +453,32 @@ int log_add_filter(const char *drv_name, enum log_category_t cat_list[],
  */
 int log_remove_filter(const char *drv_name, int filter_num);
 
+/**
+ * log_buffer_clear() - Discard all records held by the log buffer
+ */
+void log_buffer_clear(void);
+
+/**
+ * log_buffer_dump() - Format and print the records held by the log buffer
+ *
+ * @max_recs: Maximum number of records to print, counting back from the most
+ *	recent, or -1 for all
+ * @return number of records printed
+ */
+int log_buffer_dump(int max_recs);
+
+/**
+ * log_buffer_export() - Write the log buffer as text to the bloblist
+ *
+ * The records are formatted, one per line, into a BLOBLISTT_LOG blob. This is
+ * intended to be called before handing off to the next program so that it can
+ * pick up the log.
+ *
+ * @return 0 if OK, -ENOENT if the log buffer is not set up, -ENOSPC if there
+ *	is not enough space in the bloblist
+ */
+int log_buffer_export(void);
+
 #if CONFIG_IS_ENABLED(LOG)
 /**
  * log_init() - Set up the log system ready for use
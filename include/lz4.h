@@ -21,4 +21,20 @@
  */
 int ulz4fn(const void *src, size_t srcn, void *dst, size_t *dstn);
 
+/**
+ * LZ4_decompress_safe() - Decompress a raw LZ4 block
+ *
+ * This handles a single block without the frame header, as stored by
+ * filesystems such as SquashFS.
+ *
+ * @source: Source data to decompress
+ * @dest: Destination for uncompressed data
+ * @inputSize: Length of source data
+ * @maxOutputSize: Size of the destination buffer
+ * @return number of bytes written to @dest, or -ve if the data is malformed
+ *	or does not fit
+ */
+int LZ4_decompress_safe(const char *source, char *dest, int inputSize,
+			int maxOutputSize);
+
 #endif
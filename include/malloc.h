@@ -912,6 +912,18 @@ void malloc_simple_info(void);
 #define malloc_usable_size dlmalloc_usable_size
 #define malloc_stats dlmalloc_stats
 
+# elif CONFIG_IS_ENABLED(MALLOC_TRACE)
+/* The public functions are provided by malloc_trace.c, which calls these */
+# define cALLOc		dlcalloc
+# define fREe		dlfree
+# define mALLOc		dlmalloc
+# define mEMALIGn	dlmemalign
+# define rEALLOc		dlrealloc
+# define vALLOc		dlvalloc
+# define pvALLOc		dlpvalloc
+# define mALLINFo	mallinfo
+# define mALLOPt		mallopt
+
 # else /* USE_DL_PREFIX */
 # define cALLOc		calloc
 # define fREe		free
@@ -951,6 +963,15 @@ size_t  malloc_usable_size(Void_t*);
 void    malloc_stats(void);
 int     mALLOPt(int, int);
 struct mallinfo mALLINFo(void);
+#  if CONFIG_IS_ENABLED(MALLOC_TRACE)
+void *malloc(size_t);
+void free(void *);
+void *realloc(void *, size_t);
+void *memalign(size_t, size_t);
+void *valloc(size_t);
+void *pvalloc(size_t);
+void *calloc(size_t, size_t);
+#  endif
 # else
 Void_t* mALLOc();
 void    fREe();
@@ -0,0 +1,120 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Tracing of malloc() calls
+ *
+ * With CONFIG_MALLOC_TRACE, each call to malloc(), calloc(), realloc(),
+ * memalign() and free() after relocation is recorded in a ring buffer along
+ * with its caller. Counters track the number of bytes in use and the
+ * high-water mark, so that leaks and heap exhaustion can be tracked down.
+ */
+
+#ifndef __MALLOC_TRACE_H
+#define __MALLOC_TRACE_H
+
+/**
+ * enum malloc_trace_type - Type of a trace record
+ *
+ * @MALLOC_TRACE_ALLOC: Memory was allocated (or allocation failed)
+ * @MALLOC_TRACE_FREE: Memory was freed
+ */
+enum malloc_trace_type {
+	MALLOC_TRACE_ALLOC,
+	MALLOC_TRACE_FREE,
+};
+
+/**
+ * struct malloc_trace_rec - Record of a single call
+ *
+ * @caller: Address the call was made from
+ * @ptr: Pointer returned or freed, NULL if the allocation failed
+ * @size: Number of bytes requested (0 for free)
+ * @time: Time of the call in microseconds (timer_get_us())
+ * @type: Type of record
+ */
+struct malloc_trace_rec {
+	void *caller;
+	void *ptr;
+	ulong size;
+	ulong time;
+	enum malloc_trace_type type;
+};
+
+/**
+ * struct malloc_trace_stats - Counters kept while tracing
+ *
+ * @allocs: Number of successful allocations
+ * @frees: Number of calls to free() with a non-NULL pointer
+ * @failed: Number of allocations which failed
+ * @in_use: Number of bytes currently allocated, including chunk overhead
+ * @peak: Highest value seen for @in_use
+ * @count: Total number of records written to the ring buffer
+ */
+struct malloc_trace_stats {
+	ulong allocs;
+	ulong frees;
+	ulong failed;
+	ulong in_use;
+	ulong peak;
+	ulong count;
+};
+
+/**
+ * struct malloc_trace_site - Records aggregated for a call site
+ *
+ * @caller: Address of the call site
+ * @allocs: Number of allocations recorded
+ * @bytes: Total bytes requested by those allocations
+ * @live: Number of those allocations which have not been freed
+ * @live_bytes: Bytes requested by the allocations which have not been freed
+ */
+struct malloc_trace_site {
+	void *caller;
+	uint allocs;
+	ulong bytes;
+	uint live;
+	ulong live_bytes;
+};
+
+/**
+ * malloc_trace_get_stats() - Get the trace counters
+ *
+ * @stats: Returns the counters
+ */
+void malloc_trace_get_stats(struct malloc_trace_stats *stats);
+
+/**
+ * malloc_trace_get_rec() - Get a record from the ring buffer
+ *
+ * @seq: Record number, counting from 0 for the oldest record still held
+ * @rec: Returns the record
+ * @return 0 if OK, -ENOENT if there is no such record
+ */
+int malloc_trace_get_rec(int seq, struct malloc_trace_rec *rec);
+
+/**
+ * malloc_trace_get_sites() - Aggregate the ring buffer by call site
+ *
+ * Each free() is matched with the allocation it frees, if that is still in
+ * the ring buffer. Sites are sorted so that those with the most live bytes
+ * come first.
+ *
+ * @sites: Returns the sites
+ * @max_sites: Maximum number of sites to return
+ * @return total number of sites found (which may be more than @max_sites),
+ *	or -ENOMEM if out of memory
+ */
+int malloc_trace_get_sites(struct malloc_trace_site *sites, int max_sites);
+
+/**
+ * malloc_trace_reset() - Empty the ring buffer and reset the counters
+ *
+ * The high-water mark is reset to the number of bytes currently in use.
+ */
+void malloc_trace_reset(void);
+
+/**
+ * malloc_trace_report() - Print the heap usage and high-water mark
+ */
+void malloc_trace_report(void);
+
+#endif
@@ -0,0 +1,131 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Memory test engine, used by mtest and POST
+ *
+ * The memory is filled with, and checked against, a sequence of words
+ * which starts at a pattern and goes up (or down) by a fixed amount for
+ * each word. This is done a block at a time, reading and writing several
+ * words at once, so that the CPU can use its widest load and store
+ * instructions. The watchdog is reset after each block.
+ *
+ * All the work is done by the calling CPU. Secondary cores on some SoCs can
+ * be released from their spin table (see cpu_release() on Layerscape), but
+ * they start with no stack and with the MMU and caches off, and cannot go
+ * back to the spin table when done, so the OS would not be able to start
+ * them later. Splitting a test across cores would need all of that to be
+ * sorted out first.
+ */
+
+#ifndef __MEMTEST_H
+#define __MEMTEST_H
+
+/* Number of errors whose details are kept */
+#define MEMTEST_MAX_ERRS	16
+
+/**
+ * struct memtest_err - A word which did not read back as expected
+ *
+ * @addr:	Address of the word
+ * @expected:	Value which should have been read
+ * @actual:	Value which was read
+ */
+struct memtest_err {
+	ulong addr;
+	ulong expected;
+	ulong actual;
+};
+
+/**
+ * enum memtest_then - What to write to each word once it is checked
+ *
+ * @MEMTEST_KEEP:	Leave it as it is
+ * @MEMTEST_INVERT:	Write the inverse of the expected value
+ * @MEMTEST_ZERO:	Write zero
+ */
+enum memtest_then {
+	MEMTEST_KEEP,
+	MEMTEST_INVERT,
+	MEMTEST_ZERO,
+};
+
+/**
+ * struct memtest - A memory test and its results
+ *
+ * The results add up over all the passes of the test.
+ *
+ * @buf:	Memory being tested
+ * @addr:	Address of the memory, as reported in errors
+ * @words:	Number of words to test
+ * @interruptible:	true to stop the test if Ctrl-C is pressed
+ * @errs:	Number of words which were wrong
+ * @nerr:	Number of errors in @err
+ * @err:	Details of the first errors found
+ * @bytes:	Number of bytes written and read
+ * @time:	Time taken in milliseconds
+ */
+struct memtest {
+	ulong *buf;
+	ulong addr;
+	ulong words;
+	bool interruptible;
+
+	ulong errs;
+	uint nerr;
+	struct memtest_err err[MEMTEST_MAX_ERRS];
+	u64 bytes;
+	ulong time;
+};
+
+/**
+ * memtest_init() - Set up a memory test
+ *
+ * @mt:		Test to set up
+ * @addr:	Address of the memory to test
+ * @size:	Number of bytes to test, rounded down to a number of words
+ * @interruptible:	true to stop the test if Ctrl-C is pressed
+ */
+void memtest_init(struct memtest *mt, ulong addr, ulong size,
+		  bool interruptible);
+
+/**
+ * memtest_uninit() - Finish with a memory test
+ *
+ * @mt:		Test to finish with
+ */
+void memtest_uninit(struct memtest *mt);
+
+/**
+ * memtest_fill() - Fill memory with a sequence of values
+ *
+ * Word n is set to @pattern + n * @incr.
+ *
+ * @mt:		Test to run
+ * @pattern:	Value of the first word
+ * @incr:	Amount to add for each word
+ * @return 0 if OK, -EINTR if interrupted
+ */
+int memtest_fill(struct memtest *mt, ulong pattern, ulong incr);
+
+/**
+ * memtest_check() - Check that memory holds a sequence of values
+ *
+ * Words which are not @pattern + n * @incr are added to the errors.
+ *
+ * @mt:		Test to run
+ * @pattern:	Expected value of the first word
+ * @incr:	Amount to add for each word
+ * @then:	What to write to each word once it is checked
+ * @return 0 if OK (even if errors were found), -EINTR if interrupted
+ */
+int memtest_check(struct memtest *mt, ulong pattern, ulong incr,
+		  enum memtest_then then);
+
+/**
+ * memtest_mib_per_sec() - Get the speed of a memory test
+ *
+ * @mt:		Test which has been run
+ * @return number of MiB written and read per second, or 0 if unknown
+ */
+ulong memtest_mib_per_sec(const struct memtest *mt);
+
+#endif /* __MEMTEST_H */
@@ -64,6 +64,8 @@ enum ns16550_flags {
  * @reg_offset:		Offset to start of registers (normally 0)
  * @clock:		UART base clock speed in Hz
  * @fcr:		Offset of FCR register (normally UART_FCR_DEFVAL)
+ * @fifo_size:		Number of characters the TX FIFO holds, or 0 for the
+ *			16 of a 16550A
  * @flags:		A few flags (enum ns16550_flags)
  * @bdf:		PCI slot/function (pci_dev_t)
  */
@@ -74,6 +76,7 @@ struct ns16550_platdata {
 	int reg_offset;
 	int clock;
 	u32 fcr;
+	int fifo_size;
 	int flags;
 #if defined(CONFIG_PCI) && defined(CONFIG_SPL)
 	int bdf;
@@ -10,6 +10,7 @@
 #define _OF_LIVE_H
 
 struct device_node;
+struct property;
 
 /**
  * of_live_build() - build a live (hierarchical) tree from a flat DT
@@ -20,4 +21,32 @@ struct device_node;
  */
 int of_live_build(const void *fdt_blob, struct device_node **rootp);
 
+/**
+ * of_live_get_prop() - look up a property in the flat tree behind a node
+ *
+ * With CONFIG_OF_LIVE_COMPACT, properties of a node which have not yet been
+ * materialised are read directly from the copy of the flat tree which
+ * of_live_build() keeps with the live tree. This avoids creating a struct
+ * property for lookups which only need the value.
+ *
+ * @np: Node to check, whose properties have not been materialised
+ * @name: Name of property
+ * @lenp: If non-NULL, returns length of property, or -FDT_ERR_NOTFOUND
+ * @return pointer to property value, or NULL if not found
+ */
+const void *of_live_get_prop(const struct device_node *np, const char *name,
+			     int *lenp);
+
+/**
+ * of_live_load_props() - materialise the property list of a node
+ *
+ * With CONFIG_OF_LIVE_COMPACT, this creates the struct property list of a
+ * node from the flat tree, in a single allocation. It does nothing if this
+ * has already been done.
+ *
+ * @np: Node to update
+ * @return 0 if OK, -ENOMEM if out of memory
+ */
+int of_live_load_props(struct device_node *np);
+
 #endif
@@ -201,6 +201,33 @@ int part_get_info_by_name_type(struct blk_desc *dev_desc, const char *name,
 int part_get_info_by_name(struct blk_desc *dev_desc,
 			      const char *name, disk_partition_t *info);
 
+/**
+ * part_get_info_by_uuid() - Search for a partition by its unique GUID
+ *
+ * @param dev_desc - block device descriptor
+ * @param uuid - the partition GUID, as a string
+ * @param info - returns the disk partition info
+ *
+ * @return - the partition number on match (starting on 1), -1 on no match,
+ * otherwise error
+ */
+int part_get_info_by_uuid(struct blk_desc *dev_desc, const char *uuid,
+			  disk_partition_t *info);
+
+/**
+ * part_get_info_by_type_guid() - Search for the first partition of a type
+ *
+ * @param dev_desc - block device descriptor
+ * @param type_guid - the partition type GUID as a string, or a shortcut
+ *		      such as "system" with CONFIG_PARTITION_TYPE_GUID
+ * @param info - returns the disk partition info
+ *
+ * @return - the partition number on match (starting on 1), -1 on no match,
+ * otherwise error
+ */
+int part_get_info_by_type_guid(struct blk_desc *dev_desc,
+			       const char *type_guid, disk_partition_t *info);
+
 /**
  * Get partition info from dev number + part name, or dev number + part number.
  *
@@ -279,6 +306,13 @@ static inline int blk_get_device_part_str(const char *ifname,
 #endif
 
 
+/* What to match when searching for a partition */
+enum part_key {
+	PART_KEY_NAME,
+	PART_KEY_UUID,
+	PART_KEY_TYPE_GUID,
+};
+
 struct part_driver {
 	const char *name;
 	int part_type;
@@ -309,6 +343,22 @@ struct part_driver {
 	 *	   type, -ve if not
 	 */
 	int (*test)(struct blk_desc *dev_desc);
+
+	/**
+	 * find() - Find a partition by name or GUID
+	 *
+	 * This is optional. Without it, each partition is checked in turn
+	 * using get_info(), stopping at the first that cannot be read. A
+	 * driver which provides it must give the same result.
+	 *
+	 * @dev_desc:	Block device descriptor
+	 * @key:	What to match
+	 * @value:	Partition name, or GUID as a string
+	 * @info:	Returns partition information
+	 * @return partition number (1 = first) if found, -ve if not
+	 */
+	int (*find)(struct blk_desc *dev_desc, enum part_key key,
+		    const char *value, disk_partition_t *info);
 };
 
 /* Declare a new U-Boot partition 'driver' */
@@ -441,6 +491,18 @@ int gpt_verify_partitions(struct blk_desc *dev_desc,
  */
 int get_disk_guid(struct blk_desc *dev_desc, char *guid);
 
+/**
+ * gpt_cache_recheck() - Check the cached GPT against the disk on next use
+ *
+ * This is called when a device is (re)initialised, since the medium may have
+ * been changed. Only the GPT header is read again; the cache is kept if it is
+ * unchanged.
+ *
+ * @param dev_desc - block device descriptor
+ */
+void gpt_cache_recheck(struct blk_desc *dev_desc);
+#else
+static inline void gpt_cache_recheck(struct blk_desc *dev_desc) {}
 #endif
 
 #if CONFIG_IS_ENABLED(DOS_PARTITION)
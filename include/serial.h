@@ -191,6 +191,22 @@ struct dm_serial_ops {
 	 * @return 0 if OK, -ve on error
 	 */
 	int (*putc)(struct udevice *dev, const char ch);
+	/**
+	 * puts() - Write a string
+	 *
+	 * This writes as many characters as the device can accept without
+	 * waiting, which may be fewer than @len. Newlines are not translated
+	 * to carriage return + newline, since the uclass does this.
+	 *
+	 * This method is optional. If it is not provided, putc() is used.
+	 *
+	 * @dev: Device pointer
+	 * @s: Characters to write
+	 * @len: Number of characters to write
+	 * @return number of characters written (at least 1), -EAGAIN if
+	 *	none could be written yet, other -ve on error
+	 */
+	ssize_t (*puts)(struct udevice *dev, const char *s, size_t len);
 	/**
 	 * pending() - Check if input/output characters are waiting
 	 *
@@ -270,6 +286,10 @@ struct dm_serial_ops {
  * @buf:	Pointer to the RX buffer
  * @rd_ptr:	Read pointer in the RX buffer
  * @wr_ptr:	Write pointer in the RX buffer
+ *
+ * @tx_buf:	Pointer to the TX buffer, NULL if output is not buffered
+ * @tx_rd:	Number of characters taken from the TX buffer
+ * @tx_wr:	Number of characters added to the TX buffer
  */
 struct serial_dev_priv {
 	struct stdio_dev *sdev;
@@ -277,6 +297,10 @@ struct serial_dev_priv {
 	char *buf;
 	int rd_ptr;
 	int wr_ptr;
+
+	char *tx_buf;
+	uint tx_rd;
+	uint tx_wr;
 };
 
 /* Access the serial operations for a device */
@@ -337,6 +361,15 @@ int serial_printf(const char *fmt, ...)
 
 int serial_init(void);
 void serial_setbrg(void);
+
+/**
+ * serial_flush() - Wait until all buffered output has been sent
+ *
+ * With CONFIG_SERIAL_TX_BUFFER, output is held in a buffer and sent to the
+ * UART when it has space. This writes out everything in the buffer of each
+ * active serial device, e.g. before a reset or jumping to an OS.
+ */
+void serial_flush(void);
 void serial_putc(const char ch);
 void serial_putc_raw(const char ch);
 void serial_puts(const char *str);
@@ -0,0 +1,89 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Size-class allocator for small fixed-size objects
+ *
+ * Driver model allocates a large number of small objects (struct udevice,
+ * struct uclass, small private-data structs) whose size is known both when
+ * they are allocated and when they are freed. This allocator serves them from
+ * pages of same-sized objects so that each one does not need its own heap
+ * chunk. Freed objects are reused, which also works before relocation where
+ * free() is otherwise a no-op.
+ */
+
+#ifndef __SLAB_H
+#define __SLAB_H
+
+#include <malloc.h>
+#include <linux/errno.h>
+
+/* Number of size classes */
+#define SLAB_CLASS_COUNT	8
+
+/* Largest object served from a slab; larger requests use calloc() */
+#define SLAB_MAX_SIZE		256
+
+/**
+ * struct slab_stats - Statistics for a slab size class
+ *
+ * @size: Size of each object in this class in bytes
+ * @pages: Number of pages currently held by this class
+ * @objs: Number of objects currently in use
+ * @peak: Maximum value seen for @objs
+ * @allocs: Total number of objects allocated
+ * @frees: Total number of objects freed
+ */
+struct slab_stats {
+	uint size;
+	uint pages;
+	uint objs;
+	uint peak;
+	ulong allocs;
+	ulong frees;
+};
+
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)
+/**
+ * slab_alloc() - Allocate a zeroed object
+ *
+ * Objects of up to SLAB_MAX_SIZE bytes are allocated from the size class
+ * which fits them. Larger objects are allocated with calloc().
+ *
+ * @size: Size of object in bytes
+ * @return pointer to zeroed object, or NULL if out of memory
+ */
+void *slab_alloc(size_t size);
+
+/**
+ * slab_free() - Free an object allocated by slab_alloc()
+ *
+ * @ptr: Object to free (NULL is ignored)
+ * @size: Size of the object, as passed to slab_alloc()
+ */
+void slab_free(void *ptr, size_t size);
+
+/**
+ * slab_get_stats() - Get statistics for a size class
+ *
+ * @class: Size class (0 to SLAB_CLASS_COUNT - 1)
+ * @stats: Returns statistics for the class
+ * @return 0 if OK, -ENOENT if @class is out of range
+ */
+int slab_get_stats(int class, struct slab_stats *stats);
+#else
+static inline void *slab_alloc(size_t size)
+{
+	return calloc(1, size);
+}
+
+static inline void slab_free(void *ptr, size_t size)
+{
+	free(ptr);
+}
+
+static inline int slab_get_stats(int class, struct slab_stats *stats)
+{
+	return -ENOSYS;
+}
+#endif
+
+#endif
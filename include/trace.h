@@ -25,17 +25,66 @@ enum {
 	FUNC_SITE_SIZE	= 4,	/* distance between function sites */
 };
 
+/**
+ * enum trace_mode - How function calls are recorded in the trace buffer
+ *
+ * @TRACE_MODE_CALLS: A struct trace_call for each function entry and exit
+ * @TRACE_MODE_COMPACT: A delta-encoded variable-length record for each
+ *	function entry and exit (see TRACE_CHUNK_COMPACT)
+ * @TRACE_MODE_AGGREGATE: Call count and inclusive / exclusive time for each
+ *	function, with no record of individual calls
+ */
+enum trace_mode {
+	TRACE_MODE_CALLS,
+	TRACE_MODE_COMPACT,
+	TRACE_MODE_AGGREGATE,
+
+	TRACE_MODE_COUNT,
+};
+
+/*
+ * Chunks written to the profile output. Each starts with a struct
+ * trace_output_hdr:
+ *
+ * TRACE_CHUNK_FUNCS: rec_count struct trace_output_func records
+ * TRACE_CHUNK_CALLS: rec_count struct trace_call records
+ * TRACE_CHUNK_COMPACT: rec_count bytes of compact call records. Each record
+ *	is a sequence of unsigned LEB128 values:
+ *
+ *	(time delta in microseconds << 2) | call type (FUNCF_... >> 30)
+ *	zigzag-encoded function delta, in units of FUNC_SITE_SIZE
+ *	zigzag-encoded caller delta, in units of FUNC_SITE_SIZE
+ *
+ *	Deltas are from the previous record, starting from zero. For
+ *	FUNCF_TEXTBASE records the time delta is zero and the second value is
+ *	the text base. There is no third value and the previous function and
+ *	caller are left unchanged.
+ * TRACE_CHUNK_AGGREGATE: rec_count struct trace_output_agg records
+ */
 enum trace_chunk_type {
 	TRACE_CHUNK_FUNCS,
 	TRACE_CHUNK_CALLS,
+	TRACE_CHUNK_COMPACT,
+	TRACE_CHUNK_AGGREGATE,
 };
 
+/* Maximum size of a record in a TRACE_CHUNK_COMPACT chunk */
+#define TRACE_COMPACT_MAX	20
+
 /* A trace record for a function, as written to the profile output file */
 struct trace_output_func {
 	uint32_t offset;		/* Function offset into code */
 	uint32_t call_count;		/* Number of times called */
 };
 
+/* Time spent in a function, as written to the profile output file */
+struct trace_output_agg {
+	uint32_t offset;		/* Function offset into code */
+	uint32_t call_count;		/* Number of times called */
+	uint64_t incl_us;		/* Time including called functions */
+	uint64_t excl_us;		/* Time excluding called functions */
+};
+
 /* A header at the start of the trace output buffer */
 struct trace_output_hdr {
 	enum trace_chunk_type type;	/* Record type */
@@ -77,8 +126,45 @@ struct trace_call {
 	uint32_t flags;		/* Flags and timestamp */
 };
 
+/**
+ * Dump the recorded function calls into a buffer
+ *
+ * The chunk written depends on the trace mode: TRACE_CHUNK_CALLS,
+ * TRACE_CHUNK_COMPACT or TRACE_CHUNK_AGGREGATE.
+ *
+ * @param buff		Buffer in which to place data, or NULL to count size
+ * @param buff_size	Size of buffer
+ * @param needed	Returns number of bytes used / needed
+ * @return 0 if ok, -ENOSPC if space was exhausted
+ */
 int trace_list_calls(void *buff, size_t buff_size, size_t *needed);
 
+/**
+ * Get the name of a trace mode
+ *
+ * @param mode		Mode to look up
+ * @return name of mode, e.g. "compact", or NULL if invalid
+ */
+const char *trace_get_mode_name(enum trace_mode mode);
+
+/**
+ * Get the current trace mode
+ *
+ * @return current mode (enum trace_mode), or -ENOENT if trace is not set up
+ */
+int trace_get_mode(void);
+
+/**
+ * Change the way function calls are recorded
+ *
+ * Any calls recorded so far are discarded. Function call counts are kept.
+ *
+ * @param mode		New mode
+ * @return 0 if ok, -ENOENT if trace is not set up, -EINVAL if @mode is
+ *	invalid, -ENOSPC if there is not enough space in the buffer
+ */
+int trace_set_mode(enum trace_mode mode);
+
 /**
  * Turn function tracing on and off
  *
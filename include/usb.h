@@ -13,6 +13,7 @@
 
 #include <fdtdec.h>
 #include <usb_defs.h>
+#include <linux/list.h>
 #include <linux/usb/ch9.h>
 #include <asm/cache.h>
 #include <part.h>
@@ -179,6 +180,33 @@ int usb_reset_root_port(struct usb_device *dev);
 #define usb_reset_root_port(dev)
 #endif
 
+/**
+ * struct usb_bulk_req - a bulk transfer queued with usb_bulk_submit()
+ *
+ * The caller fills in @pipe, @buffer and @length. The rest is set up when the
+ * request is submitted.
+ *
+ * @pipe:	Bulk pipe to use
+ * @buffer:	Data buffer, which must stay valid until the request is done.
+ *		This should be DMA-aligned.
+ * @length:	Number of bytes to transfer
+ * @act_len:	Number of bytes actually transferred, once done
+ * @status:	USB_ST_... status once done, 0 if the transfer succeeded
+ * @done:	true once the request has completed or been cancelled
+ * @list:	Used by the host controller driver while the request is queued
+ * @hcpriv:	Private data for the host controller driver
+ */
+struct usb_bulk_req {
+	unsigned long pipe;
+	void *buffer;
+	int length;
+	int act_len;
+	unsigned long status;
+	bool done;
+	struct list_head list;
+	void *hcpriv[3];
+};
+
 int submit_bulk_msg(struct usb_device *dev, unsigned long pipe,
 			void *buffer, int transfer_len);
 int submit_control_msg(struct usb_device *dev, unsigned long pipe, void *buffer,
@@ -194,6 +222,11 @@ int destroy_int_queue(struct usb_device *dev, struct int_queue *queue);
 void *poll_int_queue(struct usb_device *dev, struct int_queue *queue);
 #endif
 
+int submit_bulk_req(struct usb_device *dev, struct usb_bulk_req *req);
+int reap_bulk_req(struct usb_device *dev, struct usb_bulk_req *req,
+		  int timeout);
+int cancel_bulk_reqs(struct usb_device *dev, unsigned long pipe);
+
 /* Defines */
 #define USB_UHCI_VEND_ID	0x8086
 #define USB_UHCI_DEV_ID		0x7112
@@ -269,6 +302,48 @@ int usb_bulk_msg(struct usb_device *dev, unsigned int pipe,
 			void *data, int len, int *actual_length, int timeout);
 int usb_int_msg(struct usb_device *dev, unsigned long pipe,
 		void *buffer, int transfer_len, int interval, bool nonblock);
+
+/**
+ * usb_bulk_submit() - Queue a bulk transfer without waiting for it
+ *
+ * Controllers which can do so keep several transfers queued on an endpoint,
+ * moving from one to the next without waiting for software. Requests on the
+ * same pipe complete in the order they were submitted. With other controllers
+ * the transfer is carried out by usb_bulk_reap() instead, so requests should
+ * be reaped in the order they were submitted.
+ *
+ * @dev:	USB device to transfer with
+ * @req:	Request to queue, with @pipe, @buffer and @length filled in
+ * @return 0 if queued, -EBUSY if the controller cannot take any more
+ *	requests until some are reaped, other -ve on error
+ */
+int usb_bulk_submit(struct usb_device *dev, struct usb_bulk_req *req);
+
+/**
+ * usb_bulk_reap() - Wait for a queued bulk transfer to complete
+ *
+ * Any other requests which complete meanwhile are marked as done, so reaping
+ * the last of several requests reaps them all.
+ *
+ * @dev:	USB device the request was submitted to
+ * @req:	Request to wait for
+ * @timeout:	Time to wait in milliseconds, 0 to just check
+ * @return 0 if the transfer succeeded, -ETIMEDOUT if it is still queued,
+ *	-EIO if it failed (see @req->status)
+ */
+int usb_bulk_reap(struct usb_device *dev, struct usb_bulk_req *req,
+		  int timeout);
+
+/**
+ * usb_bulk_cancel() - Cancel the bulk transfers still queued on a pipe
+ *
+ * Requests which have not completed are marked as done with a status of
+ * USB_ST_NOT_PROC. This also restarts an endpoint which halted on an error.
+ *
+ * @dev:	USB device the requests were submitted to
+ * @pipe:	Pipe to cancel
+ */
+void usb_bulk_cancel(struct usb_device *dev, unsigned long pipe);
 int usb_disable_asynch(int disable);
 int usb_maxpacket(struct usb_device *dev, unsigned long pipe);
 int usb_get_configuration_no(struct usb_device *dev, int cfgno,
@@ -791,6 +866,40 @@ struct dm_usb_ops {
 	 * in a USB transfer. USB class driver needs to be aware of this.
 	 */
 	int (*get_max_xfer_size)(struct udevice *bus, size_t *size);
+
+	/**
+	 * submit_bulk_req() - Queue a bulk transfer without waiting for it
+	 *
+	 * This may be NULL, in which case usb_bulk_reap() carries out the
+	 * transfer with bulk().
+	 *
+	 * @req: Request to queue
+	 * @return 0 if queued, -EBUSY if there is no room for it yet, other
+	 *	-ve on error
+	 */
+	int (*submit_bulk_req)(struct udevice *bus, struct usb_device *udev,
+			       struct usb_bulk_req *req);
+
+	/**
+	 * reap_bulk_req() - Process completed bulk transfers
+	 *
+	 * This handles completions until @req is done, updating each request
+	 * which completes.
+	 *
+	 * @req: Request to wait for
+	 * @timeout: Time to wait in milliseconds, 0 to just check
+	 * @return 0 if @req is done, -ETIMEDOUT if it is still queued
+	 */
+	int (*reap_bulk_req)(struct udevice *bus, struct usb_device *udev,
+			     struct usb_bulk_req *req, int timeout);
+
+	/**
+	 * cancel_bulk_reqs() - Cancel the bulk transfers queued on a pipe
+	 *
+	 * @return 0 if OK, -ve on error
+	 */
+	int (*cancel_bulk_reqs)(struct udevice *bus, struct usb_device *udev,
+				unsigned long pipe);
 };
 
 #define usb_get_ops(dev)	((struct dm_usb_ops *)(dev)->driver->ops)
@@ -1067,6 +1067,9 @@ struct xhci_virt_ep {
 #define EP_HAS_STREAMS		(1 << 4)
 /* Transitioning the endpoint to not using streams, don't enqueue URBs */
 #define EP_GETTING_NO_STREAMS	(1 << 5)
+	/* Bulk transfers queued by xhci_bulk_submit(), oldest first */
+	struct list_head		bulk_reqs;
+	unsigned int			bulk_trbs;	/* TRBs they use */
 };
 
 #define CTX_SIZE(_hcc) (HCC_64BYTE_CONTEXT(_hcc) ? 64 : 32)
@@ -1255,6 +1258,10 @@ void xhci_acknowledge_event(struct xhci_ctrl *ctrl);
 union xhci_trb *xhci_wait_for_event(struct xhci_ctrl *ctrl, trb_type expected);
 int xhci_bulk_tx(struct usb_device *udev, unsigned long pipe,
 		 int length, void *buffer);
+int xhci_bulk_submit(struct usb_device *udev, struct usb_bulk_req *req);
+int xhci_bulk_reap(struct usb_device *udev, struct usb_bulk_req *req,
+		   int timeout);
+void xhci_bulk_cancel(struct usb_device *udev, unsigned long pipe);
 int xhci_ctrl_tx(struct usb_device *udev, unsigned long pipe,
 		 struct devrequest *req, int length, void *buffer);
 int xhci_check_maxpacket(struct usb_device *udev);
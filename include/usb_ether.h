@@ -7,15 +7,23 @@
 #define __USB_ETHER_H__
 
 #include <net.h>
+#include <usb.h>
+
+/* Number of receive transfers kept queued on the bulk in endpoint */
+#define USB_ETHER_RX_QUEUE	4
 
 /* TODO(sjg@chromium.org): Remove @pusb_dev when all boards use CONFIG_DM_ETH */
 struct ueth_data {
 	/* eth info */
 #ifdef CONFIG_DM_ETH
-	uint8_t *rxbuf;
+	uint8_t *rxbuf;			/* Buffer being processed */
 	int rxsize;
 	int rxlen;			/* Total bytes available in rxbuf */
 	int rxptr;			/* Current position in rxbuf */
+	struct usb_bulk_req rxreq[USB_ETHER_RX_QUEUE];	/* Receive buffers */
+	int rxhead;			/* Oldest queued receive */
+	bool rxqueued;			/* Receives have been submitted */
+	bool rxheld;			/* rxreq[rxhead] is being processed */
 #else
 	struct eth_device eth_dev;	/* used with eth_register */
 	/* driver private */
@@ -58,7 +66,9 @@ int usb_ether_deregister(struct ueth_data *ueth);
 /**
  * usb_ether_receive() - recieve a packet from the bulk in endpoint
  *
- * The packet is stored in the internal buffer ready for processing.
+ * The packet is stored in the internal buffer ready for processing. Several
+ * receive transfers are kept queued, so that the controller can take packets
+ * while earlier ones are being processed.
  *
  * @ueth:	USB Ethernet device
  * @rxsize:	Maximum size to receive
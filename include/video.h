@@ -61,7 +61,10 @@ enum video_log2_bpp {
  * @vidconsole_drv_name:	Driver to use for the text console, NULL to
  *		select automatically
  * @font_size:	Font size in pixels (0 to use a default value)
- * @fb:		Frame buffer
+ * @yvirt:	Number of pixel rows in the frame buffer, if the driver can
+ *		pan the display over a frame buffer taller than it (see
+ *		struct video_ops). 0 if the display cannot pan
+ * @fb:		Frame buffer, from the first row shown on the display
  * @fb_size:	Frame buffer size
  * @line_length:	Length of each frame buffer line, in bytes. This can be
  *		set by the driver, but if not, the uclass will set it after
@@ -73,6 +76,13 @@ enum video_log2_bpp {
  * @cmap:	Colour map for 8-bit-per-pixel displays
  * @fg_col_idx:	Foreground color code (bit 3 = bold, bit 0-2 = color)
  * @bg_col_idx:	Background color code (bit 3 = bold, bit 0-2 = color)
+ * @yoffset:	Frame buffer row shown at the top of the display
+ * @no_pan:	true if panning has been disabled with video_pan_disable()
+ * @dirty_ystart:	First frame buffer row changed since the last sync
+ * @dirty_yend:	Row after the last one changed since the last sync (equal
+ *		to @dirty_ystart if nothing has changed)
+ * @sync_all:	true if something writes to the frame buffer without calling
+ *		video_damage(), so that every sync flushes all of it
  */
 struct video_priv {
 	/* Things set up by the driver: */
@@ -82,6 +92,7 @@ struct video_priv {
 	enum video_log2_bpp bpix;
 	const char *vidconsole_drv_name;
 	int font_size;
+	ushort yvirt;
 
 	/*
 	 * Things that are private to the uclass: don't use these in the
@@ -96,10 +107,31 @@ struct video_priv {
 	ushort *cmap;
 	u8 fg_col_idx;
 	u8 bg_col_idx;
+	int yoffset;
+	bool no_pan;
+	int dirty_ystart;
+	int dirty_yend;
+	bool sync_all;
 };
 
-/* Placeholder - there are no video operations at present */
+/**
+ * struct video_ops - Video driver operations
+ *
+ * All of these are optional.
+ */
 struct video_ops {
+	/**
+	 * set_pan() - Set the frame buffer row shown at the top of the display
+	 *
+	 * This is used to scroll the display without copying the frame
+	 * buffer. The driver must set @yvirt in struct video_priv and reserve
+	 * enough memory for that many rows.
+	 *
+	 * @dev:	Device to update
+	 * @yoffset:	Row to show at the top, from 0 to @yvirt - @ysize
+	 * @return 0 if OK, -ve on error
+	 */
+	int (*set_pan)(struct udevice *dev, uint yoffset);
 };
 
 #define video_get_ops(dev)        ((struct video_ops *)(dev)->driver->ops)
@@ -130,12 +162,53 @@ int video_reserve(ulong *addrp);
  */
 int video_clear(struct udevice *dev);
 
+/**
+ * video_damage() - Record that part of a device's frame buffer has changed
+ *
+ * Code which writes to the frame buffer must call this so that the next
+ * video_sync() knows which rows to flush.
+ *
+ * @dev:	Device which was updated
+ * @y:		First row changed, in pixels from the top of the display
+ * @height:	Number of rows changed
+ */
+void video_damage(struct udevice *dev, int y, int height);
+
+/**
+ * video_scroll_pan() - Scroll the display up by panning
+ *
+ * This moves the display down the frame buffer by @lines rows, so that the
+ * top @lines rows disappear and the same number of rows, cleared to the
+ * background colour, appear at the bottom. Nothing is copied until the end
+ * of the frame buffer is reached, when the display is moved back to the
+ * start.
+ *
+ * @dev:	Device to scroll
+ * @lines:	Number of pixel rows to scroll by
+ * @return 0 if OK, -ENOSYS if the device cannot pan, other -ve on error
+ */
+int video_scroll_pan(struct udevice *dev, int lines);
+
+/**
+ * video_pan_disable() - Stop scrolling by panning
+ *
+ * This moves the display back to the start of the frame buffer, for users
+ * which need the frame buffer to stay at a fixed address, such as the EFI
+ * graphics output protocol. Scrolling copies the frame buffer from then on.
+ *
+ * @dev:	Device to update
+ * @return 0 if OK, -ve on error
+ */
+int video_pan_disable(struct udevice *dev);
+
 /**
  * video_sync() - Sync a device's frame buffer with its hardware
  *
  * Some frame buffers are cached or have a secondary frame buffer. This
  * function syncs these up so that the current contents of the U-Boot frame
- * buffer are displayed to the user.
+ * buffer are displayed to the user. Only the rows marked with
+ * video_damage() since the last sync are flushed from the cache, unless
+ * video_set_sync_all() has been used.
  *
  * @dev:	Device to sync
  * @force:	True to force a sync even if there was one recently (this is
@@ -194,6 +267,19 @@ int video_get_ysize(struct udevice *dev);
  */
 void video_set_flush_dcache(struct udevice *dev, bool flush);
 
+/**
+ * video_set_sync_all() - Set whether each sync covers the whole frame buffer
+ *
+ * This is needed when the frame buffer is handed to code which writes to it
+ * directly and does not call video_damage(), such as an EFI application using
+ * the graphics output protocol.
+ *
+ * @dev:	Device to update
+ * @sync_all:	true to flush the whole frame buffer on every sync, false to
+ *		only flush the rows marked with video_damage()
+ */
+void video_set_sync_all(struct udevice *dev, bool sync_all);
+
 /**
  * Set default colors and attributes
  *
@@ -109,6 +109,10 @@ struct vidconsole_ops {
 	/**
 	 * move_rows() - Move text rows from one place to another
 	 *
+	 * When the rows are moved up from the bottom of the display, this
+	 * may scroll the display with video_scroll_pan(). The rows left
+	 * behind are then cleared to the background colour.
+	 *
 	 * @dev:	Device to adjust
 	 * @rowdst:	Destination text row (0=top)
 	 * @rowsrc:	Source start text row
@@ -258,4 +262,39 @@ u32 vid_console_color(struct video_priv *priv, unsigned int idx);
 
 #endif
 
+/**
+ * struct console_tt_cache_stats - Statistics of the TrueType glyph cache
+ *
+ * @hits:	Number of characters drawn from the cache
+ * @misses:	Number of characters which had to be rendered
+ * @entries:	Number of character images in the cache
+ * @size:	Number of bytes of memory used by the cache
+ * @max_size:	Maximum number of bytes the cache can use
+ */
+struct console_tt_cache_stats {
+	uint hits;
+	uint misses;
+	uint entries;
+	uint size;
+	uint max_size;
+};
+
+/**
+ * console_truetype_cache_configure() - Empty and resize the glyph cache
+ *
+ * The TrueType console keeps the images of the characters it draws, so that
+ * drawing them again does not need the font to be rendered. This empties
+ * the cache, resets its statistics and sets how much memory it can use.
+ *
+ * @max_size:	Maximum number of bytes to use (0 to disable the cache)
+ */
+void console_truetype_cache_configure(uint max_size);
+
+/**
+ * console_truetype_cache_stats() - Return statistics and reset them
+ *
+ * @stats:	Returns the statistics. The hit and miss counts are then reset
+ */
+void console_truetype_cache_stats(struct console_tt_cache_stats *stats);
+
 #endif
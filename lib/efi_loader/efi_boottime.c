@@ -15,6 +15,7 @@
 #include <u-boot/crc.h>
 #include <bootm.h>
 #include <pe.h>
+#include <serial.h>
 #include <u-boot/crc.h>
 #include <watchdog.h>
 
@@ -1987,6 +1988,10 @@ static efi_status_t EFIAPI efi_exit_boot_services(efi_handle_t image_handle,
 			list_del(&evt->link);
 	}
 
+	/* The payload takes over the console, so send what is left */
+	if (CONFIG_IS_ENABLED(SERIAL_TX_BUFFER))
+		serial_flush();
+
 	board_quiesce_devices();
 
 	/* Patch out unsupported runtime function */
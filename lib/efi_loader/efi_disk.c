@@ -12,14 +12,45 @@
 #include <fs.h>
 #include <part.h>
 #include <malloc.h>
+#include <memalign.h>
+#include <linux/math64.h>
+#include <linux/sizes.h>
 
 const efi_guid_t efi_block_io_guid = EFI_BLOCK_IO_PROTOCOL_GUID;
+const efi_guid_t efi_block_io2_guid = EFI_BLOCK_IO2_PROTOCOL_GUID;
+const efi_guid_t efi_disk_io_guid = EFI_DISK_IO_PROTOCOL_GUID;
+
+/*
+ * Size of the buffer through which EFI_DISK_IO_PROTOCOL accesses partial
+ * blocks and unaligned buffers. Reads fill the whole buffer so that
+ * sequential small reads are served from memory.
+ */
+#define EFI_DISK_IO_BUF_SIZE	SZ_32K
+
+/*
+ * Blocks read ahead for EFI_DISK_IO_PROTOCOL. They are held per block device
+ * rather than per handle, so that efi_disk_invalidate() can drop them
+ * whenever the device is written, whichever handle or command does it.
+ *
+ * @disk_io_desc:	block device the blocks were read from
+ * @disk_io_lba:	first block held, counted from the start of the device
+ * @disk_io_blocks:	number of valid blocks, 0 if empty
+ * @disk_io_buf:	buffer holding the blocks
+ * @disk_io_size:	size of @disk_io_buf in bytes
+ */
+static struct blk_desc *disk_io_desc;
+static lbaint_t disk_io_lba;
+static lbaint_t disk_io_blocks;
+static u8 *disk_io_buf;
+static size_t disk_io_size;
 
 /**
  * struct efi_disk_obj - EFI disk object
  *
  * @header:	EFI object header
- * @ops:	EFI disk I/O protocol interface
+ * @ops:	EFI block I/O protocol interface
+ * @ops2:	EFI block I/O 2 protocol interface
+ * @disk_io:	EFI disk I/O protocol interface
  * @ifname:	interface name for block device
  * @dev_index:	device index of block device
  * @media:	block I/O media information
@@ -32,6 +63,8 @@ const efi_guid_t efi_block_io_guid = EFI_BLOCK_IO_PROTOCOL_GUID;
 struct efi_disk_obj {
 	struct efi_object header;
 	struct efi_block_io ops;
+	struct efi_block_io2 ops2;
+	struct efi_disk_io disk_io;
 	const char *ifname;
 	int dev_index;
 	struct efi_block_io_media media;
@@ -222,6 +255,394 @@ static const struct efi_block_io block_io_disk_template = {
 	.flush_blocks = &efi_disk_flush_blocks,
 };
 
+/**
+ * efi_disk_reset_ex() - reset block device
+ *
+ * This function implements the Reset service of the EFI_BLOCK_IO2_PROTOCOL.
+ *
+ * See the Unified Extensible Firmware Interface (UEFI) specification for
+ * details.
+ *
+ * @this:			pointer to the BLOCK_IO2_PROTOCOL
+ * @extended_verification:	extended verification
+ * Return:			status code
+ */
+static efi_status_t EFIAPI efi_disk_reset_ex(struct efi_block_io2 *this,
+			char extended_verification)
+{
+	EFI_ENTRY("%p, %x", this, extended_verification);
+	return EFI_EXIT(EFI_SUCCESS);
+}
+
+/**
+ * efi_disk_complete() - complete an EFI_BLOCK_IO2_PROTOCOL request
+ *
+ * U-Boot's block devices have no asynchronous interface, so every request
+ * has been carried out by the time this function is called. For a
+ * non-blocking request the outcome of the transfer is stored in the token
+ * and its event is signaled. Errors in the parameters are still returned
+ * directly, as required by the UEFI specification.
+ *
+ * @token:	token passed by the caller, may be NULL
+ * @ret:	status of the transfer
+ * Return:	status code to return to the caller
+ */
+static efi_status_t efi_disk_complete(struct efi_block_io2_token *token,
+				      efi_status_t ret)
+{
+	if (!token || !token->event)
+		return ret;
+	if (ret != EFI_SUCCESS && ret != EFI_DEVICE_ERROR)
+		return ret;
+
+	token->transaction_status = ret;
+	efi_signal_event(token->event);
+
+	return EFI_SUCCESS;
+}
+
+/**
+ * efi_disk_read_blocks_ex() - read blocks from device
+ *
+ * This function implements the ReadBlocksEx service of the
+ * EFI_BLOCK_IO2_PROTOCOL.
+ *
+ * See the Unified Extensible Firmware Interface (UEFI) specification for
+ * details.
+ *
+ * @this:		pointer to the BLOCK_IO2_PROTOCOL
+ * @media_id:		id of the medium to read from
+ * @lba:		first block to read
+ * @token:		token for non-blocking access, or NULL
+ * @buffer_size:	number of bytes to read
+ * @buffer:		buffer to read to
+ * Return:		status code
+ */
+static efi_status_t EFIAPI efi_disk_read_blocks_ex(struct efi_block_io2 *this,
+			u32 media_id, u64 lba,
+			struct efi_block_io2_token *token,
+			efi_uintn_t buffer_size, void *buffer)
+{
+	struct efi_disk_obj *diskobj;
+	efi_status_t ret;
+
+	EFI_ENTRY("%p, %x, %llx, %p, %zx, %p", this, media_id, lba, token,
+		  buffer_size, buffer);
+
+	if (!this)
+		return EFI_EXIT(EFI_INVALID_PARAMETER);
+	diskobj = container_of(this, struct efi_disk_obj, ops2);
+	ret = EFI_CALL(efi_disk_read_blocks(&diskobj->ops, media_id, lba,
+					    buffer_size, buffer));
+
+	return EFI_EXIT(efi_disk_complete(token, ret));
+}
+
+/**
+ * efi_disk_write_blocks_ex() - write blocks to device
+ *
+ * This function implements the WriteBlocksEx service of the
+ * EFI_BLOCK_IO2_PROTOCOL.
+ *
+ * See the Unified Extensible Firmware Interface (UEFI) specification for
+ * details.
+ *
+ * @this:		pointer to the BLOCK_IO2_PROTOCOL
+ * @media_id:		id of the medium to write to
+ * @lba:		first block to write
+ * @token:		token for non-blocking access, or NULL
+ * @buffer_size:	number of bytes to write
+ * @buffer:		buffer to write from
+ * Return:		status code
+ */
+static efi_status_t EFIAPI efi_disk_write_blocks_ex(struct efi_block_io2 *this,
+			u32 media_id, u64 lba,
+			struct efi_block_io2_token *token,
+			efi_uintn_t buffer_size, void *buffer)
+{
+	struct efi_disk_obj *diskobj;
+	efi_status_t ret;
+
+	EFI_ENTRY("%p, %x, %llx, %p, %zx, %p", this, media_id, lba, token,
+		  buffer_size, buffer);
+
+	if (!this)
+		return EFI_EXIT(EFI_INVALID_PARAMETER);
+	diskobj = container_of(this, struct efi_disk_obj, ops2);
+	ret = EFI_CALL(efi_disk_write_blocks(&diskobj->ops, media_id, lba,
+					     buffer_size, buffer));
+
+	return EFI_EXIT(efi_disk_complete(token, ret));
+}
+
+/**
+ * efi_disk_flush_blocks_ex() - flush written data to device
+ *
+ * This function implements the FlushBlocksEx service of the
+ * EFI_BLOCK_IO2_PROTOCOL. We always write synchronously.
+ *
+ * @this:	pointer to the BLOCK_IO2_PROTOCOL
+ * @token:	token for non-blocking access, or NULL
+ * Return:	status code
+ */
+static efi_status_t EFIAPI efi_disk_flush_blocks_ex(struct efi_block_io2 *this,
+			struct efi_block_io2_token *token)
+{
+	EFI_ENTRY("%p, %p", this, token);
+	return EFI_EXIT(efi_disk_complete(token, EFI_SUCCESS));
+}
+
+static const struct efi_block_io2 block_io2_disk_template = {
+	.reset = &efi_disk_reset_ex,
+	.read_blocks_ex = &efi_disk_read_blocks_ex,
+	.write_blocks_ex = &efi_disk_write_blocks_ex,
+	.flush_blocks_ex = &efi_disk_flush_blocks_ex,
+};
+
+/**
+ * efi_disk_io_check() - check the parameters of a disk I/O request
+ *
+ * @diskobj:	disk object
+ * @media_id:	id of the medium to access
+ * @offset:	first byte to access
+ * @size:	number of bytes to access
+ * Return:	status code
+ */
+static efi_status_t efi_disk_io_check(struct efi_disk_obj *diskobj,
+				      u32 media_id, u64 offset, u64 size)
+{
+	struct efi_block_io_media *media = &diskobj->media;
+
+	if (media_id != media->media_id)
+		return EFI_MEDIA_CHANGED;
+	if (!media->media_present)
+		return EFI_NO_MEDIA;
+	if (offset + size < offset ||
+	    offset + size > media->last_block * media->block_size)
+		return EFI_INVALID_PARAMETER;
+
+	return EFI_SUCCESS;
+}
+
+/**
+ * efi_disk_io_block() - get a block through the disk I/O buffer
+ *
+ * If the block is not held in the buffer already, the buffer is refilled
+ * starting with this block.
+ *
+ * @diskobj:	disk object
+ * @lba:	block number
+ * @countp:	returns the number of blocks held from @lba onwards
+ * Return:	pointer to the contents of the block, NULL on error
+ */
+static u8 *efi_disk_io_block(struct efi_disk_obj *diskobj, u64 lba,
+			     u64 *countp)
+{
+	u32 blksz = diskobj->media.block_size;
+	lbaint_t start = diskobj->offset + lba;
+	size_t size = max(EFI_DISK_IO_BUF_SIZE, (int)blksz);
+	u64 count;
+	efi_status_t ret;
+
+	if (diskobj->desc == disk_io_desc && start >= disk_io_lba &&
+	    start < disk_io_lba + disk_io_blocks) {
+		*countp = disk_io_lba + disk_io_blocks - start;
+		return disk_io_buf + (start - disk_io_lba) * blksz;
+	}
+
+	disk_io_blocks = 0;
+	if (size > disk_io_size) {
+		free(disk_io_buf);
+		disk_io_size = 0;
+		disk_io_buf = malloc_cache_aligned(size);
+		if (!disk_io_buf)
+			return NULL;
+		disk_io_size = size;
+	}
+	count = size / blksz;
+	count = min(count, diskobj->media.last_block - lba);
+	ret = EFI_CALL(efi_disk_read_blocks(&diskobj->ops,
+					    diskobj->media.media_id, lba,
+					    count * blksz, disk_io_buf));
+	if (ret != EFI_SUCCESS)
+		return NULL;
+	disk_io_desc = diskobj->desc;
+	disk_io_lba = start;
+	disk_io_blocks = count;
+	*countp = count;
+
+	return disk_io_buf;
+}
+
+/**
+ * efi_disk_invalidate() - drop blocks read ahead for the disk I/O protocol
+ *
+ * @desc:	block device which is being written or removed
+ */
+void efi_disk_invalidate(struct blk_desc *desc)
+{
+	if (desc == disk_io_desc) {
+		disk_io_desc = NULL;
+		disk_io_blocks = 0;
+	}
+}
+
+/**
+ * efi_disk_read_disk() - read from device
+ *
+ * This function implements the ReadDisk service of the
+ * EFI_DISK_IO_PROTOCOL.
+ *
+ * Runs of whole blocks are read straight into the caller's buffer if it is
+ * suitably aligned. Partial blocks and unaligned buffers are served from a
+ * buffer of recently read blocks.
+ *
+ * See the Unified Extensible Firmware Interface (UEFI) specification for
+ * details.
+ *
+ * @this:		pointer to the DISK_IO_PROTOCOL
+ * @media_id:		id of the medium to read from
+ * @offset:		byte offset to start reading at
+ * @buffer_size:	number of bytes to read
+ * @buffer:		buffer to read to
+ * Return:		status code
+ */
+static efi_status_t EFIAPI efi_disk_read_disk(struct efi_disk_io *this,
+			u32 media_id, u64 offset, efi_uintn_t buffer_size,
+			void *buffer)
+{
+	struct efi_disk_obj *diskobj;
+	u8 *dst = buffer;
+	efi_status_t ret;
+	u32 blksz;
+
+	EFI_ENTRY("%p, %x, %llx, %zx, %p", this, media_id, offset,
+		  buffer_size, buffer);
+
+	if (!this || (buffer_size && !buffer))
+		return EFI_EXIT(EFI_INVALID_PARAMETER);
+	diskobj = container_of(this, struct efi_disk_obj, disk_io);
+	ret = efi_disk_io_check(diskobj, media_id, offset, buffer_size);
+	if (ret != EFI_SUCCESS)
+		return EFI_EXIT(ret);
+	blksz = diskobj->media.block_size;
+
+	while (buffer_size) {
+		u32 skip;
+		u64 lba = div_u64_rem(offset, blksz, &skip);
+		efi_uintn_t len;
+		u64 count;
+		u8 *blk;
+
+		if (!skip && buffer_size >= blksz &&
+		    !((uintptr_t)dst & (blksz - 1))) {
+			len = buffer_size - buffer_size % blksz;
+			ret = EFI_CALL(efi_disk_read_blocks(&diskobj->ops,
+							    media_id, lba, len,
+							    dst));
+			if (ret != EFI_SUCCESS)
+				break;
+		} else {
+			blk = efi_disk_io_block(diskobj, lba, &count);
+			if (!blk) {
+				ret = EFI_DEVICE_ERROR;
+				break;
+			}
+			len = count * blksz - skip;
+			len = min(len, buffer_size);
+			memcpy(dst, blk + skip, len);
+		}
+		offset += len;
+		dst += len;
+		buffer_size -= len;
+	}
+
+	return EFI_EXIT(ret);
+}
+
+/**
+ * efi_disk_write_disk() - write to device
+ *
+ * This function implements the WriteDisk service of the
+ * EFI_DISK_IO_PROTOCOL.
+ *
+ * Runs of whole blocks are written straight from the caller's buffer if it
+ * is suitably aligned. Other blocks are updated by reading, modifying and
+ * writing back a single block.
+ *
+ * See the Unified Extensible Firmware Interface (UEFI) specification for
+ * details.
+ *
+ * @this:		pointer to the DISK_IO_PROTOCOL
+ * @media_id:		id of the medium to write to
+ * @offset:		byte offset to start writing at
+ * @buffer_size:	number of bytes to write
+ * @buffer:		buffer to write from
+ * Return:		status code
+ */
+static efi_status_t EFIAPI efi_disk_write_disk(struct efi_disk_io *this,
+			u32 media_id, u64 offset, efi_uintn_t buffer_size,
+			void *buffer)
+{
+	struct efi_disk_obj *diskobj;
+	u8 *src = buffer;
+	efi_status_t ret;
+	u32 blksz;
+
+	EFI_ENTRY("%p, %x, %llx, %zx, %p", this, media_id, offset,
+		  buffer_size, buffer);
+
+	if (!this || (buffer_size && !buffer))
+		return EFI_EXIT(EFI_INVALID_PARAMETER);
+	diskobj = container_of(this, struct efi_disk_obj, disk_io);
+	if (diskobj->media.read_only)
+		return EFI_EXIT(EFI_WRITE_PROTECTED);
+	ret = efi_disk_io_check(diskobj, media_id, offset, buffer_size);
+	if (ret != EFI_SUCCESS)
+		return EFI_EXIT(ret);
+	blksz = diskobj->media.block_size;
+
+	while (buffer_size) {
+		u32 skip;
+		u64 lba = div_u64_rem(offset, blksz, &skip);
+		efi_uintn_t len;
+		u64 count;
+		u8 *blk;
+
+		if (!skip && buffer_size >= blksz &&
+		    !((uintptr_t)src & (blksz - 1))) {
+			len = buffer_size - buffer_size % blksz;
+			ret = EFI_CALL(efi_disk_write_blocks(&diskobj->ops,
+							     media_id, lba, len,
+							     src));
+		} else {
+			blk = efi_disk_io_block(diskobj, lba, &count);
+			if (!blk) {
+				ret = EFI_DEVICE_ERROR;
+				break;
+			}
+			len = min(buffer_size, (efi_uintn_t)(blksz - skip));
+			memcpy(blk + skip, src, len);
+			ret = EFI_CALL(efi_disk_write_blocks(&diskobj->ops,
+							     media_id, lba,
+							     blksz, blk));
+		}
+		if (ret != EFI_SUCCESS)
+			break;
+		offset += len;
+		src += len;
+		buffer_size -= len;
+	}
+
+	return EFI_EXIT(ret);
+}
+
+static const struct efi_disk_io disk_io_template = {
+	.revision = EFI_DISK_IO_PROTOCOL_REVISION,
+	.read_disk = &efi_disk_read_disk,
+	.write_disk = &efi_disk_write_disk,
+};
+
 /*
  * Get the simple file system protocol for a file device path.
  *
@@ -333,6 +754,14 @@ static efi_status_t efi_disk_add_dev(
 			       &diskobj->ops);
 	if (ret != EFI_SUCCESS)
 		return ret;
+	ret = efi_add_protocol(&diskobj->header, &efi_block_io2_guid,
+			       &diskobj->ops2);
+	if (ret != EFI_SUCCESS)
+		return ret;
+	ret = efi_add_protocol(&diskobj->header, &efi_disk_io_guid,
+			       &diskobj->disk_io);
+	if (ret != EFI_SUCCESS)
+		return ret;
 	ret = efi_add_protocol(&diskobj->header, &efi_guid_device_path,
 			       diskobj->dp);
 	if (ret != EFI_SUCCESS)
@@ -349,6 +778,8 @@ static efi_status_t efi_disk_add_dev(
 			return ret;
 	}
 	diskobj->ops = block_io_disk_template;
+	diskobj->ops2 = block_io2_disk_template;
+	diskobj->disk_io = disk_io_template;
 	diskobj->ifname = if_typename;
 	diskobj->dev_index = dev_index;
 	diskobj->offset = offset;
@@ -368,6 +799,7 @@ static efi_status_t efi_disk_add_dev(
 	if (part != 0)
 		diskobj->media.logical_partition = 1;
 	diskobj->ops.media = &diskobj->media;
+	diskobj->ops2.media = &diskobj->media;
 	if (disk)
 		*disk = diskobj;
 	return EFI_SUCCESS;
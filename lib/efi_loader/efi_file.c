@@ -33,6 +33,9 @@ struct file_handle {
 	int isdir;
 	u64 open_mode;
 
+	/* for reading a file, opened on first read: */
+	struct fs_file *file;
+
 	/* for reading a directory: */
 	struct fs_dir_stream *dirs;
 	struct fs_dirent *dent;
@@ -295,6 +298,7 @@ out:
 
 static efi_status_t file_close(struct file_handle *fh)
 {
+	fs_close_file(fh->file);
 	fs_closedir(fh->dirs);
 	free(fh);
 	return EFI_SUCCESS;
@@ -331,6 +335,12 @@ static efi_status_t EFIAPI efi_file_delete(struct efi_file_handle *file)
 static efi_status_t efi_get_file_size(struct file_handle *fh,
 				      loff_t *file_size)
 {
+	if (fh->file) {
+		if (fs_file_size(fh->file, file_size))
+			return EFI_DEVICE_ERROR;
+		return EFI_SUCCESS;
+	}
+
 	if (set_blk_dev(fh))
 		return EFI_DEVICE_ERROR;
 
@@ -347,6 +357,15 @@ static efi_status_t file_read(struct file_handle *fh, u64 *buffer_size,
 	efi_status_t ret;
 	loff_t file_size;
 
+	/*
+	 * Keep the file open so that the many small reads made by boot
+	 * loaders do not each mount the filesystem and look up the file
+	 */
+	if (!fh->file) {
+		if (set_blk_dev(fh) || fs_open(fh->path, &fh->file))
+			return EFI_DEVICE_ERROR;
+	}
+
 	ret = efi_get_file_size(fh, &file_size);
 	if (ret != EFI_SUCCESS)
 		return ret;
@@ -355,10 +374,8 @@ static efi_status_t file_read(struct file_handle *fh, u64 *buffer_size,
 		return ret;
 	}
 
-	if (set_blk_dev(fh))
-		return EFI_DEVICE_ERROR;
-	if (fs_read(fh->path, map_to_sysmem(buffer), fh->offset,
-		    *buffer_size, &actread))
+	if (fs_read_at(fh->file, map_to_sysmem(buffer), fh->offset,
+		       *buffer_size, &actread))
 		return EFI_DEVICE_ERROR;
 
 	*buffer_size = actread;
@@ -25,6 +25,7 @@ static const efi_guid_t efi_gop_guid = EFI_GRAPHICS_OUTPUT_PROTOCOL_GUID;
  * @mode:	graphical output mode
  * @bpix:	bits per pixel
  * @fb:		frame buffer
+ * @vdev:	video device
  */
 struct efi_gop_obj {
 	struct efi_object header;
@@ -34,6 +35,9 @@ struct efi_gop_obj {
 	/* Fields we only have access to during init */
 	u32 bpix;
 	void *fb;
+#ifdef CONFIG_DM_VIDEO
+	struct udevice *vdev;
+#endif
 };
 
 static efi_status_t EFIAPI gop_query_mode(struct efi_gop *this, u32 mode_number,
@@ -413,6 +417,12 @@ efi_status_t EFIAPI gop_blt(struct efi_gop *this, struct efi_gop_pixel *buffer,
 		return EFI_EXIT(ret);
 
 #ifdef CONFIG_DM_VIDEO
+	if (operation != EFI_BLT_VIDEO_TO_BLT_BUFFER) {
+		struct efi_gop_obj *gopobj;
+
+		gopobj = container_of(this, struct efi_gop_obj, ops);
+		video_damage(gopobj->vdev, dy, height);
+	}
 	video_sync_all();
 #else
 	lcd_sync();
@@ -445,6 +455,12 @@ efi_status_t efi_gop_register(void)
 		return EFI_SUCCESS;
 	}
 
+	/*
+	 * EFI applications expect the frame buffer to stay where it is, and
+	 * write to it without telling us what they changed
+	 */
+	video_pan_disable(vdev);
+	video_set_sync_all(vdev, true);
 	priv = dev_get_uclass_priv(vdev);
 	bpix = priv->bpix;
 	col = video_get_xsize(vdev);
@@ -525,6 +541,9 @@ efi_status_t efi_gop_register(void)
 	gopobj->info.pixels_per_scanline = col;
 	gopobj->bpix = bpix;
 	gopobj->fb = fb;
+#ifdef CONFIG_DM_VIDEO
+	gopobj->vdev = vdev;
+#endif
 
 	return EFI_SUCCESS;
 }
@@ -11,7 +11,7 @@
 #include <malloc.h>
 #include <mapmem.h>
 #include <watchdog.h>
-#include <linux/list_sort.h>
+#include <linux/rbtree_augmented.h>
 #include <linux/sizes.h>
 
 DECLARE_GLOBAL_DATA_PTR;
@@ -21,17 +21,28 @@ DECLARE_GLOBAL_DATA_PTR;
 
 efi_uintn_t efi_memory_map_key;
 
+/**
+ * struct efi_mem_list - memory map entry
+ *
+ * @node:	node in the efi_mem tree, which is sorted by address
+ * @desc:	memory descriptor
+ * @max_free:	largest number of pages in a single EFI_CONVENTIONAL_MEMORY
+ *		entry in the subtree rooted at this node
+ */
 struct efi_mem_list {
-	struct list_head link;
+	struct rb_node node;
 	struct efi_mem_desc desc;
+	u64 max_free;
 };
 
-#define EFI_CARVE_NO_OVERLAP		-1
-#define EFI_CARVE_LOOP_AGAIN		-2
-#define EFI_CARVE_OVERLAPS_NONRAM	-3
+/*
+ * This tree contains all memory map items. Items never overlap so it can be
+ * sorted by start address, which also sorts it by end address.
+ */
+static struct rb_root efi_mem = RB_ROOT;
 
-/* This list contains all memory map items */
-LIST_HEAD(efi_mem);
+/* Number of items in efi_mem */
+static efi_uintn_t efi_mem_count;
 
 #ifdef CONFIG_EFI_LOADER_BOUNCE_BUFFER
 void *efi_bounce_buffer;
@@ -76,156 +87,198 @@ static u64 checksum(struct efi_pool_allocation *alloc)
 	return ret;
 }
 
-/*
- * Sorts the memory list from highest address to lowest address
- *
- * When allocating memory we should always start from the highest
- * address chunk, so sort the memory list such that the first list
- * iterator gets the highest address and goes lower from there.
- */
-static int efi_mem_cmp(void *priv, struct list_head *a, struct list_head *b)
+static uint64_t desc_get_end(struct efi_mem_desc *desc)
 {
-	struct efi_mem_list *mema = list_entry(a, struct efi_mem_list, link);
-	struct efi_mem_list *memb = list_entry(b, struct efi_mem_list, link);
+	return desc->physical_start + (desc->num_pages << EFI_PAGE_SHIFT);
+}
 
-	if (mema->desc.physical_start == memb->desc.physical_start)
-		return 0;
-	else if (mema->desc.physical_start < memb->desc.physical_start)
-		return 1;
-	else
-		return -1;
+static u64 efi_mem_free_pages(struct efi_mem_list *mem)
+{
+	return mem->desc.type == EFI_CONVENTIONAL_MEMORY ?
+		mem->desc.num_pages : 0;
 }
 
-static uint64_t desc_get_end(struct efi_mem_desc *desc)
+static u64 efi_mem_compute_max(struct efi_mem_list *mem)
 {
-	return desc->physical_start + (desc->num_pages << EFI_PAGE_SHIFT);
+	u64 max_free = efi_mem_free_pages(mem);
+	struct efi_mem_list *child;
+
+	if (mem->node.rb_left) {
+		child = rb_entry(mem->node.rb_left, struct efi_mem_list, node);
+		max_free = max(max_free, child->max_free);
+	}
+	if (mem->node.rb_right) {
+		child = rb_entry(mem->node.rb_right, struct efi_mem_list, node);
+		max_free = max(max_free, child->max_free);
+	}
+
+	return max_free;
+}
+
+RB_DECLARE_CALLBACKS(static, efi_mem_augment, struct efi_mem_list, node, u64,
+		     max_free, efi_mem_compute_max)
+
+static struct efi_mem_list *efi_mem_entry(struct rb_node *node)
+{
+	return node ? rb_entry(node, struct efi_mem_list, node) : NULL;
 }
 
-static void efi_mem_sort(void)
+/**
+ * efi_mem_insert() - add an item to the memory map tree
+ *
+ * @mem:	item to add, which must not overlap any other item
+ */
+static void efi_mem_insert(struct efi_mem_list *mem)
 {
-	struct list_head *lhandle;
-	struct efi_mem_list *prevmem = NULL;
-	bool merge_again = true;
-
-	list_sort(NULL, &efi_mem, efi_mem_cmp);
-
-	/* Now merge entries that can be merged */
-	while (merge_again) {
-		merge_again = false;
-		list_for_each(lhandle, &efi_mem) {
-			struct efi_mem_list *lmem;
-			struct efi_mem_desc *prev = &prevmem->desc;
-			struct efi_mem_desc *cur;
-			uint64_t pages;
-
-			lmem = list_entry(lhandle, struct efi_mem_list, link);
-			if (!prevmem) {
-				prevmem = lmem;
-				continue;
-			}
-
-			cur = &lmem->desc;
-
-			if ((desc_get_end(cur) == prev->physical_start) &&
-			    (prev->type == cur->type) &&
-			    (prev->attribute == cur->attribute)) {
-				/* There is an existing map before, reuse it */
-				pages = cur->num_pages;
-				prev->num_pages += pages;
-				prev->physical_start -= pages << EFI_PAGE_SHIFT;
-				prev->virtual_start -= pages << EFI_PAGE_SHIFT;
-				list_del(&lmem->link);
-				free(lmem);
-
-				merge_again = true;
-				break;
-			}
-
-			prevmem = lmem;
-		}
+	struct rb_node **link = &efi_mem.rb_node, *parent = NULL;
+	u64 free_pages = efi_mem_free_pages(mem);
+
+	while (*link) {
+		struct efi_mem_list *cur = efi_mem_entry(*link);
+
+		parent = *link;
+		cur->max_free = max(cur->max_free, free_pages);
+		if (mem->desc.physical_start < cur->desc.physical_start)
+			link = &parent->rb_left;
+		else
+			link = &parent->rb_right;
 	}
+	mem->max_free = free_pages;
+	rb_link_node(&mem->node, parent, link);
+	rb_insert_augmented(&mem->node, &efi_mem, &efi_mem_augment);
+	efi_mem_count++;
 }
 
-/** efi_mem_carve_out - unmap memory region
+/**
+ * efi_mem_remove() - remove an item from the memory map tree and free it
+ *
+ * @mem:	item to remove
+ */
+static void efi_mem_remove(struct efi_mem_list *mem)
+{
+	rb_erase_augmented(&mem->node, &efi_mem, &efi_mem_augment);
+	efi_mem_count--;
+	free(mem);
+}
+
+/**
+ * efi_mem_changed() - update the tree after the size or type of an item changes
  *
- * @map:		memory map
- * @carve_desc:		memory region to unmap
- * @overlap_only_ram:	the carved out region may only overlap RAM
- * Return Value:	the number of overlapping pages which have been
- *			removed from the map,
- *			EFI_CARVE_NO_OVERLAP, if the regions don't overlap,
- *			EFI_CARVE_OVERLAPS_NONRAM, if the carve and map overlap,
- *			and the map contains anything but free ram
- *			(only when overlap_only_ram is true),
- *			EFI_CARVE_LOOP_AGAIN, if the mapping list should be
- *			traversed again, as it has been altered.
+ * The start address may only be changed if this does not change the order of
+ * the items.
  *
- * Unmaps all memory occupied by the carve_desc region from the list entry
- * pointed to by map.
+ * @mem:	item which changed
+ */
+static void efi_mem_changed(struct efi_mem_list *mem)
+{
+	efi_mem_augment.propagate(&mem->node, NULL);
+}
+
+/**
+ * efi_mem_find_end_after() - find the first item which ends after an address
  *
- * In case of EFI_CARVE_OVERLAPS_NONRAM it is the callers responsibility
- * to re-add the already carved out pages to the mapping.
+ * @addr:	address
+ * Return:	lowest item which contains @addr or lies above it, NULL if none
  */
-static s64 efi_mem_carve_out(struct efi_mem_list *map,
-			     struct efi_mem_desc *carve_desc,
-			     bool overlap_only_ram)
+static struct efi_mem_list *efi_mem_find_end_after(u64 addr)
 {
-	struct efi_mem_list *newmap;
-	struct efi_mem_desc *map_desc = &map->desc;
-	uint64_t map_start = map_desc->physical_start;
-	uint64_t map_end = map_start + (map_desc->num_pages << EFI_PAGE_SHIFT);
-	uint64_t carve_start = carve_desc->physical_start;
-	uint64_t carve_end = carve_start +
-			     (carve_desc->num_pages << EFI_PAGE_SHIFT);
-
-	/* check whether we're overlapping */
-	if ((carve_end <= map_start) || (carve_start >= map_end))
-		return EFI_CARVE_NO_OVERLAP;
-
-	/* We're overlapping with non-RAM, warn the caller if desired */
-	if (overlap_only_ram && (map_desc->type != EFI_CONVENTIONAL_MEMORY))
-		return EFI_CARVE_OVERLAPS_NONRAM;
-
-	/* Sanitize carve_start and carve_end to lie within our bounds */
-	carve_start = max(carve_start, map_start);
-	carve_end = min(carve_end, map_end);
-
-	/* Carving at the beginning of our map? Just move it! */
-	if (carve_start == map_start) {
-		if (map_end == carve_end) {
-			/* Full overlap, just remove map */
-			list_del(&map->link);
-			free(map);
+	struct rb_node *node = efi_mem.rb_node;
+	struct efi_mem_list *found = NULL;
+
+	while (node) {
+		struct efi_mem_list *mem = efi_mem_entry(node);
+
+		if (desc_get_end(&mem->desc) > addr) {
+			found = mem;
+			node = node->rb_left;
 		} else {
-			map->desc.physical_start = carve_end;
-			map->desc.virtual_start = carve_end;
-			map->desc.num_pages = (map_end - carve_end)
-					      >> EFI_PAGE_SHIFT;
+			node = node->rb_right;
 		}
-
-		return (carve_end - carve_start) >> EFI_PAGE_SHIFT;
 	}
 
-	/*
-	 * Overlapping maps, just split the list map at carve_start,
-	 * it will get moved or removed in the next iteration.
-	 *
-	 * [ map_desc |__carve_start__| newmap ]
-	 */
+	return found;
+}
 
-	/* Create a new map from [ carve_start ... map_end ] */
-	newmap = calloc(1, sizeof(*newmap));
-	newmap->desc = map->desc;
-	newmap->desc.physical_start = carve_start;
-	newmap->desc.virtual_start = carve_start;
-	newmap->desc.num_pages = (map_end - carve_start) >> EFI_PAGE_SHIFT;
-	/* Insert before current entry (descending address order) */
-	list_add_tail(&newmap->link, &map->link);
+/**
+ * efi_mem_carve_out() - remove an address range from the memory map
+ *
+ * Items which overlap the range are shrunk or removed. If the range lies
+ * within a single item, that item is split in two, using @spare for the upper
+ * part.
+ *
+ * @start:	start of range
+ * @end:	end of range
+ * @sparep:	spare item to use for a split. This is set to NULL if used
+ */
+static void efi_mem_carve_out(u64 start, u64 end, struct efi_mem_list **sparep)
+{
+	struct efi_mem_list *mem, *next;
+
+	for (mem = efi_mem_find_end_after(start);
+	     mem && mem->desc.physical_start < end; mem = next) {
+		u64 map_start = mem->desc.physical_start;
+		u64 map_end = desc_get_end(&mem->desc);
+
+		next = efi_mem_entry(rb_next(&mem->node));
+		if (map_start < start && map_end > end) {
+			/* [ mem |__carve__| spare ] */
+			struct efi_mem_list *spare = *sparep;
+
+			spare->desc = mem->desc;
+			spare->desc.physical_start = end;
+			spare->desc.virtual_start = end;
+			spare->desc.num_pages = (map_end - end) >> EFI_PAGE_SHIFT;
+			mem->desc.num_pages = (start - map_start) >>
+					      EFI_PAGE_SHIFT;
+			efi_mem_changed(mem);
+			efi_mem_insert(spare);
+			*sparep = NULL;
+			break;
+		} else if (map_start < start) {
+			mem->desc.num_pages = (start - map_start) >>
+					      EFI_PAGE_SHIFT;
+			efi_mem_changed(mem);
+		} else if (map_end > end) {
+			mem->desc.physical_start = end;
+			mem->desc.virtual_start = end;
+			mem->desc.num_pages = (map_end - end) >> EFI_PAGE_SHIFT;
+			efi_mem_changed(mem);
+		} else {
+			efi_mem_remove(mem);
+		}
+	}
+}
 
-	/* Shrink the map to [ map_start ... carve_start ] */
-	map_desc->num_pages = (carve_start - map_start) >> EFI_PAGE_SHIFT;
+static bool efi_mem_can_merge(struct efi_mem_list *lower,
+			      struct efi_mem_list *upper)
+{
+	return desc_get_end(&lower->desc) == upper->desc.physical_start &&
+	       lower->desc.type == upper->desc.type &&
+	       lower->desc.attribute == upper->desc.attribute;
+}
 
-	return EFI_CARVE_LOOP_AGAIN;
+/**
+ * efi_mem_merge() - merge an item with its neighbours if they match
+ *
+ * @mem:	item to merge
+ */
+static void efi_mem_merge(struct efi_mem_list *mem)
+{
+	struct efi_mem_list *prev, *next;
+
+	prev = efi_mem_entry(rb_prev(&mem->node));
+	if (prev && efi_mem_can_merge(prev, mem)) {
+		prev->desc.num_pages += mem->desc.num_pages;
+		efi_mem_remove(mem);
+		efi_mem_changed(prev);
+		mem = prev;
+	}
+	next = efi_mem_entry(rb_next(&mem->node));
+	if (next && efi_mem_can_merge(mem, next)) {
+		mem->desc.num_pages += next->desc.num_pages;
+		efi_mem_remove(next);
+		efi_mem_changed(mem);
+	}
 }
 
 /**
@@ -240,10 +293,8 @@ static s64 efi_mem_carve_out(struct efi_mem_list *map,
 efi_status_t efi_add_memory_map(uint64_t start, uint64_t pages, int memory_type,
 				bool overlap_only_ram)
 {
-	struct list_head *lhandle;
-	struct efi_mem_list *newlist;
-	bool carve_again;
-	uint64_t carved_pages = 0;
+	struct efi_mem_list *newmem, *spare, *mem;
+	uint64_t end = start + (pages << EFI_PAGE_SHIFT);
 	struct efi_event *evt;
 
 	EFI_PRINT("%s: 0x%llx 0x%llx %d %s\n", __func__,
@@ -255,80 +306,56 @@ efi_status_t efi_add_memory_map(uint64_t start, uint64_t pages, int memory_type,
 	if (!pages)
 		return EFI_SUCCESS;
 
+	if (overlap_only_ram) {
+		uint64_t covered = 0;
+
+		/*
+		 * The payload wants the whole area to lie in free RAM, so
+		 * check this before changing anything
+		 */
+		for (mem = efi_mem_find_end_after(start);
+		     mem && mem->desc.physical_start < end;
+		     mem = efi_mem_entry(rb_next(&mem->node))) {
+			if (mem->desc.type != EFI_CONVENTIONAL_MEMORY)
+				return EFI_NO_MAPPING;
+			covered += min(end, desc_get_end(&mem->desc)) -
+				   max(start, mem->desc.physical_start);
+		}
+		if (covered != end - start)
+			return EFI_NO_MAPPING;
+	}
+
+	newmem = calloc(1, sizeof(*newmem));
+	spare = calloc(1, sizeof(*spare));
+	if (!newmem || !spare) {
+		free(newmem);
+		free(spare);
+		return EFI_OUT_OF_RESOURCES;
+	}
 	++efi_memory_map_key;
-	newlist = calloc(1, sizeof(*newlist));
-	newlist->desc.type = memory_type;
-	newlist->desc.physical_start = start;
-	newlist->desc.virtual_start = start;
-	newlist->desc.num_pages = pages;
+	newmem->desc.type = memory_type;
+	newmem->desc.physical_start = start;
+	newmem->desc.virtual_start = start;
+	newmem->desc.num_pages = pages;
 
 	switch (memory_type) {
 	case EFI_RUNTIME_SERVICES_CODE:
 	case EFI_RUNTIME_SERVICES_DATA:
-		newlist->desc.attribute = EFI_MEMORY_WB | EFI_MEMORY_RUNTIME;
+		newmem->desc.attribute = EFI_MEMORY_WB | EFI_MEMORY_RUNTIME;
 		break;
 	case EFI_MMAP_IO:
-		newlist->desc.attribute = EFI_MEMORY_RUNTIME;
+		newmem->desc.attribute = EFI_MEMORY_RUNTIME;
 		break;
 	default:
-		newlist->desc.attribute = EFI_MEMORY_WB;
+		newmem->desc.attribute = EFI_MEMORY_WB;
 		break;
 	}
 
-	/* Add our new map */
-	do {
-		carve_again = false;
-		list_for_each(lhandle, &efi_mem) {
-			struct efi_mem_list *lmem;
-			s64 r;
-
-			lmem = list_entry(lhandle, struct efi_mem_list, link);
-			r = efi_mem_carve_out(lmem, &newlist->desc,
-					      overlap_only_ram);
-			switch (r) {
-			case EFI_CARVE_OVERLAPS_NONRAM:
-				/*
-				 * The user requested to only have RAM overlaps,
-				 * but we hit a non-RAM region. Error out.
-				 */
-				return EFI_NO_MAPPING;
-			case EFI_CARVE_NO_OVERLAP:
-				/* Just ignore this list entry */
-				break;
-			case EFI_CARVE_LOOP_AGAIN:
-				/*
-				 * We split an entry, but need to loop through
-				 * the list again to actually carve it.
-				 */
-				carve_again = true;
-				break;
-			default:
-				/* We carved a number of pages */
-				carved_pages += r;
-				carve_again = true;
-				break;
-			}
-
-			if (carve_again) {
-				/* The list changed, we need to start over */
-				break;
-			}
-		}
-	} while (carve_again);
-
-	if (overlap_only_ram && (carved_pages != pages)) {
-		/*
-		 * The payload wanted to have RAM overlaps, but we overlapped
-		 * with an unallocated region. Error out.
-		 */
-		return EFI_NO_MAPPING;
-	}
-
-	/* Add our new map */
-        list_add_tail(&newlist->link, &efi_mem);
-
-	/* And make sure memory is listed in descending order */
-	efi_mem_sort();
+	/* Remove anything in the way, then add our new map */
+	efi_mem_carve_out(start, end, &spare);
+	free(spare);
+	efi_mem_insert(newmem);
+	efi_mem_merge(newmem);
 
 	/* Notify that the memory map was changed */
 	list_for_each_entry(evt, &efi_events, link) {
@@ -360,64 +387,65 @@ efi_status_t efi_add_memory_map(uint64_t start, uint64_t pages, int memory_type,
  */
 static efi_status_t efi_check_allocated(u64 addr, bool must_be_allocated)
 {
-	struct efi_mem_list *item;
-
-	list_for_each_entry(item, &efi_mem, link) {
-		u64 start = item->desc.physical_start;
-		u64 end = start + (item->desc.num_pages << EFI_PAGE_SHIFT);
-
-		if (addr >= start && addr < end) {
-			if (must_be_allocated ^
-			    (item->desc.type == EFI_CONVENTIONAL_MEMORY))
-				return EFI_SUCCESS;
-			else
-				return EFI_NOT_FOUND;
-		}
-	}
+	struct efi_mem_list *item = efi_mem_find_end_after(addr);
+
+	if (!item || addr < item->desc.physical_start)
+		return EFI_NOT_FOUND;
+	if (must_be_allocated ^ (item->desc.type == EFI_CONVENTIONAL_MEMORY))
+		return EFI_SUCCESS;
 
 	return EFI_NOT_FOUND;
 }
 
-static uint64_t efi_find_free_memory(uint64_t len, uint64_t max_addr)
+/**
+ * efi_find_free_in() - find free memory in a subtree of the memory map
+ *
+ * Subtrees without a large enough free item are skipped, as are items above
+ * @max_addr, so this only visits O(log n) items.
+ *
+ * @node:	root of subtree
+ * @len:	number of bytes needed
+ * @max_addr:	highest address which may be returned, page-aligned
+ * Return:	highest suitable address in the subtree, or 0 if none
+ */
+static uint64_t efi_find_free_in(struct rb_node *node, uint64_t len,
+				 uint64_t max_addr)
 {
-	struct list_head *lhandle;
-
-	/*
-	 * Prealign input max address, so we simplify our matching
-	 * logic below and can just reuse it as return pointer.
-	 */
-	max_addr &= ~EFI_PAGE_MASK;
-
-	list_for_each(lhandle, &efi_mem) {
-		struct efi_mem_list *lmem = list_entry(lhandle,
-			struct efi_mem_list, link);
-		struct efi_mem_desc *desc = &lmem->desc;
-		uint64_t desc_len = desc->num_pages << EFI_PAGE_SHIFT;
-		uint64_t desc_end = desc->physical_start + desc_len;
-		uint64_t curmax = min(max_addr, desc_end);
-		uint64_t ret = curmax - len;
+	struct efi_mem_list *mem = efi_mem_entry(node);
+	struct efi_mem_desc *desc;
+	uint64_t curmax, ret;
 
-		/* We only take memory from free RAM */
-		if (desc->type != EFI_CONVENTIONAL_MEMORY)
-			continue;
-
-		/* Out of bounds for max_addr */
-		if ((ret + len) > max_addr)
-			continue;
-
-		/* Out of bounds for upper map limit */
-		if ((ret + len) > desc_end)
-			continue;
+	if (!mem || (mem->max_free << EFI_PAGE_SHIFT) < len)
+		return 0;
+	desc = &mem->desc;
 
-		/* Out of bounds for lower map limit */
-		if (ret < desc->physical_start)
-			continue;
+	/* Try higher addresses first */
+	if (desc->physical_start < max_addr) {
+		ret = efi_find_free_in(node->rb_right, len, max_addr);
+		if (ret)
+			return ret;
+	}
 
+	/* We only take memory from free RAM */
+	if (desc->type == EFI_CONVENTIONAL_MEMORY) {
 		/* Return the highest address in this map within bounds */
-		return ret;
+		curmax = min(max_addr, desc_get_end(desc));
+		if (curmax >= len && curmax - len >= desc->physical_start)
+			return curmax - len;
 	}
 
-	return 0;
+	return efi_find_free_in(node->rb_left, len, max_addr);
+}
+
+static uint64_t efi_find_free_memory(uint64_t len, uint64_t max_addr)
+{
+	/*
+	 * Prealign input max address, so we can just reuse it as return
+	 * pointer.
+	 */
+	max_addr &= ~EFI_PAGE_MASK;
+
+	return efi_find_free_in(efi_mem.rb_node, len, max_addr);
 }
 
 /*
@@ -611,19 +639,15 @@ efi_status_t efi_get_memory_map(efi_uintn_t *memory_map_size,
 				uint32_t *descriptor_version)
 {
 	efi_uintn_t map_size = 0;
-	int map_entries = 0;
-	struct list_head *lhandle;
 	efi_uintn_t provided_map_size;
+	struct rb_node *node;
 
 	if (!memory_map_size)
 		return EFI_INVALID_PARAMETER;
 
 	provided_map_size = *memory_map_size;
 
-	list_for_each(lhandle, &efi_mem)
-		map_entries++;
-
-	map_size = map_entries * sizeof(struct efi_mem_desc);
+	map_size = efi_mem_count * sizeof(struct efi_mem_desc);
 
 	*memory_map_size = map_size;
 
@@ -639,16 +663,9 @@ efi_status_t efi_get_memory_map(efi_uintn_t *memory_map_size,
 	if (descriptor_version)
 		*descriptor_version = EFI_MEMORY_DESCRIPTOR_VERSION;
 
-	/* Copy list into array */
-	/* Return the list in ascending order */
-	memory_map = &memory_map[map_entries - 1];
-	list_for_each(lhandle, &efi_mem) {
-		struct efi_mem_list *lmem;
-
-		lmem = list_entry(lhandle, struct efi_mem_list, link);
-		*memory_map = lmem->desc;
-		memory_map--;
-	}
+	/* Copy tree into array, in ascending order */
+	for (node = rb_first(&efi_mem); node; node = rb_next(node))
+		*memory_map++ = efi_mem_entry(node)->desc;
 
 	if (map_key)
 		*map_key = efi_memory_map_key;
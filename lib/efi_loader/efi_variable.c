@@ -16,7 +16,15 @@
 #define READ_ONLY BIT(31)
 
 /*
- * Mapping between EFI variables and u-boot variables:
+ * UEFI variables are held in memory, with binary values. A hash table on the
+ * vendor GUID and name finds a variable and a list holds them in the order
+ * in which they were created, for GetNextVariableName().
+ *
+ * The non-volatile variables are persisted as a single blob (struct
+ * efi_var_file) in the U-Boot variable 'efi_vars', hex-encoded, so they are
+ * stored by saveenv.
+ *
+ * Earlier versions stored each UEFI variable in its own U-Boot variable:
  *
  *   efi_$guid_$varname = {attributes}(type)value
  *
@@ -31,12 +39,10 @@
  * attributes:
  *
  *   + ro   - read-only
+ *   + nv   - non-volatile
  *   + boot - boot-services access
  *   + run  - runtime access
  *
- * NOTE: with current implementation, no variables are available after
- * ExitBootServices, and all are persisted (if possible).
- *
  * If not specified, the attributes default to "{boot}".
  *
  * The required type is one of:
@@ -44,43 +50,352 @@
  *   + utf8 - raw utf8 string
  *   + blob - arbitrary length hex string
  *
- * Maybe a utf16 type would be useful to for a string value to be auto
- * converted to utf16?
+ * Such variables are still imported into the store when the UEFI sub-system
+ * is initialized, and then removed from the environment. This also allows a
+ * read-only variable to be created with setenv.
+ *
+ * NOTE: with current implementation, no variables are available after
+ * ExitBootServices.
  */
 
-#define PREFIX_LEN (strlen("efi_xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx_"))
+#define EFI_VAR_ENV		"efi_vars"
+#define EFI_VAR_FILE_MAGIC	0x52415645 /* "EVAR" */
+
+/* Initial number of hash buckets, must be a power of two */
+#define EFI_VAR_BUCKETS		64
+
+/**
+ * struct efi_var - a UEFI variable
+ *
+ * @link:	entry in efi_var_list
+ * @hnext:	next variable in the same hash bucket
+ * @hash:	hash of @guid and @name
+ * @guid:	vendor GUID
+ * @attr:	attributes, including READ_ONLY
+ * @size:	number of bytes in @data
+ * @data:	value of the variable
+ * @name:	name of the variable, null-terminated
+ */
+struct efi_var {
+	struct list_head link;
+	struct efi_var *hnext;
+	u32 hash;
+	efi_guid_t guid;
+	u32 attr;
+	efi_uintn_t size;
+	u8 *data;
+	u16 name[];
+};
 
 /**
- * efi_to_native() - convert the UEFI variable name and vendor GUID to U-Boot
- *		     variable name
+ * struct efi_var_file - header of the blob holding non-volatile variables
  *
- * The U-Boot variable name is a concatenation of prefix 'efi', the hexstring
- * encoded vendor GUID, and the UTF-8 encoded UEFI variable name separated by
- * underscores, e.g. 'efi_8be4df61-93ca-11d2-aa0d-00e098032b8c_BootOrder'.
+ * The header is followed by a struct efi_var_rec for each variable.
  *
- * @native:		pointer to pointer to U-Boot variable name
- * @variable_name:	UEFI variable name
- * @vendor:		vendor GUID
- * Return:		status code
+ * @magic:	EFI_VAR_FILE_MAGIC
+ * @length:	length of the blob in bytes, including this header
+ * @crc32:	CRC32 of the records which follow the header
+ * @reserved:	reserved, must be zero
  */
-static efi_status_t efi_to_native(char **native, const u16 *variable_name,
-				  const efi_guid_t *vendor)
+struct efi_var_file {
+	u32 magic;
+	u32 length;
+	u32 crc32;
+	u32 reserved;
+};
+
+/**
+ * struct efi_var_rec - a variable in the blob
+ *
+ * The header is followed by the name (@name_size bytes) and the value
+ * (@data_size bytes). Records are padded to a multiple of 8 bytes.
+ *
+ * @length:	length of the record in bytes, including padding
+ * @attr:	attributes of the variable
+ * @name_size:	size of the name in bytes, including the null terminator
+ * @data_size:	size of the value in bytes
+ * @guid:	vendor GUID
+ */
+struct efi_var_rec {
+	u32 length;
+	u32 attr;
+	u32 name_size;
+	u32 data_size;
+	efi_guid_t guid;
+};
+
+/* All variables, in the order in which they were created */
+static LIST_HEAD(efi_var_list);
+static struct efi_var **efi_var_table;
+static uint efi_var_buckets;
+static uint efi_var_count;
+
+/**
+ * efi_var_hash() - calculate the hash of a variable's GUID and name
+ *
+ * This uses the FNV-1a hash function.
+ *
+ * @name:	name of the variable
+ * @guid:	vendor GUID
+ * Return:	hash value
+ */
+static u32 efi_var_hash(const u16 *name, const efi_guid_t *guid)
 {
-	size_t len;
-	char *pos;
+	u32 hash = 2166136261u;
+	int i;
+
+	for (i = 0; i < sizeof(*guid); i++)
+		hash = (hash ^ guid->b[i]) * 16777619;
+	for (; *name; name++) {
+		hash = (hash ^ (*name & 0xff)) * 16777619;
+		hash = (hash ^ (*name >> 8)) * 16777619;
+	}
+
+	return hash;
+}
 
-	len = PREFIX_LEN + utf16_utf8_strlen(variable_name) + 1;
-	*native = malloc(len);
-	if (!*native)
+/**
+ * efi_var_find() - find a variable
+ *
+ * @name:	name of the variable
+ * @guid:	vendor GUID
+ * Return:	variable, or NULL if not found
+ */
+static struct efi_var *efi_var_find(const u16 *name, const efi_guid_t *guid)
+{
+	struct efi_var *var;
+	u32 hash;
+
+	if (!efi_var_table)
+		return NULL;
+
+	hash = efi_var_hash(name, guid);
+	for (var = efi_var_table[hash & (efi_var_buckets - 1)]; var;
+	     var = var->hnext) {
+		if (var->hash == hash && !guidcmp(&var->guid, guid) &&
+		    !u16_strcmp(var->name, name))
+			return var;
+	}
+
+	return NULL;
+}
+
+/**
+ * efi_var_rehash() - resize the hash table
+ *
+ * @buckets:	new number of buckets, a power of two
+ * Return:	status code
+ */
+static efi_status_t efi_var_rehash(uint buckets)
+{
+	struct efi_var **table;
+	struct efi_var *var;
+
+	table = calloc(buckets, sizeof(*table));
+	if (!table)
 		return EFI_OUT_OF_RESOURCES;
 
-	pos = *native;
-	pos += sprintf(pos, "efi_%pUl_", vendor);
-	utf16_utf8_strcpy(&pos, variable_name);
+	list_for_each_entry(var, &efi_var_list, link) {
+		struct efi_var **head = &table[var->hash & (buckets - 1)];
+
+		var->hnext = *head;
+		*head = var;
+	}
+	free(efi_var_table);
+	efi_var_table = table;
+	efi_var_buckets = buckets;
+
+	return EFI_SUCCESS;
+}
+
+/**
+ * efi_var_add() - add a new variable to the store
+ *
+ * @name:	name of the variable
+ * @guid:	vendor GUID
+ * @attr:	attributes of the variable
+ * @data:	value of the variable
+ * @size:	size of the value in bytes
+ * Return:	status code
+ */
+static efi_status_t efi_var_add(const u16 *name, const efi_guid_t *guid,
+				u32 attr, const void *data, efi_uintn_t size)
+{
+	size_t name_size = (u16_strlen(name) + 1) * sizeof(u16);
+	struct efi_var **head;
+	struct efi_var *var;
+
+	/* Keep the average chain length at one or less */
+	if (efi_var_count >= efi_var_buckets &&
+	    efi_var_rehash(efi_var_buckets ? efi_var_buckets * 2 :
+			   EFI_VAR_BUCKETS) != EFI_SUCCESS)
+		return EFI_OUT_OF_RESOURCES;
+
+	var = malloc(sizeof(*var) + name_size);
+	if (!var)
+		return EFI_OUT_OF_RESOURCES;
+	var->data = malloc(size);
+	if (!var->data) {
+		free(var);
+		return EFI_OUT_OF_RESOURCES;
+	}
+	memcpy(var->name, name, name_size);
+	memcpy(var->data, data, size);
+	var->guid = *guid;
+	var->attr = attr;
+	var->size = size;
+	var->hash = efi_var_hash(name, guid);
+
+	head = &efi_var_table[var->hash & (efi_var_buckets - 1)];
+	var->hnext = *head;
+	*head = var;
+	list_add_tail(&var->link, &efi_var_list);
+	efi_var_count++;
 
 	return EFI_SUCCESS;
 }
 
+/**
+ * efi_var_delete() - remove a variable from the store and free it
+ *
+ * @var:	variable to remove
+ */
+static void efi_var_delete(struct efi_var *var)
+{
+	struct efi_var **pp = &efi_var_table[var->hash & (efi_var_buckets - 1)];
+
+	while (*pp != var)
+		pp = &(*pp)->hnext;
+	*pp = var->hnext;
+	list_del(&var->link);
+	efi_var_count--;
+	free(var->data);
+	free(var);
+}
+
+/**
+ * efi_var_save() - persist the non-volatile variables
+ *
+ * All non-volatile variables are written as a single blob to the U-Boot
+ * variable EFI_VAR_ENV.
+ *
+ * Return:	status code
+ */
+static efi_status_t efi_var_save(void)
+{
+	struct efi_var_file *file;
+	struct efi_var_rec *rec;
+	struct efi_var *var;
+	efi_status_t ret = EFI_SUCCESS;
+	size_t len = sizeof(*file);
+	char *hex;
+
+	list_for_each_entry(var, &efi_var_list, link) {
+		if (var->attr & EFI_VARIABLE_NON_VOLATILE)
+			len += ALIGN(sizeof(*rec) + (u16_strlen(var->name) + 1) *
+				     sizeof(u16) + var->size, 8);
+	}
+	if (len == sizeof(*file)) {
+		if (env_get(EFI_VAR_ENV) && env_set(EFI_VAR_ENV, NULL))
+			return EFI_DEVICE_ERROR;
+		return EFI_SUCCESS;
+	}
+
+	file = calloc(1, len);
+	hex = malloc(len * 2 + 1);
+	if (!file || !hex) {
+		ret = EFI_OUT_OF_RESOURCES;
+		goto out;
+	}
+	file->magic = EFI_VAR_FILE_MAGIC;
+	file->length = len;
+
+	rec = (struct efi_var_rec *)(file + 1);
+	list_for_each_entry(var, &efi_var_list, link) {
+		u8 *pos = (u8 *)(rec + 1);
+
+		if (!(var->attr & EFI_VARIABLE_NON_VOLATILE))
+			continue;
+		rec->attr = var->attr;
+		rec->name_size = (u16_strlen(var->name) + 1) * sizeof(u16);
+		rec->data_size = var->size;
+		rec->guid = var->guid;
+		rec->length = ALIGN(sizeof(*rec) + rec->name_size +
+				    rec->data_size, 8);
+		memcpy(pos, var->name, rec->name_size);
+		memcpy(pos + rec->name_size, var->data, var->size);
+		rec = (void *)rec + rec->length;
+	}
+	file->crc32 = crc32(0, (u8 *)(file + 1), len - sizeof(*file));
+
+	*bin2hex(hex, file, len) = '\0';
+	if (env_set(EFI_VAR_ENV, hex))
+		ret = EFI_DEVICE_ERROR;
+
+out:
+	free(hex);
+	free(file);
+
+	return ret;
+}
+
+/**
+ * efi_var_load() - load the non-volatile variables
+ *
+ * Return:	status code
+ */
+static efi_status_t efi_var_load(void)
+{
+	struct efi_var_file *file;
+	struct efi_var_rec *rec;
+	efi_status_t ret = EFI_SUCCESS;
+	const char *hex;
+	size_t len;
+	void *end;
+
+	hex = env_get(EFI_VAR_ENV);
+	if (!hex)
+		return EFI_SUCCESS;
+	len = strlen(hex) / 2;
+	if (len < sizeof(*file)) {
+		printf("%s: Invalid UEFI variable store\n", __func__);
+		return EFI_SUCCESS;
+	}
+
+	file = malloc(len);
+	if (!file)
+		return EFI_OUT_OF_RESOURCES;
+	if (hex2bin((u8 *)file, hex, len) ||
+	    file->magic != EFI_VAR_FILE_MAGIC || file->length != len ||
+	    file->crc32 != crc32(0, (u8 *)(file + 1), len - sizeof(*file))) {
+		printf("%s: Invalid UEFI variable store\n", __func__);
+		goto out;
+	}
+
+	end = (void *)file + len;
+	for (rec = (struct efi_var_rec *)(file + 1); (void *)(rec + 1) <= end;
+	     rec = (void *)rec + rec->length) {
+		u16 *name = (u16 *)(rec + 1);
+
+		if (rec->length < sizeof(*rec) + (u64)rec->name_size +
+				  rec->data_size ||
+		    rec->length > end - (void *)rec || rec->name_size < 2 ||
+		    name[rec->name_size / sizeof(u16) - 1]) {
+			printf("%s: Invalid UEFI variable record\n", __func__);
+			break;
+		}
+		ret = efi_var_add(name, &rec->guid, rec->attr,
+				  (u8 *)name + rec->name_size, rec->data_size);
+		if (ret != EFI_SUCCESS)
+			break;
+	}
+
+out:
+	free(file);
+
+	return ret;
+}
+
 /**
  * prefix() - skip over prefix
  *
@@ -148,169 +463,172 @@ static const char *parse_attr(const char *str, u32 *attrp)
 }
 
 /**
- * efi_get_variable() - retrieve value of a UEFI variable
- *
- * This function implements the GetVariable runtime service.
+ * efi_var_import() - import a UEFI variable from a U-Boot variable
  *
- * See the Unified Extensible Firmware Interface (UEFI) specification for
- * details.
- *
- * @variable_name:	name of the variable
- * @vendor:		vendor GUID
- * @attributes:		attributes of the variable
- * @data_size:		size of the buffer to which the variable value is copied
- * @data:		buffer to which the variable value is copied
- * Return:		status code
+ * @variable:	U-Boot variable in the form efi_$guid_$varname=value. The
+ *		'=' is replaced by a null character, leaving just the name
+ * Return:	status code
  */
-efi_status_t EFIAPI efi_get_variable(u16 *variable_name,
-				     const efi_guid_t *vendor, u32 *attributes,
-				     efi_uintn_t *data_size, void *data)
+static efi_status_t efi_var_import(char *variable)
 {
-	char *native_name;
+	char guid[UUID_STR_LEN + 1];
+	char *name, *val;
+	const char *s;
+	efi_guid_t vendor;
 	efi_status_t ret;
-	unsigned long in_size;
-	const char *val, *s;
+	u16 *name16, *p;
+	size_t len;
+	u8 *data;
 	u32 attr;
 
-	EFI_ENTRY("\"%ls\" %pUl %p %p %p", variable_name, vendor, attributes,
-		  data_size, data);
-
-	if (!variable_name || !vendor || !data_size)
-		return EFI_EXIT(EFI_INVALID_PARAMETER);
-
-	ret = efi_to_native(&native_name, variable_name, vendor);
-	if (ret)
-		return EFI_EXIT(ret);
-
-	EFI_PRINT("get '%s'\n", native_name);
-
-	val = env_get(native_name);
-	free(native_name);
+	val = strchr(variable, '=');
 	if (!val)
-		return EFI_EXIT(EFI_NOT_FOUND);
-
-	val = parse_attr(val, &attr);
-
-	in_size = *data_size;
-
-	if ((s = prefix(val, "(blob)"))) {
-		size_t len = strlen(s);
+		return EFI_INVALID_PARAMETER;
+	*val++ = '\0';
+	name = variable + strlen("efi_") + UUID_STR_LEN;
+	if (strlen(variable) <= name - variable || *name++ != '_')
+		return EFI_INVALID_PARAMETER;
+	strlcpy(guid, variable + strlen("efi_"), sizeof(guid));
+	if (uuid_str_to_bin(guid, vendor.b, UUID_STR_FORMAT_GUID))
+		return EFI_INVALID_PARAMETER;
 
+	s = parse_attr(val, &attr);
+	if ((val = (char *)prefix(s, "(blob)"))) {
+		len = strlen(val);
 		/* number of hexadecimal digits must be even */
 		if (len & 1)
-			return EFI_EXIT(EFI_DEVICE_ERROR);
-
-		/* two characters per byte: */
+			return EFI_INVALID_PARAMETER;
 		len /= 2;
-		*data_size = len;
-
-		if (in_size < len) {
-			ret = EFI_BUFFER_TOO_SMALL;
-			goto out;
+		data = malloc(len);
+		if (data && hex2bin(data, val, len)) {
+			free(data);
+			return EFI_INVALID_PARAMETER;
 		}
+	} else if ((val = (char *)prefix(s, "(utf8)"))) {
+		len = strlen(val) + 1;
+		data = (u8 *)strdup(val);
+	} else {
+		return EFI_INVALID_PARAMETER;
+	}
 
-		if (!data)
-			return EFI_EXIT(EFI_INVALID_PARAMETER);
-
-		if (hex2bin(data, s, len))
-			return EFI_EXIT(EFI_DEVICE_ERROR);
+	name16 = malloc((utf8_utf16_strlen(name) + 1) * sizeof(u16));
+	if (!data || !name16) {
+		ret = EFI_OUT_OF_RESOURCES;
+		goto out;
+	}
+	p = name16;
+	utf8_utf16_strcpy(&p, name);
 
-		EFI_PRINT("got value: \"%s\"\n", s);
-	} else if ((s = prefix(val, "(utf8)"))) {
-		unsigned len = strlen(s) + 1;
+	if (efi_var_find(name16, &vendor))
+		ret = EFI_SUCCESS;
+	else
+		ret = efi_var_add(name16, &vendor, attr, data, len);
 
-		*data_size = len;
+out:
+	free(name16);
+	free(data);
 
-		if (in_size < len) {
-			ret = EFI_BUFFER_TOO_SMALL;
-			goto out;
-		}
+	return ret;
+}
 
-		if (!data)
-			return EFI_EXIT(EFI_INVALID_PARAMETER);
+/**
+ * efi_var_import_env() - import UEFI variables held as U-Boot variables
+ *
+ * Each variable which is imported is removed from the environment.
+ *
+ * Return:	status code
+ */
+static efi_status_t efi_var_import_env(void)
+{
+	char regex[] = "efi_.*-.*-.*-.*-.*_.*";
+	char * const regexlist[] = {regex};
+	char *list = NULL, *variable, *next;
+	efi_status_t ret = EFI_SUCCESS;
+	bool imported = false;
+	ssize_t len;
+
+	len = hexport_r(&env_htab, '\n', H_MATCH_REGEX | H_MATCH_KEY, &list,
+			0, 1, regexlist);
+	/* 1 indicates that no match was found */
+	if (len <= 1) {
+		free(list);
+		return EFI_SUCCESS;
+	}
 
-		memcpy(data, s, len);
-		((char *)data)[len] = '\0';
+	for (variable = list; variable && *variable; variable = next) {
+		next = strchr(variable, '\n');
+		if (next)
+			*next++ = '\0';
 
-		EFI_PRINT("got value: \"%s\"\n", (char *)data);
-	} else {
-		EFI_PRINT("invalid value: '%s'\n", val);
-		return EFI_EXIT(EFI_DEVICE_ERROR);
+		ret = efi_var_import(variable);
+		if (ret == EFI_OUT_OF_RESOURCES)
+			break;
+		if (ret != EFI_SUCCESS) {
+			printf("%s: Cannot import %s\n", __func__, variable);
+			continue;
+		}
+		/* efi_var_import() has split off the name */
+		env_set(variable, NULL);
+		imported = true;
 	}
+	free(list);
+	if (ret == EFI_OUT_OF_RESOURCES)
+		return ret;
 
-out:
-	if (attributes)
-		*attributes = attr & EFI_VARIABLE_MASK;
-
-	return EFI_EXIT(ret);
+	/* Anything imported may be non-volatile, so save it again */
+	return imported ? efi_var_save() : EFI_SUCCESS;
 }
 
-static char *efi_variables_list;
-static char *efi_cur_variable;
-
 /**
- * parse_uboot_variable() - parse a u-boot variable and get uefi-related
- *			    information
- * @variable:		whole data of u-boot variable (ie. name=value)
- * @variable_name_size: size of variable_name buffer in byte
- * @variable_name:	name of uefi variable in u16, null-terminated
- * @vendor:		vendor's guid
- * @attributes:		attributes
+ * efi_get_variable() - retrieve value of a UEFI variable
  *
- * A uefi variable is encoded into a u-boot variable as described above.
- * This function parses such a u-boot variable and retrieve uefi-related
- * information into respective parameters. In return, variable_name_size
- * is the size of variable name including NULL.
+ * This function implements the GetVariable runtime service.
+ *
+ * See the Unified Extensible Firmware Interface (UEFI) specification for
+ * details.
  *
- * Return:		EFI_SUCCESS if parsing is OK, EFI_NOT_FOUND when
- *			the entire variable list has been returned,
- *			otherwise non-zero status code
+ * @variable_name:	name of the variable
+ * @vendor:		vendor GUID
+ * @attributes:		attributes of the variable
+ * @data_size:		size of the buffer to which the variable value is copied
+ * @data:		buffer to which the variable value is copied
+ * Return:		status code
  */
-static efi_status_t parse_uboot_variable(char *variable,
-					 efi_uintn_t *variable_name_size,
-					 u16 *variable_name,
-					 const efi_guid_t *vendor,
-					 u32 *attributes)
+efi_status_t EFIAPI efi_get_variable(u16 *variable_name,
+				     const efi_guid_t *vendor, u32 *attributes,
+				     efi_uintn_t *data_size, void *data)
 {
-	char *guid, *name, *end, c;
-	unsigned long name_len;
-	u16 *p;
+	struct efi_var *var;
+	efi_status_t ret = EFI_SUCCESS;
+	efi_uintn_t in_size;
 
-	guid = strchr(variable, '_');
-	if (!guid)
-		return EFI_INVALID_PARAMETER;
-	guid++;
-	name = strchr(guid, '_');
-	if (!name)
-		return EFI_INVALID_PARAMETER;
-	name++;
-	end = strchr(name, '=');
-	if (!end)
-		return EFI_INVALID_PARAMETER;
+	EFI_ENTRY("\"%ls\" %pUl %p %p %p", variable_name, vendor, attributes,
+		  data_size, data);
 
-	name_len = end - name;
-	if (*variable_name_size < (name_len + 1)) {
-		*variable_name_size = name_len + 1;
-		return EFI_BUFFER_TOO_SMALL;
+	if (!variable_name || !vendor || !data_size)
+		return EFI_EXIT(EFI_INVALID_PARAMETER);
+
+	var = efi_var_find(variable_name, vendor);
+	if (!var)
+		return EFI_EXIT(EFI_NOT_FOUND);
+
+	in_size = *data_size;
+	*data_size = var->size;
+	if (in_size < var->size) {
+		ret = EFI_BUFFER_TOO_SMALL;
+		goto out;
 	}
-	end++; /* point to value */
 
-	/* variable name */
-	p = variable_name;
-	utf8_utf16_strncpy(&p, name, name_len);
-	variable_name[name_len] = 0;
-	*variable_name_size = name_len + 1;
+	if (!data)
+		return EFI_EXIT(EFI_INVALID_PARAMETER);
 
-	/* guid */
-	c = *(name - 1);
-	*(name - 1) = '\0'; /* guid need be null-terminated here */
-	uuid_str_to_bin(guid, (unsigned char *)vendor, UUID_STR_FORMAT_GUID);
-	*(name - 1) = c;
+	memcpy(data, var->data, var->size);
 
-	/* attributes */
-	parse_attr(end, attributes);
+out:
+	if (attributes)
+		*attributes = var->attr & EFI_VARIABLE_MASK;
 
-	return EFI_SUCCESS;
+	return EFI_EXIT(ret);
 }
 
 /**
@@ -331,13 +649,9 @@ efi_status_t EFIAPI efi_get_next_variable_name(efi_uintn_t *variable_name_size,
 					       u16 *variable_name,
 					       const efi_guid_t *vendor)
 {
-	char *native_name, *variable;
-	ssize_t name_len, list_len;
-	char regex[256];
-	char * const regexlist[] = {regex};
-	u32 attributes;
+	struct efi_var *var;
+	efi_uintn_t name_size;
 	int i;
-	efi_status_t ret;
 
 	EFI_ENTRY("%p \"%ls\" %pUl", variable_name_size, variable_name, vendor);
 
@@ -346,61 +660,38 @@ efi_status_t EFIAPI efi_get_next_variable_name(efi_uintn_t *variable_name_size,
 
 	if (variable_name[0]) {
 		/* check null-terminated string */
-		for (i = 0; i < *variable_name_size; i++)
+		for (i = 0; i < *variable_name_size / sizeof(u16); i++)
 			if (!variable_name[i])
 				break;
-		if (i >= *variable_name_size)
+		if (i >= *variable_name_size / sizeof(u16))
 			return EFI_EXIT(EFI_INVALID_PARAMETER);
 
 		/* search for the last-returned variable */
-		ret = efi_to_native(&native_name, variable_name, vendor);
-		if (ret)
-			return EFI_EXIT(ret);
-
-		name_len = strlen(native_name);
-		for (variable = efi_variables_list; variable && *variable;) {
-			if (!strncmp(variable, native_name, name_len) &&
-			    variable[name_len] == '=')
-				break;
-
-			variable = strchr(variable, '\n');
-			if (variable)
-				variable++;
-		}
-
-		free(native_name);
-		if (!(variable && *variable))
+		var = efi_var_find(variable_name, vendor);
+		if (!var)
 			return EFI_EXIT(EFI_INVALID_PARAMETER);
 
 		/* next variable */
-		variable = strchr(variable, '\n');
-		if (variable)
-			variable++;
-		if (!(variable && *variable))
+		if (list_is_last(&var->link, &efi_var_list))
 			return EFI_EXIT(EFI_NOT_FOUND);
+		var = list_entry(var->link.next, struct efi_var, link);
 	} else {
-		/*
-		 *new search: free a list used in the previous search
-		 */
-		free(efi_variables_list);
-		efi_variables_list = NULL;
-		efi_cur_variable = NULL;
-
-		snprintf(regex, 256, "efi_.*-.*-.*-.*-.*_.*");
-		list_len = hexport_r(&env_htab, '\n',
-				     H_MATCH_REGEX | H_MATCH_KEY,
-				     &efi_variables_list, 0, 1, regexlist);
-		/* 1 indicates that no match was found */
-		if (list_len <= 1)
+		if (list_empty(&efi_var_list))
 			return EFI_EXIT(EFI_NOT_FOUND);
-
-		variable = efi_variables_list;
+		var = list_first_entry(&efi_var_list, struct efi_var, link);
 	}
 
-	ret = parse_uboot_variable(variable, variable_name_size, variable_name,
-				   vendor, &attributes);
+	name_size = (u16_strlen(var->name) + 1) * sizeof(u16);
+	if (*variable_name_size < name_size) {
+		*variable_name_size = name_size;
+		return EFI_EXIT(EFI_BUFFER_TOO_SMALL);
+	}
+	memcpy(variable_name, var->name, name_size);
+	*variable_name_size = name_size;
+	/* vendor is declared const, but is an output parameter */
+	memcpy((efi_guid_t *)vendor, &var->guid, sizeof(var->guid));
 
-	return EFI_EXIT(ret);
+	return EFI_EXIT(EFI_SUCCESS);
 }
 
 /**
@@ -422,9 +713,7 @@ efi_status_t EFIAPI efi_set_variable(u16 *variable_name,
 				     const efi_guid_t *vendor, u32 attributes,
 				     efi_uintn_t data_size, const void *data)
 {
-	char *native_name = NULL, *val = NULL, *s;
-	const char *old_val;
-	size_t old_size;
+	struct efi_var *var;
 	efi_status_t ret = EFI_SUCCESS;
 	u32 attr;
 
@@ -438,16 +727,17 @@ efi_status_t EFIAPI efi_set_variable(u16 *variable_name,
 		goto out;
 	}
 
-	ret = efi_to_native(&native_name, variable_name, vendor);
-	if (ret)
-		goto out;
+	/* store attributes */
+	attr = attributes & (EFI_VARIABLE_NON_VOLATILE |
+			     EFI_VARIABLE_BOOTSERVICE_ACCESS |
+			     EFI_VARIABLE_RUNTIME_ACCESS);
 
-	old_val = env_get(native_name);
-	if (old_val) {
-		old_val = parse_attr(old_val, &attr);
+	var = efi_var_find(variable_name, vendor);
+	if (var) {
+		u32 old_attr = var->attr;
 
 		/* check read-only first */
-		if (attr & READ_ONLY) {
+		if (old_attr & READ_ONLY) {
 			ret = EFI_WRITE_PROTECTED;
 			goto out;
 		}
@@ -456,25 +746,39 @@ efi_status_t EFIAPI efi_set_variable(u16 *variable_name,
 		     !(attributes & EFI_VARIABLE_APPEND_WRITE)) ||
 		    !attributes) {
 			/* delete the variable: */
-			env_set(native_name, NULL);
-			ret = EFI_SUCCESS;
+			efi_var_delete(var);
+			if (old_attr & EFI_VARIABLE_NON_VOLATILE)
+				ret = efi_var_save();
 			goto out;
 		}
 
 		/* attributes won't be changed */
-		if (attr != (attributes & ~EFI_VARIABLE_APPEND_WRITE)) {
+		if (old_attr != (attributes & ~EFI_VARIABLE_APPEND_WRITE)) {
 			ret = EFI_INVALID_PARAMETER;
 			goto out;
 		}
 
 		if (attributes & EFI_VARIABLE_APPEND_WRITE) {
-			if (!prefix(old_val, "(blob)")) {
-				ret = EFI_DEVICE_ERROR;
+			u8 *new_data = realloc(var->data, var->size + data_size);
+
+			if (!new_data) {
+				ret = EFI_OUT_OF_RESOURCES;
 				goto out;
 			}
-			old_size = strlen(old_val);
+			memcpy(new_data + var->size, data, data_size);
+			var->data = new_data;
+			var->size += data_size;
 		} else {
-			old_size = 0;
+			u8 *new_data = malloc(data_size);
+
+			if (!new_data) {
+				ret = EFI_OUT_OF_RESOURCES;
+				goto out;
+			}
+			memcpy(new_data, data, data_size);
+			free(var->data);
+			var->data = new_data;
+			var->size = data_size;
 		}
 	} else {
 		if (data_size == 0 || !attributes ||
@@ -487,58 +791,16 @@ efi_status_t EFIAPI efi_set_variable(u16 *variable_name,
 			goto out;
 		}
 
-		old_size = 0;
-	}
-
-	val = malloc(old_size + 2 * data_size
-		     + strlen("{ro,run,boot,nv}(blob)") + 1);
-	if (!val) {
-		ret = EFI_OUT_OF_RESOURCES;
-		goto out;
-	}
-
-	s = val;
-
-	/* store attributes */
-	attributes &= (EFI_VARIABLE_NON_VOLATILE |
-		       EFI_VARIABLE_BOOTSERVICE_ACCESS |
-		       EFI_VARIABLE_RUNTIME_ACCESS);
-	s += sprintf(s, "{");
-	while (attributes) {
-		u32 attr = 1 << (ffs(attributes) - 1);
-
-		if (attr == EFI_VARIABLE_NON_VOLATILE)
-			s += sprintf(s, "nv");
-		else if (attr == EFI_VARIABLE_BOOTSERVICE_ACCESS)
-			s += sprintf(s, "boot");
-		else if (attr == EFI_VARIABLE_RUNTIME_ACCESS)
-			s += sprintf(s, "run");
-
-		attributes &= ~attr;
-		if (attributes)
-			s += sprintf(s, ",");
+		ret = efi_var_add(variable_name, vendor, attr, data,
+				  data_size);
+		if (ret != EFI_SUCCESS)
+			goto out;
 	}
-	s += sprintf(s, "}");
-
-	if (old_size)
-		/* APPEND_WRITE */
-		s += sprintf(s, old_val);
-	else
-		s += sprintf(s, "(blob)");
-
-	/* store payload: */
-	s = bin2hex(s, data, data_size);
-	*s = '\0';
 
-	EFI_PRINT("setting: %s=%s\n", native_name, val);
-
-	if (env_set(native_name, val))
-		ret = EFI_DEVICE_ERROR;
+	if (attr & EFI_VARIABLE_NON_VOLATILE)
+		ret = efi_var_save();
 
 out:
-	free(native_name);
-	free(val);
-
 	return EFI_EXIT(ret);
 }
 
@@ -639,5 +901,11 @@ void efi_variables_boot_exit_notify(void)
  */
 efi_status_t efi_init_variables(void)
 {
-	return EFI_SUCCESS;
+	efi_status_t ret;
+
+	ret = efi_var_load();
+	if (ret != EFI_SUCCESS)
+		return ret;
+
+	return efi_var_import_env();
 }
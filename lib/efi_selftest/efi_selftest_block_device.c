@@ -11,6 +11,8 @@
  * ConnectController is used to setup partitions and to install the simple
  * file protocol.
  * A known file is read from the file system and verified.
+ * Unaligned reads with the disk IO protocol are compared with the data read
+ * with the block IO protocol, before and after the file system is written.
  */
 
 #include <efi_selftest.h>
@@ -25,6 +27,7 @@
 static struct efi_boot_services *boottime;
 
 static const efi_guid_t block_io_protocol_guid = EFI_BLOCK_IO_PROTOCOL_GUID;
+static const efi_guid_t disk_io_protocol_guid = EFI_DISK_IO_PROTOCOL_GUID;
 static const efi_guid_t guid_device_path = EFI_DEVICE_PATH_PROTOCOL_GUID;
 static const efi_guid_t guid_simple_file_system_protocol =
 					EFI_SIMPLE_FILE_SYSTEM_PROTOCOL_GUID;
@@ -288,6 +291,67 @@ static efi_uintn_t dp_size(struct efi_device_path *dp)
 	return (char *)pos - (char *)dp;
 }
 
+/*
+ * Read the first blocks of a partition with the block IO protocol and
+ * compare them with unaligned reads done with the disk IO protocol.
+ *
+ * @handle	handle of the partition
+ * @return	EFI_ST_SUCCESS for success
+ */
+static int check_disk_io(efi_handle_t handle)
+{
+	struct efi_block_io *block_io;
+	struct efi_disk_io *disk_io;
+	u8 blocks[2 << LB_BLOCK_SIZE] __aligned(1 << LB_BLOCK_SIZE);
+	u8 buf[600];
+	efi_status_t ret;
+
+	ret = boottime->open_protocol(handle, &block_io_protocol_guid,
+				      (void **)&block_io, NULL, NULL,
+				      EFI_OPEN_PROTOCOL_GET_PROTOCOL);
+	if (ret != EFI_SUCCESS) {
+		efi_st_error("Failed to open block IO protocol\n");
+		return EFI_ST_FAILURE;
+	}
+	ret = boottime->open_protocol(handle, &disk_io_protocol_guid,
+				      (void **)&disk_io, NULL, NULL,
+				      EFI_OPEN_PROTOCOL_GET_PROTOCOL);
+	if (ret != EFI_SUCCESS) {
+		efi_st_error("Failed to open disk IO protocol\n");
+		return EFI_ST_FAILURE;
+	}
+	ret = block_io->read_blocks(block_io, block_io->media->media_id, 0,
+				    sizeof(blocks), blocks);
+	if (ret != EFI_SUCCESS) {
+		efi_st_error("Failed to read blocks\n");
+		return EFI_ST_FAILURE;
+	}
+	/* Crosses a block boundary */
+	ret = disk_io->read_disk(disk_io, block_io->media->media_id, 300,
+				 sizeof(buf), buf);
+	if (ret != EFI_SUCCESS) {
+		efi_st_error("Failed to read disk\n");
+		return EFI_ST_FAILURE;
+	}
+	if (memcmp(buf, blocks + 300, sizeof(buf))) {
+		efi_st_error("Disk IO read returned wrong data\n");
+		return EFI_ST_FAILURE;
+	}
+	/* Unaligned buffer with whole blocks */
+	ret = disk_io->read_disk(disk_io, block_io->media->media_id, 0,
+				 1 << LB_BLOCK_SIZE, buf + 1);
+	if (ret != EFI_SUCCESS) {
+		efi_st_error("Failed to read disk\n");
+		return EFI_ST_FAILURE;
+	}
+	if (memcmp(buf + 1, blocks, 1 << LB_BLOCK_SIZE)) {
+		efi_st_error("Disk IO read returned wrong data\n");
+		return EFI_ST_FAILURE;
+	}
+
+	return EFI_ST_SUCCESS;
+}
+
 /*
  * Execute unit test.
  *
@@ -352,6 +416,10 @@ static int execute(void)
 		return EFI_ST_FAILURE;
 	}
 
+	/* Compare unaligned disk IO reads with block IO reads */
+	if (check_disk_io(handle_partition) != EFI_ST_SUCCESS)
+		return EFI_ST_FAILURE;
+
 	/* Open the simple file system protocol */
 	ret = boottime->open_protocol(handle_partition,
 				      &guid_simple_file_system_protocol,
@@ -489,6 +557,13 @@ static int execute(void)
 		efi_st_error("Failed to close file\n");
 		return EFI_ST_FAILURE;
 	}
+
+	/*
+	 * Writing the file changed the FAT behind the back of the disk IO
+	 * protocol, which must not return the blocks it read before
+	 */
+	if (check_disk_io(handle_partition) != EFI_ST_SUCCESS)
+		return EFI_ST_FAILURE;
 #else
 	efi_st_todo("CONFIG_FAT_WRITE is not set\n");
 #endif /* CONFIG_FAT_WRITE */
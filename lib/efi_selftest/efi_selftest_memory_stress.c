@@ -0,0 +1,323 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * efi_selftest_memory_stress
+ *
+ * This unit test stresses the memory allocator with a large number of
+ * allocations of different sizes and memory types. It checks that the
+ * memory map stays sorted, free of overlaps and fully merged, and that it
+ * returns to its original state when everything has been freed.
+ */
+
+#include <efi_selftest.h>
+
+#define EFI_ST_NUM_ALLOCS 512
+#define EFI_ST_MAX_PAGES 8
+
+/**
+ * struct efi_st_alloc - record of an allocation
+ *
+ * @addr:	address of the allocated memory, 0 if not allocated
+ * @pages:	number of pages, 0 for a pool allocation
+ * @type:	memory type
+ */
+struct efi_st_alloc {
+	u64 addr;
+	efi_uintn_t pages;
+	int type;
+};
+
+static struct efi_boot_services *boottime;
+static struct efi_st_alloc *allocs;
+static struct efi_mem_desc *memory_map;
+static efi_uintn_t memory_map_size;
+static u32 seed;
+
+static const int types[] = {
+	EFI_LOADER_DATA,
+	EFI_LOADER_CODE,
+	EFI_BOOT_SERVICES_DATA,
+	EFI_RUNTIME_SERVICES_DATA,
+};
+
+/**
+ * next_rand() - simple pseudo-random number generator
+ *
+ * Return:	next pseudo-random number
+ */
+static u32 next_rand(void)
+{
+	seed = seed * 1103515245 + 12345;
+
+	return seed >> 16;
+}
+
+/**
+ * get_map() - read the memory map into memory_map
+ *
+ * @map_size:	returns the size of the memory map
+ * @desc_size:	returns the size of a memory map entry
+ * Return:	EFI_ST_SUCCESS for success
+ */
+static int get_map(efi_uintn_t *map_size, efi_uintn_t *desc_size)
+{
+	efi_uintn_t map_key;
+	u32 desc_version;
+	efi_status_t ret;
+
+	*map_size = memory_map_size;
+	ret = boottime->get_memory_map(map_size, memory_map, &map_key,
+				       desc_size, &desc_version);
+	if (ret != EFI_SUCCESS) {
+		efi_st_error("GetMemoryMap did not return EFI_SUCCESS\n");
+		return EFI_ST_FAILURE;
+	}
+	return EFI_ST_SUCCESS;
+}
+
+/**
+ * count_entries() - get the number of entries in the memory map
+ *
+ * Return:	number of entries, 0 on failure
+ */
+static efi_uintn_t count_entries(void)
+{
+	efi_uintn_t map_size = 0;
+	efi_uintn_t map_key;
+	efi_uintn_t desc_size;
+	u32 desc_version;
+	efi_status_t ret;
+
+	ret = boottime->get_memory_map(&map_size, NULL, &map_key, &desc_size,
+				       &desc_version);
+	if (ret != EFI_BUFFER_TOO_SMALL || !desc_size) {
+		efi_st_error
+			("GetMemoryMap did not return EFI_BUFFER_TOO_SMALL\n");
+		return 0;
+	}
+	return map_size / desc_size;
+}
+
+/**
+ * check_map() - check the consistency of the memory map
+ *
+ * The entries must be sorted by address, must not overlap and adjacent
+ * entries with the same type and attributes must have been merged. Each
+ * allocation must lie in an entry of the right type.
+ *
+ * Return:	EFI_ST_SUCCESS for success
+ */
+static int check_map(void)
+{
+	efi_uintn_t map_size, desc_size;
+	struct efi_mem_desc *prev = NULL;
+	efi_uintn_t i, j, count;
+
+	if (get_map(&map_size, &desc_size) != EFI_ST_SUCCESS)
+		return EFI_ST_FAILURE;
+	count = map_size / desc_size;
+
+	for (i = 0; i < count; ++i) {
+		struct efi_mem_desc *entry = (void *)memory_map + i * desc_size;
+		u64 end = entry->physical_start +
+			  (entry->num_pages << EFI_PAGE_SHIFT);
+
+		if (entry->physical_start != entry->virtual_start) {
+			efi_st_error("Physical and virtual addresses do not match\n");
+			return EFI_ST_FAILURE;
+		}
+		if (!entry->num_pages) {
+			efi_st_error("Empty memory map entry\n");
+			return EFI_ST_FAILURE;
+		}
+		if (prev) {
+			u64 prev_end = prev->physical_start +
+				       (prev->num_pages << EFI_PAGE_SHIFT);
+
+			if (prev_end > entry->physical_start) {
+				efi_st_error("Memory map entries overlap or are not sorted\n");
+				return EFI_ST_FAILURE;
+			}
+			if (prev_end == entry->physical_start &&
+			    prev->type == entry->type &&
+			    prev->attribute == entry->attribute) {
+				efi_st_error("Adjacent entries not merged\n");
+				return EFI_ST_FAILURE;
+			}
+		}
+		prev = entry;
+
+		for (j = 0; j < EFI_ST_NUM_ALLOCS; ++j) {
+			if (!allocs[j].addr ||
+			    allocs[j].addr < entry->physical_start ||
+			    allocs[j].addr >= end)
+				continue;
+			if (entry->type != allocs[j].type) {
+				efi_st_error("Wrong memory type %d, expected %d\n",
+					     entry->type, allocs[j].type);
+				return EFI_ST_FAILURE;
+			}
+		}
+	}
+	return EFI_ST_SUCCESS;
+}
+
+/**
+ * free_alloc() - free an allocation
+ *
+ * @alloc:	allocation to free
+ * Return:	EFI_ST_SUCCESS for success
+ */
+static int free_alloc(struct efi_st_alloc *alloc)
+{
+	efi_status_t ret;
+
+	if (!alloc->addr)
+		return EFI_ST_SUCCESS;
+	if (alloc->pages)
+		ret = boottime->free_pages(alloc->addr, alloc->pages);
+	else
+		ret = boottime->free_pool((void *)(uintptr_t)alloc->addr);
+	if (ret != EFI_SUCCESS) {
+		efi_st_error("Failed to free memory\n");
+		return EFI_ST_FAILURE;
+	}
+	alloc->addr = 0;
+	return EFI_ST_SUCCESS;
+}
+
+/**
+ * setup() - setup unit test
+ *
+ * @handle:	handle of the loaded image
+ * @systable:	system table
+ * Return:	EFI_ST_SUCCESS for success
+ */
+static int setup(const efi_handle_t handle,
+		 const struct efi_system_table *systable)
+{
+	efi_status_t ret;
+
+	boottime = systable->boottime;
+	seed = 0x5eed;
+
+	ret = boottime->allocate_pool(EFI_LOADER_DATA,
+				      EFI_ST_NUM_ALLOCS * sizeof(*allocs),
+				      (void **)&allocs);
+	if (ret != EFI_SUCCESS) {
+		efi_st_error("AllocatePool did not return EFI_SUCCESS\n");
+		return EFI_ST_FAILURE;
+	}
+	boottime->set_mem(allocs, EFI_ST_NUM_ALLOCS * sizeof(*allocs), 0);
+
+	/* Leave room for every allocation splitting an entry in two */
+	memory_map_size = (count_entries() + 2 * EFI_ST_NUM_ALLOCS + 16) *
+			  sizeof(struct efi_mem_desc);
+	ret = boottime->allocate_pool(EFI_LOADER_DATA, memory_map_size,
+				      (void **)&memory_map);
+	if (ret != EFI_SUCCESS) {
+		efi_st_error("AllocatePool did not return EFI_SUCCESS\n");
+		return EFI_ST_FAILURE;
+	}
+	return EFI_ST_SUCCESS;
+}
+
+/**
+ * teardown() - tear down unit test
+ *
+ * Return:	EFI_ST_SUCCESS for success
+ */
+static int teardown(void)
+{
+	int ret = EFI_ST_SUCCESS;
+	efi_uintn_t i;
+
+	if (allocs) {
+		for (i = 0; i < EFI_ST_NUM_ALLOCS; ++i) {
+			if (free_alloc(&allocs[i]) != EFI_ST_SUCCESS)
+				ret = EFI_ST_FAILURE;
+		}
+		if (boottime->free_pool(allocs) != EFI_SUCCESS)
+			ret = EFI_ST_FAILURE;
+		allocs = NULL;
+	}
+	if (memory_map) {
+		if (boottime->free_pool(memory_map) != EFI_SUCCESS)
+			ret = EFI_ST_FAILURE;
+		memory_map = NULL;
+	}
+	return ret;
+}
+
+/*
+ * execute() - execute unit test
+ *
+ * Return:	EFI_ST_SUCCESS for success
+ */
+static int execute(void)
+{
+	efi_uintn_t initial, i;
+	efi_status_t ret;
+
+	initial = count_entries();
+	if (!initial)
+		return EFI_ST_FAILURE;
+
+	/* Allocate page ranges and pool buffers of varying size and type */
+	for (i = 0; i < EFI_ST_NUM_ALLOCS; ++i) {
+		struct efi_st_alloc *alloc = &allocs[i];
+		u32 r = next_rand();
+
+		alloc->type = types[r % ARRAY_SIZE(types)];
+		if (i % 4 == 3) {
+			void *buf;
+
+			ret = boottime->allocate_pool(alloc->type,
+						      1 + (r >> 4) % 20000,
+						      &buf);
+			alloc->addr = (uintptr_t)buf;
+		} else {
+			alloc->pages = 1 + (r >> 4) % EFI_ST_MAX_PAGES;
+			ret = boottime->allocate_pages(EFI_ALLOCATE_ANY_PAGES,
+						       alloc->type,
+						       alloc->pages,
+						       &alloc->addr);
+		}
+		if (ret != EFI_SUCCESS) {
+			efi_st_error("Allocation %u failed\n", (unsigned int)i);
+			return EFI_ST_FAILURE;
+		}
+	}
+	if (check_map() != EFI_ST_SUCCESS)
+		return EFI_ST_FAILURE;
+
+	/* Free every other allocation, leaving holes in the map */
+	for (i = 0; i < EFI_ST_NUM_ALLOCS; i += 2) {
+		if (free_alloc(&allocs[i]) != EFI_ST_SUCCESS)
+			return EFI_ST_FAILURE;
+	}
+	if (check_map() != EFI_ST_SUCCESS)
+		return EFI_ST_FAILURE;
+
+	/* Free the rest, which should leave the map as it was */
+	for (i = 1; i < EFI_ST_NUM_ALLOCS; i += 2) {
+		if (free_alloc(&allocs[i]) != EFI_ST_SUCCESS)
+			return EFI_ST_FAILURE;
+	}
+	if (check_map() != EFI_ST_SUCCESS)
+		return EFI_ST_FAILURE;
+	if (count_entries() != initial) {
+		efi_st_error("Memory map has %u entries, expected %u\n",
+			     (unsigned int)count_entries(),
+			     (unsigned int)initial);
+		return EFI_ST_FAILURE;
+	}
+	return EFI_ST_SUCCESS;
+}
+
+EFI_UNIT_TEST(memory_stress) = {
+	.name = "memory stress",
+	.phase = EFI_EXECUTE_BEFORE_BOOTTIME_EXIT,
+	.setup = setup,
+	.execute = execute,
+	.teardown = teardown,
+};
@@ -46,6 +46,99 @@
 
 static void default_log(const char *ignored, char *response) {}
 
+/* Write @blkcnt blocks from a buffer of @buf_blks blocks, over and over */
+static int sparse_write_repeat(struct sparse_storage *info, lbaint_t *blk,
+			       lbaint_t blkcnt, const void *buf,
+			       lbaint_t buf_blks)
+{
+	lbaint_t blks;
+	lbaint_t i;
+	lbaint_t j;
+
+	for (i = 0; i < blkcnt;) {
+		j = blkcnt - i;
+		if (j > buf_blks)
+			j = buf_blks;
+		blks = info->write(info, *blk, j, buf);
+		/* blks might be > j (eg. NAND bad-blocks) */
+		if (blks < j) {
+			printf("%s: %s " LBAFU " [" LBAFU "]\n", __func__,
+			       "Write failed, block #", *blk, j);
+			return -EIO;
+		}
+		*blk += blks;
+		i += j;
+	}
+
+	return 0;
+}
+
+/**
+ * sparse_write_fill() - Write a FILL chunk
+ *
+ * If the storage reads back @fill_val after an erase, the erase groups
+ * covered by the chunk are erased instead of written.
+ *
+ * @info: Storage to write to
+ * @blk: First block to write, updated to follow the chunk
+ * @blkcnt: Number of blocks in the chunk
+ * @fill_val: Value to fill the blocks with
+ * @err: Returns a description of the error, if any
+ * @return 0 if OK, -ve on error
+ */
+static int sparse_write_fill(struct sparse_storage *info, lbaint_t *blk,
+			     lbaint_t blkcnt, uint32_t fill_val,
+			     const char **err)
+{
+	lbaint_t fill_buf_num_blks;
+	lbaint_t head = blkcnt;
+	lbaint_t mid = 0;
+	uint32_t *fill_buf;
+	lbaint_t grp;
+	lbaint_t blks;
+	int ret;
+	int i;
+
+	if (info->erase && fill_val == info->erase_val) {
+		grp = info->erase_grp ? info->erase_grp : 1;
+		head = min(blkcnt, (grp - (*blk & (grp - 1))) & (grp - 1));
+		mid = (blkcnt - head) & ~(grp - 1);
+	}
+
+	fill_buf_num_blks = CONFIG_IMAGE_SPARSE_FILLBUF_SIZE / info->blksz;
+	fill_buf = (uint32_t *)
+		   memalign(ARCH_DMA_MINALIGN,
+			    ROUNDUP(info->blksz * fill_buf_num_blks,
+				    ARCH_DMA_MINALIGN));
+	if (!fill_buf) {
+		*err = "Malloc failed for: CHUNK_TYPE_FILL";
+		return -ENOMEM;
+	}
+	for (i = 0; i < (info->blksz * fill_buf_num_blks / sizeof(fill_val));
+	     i++)
+		fill_buf[i] = fill_val;
+
+	ret = sparse_write_repeat(info, blk, head, fill_buf,
+				  fill_buf_num_blks);
+	if (!ret && mid) {
+		blks = info->erase(info, *blk, mid);
+		if (blks != mid) {
+			printf("%s: %s " LBAFU " [" LBAFU "]\n", __func__,
+			       "Erase failed, block #", *blk, mid);
+			ret = -EIO;
+		}
+		*blk += mid;
+	}
+	if (!ret)
+		ret = sparse_write_repeat(info, blk, blkcnt - head - mid,
+					  fill_buf, fill_buf_num_blks);
+	free(fill_buf);
+	if (ret)
+		*err = "flash write failure";
+
+	return ret;
+}
+
 int write_sparse_image(struct sparse_storage *info,
 		       const char *part_name, void *data, char *response)
 {
@@ -56,16 +149,11 @@ int write_sparse_image(struct sparse_storage *info,
 	unsigned int chunk;
 	unsigned int offset;
 	unsigned int chunk_data_sz;
-	uint32_t *fill_buf = NULL;
 	uint32_t fill_val;
 	sparse_header_t *sparse_header;
 	chunk_header_t *chunk_header;
 	uint32_t total_blocks = 0;
-	int fill_buf_num_blks;
-	int i;
-	int j;
-
-	fill_buf_num_blks = CONFIG_IMAGE_SPARSE_FILLBUF_SIZE / info->blksz;
+	const char *err;
 
 	/* Read and skip over sparse image header */
 	sparse_header = (sparse_header_t *)data;
@@ -171,26 +259,9 @@ int write_sparse_image(struct sparse_storage *info,
 				return -1;
 			}
 
-			fill_buf = (uint32_t *)
-				   memalign(ARCH_DMA_MINALIGN,
-					    ROUNDUP(
-						info->blksz * fill_buf_num_blks,
-						ARCH_DMA_MINALIGN));
-			if (!fill_buf) {
-				info->mssg("Malloc failed for: CHUNK_TYPE_FILL",
-					   response);
-				return -1;
-			}
-
 			fill_val = *(uint32_t *)data;
 			data = (char *)data + sizeof(uint32_t);
 
-			for (i = 0;
-			     i < (info->blksz * fill_buf_num_blks /
-				  sizeof(fill_val));
-			     i++)
-				fill_buf[i] = fill_val;
-
 			if (blk + blkcnt > info->start + info->size) {
 				printf(
 				    "%s: Request would exceed partition size!\n",
@@ -200,28 +271,13 @@ int write_sparse_image(struct sparse_storage *info,
 				return -1;
 			}
 
-			for (i = 0; i < blkcnt;) {
-				j = blkcnt - i;
-				if (j > fill_buf_num_blks)
-					j = fill_buf_num_blks;
-				blks = info->write(info, blk, j, fill_buf);
-				/* blks might be > j (eg. NAND bad-blocks) */
-				if (blks < j) {
-					printf("%s: %s " LBAFU " [%d]\n",
-					       __func__,
-					       "Write failed, block #",
-					       blk, j);
-					info->mssg("flash write failure",
-						   response);
-					free(fill_buf);
-					return -1;
-				}
-				blk += blks;
-				i += j;
+			if (sparse_write_fill(info, &blk, blkcnt, fill_val,
+					      &err)) {
+				info->mssg(err, response);
+				return -1;
 			}
 			bytes_written += blkcnt * info->blksz;
 			total_blocks += chunk_data_sz / sparse_header->blk_sz;
-			free(fill_buf);
 			break;
 
 		case CHUNK_TYPE_DONT_CARE:
@@ -259,3 +315,338 @@ int write_sparse_image(struct sparse_storage *info,
 
 	return 0;
 }
+
+enum sparse_stream_state {
+	SPARSE_STREAM_HEADER,	/* receiving the image header */
+	SPARSE_STREAM_CHUNK,	/* receiving a chunk header */
+	SPARSE_STREAM_RAW,	/* receiving RAW chunk data */
+	SPARSE_STREAM_FILL,	/* receiving the value of a FILL chunk */
+	SPARSE_STREAM_SKIP,	/* skipping bytes, then going to @next */
+	SPARSE_STREAM_DONE,	/* all chunks received */
+};
+
+int sparse_stream_init(struct sparse_stream *ss, struct sparse_storage *info,
+		       void *buf, u32 size)
+{
+	ulong base = ALIGN((ulong)buf, ARCH_DMA_MINALIGN);
+	u32 unit = ROUNDUP(info->blksz, ARCH_DMA_MINALIGN);
+	u32 buf_size;
+
+	memset(ss, '\0', sizeof(*ss));
+	ss->info = info;
+	ss->blk = info->start;
+	ss->state = SPARSE_STREAM_HEADER;
+
+	size -= min((ulong)size, base - (ulong)buf);
+	buf_size = size / 2;
+	buf_size -= buf_size % unit;
+	if (!buf_size)
+		return -EINVAL;
+	ss->buf_size = buf_size;
+	ss->buf[0] = (char *)base;
+	ss->buf[1] = (char *)base + buf_size;
+
+	return 0;
+}
+
+static void sparse_stream_fail(struct sparse_stream *ss, const char *err)
+{
+	if (!ss->err) {
+		printf("Sparse image: %s\n", err);
+		ss->err = err;
+	}
+}
+
+int sparse_stream_flush(struct sparse_stream *ss)
+{
+	struct sparse_storage *info = ss->info;
+	int idx = !ss->cur;
+	lbaint_t blks;
+
+	if (!ss->pending || ss->err) {
+		ss->pending = 0;
+		return ss->err ? -EIO : 0;
+	}
+
+	blks = info->write(info, ss->start[idx], ss->pending, ss->buf[idx]);
+	if (blks < ss->pending) {
+		printf("%s: %s" LBAFU " [" LBAFU "]\n", __func__,
+		       "Write failed, block #", ss->start[idx], blks);
+		sparse_stream_fail(ss, "flash write failure");
+	} else {
+		ss->bytes_written += (u64)ss->pending * info->blksz;
+	}
+	ss->pending = 0;
+
+	return ss->err ? -EIO : 0;
+}
+
+/* Queue the buffer being filled and switch to the other one */
+static void sparse_stream_submit(struct sparse_stream *ss)
+{
+	struct sparse_storage *info = ss->info;
+	lbaint_t blkcnt = DIV_ROUND_UP(ss->len, info->blksz);
+
+	if (!ss->len)
+		return;
+
+	/* Only one buffer can be queued, so the other must be written now */
+	if (sparse_stream_flush(ss))
+		return;
+
+	if (ss->blk + blkcnt > info->start + info->size) {
+		sparse_stream_fail(ss, "Request would exceed partition size!");
+		return;
+	}
+
+	/* Only the end of a raw image can be a partial block */
+	memset(ss->buf[ss->cur] + ss->len, '\0',
+	       blkcnt * info->blksz - ss->len);
+	ss->start[ss->cur] = ss->blk;
+	ss->blk += blkcnt;
+	ss->pending = blkcnt;
+	ss->cur = !ss->cur;
+	ss->len = 0;
+}
+
+/* Move to @state, after skipping @skip bytes */
+static void sparse_stream_goto(struct sparse_stream *ss, int state, u32 skip)
+{
+	ss->hdr_len = 0;
+	ss->skip = skip;
+	ss->next = state;
+	ss->state = skip ? SPARSE_STREAM_SKIP : state;
+}
+
+/* Move on to the next chunk, if any */
+static void sparse_stream_next(struct sparse_stream *ss, u32 skip)
+{
+	sparse_stream_goto(ss, ss->chunk == ss->sparse_header.total_chunks ?
+			   SPARSE_STREAM_DONE : SPARSE_STREAM_CHUNK, skip);
+}
+
+/* Write the image as it is, starting with the bytes taken as its header */
+static void sparse_stream_raw(struct sparse_stream *ss)
+{
+	ss->raw = true;
+	memcpy(ss->buf[ss->cur], &ss->sparse_header, ss->hdr_len);
+	ss->len = ss->hdr_len;
+	ss->left = U64_MAX;
+	sparse_stream_goto(ss, SPARSE_STREAM_RAW, 0);
+}
+
+static void sparse_stream_header(struct sparse_stream *ss)
+{
+	sparse_header_t *sparse_header = &ss->sparse_header;
+	u32 rem;
+
+	if (!is_sparse_image(sparse_header)) {
+		puts("Flashing Raw Image\n");
+		sparse_stream_raw(ss);
+		return;
+	}
+
+	debug("=== Sparse Image Header ===\n");
+	debug("blk_sz: %d\n", sparse_header->blk_sz);
+	debug("total_blks: %d\n", sparse_header->total_blks);
+	debug("total_chunks: %d\n", sparse_header->total_chunks);
+
+	div_u64_rem(sparse_header->blk_sz, ss->info->blksz, &rem);
+	if (rem || !sparse_header->blk_sz) {
+		sparse_stream_fail(ss, "sparse image block size issue");
+		return;
+	}
+	if (sparse_header->file_hdr_sz < sizeof(sparse_header_t) ||
+	    sparse_header->chunk_hdr_sz < sizeof(chunk_header_t)) {
+		sparse_stream_fail(ss, "sparse image header size issue");
+		return;
+	}
+
+	puts("Flashing Sparse Image\n");
+	sparse_stream_next(ss, sparse_header->file_hdr_sz -
+			   sizeof(sparse_header_t));
+}
+
+static void sparse_stream_chunk(struct sparse_stream *ss)
+{
+	sparse_header_t *sparse_header = &ss->sparse_header;
+	chunk_header_t *chunk_header = &ss->chunk_header;
+	struct sparse_storage *info = ss->info;
+	u32 extra = sparse_header->chunk_hdr_sz - sizeof(chunk_header_t);
+	u64 chunk_data_sz;
+	lbaint_t blkcnt;
+
+	chunk_data_sz = (u64)sparse_header->blk_sz * chunk_header->chunk_sz;
+	blkcnt = div_u64(chunk_data_sz, info->blksz);
+	ss->chunk++;
+
+	switch (chunk_header->chunk_type) {
+	case CHUNK_TYPE_RAW:
+		if (chunk_header->total_sz !=
+		    sparse_header->chunk_hdr_sz + chunk_data_sz) {
+			sparse_stream_fail(ss,
+					   "Bogus chunk size for chunk type Raw");
+			return;
+		}
+		if (ss->blk + blkcnt > info->start + info->size) {
+			sparse_stream_fail(ss,
+					   "Request would exceed partition size!");
+			return;
+		}
+		ss->left = chunk_data_sz;
+		if (!ss->left)
+			sparse_stream_next(ss, extra);
+		else
+			sparse_stream_goto(ss, SPARSE_STREAM_RAW, extra);
+		break;
+
+	case CHUNK_TYPE_FILL:
+		if (chunk_header->total_sz !=
+		    sparse_header->chunk_hdr_sz + sizeof(uint32_t)) {
+			sparse_stream_fail(ss,
+					   "Bogus chunk size for chunk type FILL");
+			return;
+		}
+		ss->left = blkcnt;
+		sparse_stream_goto(ss, SPARSE_STREAM_FILL, extra);
+		break;
+
+	case CHUNK_TYPE_DONT_CARE:
+		if (chunk_header->total_sz < sparse_header->chunk_hdr_sz) {
+			sparse_stream_fail(ss,
+					   "Bogus chunk size for chunk type Dont Care");
+			return;
+		}
+		ss->blk += info->reserve(info, ss->blk, blkcnt);
+		sparse_stream_next(ss, chunk_header->total_sz -
+				   sizeof(chunk_header_t));
+		break;
+
+	case CHUNK_TYPE_CRC32:
+		if (chunk_header->total_sz < sparse_header->chunk_hdr_sz) {
+			sparse_stream_fail(ss,
+					   "Bogus chunk size for chunk type CRC32");
+			return;
+		}
+		sparse_stream_next(ss, chunk_header->total_sz -
+				   sizeof(chunk_header_t));
+		break;
+
+	default:
+		printf("%s: Unknown chunk type: %x\n", __func__,
+		       chunk_header->chunk_type);
+		sparse_stream_fail(ss, "Unknown chunk type");
+		return;
+	}
+	ss->total_blocks += chunk_header->chunk_sz;
+}
+
+static void sparse_stream_fill(struct sparse_stream *ss)
+{
+	struct sparse_storage *info = ss->info;
+	lbaint_t blkcnt = ss->left;
+	const char *err;
+
+	if (ss->blk + blkcnt > info->start + info->size) {
+		sparse_stream_fail(ss, "Request would exceed partition size!");
+		return;
+	}
+	if (sparse_write_fill(info, &ss->blk, blkcnt, ss->fill_val, &err)) {
+		sparse_stream_fail(ss, err);
+		return;
+	}
+	ss->bytes_written += (u64)blkcnt * info->blksz;
+	sparse_stream_next(ss, 0);
+}
+
+/* Add received bytes to the header being collected */
+static u32 sparse_stream_collect(struct sparse_stream *ss, void *hdr,
+				 u32 size, const char *data, u32 len)
+{
+	u32 n = min(len, size - ss->hdr_len);
+
+	memcpy(hdr + ss->hdr_len, data, n);
+	ss->hdr_len += n;
+
+	return n;
+}
+
+int sparse_stream_write(struct sparse_stream *ss, const void *data, u32 len)
+{
+	const char *p = data;
+	u32 n;
+
+	while (len && !ss->err) {
+		switch (ss->state) {
+		case SPARSE_STREAM_HEADER:
+			n = sparse_stream_collect(ss, &ss->sparse_header,
+						  sizeof(sparse_header_t),
+						  p, len);
+			if (ss->hdr_len == sizeof(sparse_header_t))
+				sparse_stream_header(ss);
+			break;
+		case SPARSE_STREAM_CHUNK:
+			n = sparse_stream_collect(ss, &ss->chunk_header,
+						  sizeof(chunk_header_t),
+						  p, len);
+			if (ss->hdr_len == sizeof(chunk_header_t))
+				sparse_stream_chunk(ss);
+			break;
+		case SPARSE_STREAM_FILL:
+			n = sparse_stream_collect(ss, &ss->fill_val,
+						  sizeof(uint32_t), p, len);
+			if (ss->hdr_len == sizeof(uint32_t))
+				sparse_stream_fill(ss);
+			break;
+		case SPARSE_STREAM_RAW:
+			n = min3((u64)len, ss->left,
+				 (u64)(ss->buf_size - ss->len));
+			memcpy(ss->buf[ss->cur] + ss->len, p, n);
+			ss->len += n;
+			ss->left -= n;
+			/* A buffer never spans two chunks */
+			if (ss->len == ss->buf_size || !ss->left)
+				sparse_stream_submit(ss);
+			if (!ss->left)
+				sparse_stream_next(ss, 0);
+			break;
+		case SPARSE_STREAM_SKIP:
+			n = min(len, ss->skip);
+			ss->skip -= n;
+			if (!ss->skip)
+				ss->state = ss->next;
+			break;
+		default:
+			sparse_stream_fail(ss, "Data after the end of the image");
+			return -EIO;
+		}
+		p += n;
+		len -= n;
+	}
+
+	return ss->err ? -EIO : 0;
+}
+
+int sparse_stream_finish(struct sparse_stream *ss, const char *part_name)
+{
+	/* Anything too short to be a sparse image is written as it is */
+	if (ss->state == SPARSE_STREAM_HEADER && ss->hdr_len)
+		sparse_stream_raw(ss);
+	if (ss->raw)
+		sparse_stream_submit(ss);
+	sparse_stream_flush(ss);
+
+	if (!ss->raw && !ss->err) {
+		if (ss->state != SPARSE_STREAM_DONE)
+			sparse_stream_fail(ss, "sparse image is truncated");
+		else if (ss->total_blocks != ss->sparse_header.total_blks)
+			sparse_stream_fail(ss, "sparse image write failure");
+	}
+	if (ss->err)
+		return -EIO;
+
+	printf("........ wrote %llu bytes to '%s'\n", ss->bytes_written,
+	       part_name);
+
+	return 0;
+}
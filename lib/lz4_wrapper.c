@@ -62,6 +62,14 @@ struct lz4_block_header {
 	/* + u32 block_checksum iff has_block_checksum is set */
 } __packed;
 
+int LZ4_decompress_safe(const char *source, char *dest, int inputSize,
+			int maxOutputSize)
+{
+	return LZ4_decompress_generic(source, dest, inputSize, maxOutputSize,
+				      endOnInputSize, full, 0, noDict,
+				      (BYTE *)dest, NULL, 0);
+}
+
 int ulz4fn(const void *src, size_t srcn, void *dst, size_t *dstn)
 {
 	const void *end = dst + *dstn;
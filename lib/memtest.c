@@ -0,0 +1,154 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Memory test engine, used by mtest and POST
+ */
+
+#include <common.h>
+#include <console.h>
+#include <mapmem.h>
+#include <memtest.h>
+#include <watchdog.h>
+#include <linux/compiler.h>
+#include <linux/math64.h>
+#include <linux/sizes.h>
+
+/* Number of words handled between watchdog resets and checks for Ctrl-C */
+#define MEMTEST_BLOCK_WORDS	(SZ_256K / sizeof(ulong))
+
+void memtest_init(struct memtest *mt, ulong addr, ulong size,
+		  bool interruptible)
+{
+	memset(mt, '\0', sizeof(*mt));
+	mt->buf = map_sysmem(addr, size);
+	mt->addr = addr;
+	mt->words = size / sizeof(ulong);
+	mt->interruptible = interruptible;
+}
+
+void memtest_uninit(struct memtest *mt)
+{
+	unmap_sysmem(mt->buf);
+}
+
+static void memtest_fill_block(ulong *p, ulong count, ulong val, ulong incr)
+{
+	for (; count >= 4; count -= 4, p += 4, val += 4 * incr) {
+		p[0] = val;
+		p[1] = val + incr;
+		p[2] = val + 2 * incr;
+		p[3] = val + 3 * incr;
+	}
+	for (; count; count--, val += incr)
+		*p++ = val;
+}
+
+static void memtest_record(struct memtest *mt, ulong *p, ulong expected,
+			   ulong actual)
+{
+	struct memtest_err *err;
+
+	if (actual == expected)
+		return;
+	if (mt->nerr < MEMTEST_MAX_ERRS) {
+		err = &mt->err[mt->nerr++];
+		err->addr = mt->addr + (p - mt->buf) * sizeof(ulong);
+		err->expected = expected;
+		err->actual = actual;
+	}
+	mt->errs++;
+}
+
+static void memtest_write(ulong *p, uint count, ulong val, ulong incr,
+			  enum memtest_then then)
+{
+	for (; count; count--, val += incr) {
+		if (then == MEMTEST_INVERT)
+			*p++ = ~val;
+		else
+			*p++ = 0;
+	}
+}
+
+static void memtest_check_block(struct memtest *mt, ulong *p, ulong count,
+				ulong val, ulong incr, enum memtest_then then)
+{
+	ulong a, b, c, d;
+
+	for (; count >= 4; count -= 4, p += 4, val += 4 * incr) {
+		a = p[0];
+		b = p[1];
+		c = p[2];
+		d = p[3];
+		/* Compare all four at once and only look closer if needed */
+		if (unlikely((a ^ val) | (b ^ (val + incr)) |
+			     (c ^ (val + 2 * incr)) | (d ^ (val + 3 * incr)))) {
+			memtest_record(mt, p, val, a);
+			memtest_record(mt, p + 1, val + incr, b);
+			memtest_record(mt, p + 2, val + 2 * incr, c);
+			memtest_record(mt, p + 3, val + 3 * incr, d);
+		}
+		if (then != MEMTEST_KEEP)
+			memtest_write(p, 4, val, incr, then);
+	}
+	for (; count; count--, p++, val += incr) {
+		memtest_record(mt, p, val, *p);
+		if (then != MEMTEST_KEEP)
+			memtest_write(p, 1, val, incr, then);
+	}
+}
+
+int memtest_fill(struct memtest *mt, ulong pattern, ulong incr)
+{
+	ulong start = get_timer(0);
+	ulong done, count;
+	int ret = 0;
+
+	for (done = 0; done < mt->words; done += count) {
+		count = min(mt->words - done, (ulong)MEMTEST_BLOCK_WORDS);
+		memtest_fill_block(mt->buf + done, count, pattern + done * incr,
+				   incr);
+		/* Make sure the block is written before anything else */
+		barrier();
+		WATCHDOG_RESET();
+		if (mt->interruptible && ctrlc()) {
+			ret = -EINTR;
+			break;
+		}
+	}
+	mt->bytes += done * sizeof(ulong);
+	mt->time += get_timer(start);
+
+	return ret;
+}
+
+int memtest_check(struct memtest *mt, ulong pattern, ulong incr,
+		  enum memtest_then then)
+{
+	ulong start = get_timer(0);
+	ulong done, count;
+	int ret = 0;
+
+	for (done = 0; done < mt->words; done += count) {
+		count = min(mt->words - done, (ulong)MEMTEST_BLOCK_WORDS);
+		memtest_check_block(mt, mt->buf + done, count,
+				    pattern + done * incr, incr, then);
+		barrier();
+		WATCHDOG_RESET();
+		if (mt->interruptible && ctrlc()) {
+			ret = -EINTR;
+			break;
+		}
+	}
+	mt->bytes += done * sizeof(ulong) * (then == MEMTEST_KEEP ? 1 : 2);
+	mt->time += get_timer(start);
+
+	return ret;
+}
+
+ulong memtest_mib_per_sec(const struct memtest *mt)
+{
+	if (!mt->time)
+		return 0;
+
+	return div_u64(mt->bytes * 1000 / SZ_1M, mt->time);
+}
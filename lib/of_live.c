@@ -15,6 +15,12 @@
 #include <dm/of_access.h>
 #include <linux/err.h>
 
+/*
+ * Flat tree which a compact live tree materialises its properties from. This
+ * is a copy held in the same allocation as the nodes.
+ */
+static const void *of_live_blob;
+
 static void *unflatten_dt_alloc(void **mem, unsigned long size,
 				unsigned long align)
 {
@@ -28,38 +34,39 @@ static void *unflatten_dt_alloc(void **mem, unsigned long size,
 }
 
 /**
- * unflatten_dt_node() - Alloc and populate a device_node from the flat tree
+ * unflatten_dt_full_node() - Alloc and populate a device_node and properties
+ *
+ * Every property in the flat tree gets its own struct property and each node
+ * holds a copy of its full path.
+ *
  * @blob: The parent device tree blob
- * @mem: Memory chunk to use for allocating device nodes and properties
- * @poffset: pointer to node in flat tree
+ * @mem: Memory chunk to use for allocating device nodes and properties,
+ * updated on exit
+ * @offset: offset of node in flat tree
+ * @pathp: Name of the node in the flat tree
+ * @l: Length of @pathp, including the terminator
  * @dad: Parent struct device_node
- * @nodepp: The device_node tree created by the call
- * @fpsize: Size of the node path up at t05he current depth.
+ * @fpsize: Size of the node path up at the current depth, updated on exit
  * @dryrun: If true, do not allocate device nodes but still calculate needed
  * memory size
+ * @return the new node
  */
-static void *unflatten_dt_node(const void *blob, void *mem, int *poffset,
-			       struct device_node *dad,
-			       struct device_node **nodepp,
-			       unsigned long fpsize, bool dryrun)
+static struct device_node *unflatten_dt_full_node(const void *blob, void **mem,
+						  int offset,
+						  const char *pathp, int l,
+						  struct device_node *dad,
+						  unsigned long *fpsize,
+						  bool dryrun)
 {
 	const __be32 *p;
 	struct device_node *np;
 	struct property *pp, **prev_pp = NULL;
-	const char *pathp;
-	int l;
 	unsigned int allocl;
-	static int depth;
-	int old_depth;
-	int offset;
+	int node_offset = offset;
 	int has_name = 0;
 	int new_format = 0;
 
-	pathp = fdt_get_name(blob, *poffset, &l);
-	if (!pathp)
-		return mem;
-
-	allocl = ++l;
+	allocl = l;
 
 	/*
 	 * version 0x10 has a more compact unit name here instead of the full
@@ -69,14 +76,14 @@ static void *unflatten_dt_node(const void *blob, void *mem, int *poffset,
 	 */
 	if ((*pathp) != '/') {
 		new_format = 1;
-		if (fpsize == 0) {
+		if (*fpsize == 0) {
 			/*
 			 * root node: special case. fpsize accounts for path
 			 * plus terminating zero. root node only has '/', so
 			 * fpsize should be 2, but we want to avoid the first
 			 * level nodes to have two '/' so we use fpsize 1 here
 			 */
-			fpsize = 1;
+			*fpsize = 1;
 			allocl = 2;
 			l = 1;
 			pathp = "";
@@ -85,18 +92,19 @@ static void *unflatten_dt_node(const void *blob, void *mem, int *poffset,
 			 * account for '/' and path size minus terminal 0
 			 * already in 'l'
 			 */
-			fpsize += l;
-			allocl = fpsize;
+			*fpsize += l;
+			allocl = *fpsize;
 		}
 	}
 
-	np = unflatten_dt_alloc(&mem, sizeof(struct device_node) + allocl,
+	np = unflatten_dt_alloc(mem, sizeof(struct device_node) + allocl,
 				__alignof__(struct device_node));
 	if (!dryrun) {
 		char *fn;
 
 		fn = (char *)np + sizeof(*np);
 		np->full_name = fn;
+		np->offset = -1;
 		if (new_format) {
 			/* rebuild full path for new format */
 			if (dad && dad->parent) {
@@ -122,7 +130,7 @@ static void *unflatten_dt_node(const void *blob, void *mem, int *poffset,
 		}
 	}
 	/* process properties */
-	for (offset = fdt_first_property_offset(blob, *poffset);
+	for (offset = fdt_first_property_offset(blob, node_offset);
 	     (offset >= 0);
 	     (offset = fdt_next_property_offset(blob, offset))) {
 		const char *pname;
@@ -140,7 +148,7 @@ static void *unflatten_dt_node(const void *blob, void *mem, int *poffset,
 		}
 		if (strcmp(pname, "name") == 0)
 			has_name = 1;
-		pp = unflatten_dt_alloc(&mem, sizeof(struct property),
+		pp = unflatten_dt_alloc(mem, sizeof(struct property),
 					__alignof__(struct property));
 		if (!dryrun) {
 			/*
@@ -185,7 +193,7 @@ static void *unflatten_dt_node(const void *blob, void *mem, int *poffset,
 		if (pa < ps)
 			pa = p1;
 		sz = (pa - ps) + 1;
-		pp = unflatten_dt_alloc(&mem, sizeof(struct property) + sz,
+		pp = unflatten_dt_alloc(mem, sizeof(struct property) + sz,
 					__alignof__(struct property));
 		if (!dryrun) {
 			pp->name = "name";
@@ -209,6 +217,131 @@ static void *unflatten_dt_node(const void *blob, void *mem, int *poffset,
 		if (!np->type)
 			np->type = "<NULL>";	}
 
+	return np;
+}
+
+/**
+ * unflatten_dt_compact_node() - Alloc and populate a compact device_node
+ *
+ * Only the node and its full path are created. Its name points into the flat
+ * tree and its properties are materialised later by of_live_load_props(),
+ * when needed.
+ *
+ * @blob: The parent device tree blob
+ * @mem: Memory chunk to use for allocating device nodes, updated on exit
+ * @offset: offset of node in flat tree
+ * @pathp: Name of the node in the flat tree
+ * @dad: Parent struct device_node
+ * @fpsize: Size of the node path up at the current depth, updated on exit
+ * @dryrun: If true, do not allocate device nodes but still calculate needed
+ * memory size
+ * @return the new node
+ */
+static struct device_node *unflatten_dt_compact_node(const void *blob,
+						     void **mem, int offset,
+						     const char *pathp,
+						     struct device_node *dad,
+						     unsigned long *fpsize,
+						     bool dryrun)
+{
+	struct device_node *np;
+	const fdt32_t *prop;
+	const char *name, *ps;
+	char *fixup, *fn;
+	int allocl, sz;
+
+	/*
+	 * the path is the parent's path, a '/' and the unit name. As with a
+	 * full node, use @fpsize to spot the root node, since @dad is not a
+	 * real node in a dry run
+	 */
+	ps = strrchr(pathp, '/');
+	ps = ps ? ps + 1 : pathp;
+	if (*fpsize == 0) {
+		*fpsize = 1;
+		allocl = 2;
+		ps = "";
+	} else {
+		*fpsize += strlen(ps) + 1;
+		allocl = *fpsize;
+	}
+	np = unflatten_dt_alloc(mem, sizeof(struct device_node) + allocl,
+				__alignof__(struct device_node));
+
+	/* recreate the name from the unit name if there is no property */
+	name = fdt_getprop(blob, offset, "name", NULL);
+	if (!name) {
+		sz = strchrnul(ps, '@') - ps + 1;
+		fixup = unflatten_dt_alloc(mem, sz, 1);
+		if (!dryrun) {
+			memcpy(fixup, ps, sz - 1);
+			fixup[sz - 1] = '\0';
+		}
+		name = fixup;
+	}
+	if (dryrun)
+		return np;
+
+	fn = (char *)np + sizeof(*np);
+	np->full_name = fn;
+	if (dad && dad->parent) {
+		strcpy(fn, dad->full_name);
+		fn += strlen(fn);
+	}
+	*fn++ = '/';
+	strcpy(fn, ps);
+
+	np->name = name;
+	np->type = fdt_getprop(blob, offset, "device_type", NULL);
+	if (!np->type)
+		np->type = "<NULL>";
+	np->phandle = fdt_get_phandle(blob, offset);
+	prop = fdt_getprop(blob, offset, "ibm,phandle", &sz);
+	if (prop && sz == sizeof(*prop))
+		np->phandle = fdt32_to_cpu(*prop);
+	np->offset = offset;
+	if (dad) {
+		np->parent = dad;
+		np->sibling = dad->child;
+		dad->child = np;
+	}
+
+	return np;
+}
+
+/**
+ * unflatten_dt_node() - Alloc and populate a device_node from the flat tree
+ * @blob: The parent device tree blob
+ * @mem: Memory chunk to use for allocating device nodes and properties
+ * @poffset: pointer to node in flat tree
+ * @dad: Parent struct device_node
+ * @nodepp: The device_node tree created by the call
+ * @fpsize: Size of the node path up at t05he current depth.
+ * @dryrun: If true, do not allocate device nodes but still calculate needed
+ * memory size
+ */
+static void *unflatten_dt_node(const void *blob, void *mem, int *poffset,
+			       struct device_node *dad,
+			       struct device_node **nodepp,
+			       unsigned long fpsize, bool dryrun)
+{
+	struct device_node *np;
+	const char *pathp;
+	int l;
+	static int depth;
+	int old_depth;
+
+	pathp = fdt_get_name(blob, *poffset, &l);
+	if (!pathp)
+		return mem;
+
+	if (IS_ENABLED(CONFIG_OF_LIVE_COMPACT))
+		np = unflatten_dt_compact_node(blob, &mem, *poffset, pathp,
+					       dad, &fpsize, dryrun);
+	else
+		np = unflatten_dt_full_node(blob, &mem, *poffset, pathp, l + 1,
+					    dad, &fpsize, dryrun);
+
 	old_depth = depth;
 	*poffset = fdt_next_node(blob, *poffset, &depth);
 	if (depth < 0)
@@ -261,7 +394,7 @@ static void *unflatten_dt_node(const void *blob, void *mem, int *poffset,
 static int unflatten_device_tree(const void *blob,
 				 struct device_node **mynodes)
 {
-	unsigned long size;
+	unsigned long size, blob_size;
 	int start;
 	void *mem;
 
@@ -290,14 +423,29 @@ static int unflatten_device_tree(const void *blob,
 		return -EFAULT;
 	size = ALIGN(size, 4);
 
-	debug("  size is %lx, allocating...\n", size);
+	/*
+	 * A compact tree reads properties from the flat tree for as long as it
+	 * exists, so keep a copy of it after the nodes, in case the original is
+	 * moved or changed
+	 */
+	blob_size = 0;
+	if (IS_ENABLED(CONFIG_OF_LIVE_COMPACT))
+		blob_size = fdt_totalsize(blob);
+
+	debug("  size is %lx, allocating...\n", size + blob_size);
 
 	/* Allocate memory for the expanded device tree */
-	mem = malloc(size + 4);
+	mem = malloc(size + 4 + blob_size);
+	if (!mem)
+		return -ENOMEM;
 	memset(mem, '\0', size);
 
 	*(__be32 *)(mem + size) = cpu_to_be32(0xdeadbeef);
 
+	if (blob_size)
+		blob = memcpy(mem + size + 4, blob, blob_size);
+	of_live_blob = blob;
+
 	debug("  unflattening %p...\n", mem);
 
 	/* Second pass, do actual unflattening */
@@ -314,6 +462,65 @@ static int unflatten_device_tree(const void *blob,
 	return 0;
 }
 
+const void *of_live_get_prop(const struct device_node *np, const char *name,
+			     int *lenp)
+{
+	const void *val;
+
+	val = fdt_getprop(of_live_blob, np->offset, name, lenp);
+	if (!val && !strcmp(name, "name")) {
+		if (lenp)
+			*lenp = strlen(np->name) + 1;
+		return np->name;
+	}
+
+	return val;
+}
+
+int of_live_load_props(struct device_node *np)
+{
+	struct property *pp, **prev_pp;
+	const char *pname;
+	bool has_name = false;
+	int offset, count;
+
+	if (np->offset < 0)
+		return 0;
+
+	/* allow for a "name" property to be recreated from the unit name */
+	count = 1;
+	fdt_for_each_property_offset(offset, of_live_blob, np->offset)
+		count++;
+	pp = calloc(count, sizeof(*pp));
+	if (!pp)
+		return -ENOMEM;
+
+	prev_pp = &np->properties;
+	fdt_for_each_property_offset(offset, of_live_blob, np->offset) {
+		pp->value = (void *)fdt_getprop_by_offset(of_live_blob, offset,
+							  &pname, &pp->length);
+		if (!pp->value)
+			break;
+		pp->name = (char *)pname;
+		if (!strcmp(pname, "name"))
+			has_name = true;
+		*prev_pp = pp;
+		prev_pp = &pp->next;
+		pp++;
+	}
+	if (!has_name) {
+		pp->name = "name";
+		pp->length = strlen(np->name) + 1;
+		pp->value = (void *)np->name;
+		*prev_pp = pp;
+	}
+	np->offset = -1;
+	debug("%s: materialised %d properties for %s\n", __func__, count,
+	      of_node_full_name(np));
+
+	return 0;
+}
+
 int of_live_build(const void *fdt_blob, struct device_node **rootp)
 {
 	int ret;
@@ -15,6 +15,40 @@ DECLARE_GLOBAL_DATA_PTR;
 static char trace_enabled __attribute__((section(".data")));
 static char trace_inited __attribute__((section(".data")));
 
+#if defined(CONFIG_TRACE_FORMAT_COMPACT)
+#define TRACE_DEFAULT_MODE	TRACE_MODE_COMPACT
+#elif defined(CONFIG_TRACE_FORMAT_AGGREGATE)
+#define TRACE_DEFAULT_MODE	TRACE_MODE_AGGREGATE
+#else
+#define TRACE_DEFAULT_MODE	TRACE_MODE_CALLS
+#endif
+
+enum {
+	/* Call depth up to which aggregated times are tracked */
+	TRACE_AGG_DEPTH		= 64,
+};
+
+static const char *const trace_mode_name[TRACE_MODE_COUNT] = {
+	"calls",
+	"compact",
+	"aggregate",
+};
+
+/* Aggregated information about a function, in TRACE_MODE_AGGREGATE */
+struct trace_agg {
+	u32 func;		/* Function number + 1, or 0 if entry unused */
+	u32 call_count;		/* Number of calls which have returned */
+	u64 incl_us;		/* Time spent in function and its callees */
+	u64 excl_us;		/* Time spent in the function itself */
+};
+
+/* A function which has been entered, but has not returned yet */
+struct trace_agg_frame {
+	u32 func;		/* Function number */
+	ulong start;		/* Time of entry in microseconds */
+	ulong child_us;		/* Time spent in functions it called */
+};
+
 /* The header block at the start of the trace memory area */
 struct trace_hdr {
 	int func_count;		/* Total number of function call sites */
@@ -28,12 +62,33 @@ struct trace_hdr {
 	 */
 	uintptr_t *call_accum;
 
-	/* Function trace list */
+	enum trace_mode mode;	/* How calls are recorded */
+	ulong area_size;	/* Bytes available for recording calls */
+
+	/*
+	 * Function trace list. The area starting at @ftrace holds either
+	 * struct trace_call records, compact records or, when aggregating,
+	 * struct trace_agg entries, depending on @mode
+	 */
 	struct trace_call *ftrace;	/* The function call records */
 	ulong ftrace_size;	/* Num. of ftrace records we have space for */
 	ulong ftrace_count;	/* Num. of ftrace records written */
 	ulong ftrace_too_deep_count;	/* Functions that were too deep */
 
+	/* Compact records, in TRACE_MODE_COMPACT */
+	ulong compact_used;	/* Number of bytes written */
+	ulong compact_count;	/* Number of records written */
+	ulong prev_time;	/* Time of previous record */
+	u32 prev_func;		/* Function number of previous record */
+	u32 prev_caller;	/* Caller number of previous record */
+
+	/* Hash table of functions, in TRACE_MODE_AGGREGATE */
+	ulong agg_size;		/* Number of entries (a power of two) */
+	ulong agg_used;		/* Number of entries in use */
+	ulong agg_dropped;	/* Calls not recorded (too deep / full) */
+	int agg_depth;		/* Number of entries in @agg_stack */
+	struct trace_agg_frame agg_stack[TRACE_AGG_DEPTH];
+
 	int depth;
 	int depth_limit;
 	int max_depth;
@@ -100,6 +155,53 @@ static void __attribute__((no_instrument_function)) trace_swap_gd(void)
 
 #endif
 
+static u8 __attribute__((no_instrument_function)) *put_uleb128(u8 *ptr,
+								u64 val)
+{
+	while (val >= 0x80) {
+		*ptr++ = val | 0x80;
+		val >>= 7;
+	}
+	*ptr++ = val;
+
+	return ptr;
+}
+
+static u32 __attribute__((no_instrument_function)) zigzag(u32 val)
+{
+	return (val << 1) ^ -(val >> 31);
+}
+
+/**
+ * add_compact() - add a compact call record
+ *
+ * Each value is stored as a delta from the previous record, so most records
+ * take only a few bytes.
+ *
+ * @func:	function number
+ * @caller:	caller number
+ * @flags:	FUNCF_ENTRY or FUNCF_EXIT
+ */
+static void __attribute__((no_instrument_function)) add_compact(u32 func,
+				u32 caller, ulong flags)
+{
+	u8 *base = (u8 *)hdr->ftrace;
+	u8 *ptr = base + hdr->compact_used;
+	ulong now;
+
+	if (hdr->compact_used + TRACE_COMPACT_MAX > hdr->area_size)
+		return;
+	now = timer_get_us();
+	ptr = put_uleb128(ptr, (u64)(now - hdr->prev_time) << 2 | flags >> 30);
+	ptr = put_uleb128(ptr, zigzag(func - hdr->prev_func));
+	ptr = put_uleb128(ptr, zigzag(caller - hdr->prev_caller));
+	hdr->prev_time = now;
+	hdr->prev_func = func;
+	hdr->prev_caller = caller;
+	hdr->compact_used = ptr - base;
+	hdr->compact_count++;
+}
+
 static void __attribute__((no_instrument_function)) add_ftrace(void *func_ptr,
 				void *caller, ulong flags)
 {
@@ -107,7 +209,10 @@ static void __attribute__((no_instrument_function)) add_ftrace(void *func_ptr,
 		hdr->ftrace_too_deep_count++;
 		return;
 	}
-	if (hdr->ftrace_count < hdr->ftrace_size) {
+	if (hdr->mode == TRACE_MODE_COMPACT) {
+		add_compact(func_ptr_to_num(func_ptr), func_ptr_to_num(caller),
+			    flags);
+	} else if (hdr->ftrace_count < hdr->ftrace_size) {
 		struct trace_call *rec = &hdr->ftrace[hdr->ftrace_count];
 
 		rec->func = func_ptr_to_num(func_ptr);
@@ -119,7 +224,19 @@ static void __attribute__((no_instrument_function)) add_ftrace(void *func_ptr,
 
 static void __attribute__((no_instrument_function)) add_textbase(void)
 {
-	if (hdr->ftrace_count < hdr->ftrace_size) {
+	if (hdr->mode == TRACE_MODE_AGGREGATE)
+		return;
+	if (hdr->mode == TRACE_MODE_COMPACT) {
+		u8 *base = (u8 *)hdr->ftrace;
+		u8 *ptr = base + hdr->compact_used;
+
+		if (hdr->compact_used + TRACE_COMPACT_MAX <= hdr->area_size) {
+			ptr = put_uleb128(ptr, FUNCF_TEXTBASE >> 30);
+			ptr = put_uleb128(ptr, CONFIG_SYS_TEXT_BASE);
+			hdr->compact_used = ptr - base;
+			hdr->compact_count++;
+		}
+	} else if (hdr->ftrace_count < hdr->ftrace_size) {
 		struct trace_call *rec = &hdr->ftrace[hdr->ftrace_count];
 
 		rec->func = CONFIG_SYS_TEXT_BASE;
@@ -129,6 +246,131 @@ static void __attribute__((no_instrument_function)) add_textbase(void)
 	hdr->ftrace_count++;
 }
 
+/**
+ * agg_find() - find or add the hash-table entry for a function
+ *
+ * @func:	function number
+ * Return:	entry, or NULL if the table is full
+ */
+static struct trace_agg __attribute__((no_instrument_function)) *agg_find(
+				u32 func)
+{
+	struct trace_agg *agg = (struct trace_agg *)hdr->ftrace;
+	ulong mask = hdr->agg_size - 1;
+	ulong i;
+
+	for (i = (func * 2654435761U) & mask;; i = (i + 1) & mask) {
+		if (agg[i].func == func + 1)
+			return &agg[i];
+		if (!agg[i].func)
+			break;
+	}
+	/* Keep some space free so that lookups stay fast */
+	if (hdr->agg_used >= hdr->agg_size / 4 * 3)
+		return NULL;
+	agg[i].func = func + 1;
+	hdr->agg_used++;
+
+	return &agg[i];
+}
+
+static void __attribute__((no_instrument_function)) agg_enter(u32 func)
+{
+	if (hdr->agg_depth < TRACE_AGG_DEPTH) {
+		struct trace_agg_frame *frame = &hdr->agg_stack[hdr->agg_depth];
+
+		frame->func = func;
+		frame->child_us = 0;
+		frame->start = timer_get_us();
+	}
+	hdr->agg_depth++;
+}
+
+static void __attribute__((no_instrument_function)) agg_exit(void)
+{
+	struct trace_agg_frame *frame;
+	struct trace_agg *agg;
+	ulong elapsed;
+
+	/* Ignore functions which were entered before we started */
+	if (!hdr->agg_depth)
+		return;
+	if (--hdr->agg_depth >= TRACE_AGG_DEPTH) {
+		hdr->agg_dropped++;
+		return;
+	}
+	frame = &hdr->agg_stack[hdr->agg_depth];
+	elapsed = timer_get_us() - frame->start;
+	agg = agg_find(frame->func);
+	if (agg) {
+		agg->call_count++;
+		agg->incl_us += elapsed;
+		agg->excl_us += elapsed - min(elapsed, frame->child_us);
+	} else {
+		hdr->agg_dropped++;
+	}
+	if (hdr->agg_depth)
+		frame[-1].child_us += elapsed;
+}
+
+/**
+ * setup_records() - set up the area used to record function calls
+ *
+ * @base:	start of area
+ * @size:	size of area in bytes
+ * @fresh:	true to discard any records, false to keep them (used when
+ *		early trace data has been copied into a new buffer)
+ * Return:	0 if ok, -ENOSPC if the area is too small
+ */
+static int __attribute__((no_instrument_function)) setup_records(void *base,
+				size_t size, bool fresh)
+{
+	hdr->ftrace = base;
+	hdr->ftrace_size = size / sizeof(*hdr->ftrace);
+	hdr->area_size = size;
+	if (fresh) {
+		hdr->ftrace_count = 0;
+		hdr->ftrace_too_deep_count = 0;
+		hdr->compact_used = 0;
+		hdr->compact_count = 0;
+		hdr->prev_time = 0;
+		hdr->prev_func = 0;
+		hdr->prev_caller = 0;
+		hdr->agg_size = 0;
+		hdr->agg_used = 0;
+		hdr->agg_dropped = 0;
+		hdr->agg_depth = 0;
+	}
+
+	/* The table cannot be resized without losing its contents */
+	if (hdr->mode == TRACE_MODE_AGGREGATE && !hdr->agg_size) {
+		ulong entries = 1;
+
+		if (size < sizeof(struct trace_agg))
+			return -ENOSPC;
+		while (entries * 2 * sizeof(struct trace_agg) <= size)
+			entries *= 2;
+		memset(base, '\0', entries * sizeof(struct trace_agg));
+		hdr->agg_size = entries;
+	}
+	add_textbase();
+
+	return 0;
+}
+
+/* Get the end of the data used in the call-record area */
+static void __attribute__((no_instrument_function)) *records_end(void)
+{
+	switch (hdr->mode) {
+	case TRACE_MODE_COMPACT:
+		return (char *)hdr->ftrace + hdr->compact_used;
+	case TRACE_MODE_AGGREGATE:
+		return (struct trace_agg *)hdr->ftrace + hdr->agg_size;
+	default:
+		return &hdr->ftrace[min(hdr->ftrace_count, hdr->ftrace_size)];
+	}
+}
+
 /**
  * __cyg_profile_func_enter() - record function entry
  *
@@ -145,8 +387,11 @@ void __attribute__((no_instrument_function)) __cyg_profile_func_enter(
 		int func;
 
 		trace_swap_gd();
-		add_ftrace(func_ptr, caller, FUNCF_ENTRY);
 		func = func_ptr_to_num(func_ptr);
+		if (hdr->mode == TRACE_MODE_AGGREGATE)
+			agg_enter(func);
+		else
+			add_ftrace(func_ptr, caller, FUNCF_ENTRY);
 		if (func < hdr->func_count) {
 			hdr->call_accum[func]++;
 			hdr->call_count++;
@@ -171,7 +416,10 @@ void __attribute__((no_instrument_function)) __cyg_profile_func_exit(
 {
 	if (trace_enabled) {
 		trace_swap_gd();
-		add_ftrace(func_ptr, caller, FUNCF_EXIT);
+		if (hdr->mode == TRACE_MODE_AGGREGATE)
+			agg_exit();
+		else
+			add_ftrace(func_ptr, caller, FUNCF_EXIT);
 		hdr->depth--;
 		trace_swap_gd();
 	}
@@ -234,11 +482,57 @@ int trace_list_functions(void *buff, size_t buff_size, size_t *needed)
 	return 0;
 }
 
+/* Write the call records as a TRACE_CHUNK_CALLS chunk */
+static void *list_calls(void *ptr, void *end, size_t *upto)
+{
+	size_t rec, count;
+
+	count = min(hdr->ftrace_count, hdr->ftrace_size);
+	for (rec = 0; rec < count; rec++) {
+		if (ptr + sizeof(struct trace_call) < end) {
+			struct trace_call *call = &hdr->ftrace[rec];
+			struct trace_call *out = ptr;
+
+			out->func = call->func * FUNC_SITE_SIZE;
+			out->caller = call->caller * FUNC_SITE_SIZE;
+			out->flags = call->flags;
+			(*upto)++;
+		}
+		ptr += sizeof(struct trace_call);
+	}
+
+	return ptr;
+}
+
+/* Write the aggregated functions as a TRACE_CHUNK_AGGREGATE chunk */
+static void *list_aggregate(void *ptr, void *end, size_t *upto)
+{
+	struct trace_agg *agg = (struct trace_agg *)hdr->ftrace;
+	size_t i;
+
+	for (i = 0; i < hdr->agg_size; i++) {
+		if (!agg[i].func)
+			continue;
+		if (ptr + sizeof(struct trace_output_agg) < end) {
+			struct trace_output_agg *out = ptr;
+
+			out->offset = (agg[i].func - 1) * FUNC_SITE_SIZE;
+			out->call_count = agg[i].call_count;
+			out->incl_us = agg[i].incl_us;
+			out->excl_us = agg[i].excl_us;
+			(*upto)++;
+		}
+		ptr += sizeof(struct trace_output_agg);
+	}
+
+	return ptr;
+}
+
 /**
- * trace_list_functions() - produce a list of function calls
+ * trace_list_calls() - produce a list of function calls
  *
  * The information is written into the supplied buffer - a header followed
- * by a list of function records.
+ * by the records in the format used by the current trace mode.
  *
  * @buff:	buffer to place list into
  * @buff_size:	size of buffer
@@ -249,9 +543,9 @@ int trace_list_functions(void *buff, size_t buff_size, size_t *needed)
 int trace_list_calls(void *buff, size_t buff_size, size_t *needed)
 {
 	struct trace_output_hdr *output_hdr = NULL;
+	enum trace_chunk_type type;
 	void *end, *ptr = buff;
-	size_t rec, upto;
-	size_t count;
+	size_t upto = 0;
 
 	end = buff ? buff + buff_size : NULL;
 
@@ -261,26 +555,29 @@ int trace_list_calls(void *buff, size_t buff_size, size_t *needed)
 	ptr += sizeof(struct trace_output_hdr);
 
 	/* Add information about each call */
-	count = hdr->ftrace_count;
-	if (count > hdr->ftrace_size)
-		count = hdr->ftrace_size;
-	for (rec = upto = 0; rec < count; rec++) {
-		if (ptr + sizeof(struct trace_call) < end) {
-			struct trace_call *call = &hdr->ftrace[rec];
-			struct trace_call *out = ptr;
-
-			out->func = call->func * FUNC_SITE_SIZE;
-			out->caller = call->caller * FUNC_SITE_SIZE;
-			out->flags = call->flags;
-			upto++;
+	switch (hdr->mode) {
+	case TRACE_MODE_COMPACT:
+		type = TRACE_CHUNK_COMPACT;
+		if (ptr + hdr->compact_used < end) {
+			memcpy(ptr, hdr->ftrace, hdr->compact_used);
+			upto = hdr->compact_used;
 		}
-		ptr += sizeof(struct trace_call);
+		ptr += hdr->compact_used;
+		break;
+	case TRACE_MODE_AGGREGATE:
+		type = TRACE_CHUNK_AGGREGATE;
+		ptr = list_aggregate(ptr, end, &upto);
+		break;
+	default:
+		type = TRACE_CHUNK_CALLS;
+		ptr = list_calls(ptr, end, &upto);
+		break;
 	}
 
 	/* Update the header */
 	if (output_hdr) {
 		output_hdr->rec_count = upto;
-		output_hdr->type = TRACE_CHUNK_CALLS;
+		output_hdr->type = type;
 	}
 
 	/* Work out how must of the buffer we used */
@@ -312,14 +609,36 @@ void trace_print_stats(void)
 	puts(" function calls\n");
 	print_grouped_ull(hdr->untracked_count, 10);
 	puts(" untracked function calls\n");
-	count = min(hdr->ftrace_count, hdr->ftrace_size);
-	print_grouped_ull(count, 10);
-	puts(" traced function calls");
-	if (hdr->ftrace_count > hdr->ftrace_size) {
-		printf(" (%lu dropped due to overflow)",
-		       hdr->ftrace_count - hdr->ftrace_size);
+	printf("%15s trace mode\n", trace_mode_name[hdr->mode]);
+	switch (hdr->mode) {
+	case TRACE_MODE_COMPACT:
+		print_grouped_ull(hdr->compact_count, 10);
+		printf(" traced function calls in %lu bytes",
+		       hdr->compact_used);
+		if (hdr->ftrace_count > hdr->compact_count) {
+			printf(" (%lu dropped due to overflow)",
+			       hdr->ftrace_count - hdr->compact_count);
+		}
+		puts("\n");
+		break;
+	case TRACE_MODE_AGGREGATE:
+		print_grouped_ull(hdr->agg_used, 10);
+		printf(" functions aggregated (table size %lu)\n",
+		       hdr->agg_size);
+		print_grouped_ull(hdr->agg_dropped, 10);
+		puts(" calls not aggregated due to depth or table size\n");
+		break;
+	default:
+		count = min(hdr->ftrace_count, hdr->ftrace_size);
+		print_grouped_ull(count, 10);
+		puts(" traced function calls");
+		if (hdr->ftrace_count > hdr->ftrace_size) {
+			printf(" (%lu dropped due to overflow)",
+			       hdr->ftrace_count - hdr->ftrace_size);
+		}
+		puts("\n");
+		break;
 	}
-	puts("\n");
 	printf("%15d maximum observed call depth\n", hdr->max_depth);
 	printf("%15d call depth limit\n", hdr->depth_limit);
 	print_grouped_ull(hdr->ftrace_too_deep_count, 10);
@@ -331,6 +650,40 @@ void __attribute__((no_instrument_function)) trace_set_enabled(int enabled)
 	trace_enabled = enabled != 0;
 }
 
+const char *trace_get_mode_name(enum trace_mode mode)
+{
+	if (mode < 0 || mode >= TRACE_MODE_COUNT)
+		return NULL;
+
+	return trace_mode_name[mode];
+}
+
+int trace_get_mode(void)
+{
+	if (!trace_inited)
+		return -ENOENT;
+
+	return hdr->mode;
+}
+
+int __attribute__((no_instrument_function)) trace_set_mode(
+		enum trace_mode mode)
+{
+	int was_enabled = trace_enabled;
+	int ret;
+
+	if (!trace_inited)
+		return -ENOENT;
+	if (mode < 0 || mode >= TRACE_MODE_COUNT)
+		return -EINVAL;
+	trace_enabled = 0;
+	hdr->mode = mode;
+	ret = setup_records(hdr->ftrace, hdr->area_size, true);
+	trace_enabled = was_enabled && !ret;
+
+	return ret;
+}
+
 /**
  * trace_init() - initialize the tracing system and enable it
  *
@@ -359,8 +712,7 @@ int __attribute__((no_instrument_function)) trace_init(void *buff,
 		trace_enabled = 0;
 		hdr = map_sysmem(CONFIG_TRACE_EARLY_ADDR,
 				 CONFIG_TRACE_EARLY_SIZE);
-		end = (char *)&hdr->ftrace[min(hdr->ftrace_count,
-					       hdr->ftrace_size)];
+		end = records_end();
 		used = end - (char *)hdr;
 		printf("trace: copying %08lx bytes of early data from %x to %08lx\n",
 		       used, CONFIG_TRACE_EARLY_ADDR,
@@ -379,15 +731,18 @@ int __attribute__((no_instrument_function)) trace_init(void *buff,
 		return -ENOSPC;
 	}
 
-	if (was_disabled)
+	if (was_disabled) {
 		memset(hdr, '\0', needed);
+		hdr->mode = TRACE_DEFAULT_MODE;
+	}
 	hdr->func_count = func_count;
 	hdr->call_accum = (uintptr_t *)(hdr + 1);
 
 	/* Use any remaining space for the timed function trace */
-	hdr->ftrace = (struct trace_call *)(buff + needed);
-	hdr->ftrace_size = (buff_size - needed) / sizeof(*hdr->ftrace);
-	add_textbase();
+	if (setup_records(buff + needed, buff_size - needed, was_disabled)) {
+		puts("trace: no space for call records\n");
+		return -ENOSPC;
+	}
 
 	puts("trace: enabled\n");
 	hdr->depth_limit = CONFIG_TRACE_CALL_DEPTH_LIMIT;
@@ -424,11 +779,13 @@ int __attribute__((no_instrument_function)) trace_early_init(void)
 	memset(hdr, '\0', needed);
 	hdr->call_accum = (uintptr_t *)(hdr + 1);
 	hdr->func_count = func_count;
+	hdr->mode = TRACE_DEFAULT_MODE;
 
 	/* Use any remaining space for the timed function trace */
-	hdr->ftrace = (struct trace_call *)((char *)hdr + needed);
-	hdr->ftrace_size = (buff_size - needed) / sizeof(*hdr->ftrace);
-	add_textbase();
+	if (setup_records((char *)hdr + needed, buff_size - needed, true)) {
+		puts("trace: no space for call records\n");
+		return -ENOSPC;
+	}
 	hdr->depth_limit = CONFIG_TRACE_EARLY_CALL_DEPTH_LIMIT;
 	printf("trace: early enable at %08x\n", CONFIG_TRACE_EARLY_ADDR);
 
@@ -213,6 +213,10 @@ static void fastboot_send(struct fastboot_header header, char *fastboot_data,
 	net_send_udp_packet(net_server_ethaddr, fastboot_remote_ip,
 			    fastboot_remote_port, fastboot_our_port, len);
 
+	/* Write any image data while the host sends the next packet */
+	if (cmd == FASTBOOT_COMMAND_DOWNLOAD)
+		fastboot_data_flush();
+
 	/* Continue boot process after sending response */
 	if (!strncmp("OKAY", response, 4)) {
 		switch (cmd) {
@@ -133,6 +133,7 @@
  * the whole RAM.
  */
 
+#include <memtest.h>
 #include <post.h>
 #include <watchdog.h>
 
@@ -267,38 +268,33 @@ static int memory_post_addrline(ulong *testaddr, ulong *base, ulong size)
 	return ret;
 }
 
-static int memory_post_test1(unsigned long start,
-			      unsigned long size,
-			      unsigned long val)
+/* Fill memory with val + n * incr in word n, then check it */
+static int memory_post_test_seq(unsigned long start, unsigned long size,
+				unsigned long val, unsigned long incr)
 {
-	unsigned long i;
-	ulong *mem = (ulong *) start;
-	ulong readback;
+	struct memtest mt;
 	int ret = 0;
 
-	for (i = 0; i < size / sizeof (ulong); i++) {
-		mem[i] = val;
-		if (i % 1024 == 0)
-			WATCHDOG_RESET();
-	}
-
-	for (i = 0; i < size / sizeof (ulong) && !ret; i++) {
-		readback = mem[i];
-		if (readback != val) {
-			post_log("Memory error at %08x, "
-				  "wrote %08x, read %08x !\n",
-					  mem + i, val, readback);
-
-			ret = -1;
-			break;
-		}
-		if (i % 1024 == 0)
-			WATCHDOG_RESET();
+	memtest_init(&mt, start, size, false);
+	memtest_fill(&mt, val, incr);
+	memtest_check(&mt, val, incr, MEMTEST_KEEP);
+	if (mt.errs) {
+		post_log("Memory error at %08lx, wrote %08lx, read %08lx !\n",
+			 mt.err[0].addr, mt.err[0].expected, mt.err[0].actual);
+		ret = -1;
 	}
+	memtest_uninit(&mt);
 
 	return ret;
 }
 
+static int memory_post_test1(unsigned long start,
+			      unsigned long size,
+			      unsigned long val)
+{
+	return memory_post_test_seq(start, size, val, 0);
+}
+
 static int memory_post_test2(unsigned long start, unsigned long size)
 {
 	unsigned long i;
@@ -331,62 +327,12 @@ static int memory_post_test2(unsigned long start, unsigned long size)
 
 static int memory_post_test3(unsigned long start, unsigned long size)
 {
-	unsigned long i;
-	ulong *mem = (ulong *) start;
-	ulong readback;
-	int ret = 0;
-
-	for (i = 0; i < size / sizeof (ulong); i++) {
-		mem[i] = i;
-		if (i % 1024 == 0)
-			WATCHDOG_RESET();
-	}
-
-	for (i = 0; i < size / sizeof (ulong) && !ret; i++) {
-		readback = mem[i];
-		if (readback != i) {
-			post_log("Memory error at %08x, "
-				  "wrote %08x, read %08x !\n",
-					  mem + i, i, readback);
-
-			ret = -1;
-			break;
-		}
-		if (i % 1024 == 0)
-			WATCHDOG_RESET();
-	}
-
-	return ret;
+	return memory_post_test_seq(start, size, 0, 1);
 }
 
 static int memory_post_test4(unsigned long start, unsigned long size)
 {
-	unsigned long i;
-	ulong *mem = (ulong *) start;
-	ulong readback;
-	int ret = 0;
-
-	for (i = 0; i < size / sizeof (ulong); i++) {
-		mem[i] = ~i;
-		if (i % 1024 == 0)
-			WATCHDOG_RESET();
-	}
-
-	for (i = 0; i < size / sizeof (ulong) && !ret; i++) {
-		readback = mem[i];
-		if (readback != ~i) {
-			post_log("Memory error at %08x, "
-				  "wrote %08x, read %08x !\n",
-					  mem + i, ~i, readback);
-
-			ret = -1;
-			break;
-		}
-		if (i % 1024 == 0)
-			WATCHDOG_RESET();
-	}
-
-	return ret;
+	return memory_post_test_seq(start, size, ~0UL, -1UL);
 }
 
 static int memory_post_test_lines(unsigned long start, unsigned long size)
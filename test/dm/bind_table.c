@@ -0,0 +1,236 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for the pre-resolved bind table
+ */
+
+#include <common.h>
+#include <dm.h>
+#include <fdtdec.h>
+#include <malloc.h>
+#include <sort.h>
+#include <time.h>
+#include <dm/device-internal.h>
+#include <dm/root.h>
+#include <dm/test.h>
+#include <dm/util.h>
+#include <linux/libfdt.h>
+#include <test/ut.h>
+#include <u-boot/crc.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+/* Maximum number of devices bound from the test device tree */
+#define MAX_BOUND	500
+
+/**
+ * struct bound_dev - Record of a device bound from the device tree
+ *
+ * @offset: Offset of the device's node
+ * @parent: Offset of the parent device's node
+ * @drv: Driver which was bound
+ */
+struct bound_dev {
+	int offset;
+	int parent;
+	const struct driver *drv;
+};
+
+static int bound_dev_cmp(const void *a, const void *b)
+{
+	const struct bound_dev *da = a, *db = b;
+
+	return da->offset - db->offset;
+}
+
+static int bind_node_cmp(const void *a, const void *b)
+{
+	const struct dm_bind_node *na = a, *nb = b;
+
+	if (na->parent != nb->parent)
+		return na->parent - nb->parent;
+
+	return na->offset - nb->offset;
+}
+
+/* Record all devices below @parent which are bound to a device tree node */
+static int get_bound(struct udevice *parent, struct bound_dev *list, int upto)
+{
+	struct udevice *dev;
+
+	device_foreach_child(dev, parent) {
+		if (dev_of_valid(dev) && upto < MAX_BOUND) {
+			list[upto].offset = dev_of_offset(dev);
+			list[upto].parent = dev_of_offset(dev->parent);
+			list[upto].drv = dev->driver;
+			upto++;
+		}
+		upto = get_bound(dev, list, upto);
+	}
+
+	return upto;
+}
+
+/* Work out which driver binds to a node, as dtoc does */
+static void resolve_bind(const void *blob, struct dm_bind_node *bind)
+{
+	struct driver *drv = ll_entry_start(struct driver, driver);
+	const int n_ents = ll_entry_count(struct driver, driver);
+	const struct udevice_id *id;
+	const char *compat;
+	struct driver *entry;
+	int i, count;
+
+	count = fdt_stringlist_count(blob, bind->offset, "compatible");
+	for (i = 0; i < count; i++) {
+		compat = fdt_stringlist_get(blob, bind->offset, "compatible", i,
+					    NULL);
+		for (entry = drv; entry != drv + n_ents; entry++) {
+			for (id = entry->of_match; id && id->compatible; id++) {
+				if (!strcmp(id->compatible, compat)) {
+					bind->drv_name = entry->name;
+					bind->compat = id->compatible;
+					return;
+				}
+			}
+		}
+	}
+}
+
+/* Add bindings for the subnodes of a node, as dm_scan_fdt_node() scans them */
+static int add_bindings(const void *blob, int parent, int offset,
+			struct dm_bind_node *nodes, int upto)
+{
+	int node;
+
+	fdt_for_each_subnode(node, blob, offset) {
+		const char *name = fdt_get_name(blob, node, NULL);
+
+		if (!strcmp(name, "chosen") || !strcmp(name, "firmware")) {
+			upto = add_bindings(blob, parent, node, nodes, upto);
+			continue;
+		}
+		if (!fdtdec_get_is_enabled(blob, node) ||
+		    !fdt_getprop(blob, node, "compatible", NULL))
+			continue;
+		nodes[upto].offset = node;
+		nodes[upto].parent = parent;
+		nodes[upto].pre_reloc = dm_ofnode_pre_reloc(
+					offset_to_ofnode(node));
+		resolve_bind(blob, &nodes[upto]);
+		upto++;
+	}
+
+	return upto;
+}
+
+/**
+ * bind_all() - Bind all devices again, optionally using a bind table
+ *
+ * @uts: Test state
+ * @table: Table to bind with, or NULL to scan the device tree
+ * @list: Returns the devices bound, sorted by node offset
+ * @countp: Returns the number of devices in @list
+ * @usp: Returns the time taken to bind them, in microseconds
+ * @return 0 if OK, -ve on error
+ */
+static int bind_all(struct unit_test_state *uts,
+		    const struct dm_bind_table *table, struct bound_dev *list,
+		    int *countp, ulong *usp)
+{
+	const void *blob = gd->fdt_blob;
+	ulong start;
+	int count;
+
+	ut_assertok(dm_uninit());
+	ut_assertok(dm_init(false));
+	gd->dm_bind_table = NULL;
+	if (table)
+		ut_assertok(dm_bind_table_set(blob, table));
+	start = timer_get_us();
+	ut_assertok(dm_extended_scan_fdt(blob, false));
+	*usp = timer_get_us() - start;
+	count = get_bound(gd->dm_root, list, 0);
+	ut_assert(count > 0 && count < MAX_BOUND);
+	qsort(list, count, sizeof(*list), bound_dev_cmp);
+	*countp = count;
+
+	return 0;
+}
+
+/* Check that binding with @table gives the same devices as scanning */
+static int check_table(struct unit_test_state *uts,
+		       const struct dm_bind_table *table)
+{
+	struct bound_dev *scanned, *from_table;
+	ulong scan_us, table_us;
+	int count, table_count;
+	int i;
+
+	scanned = calloc(MAX_BOUND, sizeof(*scanned));
+	ut_assertnonnull(scanned);
+	from_table = calloc(MAX_BOUND, sizeof(*from_table));
+	ut_assertnonnull(from_table);
+
+	ut_assertok(bind_all(uts, NULL, scanned, &count, &scan_us));
+	ut_assertok(bind_all(uts, table, from_table, &table_count, &table_us));
+	ut_asserteq(count, table_count);
+	for (i = 0; i < count; i++) {
+		ut_asserteq(scanned[i].offset, from_table[i].offset);
+		ut_asserteq(scanned[i].parent, from_table[i].parent);
+		ut_asserteq_ptr(scanned[i].drv, from_table[i].drv);
+	}
+	printf("Bound %d devices: scan %lu us, table %lu us\n", count, scan_us,
+	       table_us);
+
+	gd->dm_bind_table = NULL;
+	free(from_table);
+	free(scanned);
+
+	return 0;
+}
+
+/* Test that binding with a bind table gives the same devices as scanning */
+static int dm_test_bind_table(struct unit_test_state *uts)
+{
+	const void *blob = gd->fdt_blob;
+	struct dm_bind_node *nodes;
+	struct dm_bind_table table;
+	int count, node;
+
+	/* Build a table in the same way as dtoc does */
+	count = 0;
+	for (node = 0; node >= 0; node = fdt_next_node(blob, node, NULL))
+		count++;
+	nodes = calloc(count, sizeof(*nodes));
+	ut_assertnonnull(nodes);
+	count = 0;
+	for (node = 0; node >= 0; node = fdt_next_node(blob, node, NULL))
+		count = add_bindings(blob, node, node, nodes, count);
+	qsort(nodes, count, sizeof(*nodes), bind_node_cmp);
+	table.nodes = nodes;
+	table.count = count;
+	table.fdt_size = fdt_totalsize(blob);
+	table.fdt_crc32 = crc32(0, blob, table.fdt_size) + 1;
+	ut_asserteq(-EINVAL, dm_bind_table_set(blob, &table));
+	table.fdt_crc32--;
+
+	ut_assertok(check_table(uts, &table));
+	free(nodes);
+
+	return 0;
+}
+DM_TEST(dm_test_bind_table, DM_TESTF_FLAT_TREE);
+
+/*
+ * Test the table generated by dtoc. With CONFIG_OF_BIND_TABLE_DTB="test" this
+ * matches the test device tree, so dm_init() selects it.
+ */
+static int dm_test_bind_table_dtoc(struct unit_test_state *uts)
+{
+	ut_assertok(dm_uninit());
+	ut_assertok(dm_init(false));
+	ut_asserteq_ptr(&dm_bind_table, gd->dm_bind_table);
+
+	return check_table(uts, &dm_bind_table);
+}
+DM_TEST(dm_test_bind_table_dtoc, DM_TESTF_FLAT_TREE);
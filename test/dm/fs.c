@@ -0,0 +1,164 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for open files kept by the filesystem layer
+ */
+
+#include <common.h>
+#include <blk.h>
+#include <dm.h>
+#include <fat.h>
+#include <fs.h>
+#include <malloc.h>
+#include <mapmem.h>
+#include <os.h>
+#include <part.h>
+#include <sandboxblockdev.h>
+#include <dm/test.h>
+#include <test/ut.h>
+
+#define SECT_SIZE	512
+#define IMG_SECTS	128
+#define FAT_SECT	1
+#define ROOT_SECT	2
+#define DATA_SECT	3	/* sector holding cluster 2 */
+
+static const char fname0[] = "fs_test0.img";
+static const char fname1[] = "fs_test1.img";
+
+/* Set up the root-directory entry for A.TXT */
+static void set_dirent(void *sect, int clust, int size)
+{
+	dir_entry *dent = sect;
+
+	memset(sect, '\0', SECT_SIZE);
+	memcpy(dent->name, "A       ", 8);
+	memcpy(dent->ext, "TXT", 3);
+	dent->attr = ATTR_ARCH;
+	dent->start = cpu_to_le16(clust);
+	dent->size = cpu_to_le32(size);
+}
+
+/*
+ * Write a tiny FAT16 image with A.TXT in cluster 2 holding @text. Cluster 3
+ * holds "second" and is not referenced by any file.
+ */
+static int make_image(struct unit_test_state *uts, const char *fname,
+		      const char *text)
+{
+	struct boot_sector *bs;
+	struct volume_info *vi;
+	u16 *fat;
+	char *buf;
+	int fd;
+
+	buf = calloc(IMG_SECTS, SECT_SIZE);
+	ut_assertnonnull(buf);
+
+	bs = (struct boot_sector *)buf;
+	memcpy(bs->system_id, "U-BOOT  ", 8);
+	bs->sector_size[0] = SECT_SIZE & 0xff;
+	bs->sector_size[1] = SECT_SIZE >> 8;
+	bs->cluster_size = 1;
+	bs->reserved = cpu_to_le16(FAT_SECT);
+	bs->fats = 1;
+	bs->dir_entries[0] = SECT_SIZE / sizeof(dir_entry);
+	bs->sectors[0] = IMG_SECTS;
+	bs->media = 0xf8;
+	bs->fat_length = cpu_to_le16(1);
+	vi = (struct volume_info *)(buf + offsetof(struct boot_sector,
+						   fat32_length));
+	vi->ext_boot_sign = 0x29;
+	memcpy(vi->volume_label, "NO NAME    ", 11);
+	memcpy(vi->fs_type, FAT16_SIGN, SIGNLEN);
+	buf[0x1fe] = 0x55;
+	buf[0x1ff] = 0xaa;
+
+	fat = (u16 *)(buf + FAT_SECT * SECT_SIZE);
+	fat[0] = cpu_to_le16(0xfff8);
+	fat[1] = cpu_to_le16(0xffff);
+	fat[2] = cpu_to_le16(0xffff);
+	fat[3] = cpu_to_le16(0xffff);
+
+	set_dirent(buf + ROOT_SECT * SECT_SIZE, 2, strlen(text));
+	strcpy(buf + DATA_SECT * SECT_SIZE, text);
+	strcpy(buf + (DATA_SECT + 1) * SECT_SIZE, "second");
+
+	fd = os_open(fname, OS_O_RDWR | OS_O_CREAT | OS_O_TRUNC);
+	ut_assert(fd >= 0);
+	ut_asserteq(IMG_SECTS * SECT_SIZE,
+		    os_write(fd, buf, IMG_SECTS * SECT_SIZE));
+	os_close(fd);
+	free(buf);
+
+	return 0;
+}
+
+/* Read the whole of an open file into @buf, which must be large enough */
+static int read_file(struct unit_test_state *uts, struct fs_file *file,
+		     char *buf)
+{
+	loff_t size, actread;
+
+	ut_assertok(fs_file_size(file, &size));
+	memset(buf, '\0', SECT_SIZE);
+	ut_assertok(fs_read_at(file, map_to_sysmem(buf), 0, size, &actread));
+	ut_asserteq(size, actread);
+
+	return 0;
+}
+
+/* Test that open files notice writes and removal of the block device */
+static int dm_test_fs_open_file(struct unit_test_state *uts)
+{
+	struct blk_desc *desc, *other;
+	disk_partition_t info;
+	struct fs_file *file;
+	char dirent[SECT_SIZE];
+	char buf[SECT_SIZE];
+	loff_t actread;
+
+	ut_assertok(make_image(uts, fname0, "first"));
+	ut_assertok(make_image(uts, fname1, "other"));
+	ut_assertok(host_dev_bind(0, (char *)fname0));
+	ut_assertok(host_dev_bind(1, (char *)fname1));
+	desc = blk_get_devnum_by_type(IF_TYPE_HOST, 0);
+	other = blk_get_devnum_by_type(IF_TYPE_HOST, 1);
+	ut_assertnonnull(desc);
+	ut_assertnonnull(other);
+
+	ut_assertok(fs_set_blk_dev("host", "0:0", FS_TYPE_FAT));
+	ut_assertok(fs_open("/a.txt", &file));
+	ut_assertok(read_file(uts, file, buf));
+	ut_asserteq_str("first", buf);
+
+	/* A partial read at an offset */
+	memset(buf, '\0', sizeof(buf));
+	ut_assertok(fs_read_at(file, map_to_sysmem(buf), 2, 2, &actread));
+	ut_asserteq(2, actread);
+	ut_asserteq_str("rs", buf);
+
+	/* Point the file at cluster 3 from underneath the filesystem */
+	set_dirent(dirent, 3, strlen("second"));
+	ut_asserteq(1, blk_dwrite(desc, ROOT_SECT, 1, dirent));
+	ut_assertok(read_file(uts, file, buf));
+	ut_asserteq_str("second", buf);
+
+	/* Use the driver directly on another device, as env_fat_save() does */
+	ut_assertok(part_get_info_whole_disk(other, &info));
+	ut_assertok(fat_set_blk_dev(other, &info));
+	ut_assertok(read_file(uts, file, buf));
+	ut_asserteq_str("second", buf);
+
+	/* Remove the device: the file can no longer be read */
+	ut_assertok(host_dev_bind(0, NULL));
+	ut_asserteq(-ENODEV, fs_read_at(file, map_to_sysmem(buf), 0, 0,
+					&actread));
+	fs_close_file(file);
+
+	ut_assertok(host_dev_bind(1, NULL));
+	os_unlink(fname0);
+	os_unlink(fname1);
+
+	return 0;
+}
+DM_TEST(dm_test_fs_open_file, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
@@ -2,6 +2,7 @@
 
 #include <common.h>
 #include <dm.h>
+#include <dm/of_access.h>
 #include <dm/of_extra.h>
 #include <dm/test.h>
 #include <test/ut.h>
@@ -113,3 +114,63 @@ static int dm_test_ofnode_read_chosen(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_ofnode_read_chosen, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+static int dm_test_ofnode_live_props(struct unit_test_state *uts)
+{
+	const struct device_node *np;
+	struct property *pp;
+	const u32 *val;
+	bool found;
+	int size;
+
+	np = ofnode_to_np(ofnode_path("/a-test"));
+	ut_assertnonnull(np);
+	ut_asserteq_str("a-test", of_node_unit_name(np));
+
+	/* Reading a value must not need the property list */
+	val = of_get_property(np, "int-value", &size);
+	ut_assertnonnull(val);
+	ut_asserteq(4, size);
+	ut_asserteq(1234, fdt32_to_cpu(val[0]));
+	ut_asserteq_str("a-test", of_get_property(np, "name", NULL));
+
+	/* The property list must agree with what was read above */
+	found = false;
+	for (pp = of_get_properties(np); pp; pp = pp->next) {
+		if (!strcmp("int-value", pp->name)) {
+			ut_asserteq_ptr(val, pp->value);
+			ut_asserteq(4, pp->length);
+			found = true;
+		}
+	}
+	ut_assert(found);
+	ut_asserteq(-1, np->offset);
+	ut_asserteq_ptr(val, of_get_property(np, "int-value", NULL));
+
+	return 0;
+}
+DM_TEST(dm_test_ofnode_live_props, DM_TESTF_SCAN_FDT | DM_TESTF_LIVE_TREE);
+
+static int dm_test_ofnode_get_name(struct unit_test_state *uts)
+{
+	const struct device_node *np;
+	ofnode node;
+
+	node = ofnode_path("/some-bus/c-test@5");
+	ut_assert(ofnode_valid(node));
+	ut_asserteq_str("c-test@5", ofnode_get_name(node));
+	ut_asserteq_str("", ofnode_get_name(ofnode_path("/")));
+
+	/* Only the live tree has full names, also when it is compact */
+	if (ofnode_is_np(node)) {
+		np = ofnode_to_np(node);
+		ut_asserteq_str("c-test@5", of_node_unit_name(np));
+		ut_asserteq_str("/some-bus/c-test@5", of_node_full_name(np));
+		np = ofnode_to_np(ofnode_path("/"));
+		ut_asserteq_str("", of_node_unit_name(np));
+		ut_asserteq_str("/", of_node_full_name(np));
+	}
+
+	return 0;
+}
+DM_TEST(dm_test_ofnode_get_name, DM_TESTF_SCAN_FDT);
@@ -0,0 +1,119 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for finding partitions in a GPT
+ */
+
+#include <common.h>
+#include <blk.h>
+#include <dm.h>
+#include <malloc.h>
+#include <os.h>
+#include <part.h>
+#include <part_efi.h>
+#include <sandboxblockdev.h>
+#include <dm/test.h>
+#include <test/ut.h>
+
+#define SECT_SIZE	512
+#define IMG_SECTS	256
+#define NUM_PARTS	3
+
+static const char fname[] = "part_test.img";
+
+static const char *const part_name[NUM_PARTS] = { "one", "two", "three" };
+
+static const char *const part_uuid[NUM_PARTS] = {
+	"d117f98e-6f2c-d04b-a5b2-331a19f91cb2",
+	"25718777-d0ad-7443-9e60-02cb591c9737",
+	"cc3d3a4e-5b7c-4f32-a4c6-c8e3ef6ad6d1",
+};
+
+static const char disk_guid[] = "375a56f7-d6c9-4e81-b5f0-09d41ca89efe";
+
+/*
+ * Write a GPT with three partitions of 16 blocks. If @hole is not -1, that
+ * entry is left unused, so the table has a gap in it.
+ */
+static int write_table(struct unit_test_state *uts, struct blk_desc *desc,
+		       int hole)
+{
+	disk_partition_t parts[NUM_PARTS];
+	gpt_header *gpt_h;
+	gpt_entry *gpt_e;
+	int i;
+
+	memset(parts, '\0', sizeof(parts));
+	for (i = 0; i < NUM_PARTS; i++) {
+		strcpy((char *)parts[i].name, part_name[i]);
+		parts[i].size = 16;
+#if CONFIG_IS_ENABLED(PARTITION_UUIDS)
+		strcpy(parts[i].uuid, part_uuid[i]);
+#endif
+	}
+
+	gpt_h = calloc(1, SECT_SIZE);
+	gpt_e = calloc(GPT_ENTRY_NUMBERS, sizeof(gpt_entry));
+	ut_assertnonnull(gpt_h);
+	ut_assertnonnull(gpt_e);
+	ut_assertok(gpt_fill_header(desc, gpt_h, (char *)disk_guid,
+				    NUM_PARTS));
+	ut_assertok(gpt_fill_pte(desc, gpt_h, gpt_e, parts, NUM_PARTS));
+	if (hole != -1)
+		memset(&gpt_e[hole], '\0', sizeof(gpt_entry));
+	ut_assertok(write_gpt_table(desc, gpt_h, gpt_e));
+	free(gpt_e);
+	free(gpt_h);
+
+	return 0;
+}
+
+/* Test that lookups stop at the first unused entry, as they always have */
+static int dm_test_part_find(struct unit_test_state *uts)
+{
+	disk_partition_t info;
+	struct blk_desc *desc;
+	char *buf;
+	int fd;
+
+	buf = calloc(IMG_SECTS, SECT_SIZE);
+	ut_assertnonnull(buf);
+	fd = os_open(fname, OS_O_RDWR | OS_O_CREAT | OS_O_TRUNC);
+	ut_assert(fd >= 0);
+	ut_asserteq(IMG_SECTS * SECT_SIZE,
+		    os_write(fd, buf, IMG_SECTS * SECT_SIZE));
+	os_close(fd);
+	free(buf);
+
+	ut_assertok(host_dev_bind(0, (char *)fname));
+	desc = blk_get_devnum_by_type(IF_TYPE_HOST, 0);
+	ut_assertnonnull(desc);
+
+	ut_assertok(write_table(uts, desc, -1));
+	part_init(desc);
+	ut_asserteq(1, part_get_info_by_name(desc, "one", &info));
+	ut_asserteq(3, part_get_info_by_name(desc, "three", &info));
+	ut_asserteq_str("three", (char *)info.name);
+	ut_asserteq(-1, part_get_info_by_name(desc, "four", &info));
+#if CONFIG_IS_ENABLED(PARTITION_UUIDS)
+	ut_asserteq(3, part_get_info_by_uuid(desc, part_uuid[2], &info));
+#endif
+
+	/* Rewriting the table drops the cached one */
+	ut_assertok(write_table(uts, desc, 1));
+	ut_asserteq(1, part_get_info_by_name(desc, "one", &info));
+	ut_asserteq(-1, part_get_info_by_name(desc, "two", &info));
+	ut_asserteq(-1, part_get_info_by_name(desc, "three", &info));
+#if CONFIG_IS_ENABLED(PARTITION_UUIDS)
+	ut_asserteq(-1, part_get_info_by_uuid(desc, part_uuid[2], &info));
+#endif
+
+	/* The entry after the gap can still be read by its number */
+	ut_assertok(part_get_info(desc, 3, &info));
+	ut_asserteq_str("three", (char *)info.name);
+
+	ut_assertok(host_dev_bind(0, NULL));
+	os_unlink(fname);
+
+	return 0;
+}
+DM_TEST(dm_test_part_find, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
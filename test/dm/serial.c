@@ -6,6 +6,8 @@
 #include <common.h>
 #include <serial.h>
 #include <dm.h>
+#include <stdio_dev.h>
+#include <asm/test.h>
 #include <dm/test.h>
 #include <test/ut.h>
 
@@ -67,3 +69,39 @@ static int dm_test_serial(struct unit_test_state *uts)
 }
 
 DM_TEST(dm_test_serial, DM_TESTF_SCAN_FDT);
+
+#if CONFIG_IS_ENABLED(SERIAL_TX_BUFFER)
+/* Test that output held in the TX buffer is all sent by serial_flush() */
+static int dm_test_serial_tx_buffer(struct unit_test_state *uts)
+{
+	const char *str = "buffered output\n";
+	struct serial_dev_priv *upriv;
+	struct udevice *dev;
+	size_t start, held, sent;
+
+	ut_assertok(uclass_get_device_by_name(UCLASS_SERIAL, "serial", &dev));
+	upriv = dev_get_uclass_priv(dev);
+	ut_assertnonnull(upriv->tx_buf);
+	ut_assertnonnull(upriv->sdev);
+
+	/*
+	 * Nothing else may be printed while the device is busy, so only
+	 * check the counts once it accepts output again
+	 */
+	start = sandbox_serial_get_tx_count();
+	sandbox_serial_set_tx_busy(true);
+	upriv->sdev->puts(upriv->sdev, str);
+	held = sandbox_serial_get_tx_count();
+	sandbox_serial_set_tx_busy(false);
+	serial_flush();
+	sent = sandbox_serial_get_tx_count();
+
+	ut_asserteq(start, held);
+	ut_asserteq(upriv->tx_wr, upriv->tx_rd);
+	/* The newline is sent as \r\n */
+	ut_asserteq(start + strlen(str) + 1, sent);
+
+	return 0;
+}
+DM_TEST(dm_test_serial_tx_buffer, DM_TESTF_SCAN_FDT);
+#endif
@@ -0,0 +1,123 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for the slab allocator used by driver model
+ */
+
+#include <common.h>
+#include <dm.h>
+#include <slab.h>
+#include <time.h>
+#include <dm/root.h>
+#include <dm/test.h>
+#include <dm/uclass-internal.h>
+#include <dm/util.h>
+#include <test/ut.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+/**
+ * struct slab_totals - Statistics summed over all size classes
+ *
+ * @allocs: Total number of objects allocated
+ * @objs: Number of objects in use
+ * @pages: Number of pages held
+ */
+struct slab_totals {
+	ulong allocs;
+	uint objs;
+	uint pages;
+};
+
+static void get_totals(struct slab_totals *tot)
+{
+	struct slab_stats stats;
+	int i;
+
+	memset(tot, '\0', sizeof(*tot));
+	for (i = 0; !slab_get_stats(i, &stats); i++) {
+		tot->allocs += stats.allocs;
+		tot->objs += stats.objs;
+		tot->pages += stats.pages;
+	}
+}
+
+/* Test allocating and freeing objects */
+static int dm_test_slab_alloc(struct unit_test_state *uts)
+{
+	struct slab_stats before, stats;
+	char *ptr, *other;
+
+	ut_asserteq(-ENOENT, slab_get_stats(SLAB_CLASS_COUNT, &stats));
+	ut_assertok(slab_get_stats(0, &before));
+	ut_asserteq(16, before.size);
+
+	/* Objects are zeroed and freed objects are reused */
+	ptr = slab_alloc(10);
+	ut_assertnonnull(ptr);
+	ut_asserteq(0, ptr[0]);
+	ut_asserteq(0, ptr[9]);
+	memset(ptr, 0xff, 10);
+	ut_assertok(slab_get_stats(0, &stats));
+	ut_asserteq(before.objs + 1, stats.objs);
+	ut_asserteq(before.allocs + 1, stats.allocs);
+	slab_free(ptr, 10);
+	other = slab_alloc(16);
+	ut_asserteq_ptr(ptr, other);
+	ut_asserteq(0, other[0]);
+	ut_asserteq(0, other[9]);
+	slab_free(other, 16);
+	ut_assertok(slab_get_stats(0, &stats));
+	ut_asserteq(before.objs, stats.objs);
+	ut_asserteq(before.frees + 2, stats.frees);
+
+	/* Large objects do not use a size class */
+	ptr = slab_alloc(SLAB_MAX_SIZE + 1);
+	ut_assertnonnull(ptr);
+	slab_free(ptr, SLAB_MAX_SIZE + 1);
+	slab_free(NULL, 10);
+
+	return 0;
+}
+DM_TEST(dm_test_slab_alloc, 0);
+
+/* Count the allocations made when binding devices, and check they are freed */
+static int dm_test_slab_bind(struct unit_test_state *uts)
+{
+	struct slab_totals start, bound, end;
+	struct udevice *dev;
+	int devs = 0;
+	ulong bind_us;
+	int id;
+
+	get_totals(&start);
+	bind_us = timer_get_us();
+	ut_assertok(dm_extended_scan_fdt(gd->fdt_blob, false));
+	bind_us = timer_get_us() - bind_us;
+	get_totals(&bound);
+
+	for (uclass_find_first_device(UCLASS_TEST_FDT, &dev); dev;
+	     uclass_find_next_device(&dev))
+		devs++;
+	ut_assert(devs > 0);
+	ut_assert(bound.objs > start.objs + devs);
+
+	/* Many objects share each page */
+	ut_assert(bound.pages - start.pages < (bound.allocs - start.allocs) / 4);
+	printf("Bound devices: %lu objects in %u pages, %lu us\n",
+	       bound.allocs - start.allocs, bound.pages - start.pages,
+	       bind_us);
+
+	/* Unbinding everything frees the objects and releases the pages */
+	for (id = UCLASS_ROOT + 1; id < UCLASS_COUNT; id++) {
+		struct uclass *uc = uclass_find(id);
+
+		if (uc)
+			ut_assertok(uclass_destroy(uc));
+	}
+	get_totals(&end);
+	ut_asserteq(start.objs, end.objs);
+	ut_asserteq(start.pages, end.pages);
+
+	return 0;
+}
+DM_TEST(dm_test_slab_bind, 0);
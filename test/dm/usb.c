@@ -6,10 +6,13 @@
 #include <common.h>
 #include <console.h>
 #include <dm.h>
+#include <malloc.h>
+#include <scsi.h>
 #include <usb.h>
 #include <asm/io.h>
 #include <asm/state.h>
 #include <asm/test.h>
+#include <asm/unaligned.h>
 #include <dm/device-internal.h>
 #include <dm/test.h>
 #include <dm/uclass-internal.h>
@@ -61,6 +64,135 @@ static int dm_test_usb_flash(struct unit_test_state *uts)
 }
 DM_TEST(dm_test_usb_flash, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
 
+#ifdef CONFIG_USB_STORAGE_UAS
+/*
+ * Test reading from the UAS flash stick, enough that several batches of
+ * queued commands are needed. Each block is filled with its number, mod 251.
+ */
+static int dm_test_usb_flash_uas(struct unit_test_state *uts)
+{
+	struct blk_desc *dev_desc;
+	const int count = 2000;
+	u8 *buf;
+	int i;
+
+	state_set_skip_delays(true);
+	ut_assertok(usb_init());
+	ut_assertok(blk_get_device_by_str("usb", "2", &dev_desc));
+	ut_asserteq(2048, dev_desc->lba);
+
+	buf = malloc(count * dev_desc->blksz);
+	ut_assertnonnull(buf);
+	ut_asserteq(count, blk_dread(dev_desc, 3, count, buf));
+	for (i = 0; i < count * dev_desc->blksz; i++)
+		ut_asserteq((3 + i / dev_desc->blksz) % 251, buf[i]);
+	free(buf);
+	ut_assertok(usb_stop());
+
+	return 0;
+}
+DM_TEST(dm_test_usb_flash_uas, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+#endif
+
+#define BULK_QUEUE_BLKS		3
+
+/*
+ * Test that queued bulk transfers complete in the order they were submitted.
+ * This reads from the flash stick with raw Bulk-Only transfers, queueing the
+ * command, each data block and the status together, then reaps only the last.
+ */
+static int dm_test_usb_bulk_queue(struct unit_test_state *uts)
+{
+	struct usb_bulk_req req[BULK_QUEUE_BLKS + 2];
+	struct usb_interface *iface;
+	struct umass_bbb_cbw *cbw;
+	struct umass_bbb_csw *csw;
+	struct usb_device *udev;
+	int ep_in = 0, ep_out = 0;
+	struct udevice *dev;
+	u8 *buf, *data;
+	int i;
+
+	state_set_skip_delays(true);
+	ut_assertok(usb_init());
+	ut_assertok(uclass_get_device(UCLASS_MASS_STORAGE, 0, &dev));
+	udev = dev_get_parent_priv(dev);
+	iface = &udev->config.if_desc[0];
+	for (i = 0; i < iface->desc.bNumEndpoints; i++) {
+		u8 addr = iface->ep_desc[i].bEndpointAddress;
+
+		if (addr & USB_DIR_IN)
+			ep_in = addr & USB_ENDPOINT_NUMBER_MASK;
+		else
+			ep_out = addr & USB_ENDPOINT_NUMBER_MASK;
+	}
+
+	buf = malloc(UMASS_BBB_CBW_SIZE + UMASS_BBB_CSW_SIZE +
+		     BULK_QUEUE_BLKS * 512);
+	ut_assertnonnull(buf);
+	cbw = (struct umass_bbb_cbw *)buf;
+	data = buf + UMASS_BBB_CBW_SIZE;
+	csw = (struct umass_bbb_csw *)(data + BULK_QUEUE_BLKS * 512);
+	memset(buf, 0xff, UMASS_BBB_CBW_SIZE + UMASS_BBB_CSW_SIZE +
+	       BULK_QUEUE_BLKS * 512);
+
+	memset(cbw, '\0', UMASS_BBB_CBW_SIZE);
+	cbw->dCBWSignature = cpu_to_le32(CBWSIGNATURE);
+	cbw->dCBWTag = cpu_to_le32(0x1234);
+	cbw->dCBWDataTransferLength = cpu_to_le32(BULK_QUEUE_BLKS * 512);
+	cbw->bCBWFlags = CBWFLAGS_IN;
+	cbw->bCDBLength = 10;
+	cbw->CBWCDB[0] = SCSI_READ10;
+	put_unaligned_be16(BULK_QUEUE_BLKS, &cbw->CBWCDB[7]);
+
+	req[0].pipe = usb_sndbulkpipe(udev, ep_out);
+	req[0].buffer = cbw;
+	req[0].length = UMASS_BBB_CBW_SIZE;
+	for (i = 1; i <= BULK_QUEUE_BLKS; i++) {
+		req[i].pipe = usb_rcvbulkpipe(udev, ep_in);
+		req[i].buffer = data + (i - 1) * 512;
+		req[i].length = 512;
+	}
+	req[BULK_QUEUE_BLKS + 1].pipe = usb_rcvbulkpipe(udev, ep_in);
+	req[BULK_QUEUE_BLKS + 1].buffer = csw;
+	req[BULK_QUEUE_BLKS + 1].length = UMASS_BBB_CSW_SIZE;
+	for (i = 0; i < ARRAY_SIZE(req); i++) {
+		ut_assertok(usb_bulk_submit(udev, &req[i]));
+		ut_assert(!req[i].done);
+	}
+
+	/* Reaping the status reaps everything before it */
+	ut_assertok(usb_bulk_reap(udev, &req[BULK_QUEUE_BLKS + 1], 0));
+	for (i = 0; i < ARRAY_SIZE(req); i++) {
+		ut_assert(req[i].done);
+		ut_assertok(usb_bulk_reap(udev, &req[i], 0));
+	}
+
+	/* Each block went to the right buffer, and the status last */
+	for (i = 1; i <= BULK_QUEUE_BLKS; i++)
+		ut_asserteq(512, req[i].act_len);
+	ut_asserteq_str("this is a test", (char *)data);
+	for (i = 512; i < BULK_QUEUE_BLKS * 512; i++)
+		ut_asserteq(0, data[i]);
+	ut_asserteq(UMASS_BBB_CSW_SIZE, req[BULK_QUEUE_BLKS + 1].act_len);
+	ut_asserteq(CSWSIGNATURE, le32_to_cpu(csw->dCSWSignature));
+	ut_asserteq(0x1234, le32_to_cpu(csw->dCSWTag));
+	ut_asserteq(CSWSTATUS_GOOD, csw->bCSWStatus);
+
+	/* A cancelled request is done, but fails */
+	ut_assertok(usb_bulk_submit(udev, &req[1]));
+	usb_bulk_cancel(udev, req[1].pipe);
+	ut_assert(req[1].done);
+	ut_asserteq(USB_ST_NOT_PROC, req[1].status);
+	ut_asserteq(-EIO, usb_bulk_reap(udev, &req[1], 0));
+
+	free(buf);
+	ut_assertok(usb_stop());
+
+	return 0;
+}
+DM_TEST(dm_test_usb_bulk_queue, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
 /* test that we can handle multiple storage devices */
 static int dm_test_usb_multi(struct unit_test_state *uts)
 {
@@ -5,13 +5,16 @@
  */
 
 #include <common.h>
+#include <bmp_layout.h>
 #include <bzlib.h>
 #include <dm.h>
+#include <hexdump.h>
 #include <malloc.h>
 #include <mapmem.h>
 #include <os.h>
 #include <video.h>
 #include <video_console.h>
+#include <asm/unaligned.h>
 #include <dm/test.h>
 #include <dm/uclass-internal.h>
 #include <test/ut.h>
@@ -238,6 +241,103 @@ static int dm_test_video_context(struct unit_test_state *uts)
 }
 DM_TEST(dm_test_video_context, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
 
+/* Test the same output when the display cannot pan, so scrolling copies */
+static int dm_test_video_context_copy(struct unit_test_state *uts)
+{
+	struct sandbox_sdl_plat *plat;
+	struct udevice *dev;
+
+	ut_assertok(select_vidconsole(uts, "vidconsole0"));
+	ut_assertok(uclass_find_device(UCLASS_VIDEO, 0, &dev));
+	plat = dev_get_platdata(dev);
+	plat->yvirt = 0;
+	ut_assertok(check_vidconsole_output(uts, 0, 788, 453));
+
+	return 0;
+}
+DM_TEST(dm_test_video_context_copy, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+/* Test scrolling the console by panning down the frame buffer */
+static int dm_test_video_pan(struct unit_test_state *uts)
+{
+	struct vidconsole_priv *vc_priv;
+	struct udevice *dev, *con;
+	struct video_priv *priv;
+	int i, size, row_size;
+	void *base;
+	u16 *pix;
+
+	ut_assertok(select_vidconsole(uts, "vidconsole0"));
+	ut_assertok(uclass_get_device(UCLASS_VIDEO, 0, &dev));
+	ut_assertok(uclass_get_device(UCLASS_VIDEO_CONSOLE, 0, &con));
+	priv = dev_get_uclass_priv(dev);
+	vc_priv = dev_get_uclass_priv(con);
+	ut_asserteq(768 * 2, priv->yvirt);
+	ut_asserteq(0, priv->yoffset);
+	ut_asserteq(48, vc_priv->rows);
+	row_size = vc_priv->y_charsize * priv->line_length;
+	base = priv->fb;
+
+	/* Only the rows written since the last sync are dirty */
+	video_sync(dev, true);
+	ut_asserteq(priv->dirty_ystart, priv->dirty_yend);
+	vidconsole_putc_xy(con, 0, 32, 'a');
+	ut_asserteq(32, priv->dirty_ystart);
+	ut_asserteq(48, priv->dirty_yend);
+	video_sync(dev, true);
+	ut_asserteq(priv->dirty_ystart, priv->dirty_yend);
+
+	/* Filling the display scrolls it by moving it down a text row */
+	for (i = 0; i < 48; i++)
+		vidconsole_put_string(con, "line\n");
+	ut_asserteq(16, priv->yoffset);
+	ut_asserteq_ptr(base + row_size, priv->fb);
+
+	/* Dirty rows are counted from the start of the frame buffer */
+	video_sync(dev, true);
+	vidconsole_putc_xy(con, 0, 0, 'b');
+	ut_asserteq(16, priv->dirty_ystart);
+	ut_asserteq(32, priv->dirty_yend);
+
+	/* At the end of the frame buffer the display moves back to the start */
+	for (i = 1; i < 48; i++)
+		vidconsole_put_string(con, "line\n");
+	ut_asserteq(768, priv->yoffset);
+	vidconsole_put_string(con, "line\n");
+	ut_asserteq(0, priv->yoffset);
+	ut_asserteq_ptr(base, priv->fb);
+
+	/* All but the last text row show the same text */
+	ut_assertok(memcmp(priv->fb, priv->fb + 46 * row_size, row_size));
+	pix = priv->fb + 47 * row_size;
+	for (i = 0; i < row_size / 2; i++)
+		ut_asserteq(priv->colour_bg, pix[i]);
+
+	/* Disabling panning keeps what is shown, and scrolling then copies */
+	vidconsole_put_string(con, "line\n");
+	ut_asserteq(16, priv->yoffset);
+	size = compress_frame_buffer(dev);
+	ut_assertok(video_pan_disable(dev));
+	ut_asserteq(0, priv->yoffset);
+	ut_asserteq_ptr(base, priv->fb);
+	ut_asserteq(size, compress_frame_buffer(dev));
+	vidconsole_put_string(con, "line\n");
+	ut_asserteq(0, priv->yoffset);
+	ut_asserteq(size, compress_frame_buffer(dev));
+
+	/* The EFI GOP needs every sync to cover the whole display */
+	video_set_sync_all(dev, true);
+	video_sync(dev, true);
+	ut_asserteq(0, priv->dirty_ystart);
+	ut_asserteq(768, priv->dirty_yend);
+	video_set_sync_all(dev, false);
+	video_sync(dev, true);
+	ut_asserteq(priv->dirty_ystart, priv->dirty_yend);
+
+	return 0;
+}
+DM_TEST(dm_test_video_pan, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
 /* Test rotated text output through the console uclass */
 static int dm_test_video_rotation1(struct unit_test_state *uts)
 {
@@ -319,6 +419,167 @@ static int dm_test_video_bmp_comp(struct unit_test_state *uts)
 }
 DM_TEST(dm_test_video_bmp_comp, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
 
+/*
+ * Colour of each entry in the colour table of bitmaps made by make_bmp(), as
+ * a 16bpp pixel. Each is different.
+ */
+#define BMP_TEST_RGB16(i)	((((i) & 0x1f) << 11) | (((i) >> 5) << 8) | 0x1f)
+
+/* Set up a bitmap at address 0 with the given pixel data */
+static ulong make_bmp(int width, int height, int bit_count, int compression,
+		      const u8 *data, int size)
+{
+	struct bmp_image *bmp = map_sysmem(0, 0);
+	int colours = bit_count == 8 ? 256 : 0;
+	int offset = sizeof(struct bmp_header) +
+		colours * sizeof(struct bmp_color_table_entry);
+	int i;
+
+	memset(bmp, '\0', offset);
+	bmp->header.signature[0] = 'B';
+	bmp->header.signature[1] = 'M';
+	put_unaligned_le32(offset + size, &bmp->header.file_size);
+	put_unaligned_le32(offset, &bmp->header.data_offset);
+	put_unaligned_le32(40, &bmp->header.size);
+	put_unaligned_le32(width, &bmp->header.width);
+	put_unaligned_le32(height, &bmp->header.height);
+	put_unaligned_le16(1, &bmp->header.planes);
+	put_unaligned_le16(bit_count, &bmp->header.bit_count);
+	put_unaligned_le32(compression, &bmp->header.compression);
+	put_unaligned_le32(size, &bmp->header.image_size);
+	for (i = 0; i < colours; i++) {
+		bmp->color_table[i].red = (i & 0x1f) << 3;
+		bmp->color_table[i].green = (i >> 5) << 5;
+		bmp->color_table[i].blue = 0xf8;
+	}
+	memcpy((void *)bmp + offset, data, size);
+
+	return 0;
+}
+
+static int video_pixel(struct video_priv *priv, int x, int y)
+{
+	return ((u16 *)(priv->fb + y * priv->line_length))[x];
+}
+
+/* Test that each pixel of a bitmap is drawn in the right place and colour */
+static int dm_test_video_bmp_pixels(struct unit_test_state *uts)
+{
+	/* Two rows, bottom first, each padded to four bytes */
+	static const u8 bmp8[] = {
+		1, 2, 3, 4, 5, 0, 0, 0,
+		6, 7, 8, 9, 10, 0, 0, 0,
+	};
+	/* Two rows of three blue, green, red pixels, each padded */
+	static const u8 bmp24[] = {
+		0x00, 0x00, 0xff, 0x00, 0xff, 0x00, 0xff, 0x00, 0x00, 0, 0, 0,
+		0x08, 0x10, 0x20, 0xf8, 0xf8, 0xf8, 0x7f, 0x3f, 0x1f, 0, 0, 0,
+	};
+	/*
+	 * Three rows: a run and a literal run which is too wide, a row with
+	 * gaps either side of a run and a row which is a single run
+	 */
+	static const u8 rle8[] = {
+		4, 7, 0, 3, 1, 2, 3, 0, 0, 0,
+		0, 2, 2, 0, 2, 9, 0, 0,
+		6, 200, 0, 1,
+	};
+	struct video_priv *priv;
+	struct udevice *dev;
+	int x;
+
+	ut_assertok(uclass_get_device(UCLASS_VIDEO, 0, &dev));
+	priv = dev_get_uclass_priv(dev);
+
+	ut_assertok(video_bmp_display(dev, make_bmp(5, 2, 8, BMP_BI_RGB, bmp8,
+						    sizeof(bmp8)),
+				      10, 20, false));
+	for (x = 0; x < 5; x++) {
+		ut_asserteq(BMP_TEST_RGB16(x + 6),
+			    video_pixel(priv, 10 + x, 20));
+		ut_asserteq(BMP_TEST_RGB16(x + 1),
+			    video_pixel(priv, 10 + x, 21));
+	}
+	ut_asserteq(priv->colour_bg, video_pixel(priv, 15, 20));
+	ut_asserteq(priv->colour_bg, video_pixel(priv, 10, 22));
+
+	/* 24bpp bitmaps are shown as 555 RGB on a 16bpp display */
+	ut_assertok(video_bmp_display(dev, make_bmp(3, 2, 24, BMP_BI_RGB, bmp24,
+						    sizeof(bmp24)),
+				      30, 20, false));
+	ut_asserteq(0x1041, video_pixel(priv, 30, 20));
+	ut_asserteq(0x7fff, video_pixel(priv, 31, 20));
+	ut_asserteq(0x0cef, video_pixel(priv, 32, 20));
+	ut_asserteq(0x7c00, video_pixel(priv, 30, 21));
+	ut_asserteq(0x03e0, video_pixel(priv, 31, 21));
+	ut_asserteq(0x001f, video_pixel(priv, 32, 21));
+	ut_asserteq(priv->colour_bg, video_pixel(priv, 33, 21));
+
+	/* Pixels which an RLE8 bitmap skips over are left alone */
+	ut_assertok(video_bmp_display(dev, make_bmp(6, 3, 8, BMP_BI_RLE8, rle8,
+						    sizeof(rle8)),
+				      50, 20, false));
+	for (x = 0; x < 6; x++)
+		ut_asserteq(BMP_TEST_RGB16(200), video_pixel(priv, 50 + x, 20));
+	ut_asserteq(priv->colour_bg, video_pixel(priv, 51, 21));
+	ut_asserteq(BMP_TEST_RGB16(9), video_pixel(priv, 52, 21));
+	ut_asserteq(BMP_TEST_RGB16(9), video_pixel(priv, 53, 21));
+	ut_asserteq(priv->colour_bg, video_pixel(priv, 54, 21));
+	for (x = 0; x < 4; x++)
+		ut_asserteq(BMP_TEST_RGB16(7), video_pixel(priv, 50 + x, 22));
+	ut_asserteq(BMP_TEST_RGB16(1), video_pixel(priv, 54, 22));
+	ut_asserteq(BMP_TEST_RGB16(2), video_pixel(priv, 55, 22));
+	ut_asserteq(priv->colour_bg, video_pixel(priv, 56, 22));
+
+	return 0;
+}
+DM_TEST(dm_test_video_bmp_pixels, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+/* Test that a bitmap drawn again from the cache is the same */
+static int dm_test_video_bmp_cache(struct unit_test_state *uts)
+{
+	struct bmp_color_table_entry *cte;
+	struct video_priv *priv;
+	struct bmp_image *bmp;
+	struct udevice *dev;
+	int x, y, i;
+	void *expect;
+	ulong addr;
+
+	ut_assertok(uclass_get_device(UCLASS_VIDEO, 0, &dev));
+	priv = dev_get_uclass_priv(dev);
+	ut_assertok(read_file(uts, "tools/logos/denx-comp.bmp", &addr));
+	bmp = map_sysmem(addr, 0);
+	cte = (void *)bmp + 14 + get_unaligned_le32(&bmp->header.size);
+
+	/* Put it partly off the display, so it is clipped */
+	x = priv->xsize - 100;
+	y = priv->ysize - 50;
+	ut_assertok(video_bmp_display(dev, addr, x, y, false));
+	expect = malloc(priv->fb_size);
+	ut_assertnonnull(expect);
+	memcpy(expect, priv->fb, priv->fb_size);
+
+	video_clear(dev);
+	ut_assertok(video_bmp_display(dev, addr, x, y, false));
+	ut_asserteq_mem(expect, priv->fb, priv->fb_size);
+
+	/* A change to the bitmap in memory must be noticed */
+	for (i = 0; i < 256; i++)
+		cte[i].red ^= 0xff;
+	ut_assertok(video_bmp_display(dev, addr, x, y, false));
+	ut_assert(memcmp(expect, priv->fb, priv->fb_size));
+
+	for (i = 0; i < 256; i++)
+		cte[i].red ^= 0xff;
+	ut_assertok(video_bmp_display(dev, addr, x, y, false));
+	ut_asserteq_mem(expect, priv->fb, priv->fb_size);
+	free(expect);
+
+	return 0;
+}
+DM_TEST(dm_test_video_bmp_cache, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
 /* Test TrueType console */
 static int dm_test_video_truetype(struct unit_test_state *uts)
 {
@@ -328,7 +589,7 @@ static int dm_test_video_truetype(struct unit_test_state *uts)
 	ut_assertok(uclass_get_device(UCLASS_VIDEO, 0, &dev));
 	ut_assertok(uclass_get_device(UCLASS_VIDEO_CONSOLE, 0, &con));
 	vidconsole_put_string(con, test_string);
-	ut_asserteq(12237, compress_frame_buffer(dev));
+	ut_asserteq(8870, compress_frame_buffer(dev));
 
 	return 0;
 }
@@ -349,7 +610,7 @@ static int dm_test_video_truetype_scroll(struct unit_test_state *uts)
 	ut_assertok(uclass_get_device(UCLASS_VIDEO, 0, &dev));
 	ut_assertok(uclass_get_device(UCLASS_VIDEO_CONSOLE, 0, &con));
 	vidconsole_put_string(con, test_string);
-	ut_asserteq(35030, compress_frame_buffer(dev));
+	ut_asserteq(29030, compress_frame_buffer(dev));
 
 	return 0;
 }
@@ -370,8 +631,70 @@ static int dm_test_video_truetype_bs(struct unit_test_state *uts)
 	ut_assertok(uclass_get_device(UCLASS_VIDEO, 0, &dev));
 	ut_assertok(uclass_get_device(UCLASS_VIDEO_CONSOLE, 0, &con));
 	vidconsole_put_string(con, test_string);
-	ut_asserteq(29018, compress_frame_buffer(dev));
+	ut_asserteq(24075, compress_frame_buffer(dev));
 
 	return 0;
 }
 DM_TEST(dm_test_video_truetype_bs, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+/* Test that characters drawn from the TrueType glyph cache are unchanged */
+static int dm_test_video_truetype_cache(struct unit_test_state *uts)
+{
+	struct console_tt_cache_stats stats;
+	struct udevice *dev, *con;
+	struct video_priv *priv;
+	const char *test_string = "Criticism may not be agreeable, but it is necessary. It fulfils the same function as pain in the human body.\n\tIt calls attention to an unhealthy state of things.\n";
+	void *expect;
+
+	ut_assertok(uclass_get_device(UCLASS_VIDEO, 0, &dev));
+	ut_assertok(uclass_get_device(UCLASS_VIDEO_CONSOLE, 0, &con));
+	priv = dev_get_uclass_priv(dev);
+
+	/* Render every character to get the expected output */
+	console_truetype_cache_configure(0);
+	vidconsole_position_cursor(con, 0, 0);
+	vidconsole_put_string(con, test_string);
+	console_truetype_cache_stats(&stats);
+	ut_asserteq(0, stats.hits);
+	ut_asserteq(159, stats.misses);
+	ut_asserteq(0, stats.entries);
+	expect = malloc(priv->fb_size);
+	ut_assertnonnull(expect);
+	memcpy(expect, priv->fb, priv->fb_size);
+
+	/* Repeated characters come from the cache */
+	console_truetype_cache_configure(CONFIG_CONSOLE_TRUETYPE_CACHE_SIZE);
+	video_clear(dev);
+	vidconsole_position_cursor(con, 0, 0);
+	vidconsole_put_string(con, test_string);
+	ut_asserteq_mem(expect, priv->fb, priv->fb_size);
+	console_truetype_cache_stats(&stats);
+	ut_asserteq(96, stats.hits);
+	ut_asserteq(63, stats.misses);
+	ut_asserteq(63, stats.entries);
+
+	/* Drawing the text again renders nothing */
+	video_clear(dev);
+	vidconsole_position_cursor(con, 0, 0);
+	vidconsole_put_string(con, test_string);
+	ut_asserteq_mem(expect, priv->fb, priv->fb_size);
+	console_truetype_cache_stats(&stats);
+	ut_asserteq(159, stats.hits);
+	ut_asserteq(0, stats.misses);
+
+	/* A small cache drops the least recently used characters */
+	console_truetype_cache_configure(0x800);
+	video_clear(dev);
+	vidconsole_position_cursor(con, 0, 0);
+	vidconsole_put_string(con, test_string);
+	ut_asserteq_mem(expect, priv->fb, priv->fb_size);
+	console_truetype_cache_stats(&stats);
+	ut_assert(stats.size <= 0x800);
+	ut_assert(stats.entries < 63);
+
+	console_truetype_cache_configure(CONFIG_CONSOLE_TRUETYPE_CACHE_SIZE);
+	free(expect);
+
+	return 0;
+}
+DM_TEST(dm_test_video_truetype_cache, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
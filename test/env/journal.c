@@ -0,0 +1,144 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for the journaling environment storage
+ */
+
+#include <common.h>
+#include <env.h>
+#include <env_internal.h>
+#include <malloc.h>
+#include <search.h>
+#include <test/env.h>
+#include <test/ut.h>
+
+/* Storage area in RAM, behaving like flash */
+static u8 jtest_area[CONFIG_ENV_SIZE];
+static int jtest_erases;
+static int jtest_writes;
+
+static int jtest_read(void *buf)
+{
+	memcpy(buf, jtest_area, CONFIG_ENV_SIZE);
+
+	return 0;
+}
+
+static int jtest_write(const void *area, u32 offset, u32 len)
+{
+	const u8 *src = area + offset;
+	u32 i;
+
+	/* Flash can only clear bits */
+	for (i = 0; i < len; i++)
+		jtest_area[offset + i] &= src[i];
+	jtest_writes++;
+
+	return 0;
+}
+
+static int jtest_erase(void)
+{
+	memset(jtest_area, 0xff, CONFIG_ENV_SIZE);
+	jtest_erases++;
+
+	return 0;
+}
+
+static const struct env_journal_ops jtest_ops = {
+	.read	= jtest_read,
+	.write	= jtest_write,
+	.erase	= jtest_erase,
+};
+
+/* Check that saving appends to the journal and loading replays it */
+static int check_journal(struct unit_test_state *uts, struct env_journal *jnl)
+{
+	u32 end;
+	int i;
+
+	memset(jtest_area, 0xff, sizeof(jtest_area));
+	jtest_erases = 0;
+	jtest_writes = 0;
+
+	/* Erased storage is not a journal, so the first save compacts */
+	ut_assertok(env_set("jtest", "1"));
+	ut_assertok(env_journal_save(jnl, &jtest_ops));
+	ut_asserteq(1, jtest_erases);
+	ut_assert(jnl->valid);
+	end = jnl->end;
+
+	/* Changes are appended */
+	ut_assertok(env_set("jtest", "2"));
+	ut_assertok(env_set("jtest2", "x"));
+	ut_assertok(env_journal_save(jnl, &jtest_ops));
+	ut_asserteq(1, jtest_erases);
+	ut_asserteq(2, jtest_writes);
+	ut_assert(jnl->end > end);
+
+	/* Saving without changes writes nothing */
+	ut_assertok(env_journal_save(jnl, &jtest_ops));
+	ut_asserteq(2, jtest_writes);
+
+	/* Unsaved changes are lost on loading */
+	ut_assertok(env_set("jtest", "3"));
+	ut_assertok(env_set("jtest2", NULL));
+	ut_assertok(env_journal_load(jnl, &jtest_ops));
+	ut_asserteq_str("2", env_get("jtest"));
+	ut_asserteq_str("x", env_get("jtest2"));
+
+	/* Deletions are replayed too */
+	ut_assertok(env_set("jtest2", NULL));
+	ut_assertok(env_journal_save(jnl, &jtest_ops));
+	ut_assertok(env_set("jtest2", "y"));
+	ut_assertok(env_journal_load(jnl, &jtest_ops));
+	ut_assertnull(env_get("jtest2"));
+
+	/* Fill the journal until it is compacted */
+	for (i = 0; jtest_erases == 1; i++) {
+		ut_assert(i < CONFIG_ENV_SIZE);
+		ut_assertok(env_set_ulong("jtest", i));
+		ut_assertok(env_journal_save(jnl, &jtest_ops));
+	}
+	ut_assertok(env_set("jtest", "4"));
+	ut_assertok(env_journal_load(jnl, &jtest_ops));
+	ut_asserteq(i - 1, env_get_hex("jtest", 0));
+
+	/* A corrupted record ends the log and forces compaction */
+	ut_assertok(env_set("jtest", "5"));
+	end = jnl->end;
+	ut_assertok(env_journal_save(jnl, &jtest_ops));
+	jtest_area[end] ^= 1;
+	ut_assertok(env_journal_load(jnl, &jtest_ops));
+	ut_asserteq(i - 1, env_get_hex("jtest", 0));
+	ut_assertok(env_set("jtest", "6"));
+	ut_assertok(env_journal_save(jnl, &jtest_ops));
+	ut_asserteq(3, jtest_erases);
+	ut_assertok(env_journal_load(jnl, &jtest_ops));
+	ut_asserteq_str("6", env_get("jtest"));
+
+	return 0;
+}
+
+static int env_test_journal(struct unit_test_state *uts)
+{
+	struct env_journal jnl;
+	char *saved = NULL;
+	ssize_t len;
+	int ret, ok;
+
+	/* Loading the journal replaces the environment, so keep a copy */
+	len = hexport_r(&env_htab, '\0', 0, &saved, 0, 0, NULL);
+	ut_assert(len > 0);
+
+	memset(&jnl, '\0', sizeof(jnl));
+	ret = check_journal(uts, &jnl);
+	free(jnl.area);
+	free(jnl.state);
+
+	ok = himport_r(&env_htab, saved, len, '\0', 0, 0, 0, NULL);
+	free(saved);
+	ut_assert(ok);
+
+	return ret;
+}
+ENV_TEST(env_test_journal, 0);
@@ -0,0 +1,136 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for DFU writes, using the RAM back end
+ */
+
+#include <common.h>
+#include <dfu.h>
+#include <env.h>
+#include <hexdump.h>
+#include <malloc.h>
+#include <test/lib.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+#define DFU_TEST_BUF_SIZE	0x1000
+#define DFU_TEST_BLK_SIZE	0x400
+#define DFU_TEST_BLKS		(DFU_TEST_BUF_SIZE / DFU_TEST_BLK_SIZE)
+/* Four buffers and a bit, so that the last one is not full */
+#define DFU_TEST_SIZE		(DFU_TEST_BUF_SIZE * 4 + DFU_TEST_BLK_SIZE * 3)
+
+/* Set up the source image and a RAM entity writing to a cleared area */
+static int dfu_test_setup(struct unit_test_state *uts, u8 **srcp, u8 **dstp,
+			  struct dfu_entity **dfup)
+{
+	char alt[64];
+	u8 *src, *dst;
+	int i;
+
+	src = malloc(DFU_TEST_SIZE);
+	ut_assertnonnull(src);
+	dst = calloc(1, DFU_TEST_SIZE);
+	ut_assertnonnull(dst);
+	for (i = 0; i < DFU_TEST_SIZE; i++)
+		src[i] = (i % 251) + 1;
+
+	ut_assertok(env_set_ulong("dfu_bufsiz", DFU_TEST_BUF_SIZE));
+	snprintf(alt, sizeof(alt), "img ram %lx %x", (ulong)dst,
+		 DFU_TEST_SIZE);
+	ut_assertok(dfu_config_entities(alt, "ram", "0"));
+	*dfup = dfu_get_entity(0);
+	ut_assertnonnull(*dfup);
+	*srcp = src;
+	*dstp = dst;
+
+	return 0;
+}
+
+static void dfu_test_cleanup(u8 *src, u8 *dst)
+{
+	dfu_free_entities();
+	env_set("dfu_bufsiz", NULL);
+	free(src);
+	free(dst);
+}
+
+/* Test that the image is written as it is, whatever the buffering */
+static int lib_test_dfu_write(struct unit_test_state *uts)
+{
+	struct dfu_entity *dfu;
+	u8 *src, *dst;
+	int blk;
+
+	ut_assertok(dfu_test_setup(uts, &src, &dst, &dfu));
+
+	for (blk = 0; blk * DFU_TEST_BLK_SIZE < DFU_TEST_SIZE; blk++) {
+		ut_assertok(dfu_write(dfu, src + blk * DFU_TEST_BLK_SIZE,
+				      DFU_TEST_BLK_SIZE, blk));
+		/* As the main DFU loop does, now and then */
+		if (blk % 3 == 0)
+			ut_assertok(dfu_write_queued());
+	}
+	ut_assertok(dfu_flush(dfu, NULL, 0, blk));
+	ut_asserteq_mem(src, dst, DFU_TEST_SIZE);
+	ut_asserteq(0, dfu_write_busy(dfu));
+
+	dfu_test_cleanup(src, dst);
+
+	return 0;
+}
+LIB_TEST(lib_test_dfu_write, 0);
+
+#ifdef CONFIG_DFU_WRITE_ALT_BUF
+static int dfu_test_write_blks(struct unit_test_state *uts,
+			       struct dfu_entity *dfu, u8 *src, int *blk,
+			       int count)
+{
+	for (; count; count--, (*blk)++)
+		ut_assertok(dfu_write(dfu, src + *blk * DFU_TEST_BLK_SIZE,
+				      DFU_TEST_BLK_SIZE, *blk));
+
+	return 0;
+}
+
+/* Test that a full buffer is left for dfu_write_queued() to write */
+static int lib_test_dfu_write_alt_buf(struct unit_test_state *uts)
+{
+	struct dfu_entity *dfu;
+	u8 *src, *dst;
+	int blk = 0;
+
+	ut_assertok(dfu_test_setup(uts, &src, &dst, &dfu));
+
+	/* The first buffer is queued and data goes to the second */
+	ut_assertok(dfu_test_write_blks(uts, dfu, src, &blk, DFU_TEST_BLKS));
+	ut_asserteq(0, dst[0]);
+	ut_asserteq(0, dfu_write_busy(dfu));
+
+	/* Once that is full too, the host must wait */
+	ut_assertok(dfu_test_write_blks(uts, dfu, src, &blk, DFU_TEST_BLKS));
+	ut_assert(dfu_write_busy(dfu) >= DFU_BUSY_POLL_TIMEOUT);
+	ut_asserteq(0, dst[0]);
+
+	/* Writing the first makes room, and queues the second */
+	ut_assertok(dfu_write_queued());
+	ut_asserteq_mem(src, dst, DFU_TEST_BUF_SIZE);
+	ut_asserteq(0, dst[DFU_TEST_BUF_SIZE]);
+	ut_asserteq(0, dfu_write_busy(dfu));
+
+	/* If the host does not wait, data is written as it arrives instead */
+	ut_assertok(dfu_test_write_blks(uts, dfu, src, &blk,
+					2 * DFU_TEST_BLKS));
+	ut_asserteq_mem(src, dst, 2 * DFU_TEST_BUF_SIZE);
+	ut_asserteq(0, dst[2 * DFU_TEST_BUF_SIZE]);
+	ut_assert(dfu_write_busy(dfu));
+
+	/* The rest is written by the flush, in order */
+	ut_assertok(dfu_test_write_blks(uts, dfu, src, &blk, 3));
+	ut_assertok(dfu_flush(dfu, NULL, 0, blk));
+	ut_asserteq_mem(src, dst, DFU_TEST_SIZE);
+
+	dfu_test_cleanup(src, dst);
+
+	return 0;
+}
+LIB_TEST(lib_test_dfu_write_alt_buf, 0);
+#endif
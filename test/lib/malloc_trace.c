@@ -0,0 +1,129 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for malloc() tracing
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <malloc_trace.h>
+#include <test/lib.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+/* Find the latest record of a given type for a pointer */
+static int find_rec(void *ptr, enum malloc_trace_type type,
+		    struct malloc_trace_rec *rec)
+{
+	int seq, found = -ENOENT;
+
+	for (seq = 0; !malloc_trace_get_rec(seq, rec); seq++) {
+		if (rec->ptr == ptr && rec->type == type)
+			found = seq;
+	}
+	if (found >= 0)
+		malloc_trace_get_rec(found, rec);
+
+	return found;
+}
+
+/* Test that the counters follow allocations and frees */
+static int lib_test_malloc_trace_counters(struct unit_test_state *uts)
+{
+	struct malloc_trace_stats before, stats;
+	struct malloc_trace_rec rec;
+	void *ptr, *other;
+
+	malloc_trace_reset();
+	malloc_trace_get_stats(&before);
+	ut_asserteq(0, before.allocs);
+	ut_asserteq(0, before.count);
+	ut_asserteq(before.in_use, before.peak);
+
+	ptr = malloc(0x1000);
+	ut_assertnonnull(ptr);
+	malloc_trace_get_stats(&stats);
+	ut_assert(stats.allocs >= 1);
+	ut_assert(stats.in_use >= before.in_use + 0x1000);
+	ut_assert(stats.peak >= stats.in_use);
+	ut_assert(find_rec(ptr, MALLOC_TRACE_ALLOC, &rec) >= 0);
+	ut_asserteq(0x1000, rec.size);
+	ut_assertnonnull(rec.caller);
+
+	/* realloc() is recorded as a free and an allocation */
+	other = realloc(ptr, 0x2000);
+	ut_assertnonnull(other);
+	ut_assert(find_rec(ptr, MALLOC_TRACE_FREE, &rec) >= 0);
+	ut_assert(find_rec(other, MALLOC_TRACE_ALLOC, &rec) >= 0);
+	ut_asserteq(0x2000, rec.size);
+
+	free(other);
+	ut_assert(find_rec(other, MALLOC_TRACE_FREE, &rec) >= 0);
+	malloc_trace_get_stats(&stats);
+	ut_assert(stats.frees >= 2);
+	ut_asserteq(before.in_use, stats.in_use);
+	ut_assert(stats.peak >= before.in_use + 0x2000);
+
+	/* A failed allocation is counted but does not change the usage */
+	ut_assertnull(malloc(-0x100));
+	malloc_trace_get_stats(&before);
+	ut_asserteq(stats.failed + 1, before.failed);
+	ut_asserteq(stats.in_use, before.in_use);
+
+	/* Page-aligned allocations are recorded, so freeing them balances */
+	ptr = valloc(0x100);
+	ut_assertnonnull(ptr);
+	ut_assert(find_rec(ptr, MALLOC_TRACE_ALLOC, &rec) >= 0);
+	ut_asserteq(0x100, rec.size);
+	other = pvalloc(0x100);
+	ut_assertnonnull(other);
+	ut_assert(find_rec(other, MALLOC_TRACE_ALLOC, &rec) >= 0);
+	malloc_trace_get_stats(&stats);
+	ut_assert(stats.allocs >= before.allocs + 2);
+	ut_assert(stats.in_use >= before.in_use + 0x200);
+	free(ptr);
+	free(other);
+	malloc_trace_get_stats(&stats);
+	ut_assert(stats.frees >= before.frees + 2);
+	ut_asserteq(before.in_use, stats.in_use);
+
+	return 0;
+}
+LIB_TEST(lib_test_malloc_trace_counters, 0);
+
+/* Test aggregating records by call site */
+static int lib_test_malloc_trace_sites(struct unit_test_state *uts)
+{
+	struct malloc_trace_site sites[4];
+	struct malloc_trace_rec rec;
+	void *ptr[3];
+	int count, i;
+
+	malloc_trace_reset();
+	for (i = 0; i < ARRAY_SIZE(ptr); i++) {
+		ptr[i] = malloc(0x10000);
+		ut_assertnonnull(ptr[i]);
+	}
+	free(ptr[0]);
+
+	/* The site holding the most memory comes first */
+	count = malloc_trace_get_sites(sites, ARRAY_SIZE(sites));
+	ut_assert(count >= 1);
+	ut_assert(find_rec(ptr[1], MALLOC_TRACE_ALLOC, &rec) >= 0);
+	ut_asserteq_ptr(rec.caller, sites[0].caller);
+	ut_asserteq(3, sites[0].allocs);
+	ut_asserteq(3 * 0x10000, sites[0].bytes);
+	ut_asserteq(2, sites[0].live);
+	ut_asserteq(2 * 0x10000, sites[0].live_bytes);
+
+	free(ptr[1]);
+	free(ptr[2]);
+	count = malloc_trace_get_sites(sites, ARRAY_SIZE(sites));
+	ut_assert(count >= 1);
+	for (i = 0; i < min(count, (int)ARRAY_SIZE(sites)); i++) {
+		if (sites[i].caller == rec.caller)
+			ut_asserteq(0, sites[i].live);
+	}
+
+	return 0;
+}
+LIB_TEST(lib_test_malloc_trace_sites, 0);
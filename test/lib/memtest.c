@@ -0,0 +1,104 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for the memory test engine
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <mapmem.h>
+#include <memtest.h>
+#include <test/lib.h>
+#include <test/test.h>
+#include <test/ut.h>
+#include <linux/sizes.h>
+
+/* A few blocks, with some words left over which are not a group of four */
+#define MEMTEST_TEST_WORDS	(SZ_512K / sizeof(ulong) + 13)
+#define MEMTEST_TEST_SIZE	(MEMTEST_TEST_WORDS * sizeof(ulong))
+
+/* Test that every word is written and checked with the right value */
+static int lib_test_memtest(struct unit_test_state *uts)
+{
+	struct memtest mt;
+	ulong *buf;
+	ulong i;
+
+	buf = malloc(MEMTEST_TEST_SIZE);
+	ut_assertnonnull(buf);
+	memtest_init(&mt, map_to_sysmem(buf), MEMTEST_TEST_SIZE, false);
+	ut_asserteq_ptr(buf, mt.buf);
+	ut_asserteq(MEMTEST_TEST_WORDS, mt.words);
+
+	ut_assertok(memtest_fill(&mt, 0x1234, 3));
+	for (i = 0; i < MEMTEST_TEST_WORDS; i++)
+		ut_assert(buf[i] == 0x1234 + i * 3);
+
+	ut_assertok(memtest_check(&mt, 0x1234, 3, MEMTEST_INVERT));
+	ut_asserteq(0, mt.errs);
+	for (i = 0; i < MEMTEST_TEST_WORDS; i++)
+		ut_assert(buf[i] == ~(0x1234 + i * 3));
+
+	ut_assertok(memtest_check(&mt, ~0x1234UL, -3UL, MEMTEST_ZERO));
+	ut_asserteq(0, mt.errs);
+	for (i = 0; i < MEMTEST_TEST_WORDS; i++)
+		ut_assert(!buf[i]);
+
+	/* One fill, then two passes which read and write */
+	ut_assert(mt.bytes == MEMTEST_TEST_SIZE * 5);
+
+	memtest_uninit(&mt);
+	free(buf);
+
+	return 0;
+}
+LIB_TEST(lib_test_memtest, 0);
+
+/* Test that bad words are reported, including when there are lots */
+static int lib_test_memtest_errs(struct unit_test_state *uts)
+{
+	const ulong top_bit = 1UL << (BITS_PER_LONG - 1);
+	const ulong last = MEMTEST_TEST_WORDS - 1;
+	struct memtest mt;
+	ulong addr, i;
+	ulong *buf;
+
+	buf = malloc(MEMTEST_TEST_SIZE);
+	ut_assertnonnull(buf);
+	addr = map_to_sysmem(buf);
+
+	/* Two bad words in a group of four, and the very last word */
+	memtest_init(&mt, addr, MEMTEST_TEST_SIZE, false);
+	ut_assertok(memtest_fill(&mt, 0, 1));
+	buf[5] ^= 0x10;
+	buf[6] = 0;
+	buf[last] ^= top_bit;
+	ut_assertok(memtest_check(&mt, 0, 1, MEMTEST_KEEP));
+	ut_asserteq(3, mt.errs);
+	ut_asserteq(3, mt.nerr);
+	ut_assert(mt.err[0].addr == addr + 5 * sizeof(ulong));
+	ut_assert(mt.err[0].expected == 5);
+	ut_assert(mt.err[0].actual == 0x15);
+	ut_assert(mt.err[1].addr == addr + 6 * sizeof(ulong));
+	ut_assert(mt.err[1].expected == 6);
+	ut_assert(mt.err[1].actual == 0);
+	ut_assert(mt.err[2].addr == addr + last * sizeof(ulong));
+	ut_assert(mt.err[2].expected == last);
+	ut_assert(mt.err[2].actual == (last ^ top_bit));
+	memtest_uninit(&mt);
+
+	/* Only the first errors are kept, but they are all counted */
+	memtest_init(&mt, addr, MEMTEST_TEST_SIZE, false);
+	ut_assertok(memtest_fill(&mt, 0, 1));
+	for (i = 0; i < MEMTEST_MAX_ERRS * 2; i++)
+		buf[i * 3] ^= 1;
+	ut_assertok(memtest_check(&mt, 0, 1, MEMTEST_KEEP));
+	ut_asserteq(MEMTEST_MAX_ERRS * 2, mt.errs);
+	ut_asserteq(MEMTEST_MAX_ERRS, mt.nerr);
+	i = MEMTEST_MAX_ERRS - 1;
+	ut_assert(mt.err[i].addr == addr + i * 3 * sizeof(ulong));
+	memtest_uninit(&mt);
+	free(buf);
+
+	return 0;
+}
+LIB_TEST(lib_test_memtest_errs, 0);
@@ -0,0 +1,231 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for writing sparse images as they are received
+ */
+
+#include <common.h>
+#include <hexdump.h>
+#include <image-sparse.h>
+#include <malloc.h>
+#include <test/lib.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+#define BLKSZ		512
+#define TARGET_BLKS	32
+#define TARGET_SIZE	(TARGET_BLKS * BLKSZ)
+#define SPARSE_BLKSZ	1024	/* two target blocks */
+#define FILE_HDR_SZ	(sizeof(sparse_header_t) + 4)
+#define CHUNK_HDR_SZ	(sizeof(chunk_header_t) + 4)
+#define STREAM_BUF_SIZE	(2 * SPARSE_BLKSZ + ARCH_DMA_MINALIGN)
+#define ERASE_VAL	0xffffffff
+#define ERASE_GRP	4
+#define FILL_VAL	0x12345678
+
+static u8 target[TARGET_SIZE];
+static u8 expected[TARGET_SIZE];
+static lbaint_t erased;
+
+static lbaint_t ram_write(struct sparse_storage *info, lbaint_t blk,
+			  lbaint_t blkcnt, const void *buffer)
+{
+	memcpy(target + blk * BLKSZ, buffer, blkcnt * BLKSZ);
+
+	return blkcnt;
+}
+
+static lbaint_t ram_reserve(struct sparse_storage *info, lbaint_t blk,
+			    lbaint_t blkcnt)
+{
+	return blkcnt;
+}
+
+static lbaint_t ram_erase(struct sparse_storage *info, lbaint_t blk,
+			  lbaint_t blkcnt)
+{
+	memset(target + blk * BLKSZ, ERASE_VAL & 0xff, blkcnt * BLKSZ);
+	erased += blkcnt;
+
+	return blkcnt;
+}
+
+static void ram_mssg(const char *str, char *response)
+{
+}
+
+static struct sparse_storage ram_storage = {
+	.blksz		= BLKSZ,
+	.start		= 0,
+	.size		= TARGET_BLKS,
+	.write		= ram_write,
+	.reserve	= ram_reserve,
+	.erase		= ram_erase,
+	.erase_val	= ERASE_VAL,
+	.erase_grp	= ERASE_GRP,
+	.mssg		= ram_mssg,
+};
+
+/*
+ * Add a chunk to the image at @p and return a pointer to what follows it.
+ * @blkp is the offset in @expected of the chunk's output, and is updated.
+ */
+static u8 *add_chunk(u8 *p, u16 type, u32 chunk_sz, const void *data,
+		     u32 data_len, uint *blkp)
+{
+	chunk_header_t *chunk = (chunk_header_t *)p;
+
+	memset(p, '\0', CHUNK_HDR_SZ);
+	chunk->chunk_type = cpu_to_le16(type);
+	chunk->chunk_sz = cpu_to_le32(chunk_sz);
+	chunk->total_sz = cpu_to_le32(CHUNK_HDR_SZ + data_len);
+	memcpy(p + CHUNK_HDR_SZ, data, data_len);
+	*blkp += chunk_sz * SPARSE_BLKSZ / BLKSZ;
+
+	return p + CHUNK_HDR_SZ + data_len;
+}
+
+/*
+ * Build a sparse image with headers larger than the ones we know about, and
+ * one chunk of each type. Also set up @expected with the output and fill
+ * @target with a pattern that DONT_CARE chunks leave alone.
+ *
+ * @return size of the image in bytes
+ */
+static uint make_image(u8 *img)
+{
+	sparse_header_t *hdr = (sparse_header_t *)img;
+	u8 raw[3 * SPARSE_BLKSZ];
+	u32 fill = cpu_to_le32(FILL_VAL);
+	u32 erase = cpu_to_le32(ERASE_VAL);
+	u32 crc = 0;
+	uint blk = 0;
+	u8 *p;
+	int i;
+
+	memset(target, 0xaa, sizeof(target));
+	memset(expected, 0xaa, sizeof(expected));
+	for (i = 0; i < sizeof(raw); i++)
+		raw[i] = i * 7 + i / 256;
+
+	memset(img, '\0', FILE_HDR_SZ);
+	hdr->magic = cpu_to_le32(SPARSE_HEADER_MAGIC);
+	hdr->major_version = cpu_to_le16(1);
+	hdr->file_hdr_sz = cpu_to_le16(FILE_HDR_SZ);
+	hdr->chunk_hdr_sz = cpu_to_le16(CHUNK_HDR_SZ);
+	hdr->blk_sz = cpu_to_le32(SPARSE_BLKSZ);
+	hdr->total_blks = cpu_to_le32(13);
+	hdr->total_chunks = cpu_to_le32(6);
+	p = img + FILE_HDR_SZ;
+
+	/* Three blocks of data, more than one stream buffer */
+	memcpy(expected + blk * BLKSZ, raw, sizeof(raw));
+	p = add_chunk(p, CHUNK_TYPE_RAW, 3, raw, sizeof(raw), &blk);
+
+	/* A fill which is written */
+	for (i = 0; i < 2 * SPARSE_BLKSZ; i += sizeof(u32))
+		memcpy(expected + blk * BLKSZ + i, &fill, sizeof(u32));
+	p = add_chunk(p, CHUNK_TYPE_FILL, 2, &fill, sizeof(fill), &blk);
+
+	/* A fill which is partly erased: blocks 10-11 and 20-21 are written */
+	memset(expected + blk * BLKSZ, 0xff, 6 * SPARSE_BLKSZ);
+	p = add_chunk(p, CHUNK_TYPE_FILL, 6, &erase, sizeof(erase), &blk);
+
+	p = add_chunk(p, CHUNK_TYPE_DONT_CARE, 1, NULL, 0, &blk);
+	p = add_chunk(p, CHUNK_TYPE_CRC32, 0, &crc, sizeof(crc), &blk);
+
+	/* The last block, from the start of the data again */
+	memcpy(expected + blk * BLKSZ, raw, SPARSE_BLKSZ);
+	p = add_chunk(p, CHUNK_TYPE_RAW, 1, raw, SPARSE_BLKSZ, &blk);
+
+	return p - img;
+}
+
+/*
+ * Send @len bytes of @img to the stream in pieces of @piece bytes, writing
+ * the queued buffer between pieces as the fastboot download does
+ *
+ * @return 0 if OK, -EIO if the stream reported an error (see @ss->err)
+ */
+static int stream_image(struct unit_test_state *uts, struct sparse_stream *ss,
+			const u8 *img, uint len, uint piece)
+{
+	uint pos, n;
+	void *buf;
+	int ret;
+
+	buf = malloc(STREAM_BUF_SIZE);
+	ut_assertnonnull(buf);
+	ut_assertok(sparse_stream_init(ss, &ram_storage, buf,
+				       STREAM_BUF_SIZE));
+	ut_asserteq(SPARSE_BLKSZ, ss->buf_size);
+
+	erased = 0;
+	for (pos = 0, ret = 0; pos < len && !ret; pos += n) {
+		n = min(piece, len - pos);
+		ret = sparse_stream_write(ss, img + pos, n);
+		if (!ret)
+			ret = sparse_stream_flush(ss);
+	}
+	if (!ret)
+		ret = sparse_stream_finish(ss, "test");
+	free(buf);
+
+	return ret;
+}
+
+/* Test that an image is written correctly however it is split up */
+static int lib_test_sparse_stream(struct unit_test_state *uts)
+{
+	/* Pieces which split headers and data at every possible place */
+	static const uint pieces[] = { 1, 3, 7, 13, 100, 511, 1025, 0x10000 };
+	struct sparse_stream ss;
+	u8 *img;
+	uint len;
+	int i;
+
+	img = malloc(0x2000);
+	ut_assertnonnull(img);
+
+	for (i = 0; i < ARRAY_SIZE(pieces); i++) {
+		len = make_image(img);
+		ut_assertok(stream_image(uts, &ss, img, len, pieces[i]));
+		ut_assertnull(ss.err);
+		ut_asserteq(13, ss.total_blocks);
+		ut_asserteq(12 * SPARSE_BLKSZ, ss.bytes_written);
+		ut_asserteq(8, erased);
+		ut_asserteq_mem(expected, target, TARGET_SIZE);
+	}
+	free(img);
+
+	return 0;
+}
+LIB_TEST(lib_test_sparse_stream, 0);
+
+/* Test that a truncated image is reported, wherever it stops */
+static int lib_test_sparse_stream_truncated(struct unit_test_state *uts)
+{
+	struct sparse_stream ss;
+	uint len, cut;
+	u8 *img;
+
+	img = malloc(0x2000);
+	ut_assertnonnull(img);
+	len = make_image(img);
+
+	/* In the file header, a chunk header and the data of a RAW chunk */
+	for (cut = FILE_HDR_SZ - 1; cut < len; cut += 97) {
+		ut_asserteq(-EIO, stream_image(uts, &ss, img, cut, 13));
+		ut_asserteq_str("sparse image is truncated", ss.err);
+	}
+	ut_asserteq(-EIO, stream_image(uts, &ss, img, len - 1, 0x10000));
+	ut_asserteq_str("sparse image is truncated", ss.err);
+
+	/* Anything after the image is refused */
+	img[len] = 0;
+	ut_asserteq(-EIO, stream_image(uts, &ss, img, len + 1, 0x10000));
+	ut_asserteq_str("Data after the end of the image", ss.err);
+	free(img);
+
+	return 0;
+}
+LIB_TEST(lib_test_sparse_stream_truncated, 0);
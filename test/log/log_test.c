@@ -194,6 +194,40 @@ static int log_test(int testnum)
 		log_io("level %d\n", LOGL_DEBUG_IO);
 		break;
 	}
+#ifdef CONFIG_LOG_BUFFER
+	case 11: {
+		/* Write records to the buffer only, for 'log dump' to format */
+		log_buffer_clear();
+		ret = log_add_filter("console", NULL, LOGL_MAX, "nonexistent");
+		if (ret < 0)
+			return ret;
+		log_info("int %d hex %#x str '%s' long %ld\n", -5, 0xabc,
+			 "hello", -1234567890L);
+		log_info("size %zu ll %lld char %c pct %%\n", (size_t)42,
+			 1LL << 40, 'x');
+		log_info("padded '%5d' '%-4s' '%08lx'\n", 12, "ab", 0xbeefUL);
+		log_info("star '%*d'\n", 4, 7);
+		ret = log_remove_filter("console", ret);
+		if (ret < 0)
+			return ret;
+		break;
+	}
+	case 12: {
+		/* Overflow the buffer so that the oldest records are dropped */
+		int i;
+
+		log_buffer_clear();
+		ret = log_add_filter("console", NULL, LOGL_MAX, "nonexistent");
+		if (ret < 0)
+			return ret;
+		for (i = 0; i < 1000; i++)
+			log_info("rec %d\n", i);
+		ret = log_remove_filter("console", ret);
+		if (ret < 0)
+			return ret;
+		break;
+	}
+#endif
 	}
 
 	return 0;
@@ -14,6 +14,7 @@ supported_fs_ext = ['fat16', 'fat32']
 supported_fs_mkdir = ['fat16', 'fat32']
 supported_fs_unlink = ['fat16', 'fat32']
 supported_fs_symlink = ['ext4']
+supported_squashfs_comp = ['gzip', 'lzo', 'lz4', 'zstd']
 
 #
 # Filesystem test specific setup
@@ -50,6 +51,7 @@ def pytest_configure(config):
     global supported_fs_mkdir
     global supported_fs_unlink
     global supported_fs_symlink
+    global supported_squashfs_comp
 
     def intersect(listA, listB):
         return  [x for x in listA if x in listB]
@@ -62,6 +64,8 @@ def pytest_configure(config):
         supported_fs_mkdir =  intersect(supported_fs, supported_fs_mkdir)
         supported_fs_unlink =  intersect(supported_fs, supported_fs_unlink)
         supported_fs_symlink =  intersect(supported_fs, supported_fs_symlink)
+        if 'squashfs' not in supported_fs:
+            supported_squashfs_comp = []
 
 def pytest_generate_tests(metafunc):
     """Parametrize fixtures, fs_obj_xxx
@@ -90,6 +94,9 @@ def pytest_generate_tests(metafunc):
     if 'fs_obj_symlink' in metafunc.fixturenames:
         metafunc.parametrize('fs_obj_symlink', supported_fs_symlink,
             indirect=True, scope='module')
+    if 'fs_obj_squashfs' in metafunc.fixturenames:
+        metafunc.parametrize('fs_obj_squashfs', supported_squashfs_comp,
+            indirect=True, scope='module')
 
 #
 # Helper functions
@@ -600,3 +607,145 @@ def fs_obj_symlink(request, u_boot_config):
         call('rmdir %s' % mount_dir, shell=True)
         if fs_img:
             call('rm -f %s' % fs_img, shell=True)
+
+#
+# Fixture for squashfs test
+#
+@pytest.yield_fixture()
+def fs_obj_squashfs(request, u_boot_config):
+    """Set up a SquashFS image to be used in squashfs test.
+
+    The image is created with mksquashfs, so it is read-only from the start.
+
+    Args:
+        request: Pytest request object.
+        u_boot_config: U-boot configuration.
+
+    Return:
+        A fixture for squashfs test, i.e. a triplet of compressor,
+        image file name and a list of MD5 hashes.
+    """
+    comp = request.param
+    fs_img = ''
+
+    if not u_boot_config.buildconfig.get('config_fs_squashfs', None):
+        pytest.skip('.config feature "FS_SQUASHFS" not enabled')
+    if comp != 'gzip' and not u_boot_config.buildconfig.get(
+            'config_%s' % comp, None):
+        pytest.skip('.config feature "%s" not enabled' % comp.upper())
+    if not tool_is_in_path('mksquashfs'):
+        pytest.skip('mksquashfs not found')
+
+    src_dir = u_boot_config.persistent_data_dir + '/squashfs'
+    small_file = src_dir + '/' + SMALL_FILE
+    fs_img = '%s/squashfs.%s.img' % (u_boot_config.persistent_data_dir, comp)
+
+    try:
+        check_call('rm -rf %s' % src_dir, shell=True)
+        check_call('mkdir -p %s/SUBDIR/MANY' % src_dir, shell=True)
+
+        # Create a small file, which spans several data blocks.
+        check_call('dd if=/dev/urandom of=%s bs=1M count=1'
+                   % small_file, shell=True)
+
+        # Create a file whose tail is stored in a fragment.
+        check_call('dd if=/dev/urandom of=%s/%s bs=1K count=20'
+                   % (src_dir, MIN_FILE), shell=True)
+
+        # Create lots of tiny files, which share fragments.
+        for i in range(SQUASHFS_FILES):
+            check_call('dd if=/dev/urandom of=%s/SUBDIR/MANY/%d bs=%d '
+                       'count=1 2> /dev/null' % (src_dir, i, 100 + i),
+                       shell=True)
+
+        # Create links, one of them relative to a subdirectory.
+        check_call('ln -s %s %s/%s.link' % (SMALL_FILE, src_dir, SMALL_FILE),
+                   shell=True)
+        check_call('ln -s ../%s %s/SUBDIR/%s.link'
+                   % (MIN_FILE, src_dir, MIN_FILE), shell=True)
+
+        check_call('mksquashfs %s %s -noappend -comp %s'
+                   % (src_dir, fs_img, comp), shell=True)
+
+        # Generate the md5sums of reads that we will test against
+        out = check_output('md5sum %s' % small_file, shell=True).decode()
+        md5val = [out.split()[0]]
+        out = check_output('md5sum %s/%s' % (src_dir, MIN_FILE),
+                           shell=True).decode()
+        md5val.append(out.split()[0])
+        # Part of the small file, not aligned to data blocks
+        out = check_output(
+            'dd if=%s bs=1K skip=300 count=500 2> /dev/null | md5sum'
+            % small_file, shell=True).decode()
+        md5val.append(out.split()[0])
+        for i in range(SQUASHFS_FILES):
+            out = check_output('md5sum %s/SUBDIR/MANY/%d' % (src_dir, i),
+                               shell=True).decode()
+            md5val.append(out.split()[0])
+    except CalledProcessError:
+        pytest.skip('Setup failed for squashfs: ' + comp)
+        return
+    else:
+        yield [comp, fs_img, md5val]
+    finally:
+        call('rm -rf %s' % src_dir, shell=True)
+        if fs_img:
+            call('rm -f %s' % fs_img, shell=True)
+
+#
+# Fixture for btrfs benchmark
+#
+@pytest.yield_fixture(scope='module')
+def fs_obj_btrfs_perf(u_boot_config):
+    """Set up a btrfs image to be used in btrfs benchmark.
+
+    Make a btrfs image with a big file and a deep tree of small files.
+
+    Args:
+        u_boot_config: U-boot configuration.
+
+    Return:
+        A tuple of the image file name, the path of the directory of small
+        files and a list of MD5 hashes: the big file, then the small files.
+    """
+    if not u_boot_config.buildconfig.get('config_fs_btrfs', None):
+        pytest.skip('.config feature "FS_BTRFS" not enabled')
+    if not tool_is_in_path('mkfs.btrfs'):
+        pytest.skip('mkfs.btrfs not found')
+
+    src_dir = u_boot_config.persistent_data_dir + '/btrfs_perf'
+    fs_img = u_boot_config.persistent_data_dir + '/btrfs_perf.img'
+    sub_dir = '/'.join(['d%d' % i for i in range(BTRFS_PERF_DEPTH)])
+
+    try:
+        check_call('rm -rf %s' % src_dir, shell=True)
+        check_call('mkdir -p %s/%s' % (src_dir, sub_dir), shell=True)
+        check_call('dd if=/dev/urandom of=%s/%s bs=1M count=32'
+                   % (src_dir, BIG_FILE), shell=True)
+        for i in range(BTRFS_PERF_FILES):
+            check_call('dd if=/dev/urandom of=%s/%s/%d bs=%d count=1 '
+                       '2> /dev/null' % (src_dir, sub_dir, i, 1000 + i * 37),
+                       shell=True)
+
+        check_call('rm -f %s' % fs_img, shell=True)
+        check_call('dd if=/dev/zero of=%s bs=1M count=128' % fs_img,
+                   shell=True)
+        check_call('mkfs.btrfs --rootdir %s %s' % (src_dir, fs_img),
+                   shell=True)
+
+        md5val = []
+        out = check_output('md5sum %s/%s' % (src_dir, BIG_FILE),
+                           shell=True).decode()
+        md5val.append(out.split()[0])
+        for i in range(BTRFS_PERF_FILES):
+            out = check_output('md5sum %s/%s/%d' % (src_dir, sub_dir, i),
+                               shell=True).decode()
+            md5val.append(out.split()[0])
+    except CalledProcessError:
+        pytest.skip('Setup failed for btrfs')
+        return
+    else:
+        yield [fs_img, sub_dir, md5val]
+    finally:
+        call('rm -rf %s' % src_dir, shell=True)
+        call('rm -f %s' % fs_img, shell=True)
@@ -12,5 +12,13 @@ MEDIUM_FILE='10MB.file'
 # $BIG_FILE is the name of the 2.5GB file in the file system image
 BIG_FILE='2.5GB.file'
 
+# $SQUASHFS_FILES is the number of tiny files in the SquashFS image
+SQUASHFS_FILES=64
+
+# $BTRFS_PERF_DEPTH is the depth of the directory of small files in the
+# btrfs benchmark image, which holds $BTRFS_PERF_FILES files
+BTRFS_PERF_DEPTH=8
+BTRFS_PERF_FILES=200
+
 ADDR=0x01000008
 LENGTH=0x00100000
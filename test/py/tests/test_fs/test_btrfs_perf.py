@@ -0,0 +1,68 @@
+# SPDX-License-Identifier:      GPL-2.0+
+#
+# U-Boot File System: btrfs benchmark
+
+"""
+Benchmark path lookups and file reads on a btrfs image, checking that the
+data read is right. The elapsed times are reported in the test log, e.g.:
+
+  ./test/py/test.py --bd sandbox --build -k btrfs_perf -s
+"""
+
+import pytest
+import time
+from fstest_defs import *
+
+# Number of times each path is looked up
+LOOPS = 50
+
+def run_timed(u_boot_console, name, count, cmd):
+    """Run a command and log how long it took."""
+
+    tstart = time.time()
+    response = u_boot_console.run_command(cmd)
+    elapsed = time.time() - tstart
+    u_boot_console.log.info('%s: %d iterations took %f seconds' %
+                            (name, count, elapsed))
+    return response
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.buildconfigspec('cmd_setexpr')
+@pytest.mark.slow
+class TestBtrfsPerf(object):
+    def test_btrfs_perf_lookup(self, u_boot_console, fs_obj_btrfs_perf):
+        """Time repeated lookups of a file deep in the tree."""
+
+        fs_img, sub_dir, md5val = fs_obj_btrfs_perf
+        u_boot_console.run_command('host bind 0 %s' % fs_img)
+        u_boot_console.run_command('setenv i 0')
+        response = run_timed(u_boot_console, 'btrfs size', LOOPS,
+            'while itest ${i} < %x; do size host 0:0 /%s/0; '
+            'setexpr i ${i} + 1; done; printenv filesize' % (LOOPS, sub_dir))
+        assert 'filesize=3e8' in response
+        u_boot_console.run_command('setenv i')
+
+    def test_btrfs_perf_small(self, u_boot_console, fs_obj_btrfs_perf):
+        """Time reading all the small files."""
+
+        fs_img, sub_dir, md5val = fs_obj_btrfs_perf
+        u_boot_console.run_command('host bind 0 %s' % fs_img)
+        tstart = time.time()
+        for i in range(BTRFS_PERF_FILES):
+            output = u_boot_console.run_command_list([
+                'load host 0:0 %x /%s/%d' % (ADDR, sub_dir, i),
+                'md5sum %x $filesize' % ADDR])
+            assert md5val[1 + i] in ''.join(output)
+        elapsed = time.time() - tstart
+        u_boot_console.log.info('btrfs small files: %d files took %f seconds'
+                                % (BTRFS_PERF_FILES, elapsed))
+
+    def test_btrfs_perf_big(self, u_boot_console, fs_obj_btrfs_perf):
+        """Time reading a big file."""
+
+        fs_img, sub_dir, md5val = fs_obj_btrfs_perf
+        u_boot_console.run_command('host bind 0 %s' % fs_img)
+        run_timed(u_boot_console, 'btrfs big file', 1,
+                  'load host 0:0 %x /%s' % (ADDR, BIG_FILE))
+        output = u_boot_console.run_command('md5sum %x $filesize' % ADDR)
+        assert md5val[0] in output
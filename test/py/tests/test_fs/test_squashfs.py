@@ -0,0 +1,132 @@
+# SPDX-License-Identifier:      GPL-2.0+
+#
+# U-Boot File System: SquashFS Test
+
+"""
+This test verifies reading from read-only SquashFS images, made with each of
+the supported compressors.
+"""
+
+import pytest
+import re
+from fstest_defs import *
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.slow
+class TestSquashfs(object):
+    def test_squashfs1(self, u_boot_console, fs_obj_squashfs):
+        """
+        Test Case 1 - ls and size
+        """
+        comp, fs_img, md5val = fs_obj_squashfs
+        with u_boot_console.log.section('Test Case 1 - ls'):
+            output = u_boot_console.run_command_list([
+                'host bind 0 %s' % fs_img,
+                'ls host 0:0 /'])
+            out = ''.join(output)
+            assert(re.search('1048576 +%s' % SMALL_FILE, out))
+            assert(re.search('20480 +%s' % MIN_FILE, out))
+            assert('SUBDIR/' in out)
+            assert('3 file(s), 1 dir(s)' in out)
+
+            output = u_boot_console.run_command(
+                'ls host 0:0 /SUBDIR/MANY')
+            assert('%d file(s), 0 dir(s)' % SQUASHFS_FILES in output)
+
+        with u_boot_console.log.section('Test Case 1b - size'):
+            output = u_boot_console.run_command_list([
+                'size host 0:0 /%s' % SMALL_FILE,
+                'printenv filesize'])
+            assert('filesize=100000' in ''.join(output))
+
+    def test_squashfs2(self, u_boot_console, fs_obj_squashfs):
+        """
+        Test Case 2 - load whole files
+        """
+        comp, fs_img, md5val = fs_obj_squashfs
+        with u_boot_console.log.section('Test Case 2a - load data blocks'):
+            output = u_boot_console.run_command_list([
+                'host bind 0 %s' % fs_img,
+                'load host 0:0 %x /%s' % (ADDR, SMALL_FILE),
+                'md5sum %x $filesize' % ADDR,
+                'setenv filesize'])
+            assert(md5val[0] in ''.join(output))
+
+        with u_boot_console.log.section('Test Case 2b - load with fragment'):
+            output = u_boot_console.run_command_list([
+                'load host 0:0 %x /%s' % (ADDR, MIN_FILE),
+                'printenv filesize',
+                'md5sum %x $filesize' % ADDR,
+                'setenv filesize'])
+            assert('filesize=5000' in ''.join(output))
+            assert(md5val[1] in ''.join(output))
+
+    def test_squashfs3(self, u_boot_console, fs_obj_squashfs):
+        """
+        Test Case 3 - load part of a file
+        """
+        comp, fs_img, md5val = fs_obj_squashfs
+        with u_boot_console.log.section('Test Case 3 - load with offset'):
+            output = u_boot_console.run_command_list([
+                'host bind 0 %s' % fs_img,
+                'load host 0:0 %x /%s 7d000 4b000' % (ADDR, SMALL_FILE),
+                'md5sum %x $filesize' % ADDR,
+                'setenv filesize'])
+            assert(md5val[2] in ''.join(output))
+
+    def test_squashfs4(self, u_boot_console, fs_obj_squashfs):
+        """
+        Test Case 4 - load lots of tiny files sharing fragments
+        """
+        comp, fs_img, md5val = fs_obj_squashfs
+        with u_boot_console.log.section('Test Case 4 - load tiny files'):
+            u_boot_console.run_command('host bind 0 %s' % fs_img)
+            for i in range(SQUASHFS_FILES):
+                output = u_boot_console.run_command_list([
+                    'load host 0:0 %x /SUBDIR/MANY/%d' % (ADDR, i),
+                    'md5sum %x $filesize' % ADDR,
+                    'setenv filesize'])
+                assert(md5val[3 + i] in ''.join(output))
+
+    def test_squashfs5(self, u_boot_console, fs_obj_squashfs):
+        """
+        Test Case 5 - follow links and ..
+        """
+        comp, fs_img, md5val = fs_obj_squashfs
+        with u_boot_console.log.section('Test Case 5a - load via link'):
+            output = u_boot_console.run_command_list([
+                'host bind 0 %s' % fs_img,
+                'load host 0:0 %x /%s.link' % (ADDR, SMALL_FILE),
+                'md5sum %x $filesize' % ADDR,
+                'setenv filesize'])
+            assert(md5val[0] in ''.join(output))
+
+        with u_boot_console.log.section('Test Case 5b - relative link'):
+            output = u_boot_console.run_command_list([
+                'load host 0:0 %x /SUBDIR/%s.link' % (ADDR, MIN_FILE),
+                'md5sum %x $filesize' % ADDR,
+                'setenv filesize'])
+            assert(md5val[1] in ''.join(output))
+
+        with u_boot_console.log.section('Test Case 5c - load via ..'):
+            output = u_boot_console.run_command_list([
+                'load host 0:0 %x /SUBDIR/MANY/../../%s' % (ADDR, MIN_FILE),
+                'md5sum %x $filesize' % ADDR,
+                'setenv filesize'])
+            assert(md5val[1] in ''.join(output))
+
+        with u_boot_console.log.section('Test Case 5d - missing file'):
+            output = u_boot_console.run_command(
+                'load host 0:0 %x /SUBDIR/nofile' % ADDR)
+            assert('Unable to read file' in output)
+
+    def test_squashfs6(self, u_boot_console, fs_obj_squashfs):
+        """
+        Test Case 6 - writing is refused
+        """
+        comp, fs_img, md5val = fs_obj_squashfs
+        with u_boot_console.log.section('Test Case 6 - save'):
+            output = u_boot_console.run_command_list([
+                'host bind 0 %s' % fs_img,
+                'save host 0:0 %x /newfile 100' % ADDR])
+            assert('Unable to write' in ''.join(output))
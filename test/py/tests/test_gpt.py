@@ -157,6 +157,28 @@ def test_gpt_swap_partitions(state_disk_image, u_boot_console):
     assert '0x00000800	0x00000fff	"second"' in output
     assert '0x00001000	0x00001bff	"first"' in output
 
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.buildconfigspec('cmd_gpt')
+@pytest.mark.buildconfigspec('cmd_gpt_rename')
+@pytest.mark.buildconfigspec('cmd_part')
+@pytest.mark.requiredtool('sgdisk')
+def test_gpt_part_lookup(state_disk_image, u_boot_console):
+    """Test that looking up partitions by name follows changes to the GPT."""
+
+    u_boot_console.run_command('host bind 0 ' + state_disk_image.path)
+    output = u_boot_console.run_command('part number host 0 first')
+    assert output == '0x2'
+    output = u_boot_console.run_command('part start host 0 second')
+    assert output == '800'
+    u_boot_console.run_command('gpt rename host 0 2 third')
+    output = u_boot_console.run_command('part number host 0 third')
+    assert output == '0x2'
+    output = u_boot_console.run_command('part number host 0 first')
+    assert output == ''
+    u_boot_console.run_command('gpt rename host 0 2 first')
+    output = u_boot_console.run_command('part number host 0 first')
+    assert output == '0x2'
+
 @pytest.mark.boardspec('sandbox')
 @pytest.mark.buildconfigspec('cmd_gpt')
 @pytest.mark.buildconfigspec('cmd_part')
@@ -0,0 +1,57 @@
+# SPDX-License-Identifier: GPL-2.0+
+
+# Benchmark command lookup and parsing in scripted loops. This is mainly of
+# use on sandbox, where the elapsed time is reported in the test log, e.g.:
+#
+#   ./test/py/test.py --bd sandbox --build -k hush_perf -s
+
+import pytest
+import time
+
+pytestmark = pytest.mark.buildconfigspec('hush_parser')
+
+# Number of iterations of the while loop
+LOOPS = 500
+
+# Number of words in the for loop, limited by the command-line length
+WORDS = 100
+
+def run_timed(u_boot_console, name, count, cmd):
+    """Run a command and log how long it took."""
+
+    tstart = time.time()
+    response = u_boot_console.run_command(cmd)
+    elapsed = time.time() - tstart
+    u_boot_console.log.info('%s: %d iterations took %f seconds' %
+                            (name, count, elapsed))
+    return response
+
+@pytest.mark.buildconfigspec('cmd_setexpr')
+def test_hush_perf_loop(u_boot_console):
+    """Time a while loop which runs a script on each iteration."""
+
+    u_boot_console.run_command('setenv i 0')
+    u_boot_console.run_command(
+        "setenv body 'setexpr i ${i} + 1; true; true; true'")
+    # setexpr and itest work in hexadecimal
+    run_timed(u_boot_console, 'while/run', LOOPS,
+              'while itest ${i} < %x; do run body; done' % LOOPS)
+    response = u_boot_console.run_command('echo ${i}')
+    assert response == '%x' % LOOPS
+    u_boot_console.run_command('setenv body; setenv i')
+
+def test_hush_perf_for(u_boot_console):
+    """Time a for loop over a list of words."""
+
+    words = ' '.join(['w%d' % i for i in range(WORDS)])
+    u_boot_console.run_command("setenv body 'true; false || true'")
+    response = run_timed(u_boot_console, 'for/run', WORDS,
+                         'for w in %s; do run body; done; echo done' % words)
+    assert response == 'done'
+    u_boot_console.run_command('setenv body')
+
+def test_hush_perf_abbrev(u_boot_console):
+    """Check that unique abbreviations of commands still work."""
+
+    response = u_boot_console.run_command('versio')
+    assert 'U-Boot' in response
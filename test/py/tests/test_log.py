@@ -130,3 +130,37 @@ def test_log_format(u_boot_console):
         run_with_format('FLfm', 'file.c:123-func() msg')
         run_with_format('lm', 'NOTICE. msg')
         run_with_format('m', 'msg')
+
+@pytest.mark.buildconfigspec('log_buffer')
+def test_log_buffer(u_boot_console):
+    """Test that records in the log buffer are formatted correctly"""
+    cons = u_boot_console
+    with cons.log.section('buffer'):
+        output = cons.run_command('log test 11')
+        assert output == 'test 11'
+        output = cons.run_command('log dump')
+        lines = output.replace('\r', '').splitlines()
+        assert lines == [
+            "log_test() int -5 hex 0xabc str 'hello' long -1234567890",
+            'log_test() size 42 ll 1099511627776 char x pct %',
+            "log_test() padded '   12' 'ab  ' '0000beef'",
+            "log_test() star '   7'",
+        ]
+
+        output = cons.run_command('log test 12')
+        assert output == 'test 12'
+        output = cons.run_command('log dump 2')
+        lines = output.replace('\r', '').splitlines()
+        assert lines == ['log_test() rec 998', 'log_test() rec 999']
+        output = cons.run_command('log dump')
+        assert output.startswith('(')
+        assert 'older records dropped' in output
+
+        # The names given to 'log rec' are gone once it returns, so they must
+        # be copied into the record
+        cons.run_command('log format FLfm')
+        cons.run_command('log rec arch notice file.c 123 func msg')
+        cons.run_command('echo xxxxxxxxxxxxxxxxxxxx yyyyyyyyyyyyyyyyyy')
+        output = cons.run_command('log dump 1')
+        assert output.replace('\r', '') == 'file.c:123-func() msg'
+        cons.run_command('log format default')
@@ -34,3 +34,29 @@ def test_md_repeat(u_boot_console):
     response = u_boot_console.run_command('')
     expected_response = addr_repeat + ': '
     assert(expected_response in response)
+
+@pytest.mark.buildconfigspec('cmd_memory')
+def test_cp_cmp(u_boot_console):
+    """Test that cp and cmp work on ranges larger than the chunks they handle
+    at a time, and that cmp finds the first difference."""
+
+    ram_base = u_boot_utils.find_ram_base(u_boot_console)
+    src = ram_base
+    dst = ram_base + 0x400000
+    words = 0xc0003
+    val = 'a5f09876'
+    u_boot_console.run_command('mw %08x %s %x' % (src, val, words))
+    response = u_boot_console.run_command('cp %08x %08x %x' %
+                                          (src, dst, words))
+    assert('%d bytes copied' % (words * 4) in response)
+    response = u_boot_console.run_command('cmp %08x %08x %x' %
+                                          (src, dst, words))
+    assert('Total of %d word(s) were the same' % words in response)
+
+    # Change a word in the third chunk
+    offset = 0x234568
+    u_boot_console.run_command('mw %08x 0' % (dst + offset))
+    response = u_boot_console.run_command('cmp %08x %08x %x' %
+                                          (src, dst, words))
+    assert('(0x%s) != word' % val in response)
+    assert('Total of %d word(s) were the same' % (offset // 4) in response)
@@ -15,6 +15,12 @@ def test_ut_dm_init(u_boot_console):
         with open(fn, 'wb') as fh:
             fh.write(data)
 
+    fn = u_boot_console.config.source_dir + '/testflash2.bin'
+    if not os.path.exists(fn):
+        data = b''.join(bytes([i % 251]) * 512 for i in range(2048))
+        with open(fn, 'wb') as fh:
+            fh.write(data)
+
     fn = u_boot_console.config.source_dir + '/spi.bin'
     if not os.path.exists(fn):
         data = b'\x00' * (2 * 1024 * 1024)
@@ -13,7 +13,10 @@ static data.
 
 import collections
 import copy
+import os
+import re
 import sys
+import zlib
 
 import fdt
 import fdt_util
@@ -45,6 +48,35 @@ TYPE_NAMES = {
 STRUCT_PREFIX = 'dtd_'
 VAL_PREFIX = 'dtv_'
 
+# Nodes which are not devices themselves but whose subnodes are scanned by
+# driver model as if they were in the parent (see dm_scan_fdt_node())
+BIND_TRANSPARENT_NODES = ['chosen', 'firmware']
+
+# Properties which cause a node to be bound before relocation in U-Boot proper
+# (see dm_ofnode_pre_reloc())
+BIND_PRE_RELOC_PROPS = [
+    'u-boot,dm-pre-reloc',
+    'u-boot,dm-pre-proper',
+    'u-boot,dm-spl',
+    'u-boot,dm-tpl',
+]
+
+RE_UDEVICE_ID = re.compile(
+    r'struct\s+udevice_id\s+(\w+)\s*\[\s*\]\s*=\s*{(.*?)}\s*;', re.S)
+RE_COMPATIBLE = re.compile(r'\.compatible\s*=\s*"([^"]+)"')
+RE_DRIVER = re.compile(r'U_BOOT_DRIVER\s*\(\s*\w+\s*\)\s*=\s*{(.*?)\n}\s*;',
+                       re.S)
+RE_DRIVER_NAME = re.compile(r'\.name\s*=\s*"([^"]+)"')
+RE_DRIVER_OF_MATCH = re.compile(r'\.of_match\s*=\s*(\w+)')
+
+# A line in a Makefile which adds objects, e.g. 'obj-$(CONFIG_FOO) += foo.o'
+# or 'foo-y := bar.o', giving the variable prefix, condition and objects
+RE_MAKE_OBJS = re.compile(
+    r'^([\w-]+?)-(y|objs|\$\(CONFIG_[\w$()]+\))\s*[:+]?=(.*)$')
+
+# Makefile variables which are empty when building U-Boot proper
+MAKE_PHASE_VARS = ['$(SPL_)', '$(SPL_TPL_)']
+
 # This holds information about a property which includes phandles.
 #
 # max_args: integer: Maximum number or arguments that any phandle uses (int).
@@ -125,6 +157,27 @@ def get_compat_name(node):
         compat, aliases = compat[0], compat[1:]
     return conv_name_to_c(compat), [conv_name_to_c(a) for a in aliases]
 
+def read_config(fname):
+    """Read the CONFIG options from a build's auto.conf file
+
+    Args:
+        fname: Filename to read, e.g. 'include/config/auto.conf'
+    Return:
+        Dict of option values, keyed by name (e.g. 'CONFIG_DM'). String
+            values have their quotes removed
+    """
+    config = {}
+    with open(fname) as infile:
+        for line in infile:
+            line = line.strip()
+            if not line.startswith('CONFIG_') or '=' not in line:
+                continue
+            name, value = line.split('=', 1)
+            if len(value) >= 2 and value[0] == '"' and value[-1] == '"':
+                value = value[1:-1]
+            config[name] = value
+    return config
+
 
 class DtbPlatdata(object):
     """Provide a means to convert device tree binary data to platform data
@@ -138,17 +191,32 @@ class DtbPlatdata(object):
         _dtb_fname: Filename of the input device tree binary file
         _valid_nodes: A list of Node object with compatible strings
         _include_disabled: true to include nodes marked status = "disabled"
+        _src_dir: Root of the U-Boot source tree, or None if not known
+        _config: Dict of CONFIG options from the build's auto.conf, keyed by
+            name, or None to scan drivers regardless of the configuration
+        _make_objs: Dict of parsed Makefiles, keyed by directory, each a
+            dict mapping an object or subdirectory to a list of
+            (prefix, enabled) tuples
         _outfile: The current output file (sys.stdout or a real file)
         _lines: Stashed list of output lines for outputting in the future
+        _compat_to_driver: Dict mapping compatible strings to driver names,
+            or None if the source tree has not been scanned yet
     """
-    def __init__(self, dtb_fname, include_disabled):
+    def __init__(self, dtb_fname, include_disabled, src_dir=None,
+                 config_fname=None):
         self._fdt = None
         self._dtb_fname = dtb_fname
         self._valid_nodes = None
         self._include_disabled = include_disabled
+        self._src_dir = src_dir
+        self._config = None
+        if config_fname:
+            self._config = read_config(config_fname)
+        self._make_objs = {}
         self._outfile = None
         self._lines = []
         self._aliases = {}
+        self._compat_to_driver = None
 
     def setup_output(self, fname):
         """Set up the output destination
@@ -548,8 +616,228 @@ class DtbPlatdata(object):
             self.output_node(node)
             nodes_to_output.remove(node)
 
+    def get_make_objs(self, dirpath):
+        """Read the objects and subdirectories added by a Makefile
+
+        Only simple assignments such as 'obj-$(CONFIG_FOO) += foo.o' are
+        understood. Conditions inside the Makefile (ifdef, etc.) are ignored.
+
+        Args:
+            dirpath: Directory containing the Makefile
+        Return:
+            Dict keyed by object (e.g. 'foo.o') or subdirectory (e.g. 'foo/'),
+                each a list of (prefix, enabled) tuples, where prefix is the
+                variable prefix (e.g. 'obj') and enabled is True if the
+                condition is enabled in the configuration
+        """
+        if dirpath in self._make_objs:
+            return self._make_objs[dirpath]
+        objs = collections.defaultdict(list)
+        fname = os.path.join(dirpath, 'Makefile')
+        if os.path.exists(fname):
+            with open(fname) as infile:
+                data = infile.read().replace('\\\n', ' ')
+            for line in data.splitlines():
+                match = RE_MAKE_OBJS.match(line.split('#')[0].strip())
+                if not match:
+                    continue
+                prefix, cond, values = match.groups()
+                if cond in ['y', 'objs']:
+                    enabled = True
+                else:
+                    for var in MAKE_PHASE_VARS:
+                        cond = cond.replace(var, '')
+                    enabled = self._config.get(cond[2:-1]) == 'y'
+                for value in values.split():
+                    objs[value].append((prefix, enabled))
+        self._make_objs[dirpath] = objs
+        return objs
+
+    def is_built(self, dirpath, target):
+        """Check whether an object or directory is built for U-Boot proper
+
+        This follows the Makefiles up the source tree, so a driver is only
+        built if its own option and those of the directories above it are
+        enabled. A directory is also built if the top-level Makefile adds it
+        to libs-y. One which is not mentioned in its parent's Makefile is
+        assumed to be added elsewhere, e.g. by the architecture's Makefile.
+
+        Args:
+            dirpath: Directory containing the target
+            target: Object (e.g. 'foo.o') or subdirectory (e.g. 'foo/')
+        Return:
+            True if the target is built, False if not
+        """
+        if os.path.samefile(dirpath, self._src_dir):
+            return True
+        if target.endswith('/'):
+            # The top-level Makefile adds many directories itself
+            path = os.path.relpath(os.path.join(dirpath, target),
+                                   self._src_dir) + '/'
+            rules = self.get_make_objs(self._src_dir).get(path, [])
+            if any(enabled for _, enabled in rules):
+                return True
+        parent, name = os.path.split(os.path.normpath(dirpath))
+        rules = self.get_make_objs(dirpath).get(target)
+        if rules is None:
+            return target.endswith('/') and self.is_built(parent, name + '/')
+        for prefix, enabled in rules:
+            if not enabled:
+                continue
+            if prefix in ['obj', 'lib']:
+                if self.is_built(parent, name + '/'):
+                    return True
+            elif prefix + '.o' != target:
+                # Part of a composite object, e.g. 'foo-y += foo-core.o'
+                if self.is_built(dirpath, prefix + '.o'):
+                    return True
+        return False
+
+    def scan_drivers(self):
+        """Scan the source tree for drivers and their compatible strings
+
+        This is a best-effort scan of the C source. If the build
+        configuration is known, only drivers which the Makefiles build for
+        U-Boot proper are considered, and only the architecture and board
+        directories in use are scanned. A compatible string which is claimed
+        by more than one driver is not resolved, so that driver model can
+        make the decision at run time.
+
+        This fills in self._compat_to_driver, a dict keyed by compatible
+        string, containing the name of the driver, or None if ambiguous.
+        """
+        self._compat_to_driver = {}
+        if not self._src_dir:
+            return
+        keep = {}
+        if self._config is not None:
+            keep['arch'] = [self._config.get('CONFIG_SYS_ARCH')]
+            keep['board'] = [self._config.get('CONFIG_SYS_VENDOR') or
+                             self._config.get('CONFIG_SYS_BOARD')]
+        for dirpath, dirnames, filenames in os.walk(self._src_dir):
+            dirnames[:] = [name for name in dirnames
+                           if name not in ['tools', 'test', 'scripts'] and
+                           not name.startswith('.')]
+            top = os.path.relpath(dirpath, self._src_dir)
+            if top in keep:
+                dirnames[:] = [name for name in dirnames if name in keep[top]]
+            for fname in filenames:
+                if not fname.endswith('.c'):
+                    continue
+                with open(os.path.join(dirpath, fname), 'rb') as infile:
+                    data = infile.read().decode('utf-8', errors='ignore')
+                if 'U_BOOT_DRIVER' not in data:
+                    continue
+                if (self._config is not None and
+                        not self.is_built(dirpath, fname[:-2] + '.o')):
+                    continue
+                ids = {}
+                for match in RE_UDEVICE_ID.finditer(data):
+                    ids[match.group(1)] = RE_COMPATIBLE.findall(
+                        match.group(2))
+                for match in RE_DRIVER.finditer(data):
+                    name = RE_DRIVER_NAME.search(match.group(1))
+                    of_match = RE_DRIVER_OF_MATCH.search(match.group(1))
+                    if not name or not of_match:
+                        continue
+                    for compat in ids.get(of_match.group(1), []):
+                        if compat in self._compat_to_driver:
+                            if self._compat_to_driver[compat] != name.group(1):
+                                self._compat_to_driver[compat] = None
+                        else:
+                            self._compat_to_driver[compat] = name.group(1)
+
+    def get_bind_driver(self, node):
+        """Work out which driver binds to a node
+
+        Args:
+            node: Node object to check
+        Return:
+            Tuple:
+                Name of driver, or None if not known
+                Compatible string which matched, or None if not known
+        """
+        compat_list = node.props['compatible'].value
+        if not isinstance(compat_list, list):
+            compat_list = [compat_list]
+        for compat in compat_list:
+            if compat in self._compat_to_driver:
+                drv_name = self._compat_to_driver[compat]
+                if not drv_name:
+                    break
+                return drv_name, compat
+        return None, None
+
+    def scan_bind_node(self, parent, node, entries):
+        """Add bind entries for the subnodes that driver model scans
+
+        This mirrors the behaviour of dm_scan_fdt_node().
+
+        Args:
+            parent: Node whose subnodes are scanned
+            node: Node to scan, either @parent or a transparent subnode
+            entries: List of (parent, node) tuples to add to
+        """
+        for subnode in node.subnodes:
+            if subnode.name in BIND_TRANSPARENT_NODES:
+                self.scan_bind_node(parent, subnode, entries)
+                continue
+            status = subnode.props.get('status')
+            if status and status.value not in ['okay', 'ok']:
+                continue
+            if 'compatible' in subnode.props:
+                entries.append((parent, subnode))
+
+    def generate_bind(self):
+        """Generate a table of pre-resolved bindings for U-Boot proper
+
+        This writes out a dm_bind_table holding the nodes which driver model
+        would bind from each node in the device tree, along with the driver
+        which matches each one. The table is sorted by parent offset, so that
+        driver model can find the subnodes of a node with a binary search. It
+        is only used if the CRC32 of the device tree matches at run time.
+
+        See the documentation in doc/driver-model/of-plat.rst for more
+        information.
+        """
+        if self._compat_to_driver is None:
+            self.scan_drivers()
+        entries = []
+        nodes = [self._fdt.GetRoot()]
+        while nodes:
+            node = nodes.pop(0)
+            self.scan_bind_node(node, node, entries)
+            nodes += node.subnodes
+        entries.sort(key=lambda entry: entry[0].Offset())
+
+        data = tools.ReadFile(self._dtb_fname)
+        self.out_header()
+        self.out('#include <common.h>\n')
+        self.out('#include <dm.h>\n')
+        self.out('\n')
+        self.out('static const struct dm_bind_node dm_bind_nodes[] = {\n')
+        for parent, node in entries:
+            drv_name, compat = self.get_bind_driver(node)
+            pre_reloc = any(prop in node.props for prop in BIND_PRE_RELOC_PROPS)
+            self.out('\t/* %s */\n' % node.path)
+            self.out('\t{%#x, %#x, ' % (node.Offset(), parent.Offset()))
+            if drv_name:
+                self.out('"%s", "%s", ' % (drv_name, compat))
+            else:
+                self.out('NULL, NULL, ')
+            self.out('%s},\n' % ('true' if pre_reloc else 'false'))
+        self.out('};\n')
+        self.out('\n')
+        self.out('const struct dm_bind_table dm_bind_table = {\n')
+        self.out('\t.fdt_size\t= %#x,\n' % len(data))
+        self.out('\t.fdt_crc32\t= %#x,\n' % (zlib.crc32(data) & 0xffffffff))
+        self.out('\t.count\t\t= ARRAY_SIZE(dm_bind_nodes),\n')
+        self.out('\t.nodes\t\t= dm_bind_nodes,\n')
+        self.out('};\n')
+
 
-def run_steps(args, dtb_file, include_disabled, output):
+def run_steps(args, dtb_file, include_disabled, output, src_dir=None,
+              config_fname=None):
     """Run all the steps of the dtoc tool
 
     Args:
@@ -557,11 +845,15 @@ def run_steps(args, dtb_file, include_disabled, output):
         dtb_file: Filename of dtb file to process
         include_disabled: True to include disabled nodes
         output: Name of output file
+        src_dir: Root of the U-Boot source tree, used by the 'bind' command to
+            find drivers, or None to leave all drivers unresolved
+        config_fname: Build's auto.conf file, used by the 'bind' command to
+            skip drivers which are not enabled, or None to use all drivers
     """
     if not args:
-        raise ValueError('Please specify a command: struct, platdata')
+        raise ValueError('Please specify a command: struct, platdata, bind')
 
-    plat = DtbPlatdata(dtb_file, include_disabled)
+    plat = DtbPlatdata(dtb_file, include_disabled, src_dir, config_fname)
     plat.scan_dtb()
     plat.scan_tree()
     plat.scan_reg_sizes()
@@ -574,6 +866,8 @@ def run_steps(args, dtb_file, include_disabled, output):
             plat.generate_structs(structs)
         elif cmd == 'platdata':
             plat.generate_tables()
+        elif cmd == 'bind':
+            plat.generate_bind()
         else:
-            raise ValueError("Unknown command '%s': (use: struct, platdata)" %
-                             cmd)
+            raise ValueError("Unknown command '%s': (use: struct, platdata, "
+                             "bind)" % cmd)
@@ -15,6 +15,7 @@ import collections
 import os
 import struct
 import unittest
+import zlib
 
 import dtb_platdata
 from dtb_platdata import conv_name_to_c
@@ -709,5 +710,135 @@ U_BOOT_DEVICE(spl_test2) = {
         output = tools.GetOutputFilename('output')
         with self.assertRaises(ValueError) as e:
             dtb_platdata.run_steps(['invalid-cmd'], dtb_file, False, output)
-        self.assertIn("Unknown command 'invalid-cmd': (use: struct, platdata)",
-                      str(e.exception))
+        self.assertIn("Unknown command 'invalid-cmd': (use: struct, platdata, "
+                      "bind)", str(e.exception))
+
+    def test_bind(self):
+        """Test output of the bind table for U-Boot proper"""
+        dtb_file = get_dtb_file('dtoc_test_bind.dts')
+        src_dir = tools.GetOutputFilename('src')
+        os.makedirs(os.path.join(src_dir, 'drivers'))
+        tools.WriteFile(os.path.join(src_dir, 'drivers', 'drv.c'), b'''
+static const struct udevice_id bind_test_ids[] = {
+	{ .compatible = "sandbox,bind-test" },
+	{ .compatible = "sandbox,bind-shared" },
+	{ }
+};
+
+U_BOOT_DRIVER(bind_test) = {
+	.name	= "bind_test_drv",
+	.of_match = bind_test_ids,
+};
+
+static const struct udevice_id other_ids[] = {
+	{ .compatible = "sandbox,bind-shared", .data = 1 },
+	{ }
+};
+
+U_BOOT_DRIVER(other) = {
+	.name	= "other_drv",
+	.of_match = other_ids,
+};
+''')
+        output = tools.GetOutputFilename('output')
+        dtb_platdata.run_steps(['bind'], dtb_file, False, output, src_dir)
+        with open(output) as infile:
+            data = infile.read()
+
+        dtb = fdt.FdtScan(dtb_file)
+        root = dtb.GetNode('/').Offset()
+        first = dtb.GetNode('/first').Offset()
+        in_chosen = dtb.GetNode('/chosen/in-chosen').Offset()
+        sub = dtb.GetNode('/first/sub').Offset()
+        contents = tools.ReadFile(dtb_file)
+        self._CheckStrings(C_HEADER.replace('#include <dt-structs.h>\n', '') +
+                           '''
+static const struct dm_bind_node dm_bind_nodes[] = {
+\t/* /chosen/in-chosen */
+\t{%#x, %#x, "bind_test_drv", "sandbox,bind-test", false},
+\t/* /first */
+\t{%#x, %#x, "bind_test_drv", "sandbox,bind-test", true},
+\t/* /chosen/in-chosen */
+\t{%#x, %#x, "bind_test_drv", "sandbox,bind-test", false},
+\t/* /first/sub */
+\t{%#x, %#x, NULL, NULL, false},
+};
+
+const struct dm_bind_table dm_bind_table = {
+\t.fdt_size\t= %#x,
+\t.fdt_crc32\t= %#x,
+\t.count\t\t= ARRAY_SIZE(dm_bind_nodes),
+\t.nodes\t\t= dm_bind_nodes,
+};
+''' % (in_chosen, root, first, root,
+       in_chosen, dtb.GetNode('/chosen').Offset(), sub, first,
+       len(contents), zlib.crc32(contents) & 0xffffffff), data)
+
+    def test_bind_config(self):
+        """Test that the bind table only uses drivers which are built"""
+        dtb_file = get_dtb_file('dtoc_test_bind.dts')
+        src_dir = tools.GetOutputFilename('src_config')
+        os.makedirs(os.path.join(src_dir, 'drivers', 'other'))
+        os.makedirs(os.path.join(src_dir, 'arch', 'arm'))
+        tools.WriteFile(os.path.join(src_dir, 'drivers', 'Makefile'), b'''
+obj-$(CONFIG_BIND_TEST) += drv.o
+obj-$(CONFIG_$(SPL_)OTHER) += \\
+	other/
+''')
+        tools.WriteFile(os.path.join(src_dir, 'drivers', 'drv.c'), b'''
+static const struct udevice_id bind_test_ids[] = {
+	{ .compatible = "sandbox,bind-test" },
+	{ .compatible = "sandbox,bind-shared" },
+	{ }
+};
+
+U_BOOT_DRIVER(bind_test) = {
+	.name	= "bind_test_drv",
+	.of_match = bind_test_ids,
+};
+''')
+        tools.WriteFile(os.path.join(src_dir, 'drivers', 'other', 'Makefile'),
+                        b'other-y := other-core.o\nobj-y += other.o\n')
+        other = b'''
+static const struct udevice_id other_ids[] = {
+	{ .compatible = "sandbox,bind-shared" },
+	{ }
+};
+
+U_BOOT_DRIVER(other) = {
+	.name	= "other_drv",
+	.of_match = other_ids,
+};
+'''
+        tools.WriteFile(os.path.join(src_dir, 'drivers', 'other',
+                                     'other-core.c'), other)
+        tools.WriteFile(os.path.join(src_dir, 'arch', 'arm', 'arm.c'),
+                        other.replace(b'"other_drv"', b'"arm_drv"'))
+
+        # The other driver is not enabled, so does not make the match
+        # ambiguous. The arm driver is ignored since this is a sandbox build
+        config = tools.GetOutputFilename('auto.conf')
+        tools.WriteFile(config, b'CONFIG_BIND_TEST=y\n'
+                        b'CONFIG_SYS_ARCH="sandbox"\n')
+        plat = dtb_platdata.DtbPlatdata(dtb_file, False, src_dir, config)
+        plat.scan_drivers()
+        self.assertEqual({'sandbox,bind-test': 'bind_test_drv',
+                          'sandbox,bind-shared': 'bind_test_drv'},
+                         plat._compat_to_driver)
+
+        # Once it is enabled, the shared compatible string is left to
+        # driver model
+        tools.WriteFile(config, b'CONFIG_BIND_TEST=y\nCONFIG_OTHER=y\n'
+                        b'CONFIG_SYS_ARCH="sandbox"\n')
+        plat = dtb_platdata.DtbPlatdata(dtb_file, False, src_dir, config)
+        plat.scan_drivers()
+        self.assertEqual({'sandbox,bind-test': 'bind_test_drv',
+                          'sandbox,bind-shared': None},
+                         plat._compat_to_driver)
+
+        # Without a configuration, all drivers are used
+        plat = dtb_platdata.DtbPlatdata(dtb_file, False, src_dir)
+        plat.scan_drivers()
+        self.assertEqual({'sandbox,bind-test': 'bind_test_drv',
+                          'sandbox,bind-shared': None},
+                         plat._compat_to_driver)
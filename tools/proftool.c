@@ -21,6 +21,7 @@
 #include <trace.h>
 
 #define MAX_LINE_LEN 500
+#define MAX_CALL_DEPTH 500
 
 enum {
 	FUNCF_TRACE	= 1 << 0,	/* Include this function in trace */
@@ -31,6 +32,8 @@ struct func_info {
 	const char *name;
 	unsigned long code_size;
 	unsigned long call_count;
+	unsigned long long incl_us;	/* time including called functions */
+	unsigned long long excl_us;	/* time excluding called functions */
 	unsigned flags;
 	/* the section this function is in */
 	struct objsection_info *objsection;
@@ -55,6 +58,8 @@ struct func_info *func_list;
 int func_count;
 struct trace_call *call_list;
 int call_count;
+struct trace_output_agg *agg_list;
+int agg_count;
 int verbose;	/* Verbosity level 0=none, 1=warn, 2=notice, 3=info, 4=debug */
 unsigned long text_offset;		/* text address of first function */
 
@@ -85,6 +90,8 @@ static void usage(void)
 		"\n"
 		"Commands\n"
 		"   dump-ftrace\t\tDump out textual data in ftrace format\n"
+		"   dump-funcs\t\tDump out call counts and time for each "
+			"function\n"
 		"\n"
 		"Options:\n"
 		"   -m <map>\tSpecify Systen.map file\n"
@@ -226,6 +233,118 @@ static int read_calls(FILE *fin, size_t count)
 	return 0;
 }
 
+static int add_call(struct trace_call *call, int *alloced)
+{
+	if (call_count == *alloced) {
+		*alloced = *alloced ? *alloced * 2 : 4096;
+		call_list = realloc(call_list, *alloced * sizeof(*call_list));
+		if (!call_list) {
+			error("Cannot allocate call_list\n");
+			return -1;
+		}
+	}
+	call_list[call_count++] = *call;
+
+	return 0;
+}
+
+static int get_uleb128(const unsigned char **ptrp, const unsigned char *end,
+		       unsigned long long *valp)
+{
+	const unsigned char *ptr = *ptrp;
+	unsigned long long val = 0;
+	int shift;
+
+	for (shift = 0; ptr < end && shift < 64; shift += 7) {
+		val |= (unsigned long long)(*ptr & 0x7f) << shift;
+		if (!(*ptr++ & 0x80)) {
+			*ptrp = ptr;
+			*valp = val;
+			return 0;
+		}
+	}
+
+	return -1;
+}
+
+static int32_t unzigzag(unsigned long long val)
+{
+	return (int32_t)((uint32_t)val >> 1) ^ -(int32_t)(val & 1);
+}
+
+/* Decode compact records (see TRACE_CHUNK_COMPACT) into call_list */
+static int read_compact(FILE *fin, size_t size)
+{
+	const unsigned char *ptr, *end;
+	unsigned long long time = 0, val;
+	uint32_t func = 0, caller = 0;
+	struct trace_call call;
+	unsigned char *buff;
+	int alloced = call_count;
+	int type;
+
+	notice("compact size: %zu\n", size);
+	buff = malloc(size);
+	if (!buff) {
+		error("Cannot allocate compact buffer\n");
+		return -1;
+	}
+	if (read_data(fin, buff, size)) {
+		free(buff);
+		return 1;
+	}
+
+	for (ptr = buff, end = buff + size; ptr < end;) {
+		if (get_uleb128(&ptr, end, &val))
+			goto err;
+		type = val & 3;
+		time += val >> 2;
+		if (get_uleb128(&ptr, end, &val))
+			goto err;
+		if ((type << 30) == FUNCF_TEXTBASE) {
+			call.func = val;
+			call.caller = 0;
+			call.flags = FUNCF_TEXTBASE;
+		} else {
+			func += unzigzag(val);
+			if (get_uleb128(&ptr, end, &val))
+				goto err;
+			caller += unzigzag(val);
+			call.func = func * FUNC_SITE_SIZE;
+			call.caller = caller * FUNC_SITE_SIZE;
+			call.flags = (type << 30) |
+				(time & FUNCF_TIMESTAMP_MASK);
+		}
+		if (add_call(&call, &alloced)) {
+			free(buff);
+			return -1;
+		}
+	}
+	notice("call count: %d\n", call_count);
+	free(buff);
+
+	return 0;
+
+err:
+	error("Invalid compact record at offset %ld\n",
+	      (long)(ptr - (const unsigned char *)buff));
+	free(buff);
+	return 1;
+}
+
+static int read_aggregate(FILE *fin, size_t count)
+{
+	notice("aggregated function count: %zu\n", count);
+	agg_list = calloc(count, sizeof(*agg_list));
+	if (!agg_list) {
+		error("Cannot allocate agg_list\n");
+		return -1;
+	}
+	agg_count = count;
+
+	return read_data(fin, agg_list, count * sizeof(*agg_list));
+}
+
 static int read_profile(FILE *fin, int *not_found)
 {
 	struct trace_output_hdr hdr;
@@ -249,6 +368,16 @@ static int read_profile(FILE *fin, int *not_found)
 			if (read_calls(fin, hdr.rec_count))
 				return 1;
 			break;
+
+		case TRACE_CHUNK_COMPACT:
+			if (read_compact(fin, hdr.rec_count))
+				return 1;
+			break;
+
+		case TRACE_CHUNK_AGGREGATE:
+			if (read_aggregate(fin, hdr.rec_count))
+				return 1;
+			break;
 		}
 	}
 	return 0;
@@ -532,6 +661,107 @@ static int make_ftrace(void)
 	return 0;
 }
 
+/* Add up the time spent in each function from the list of calls */
+static void aggregate_calls(void)
+{
+	struct {
+		struct func_info *func;
+		unsigned long start;
+		unsigned long long child_us;
+	} stack[MAX_CALL_DEPTH];
+	struct trace_call *call;
+	int depth = 0;
+	int i;
+
+	for (i = 0, call = call_list; i < call_count; i++, call++) {
+		unsigned long time = call->flags & FUNCF_TIMESTAMP_MASK;
+		unsigned long elapsed;
+
+		if (TRACE_CALL_TYPE(call) == FUNCF_ENTRY) {
+			if (depth < MAX_CALL_DEPTH) {
+				stack[depth].func = find_func_by_offset(
+							call->func);
+				stack[depth].start = time;
+				stack[depth].child_us = 0;
+			}
+			depth++;
+		} else if (TRACE_CALL_TYPE(call) == FUNCF_EXIT && depth) {
+			if (--depth >= MAX_CALL_DEPTH || !stack[depth].func)
+				continue;
+			elapsed = (time - stack[depth].start) &
+				FUNCF_TIMESTAMP_MASK;
+			stack[depth].func->call_count++;
+			stack[depth].func->incl_us += elapsed;
+			if (elapsed > stack[depth].child_us)
+				stack[depth].func->excl_us += elapsed -
+					stack[depth].child_us;
+			if (depth)
+				stack[depth - 1].child_us += elapsed;
+		}
+	}
+}
+
+static int h_cmp_excl(const void *v1, const void *v2)
+{
+	const struct func_info *f1 = *(struct func_info **)v1;
+	const struct func_info *f2 = *(struct func_info **)v2;
+
+	if (f1->excl_us != f2->excl_us)
+		return f1->excl_us < f2->excl_us ? 1 : -1;
+
+	return f1->call_count < f2->call_count ? 1 :
+		f1->call_count > f2->call_count ? -1 : 0;
+}
+
+/* Show the call count and time for each function, most expensive first */
+static int make_funcs(void)
+{
+	struct func_info **list, *func;
+	int missing_count = 0;
+	int count, i;
+
+	if (agg_list) {
+		for (i = 0; i < agg_count; i++) {
+			func = find_func_by_offset(agg_list[i].offset);
+			if (!func) {
+				warn("Cannot find function at %lx\n",
+				     text_offset + agg_list[i].offset);
+				missing_count++;
+				continue;
+			}
+			func->call_count += agg_list[i].call_count;
+			func->incl_us += agg_list[i].incl_us;
+			func->excl_us += agg_list[i].excl_us;
+		}
+	} else {
+		aggregate_calls();
+	}
+
+	list = calloc(func_count, sizeof(*list));
+	if (!list) {
+		error("Cannot allocate function list\n");
+		return -1;
+	}
+	for (i = count = 0; i < func_count; i++) {
+		func = &func_list[i];
+		if (func->call_count && (func->flags & FUNCF_TRACE))
+			list[count++] = func;
+	}
+	qsort(list, count, sizeof(*list), h_cmp_excl);
+
+	printf("%10s %15s %15s  %s\n", "Calls", "Inclusive us", "Exclusive us",
+	       "Function");
+	for (i = 0; i < count; i++) {
+		func = list[i];
+		printf("%10lu %15llu %15llu  %s\n", func->call_count,
+		       func->incl_us, func->excl_us, func->name);
+	}
+	info("funcs: %d functions not found\n", missing_count);
+	free(list);
+
+	return 0;
+}
+
 static int prof_tool(int argc, char * const argv[],
 		     const char *prof_fname, const char *map_fname,
 		     const char *trace_config_fname)
@@ -552,6 +782,8 @@ static int prof_tool(int argc, char * const argv[],
 
 		if (0 == strcmp(cmd, "dump-ftrace"))
 			err = make_ftrace();
+		else if (0 == strcmp(cmd, "dump-funcs"))
+			err = make_funcs();
 		else
 			warn("Unknown command '%s'\n", cmd);
 	}